@@ -0,0 +1,85 @@
+/**
+ * @file bounds.h
+ * @author green
+ * @date 10/16/2026
+ * @brief Bounding boxes and spheres accumulated as points arrive.
+ * A point costs two SIMD comparisons against the box so far; only points
+ * that extend it touch anything else. Besides the box, the first points with
+ * the least and greatest x, y and z are kept, from which Ritter's method
+ * grows a bounding sphere in one more pass over the points.
+ */
+#ifndef BOUNDS_H_INCLUDED
+#define BOUNDS_H_INCLUDED
+
+#include <stdint.h>
+
+/** @struct bounds_t
+ * @brief The bounds of the points seen so far. A zeroed bounds_t is empty.
+ */
+typedef struct {
+	/** The least and greatest of every component, up to four. Components a
+	 * point lacks are 0. Infinite while there are no points. */
+	float lower[4];
+	float upper[4];
+	/** The first points with the least x, greatest x, least y, and so on. */
+	float extremes[6][3];
+	uint32_t count;
+} bounds_t;
+
+/** @brief Empties the bounds.
+ * @param bounds The bounds.
+ */
+void
+bounds_init(bounds_t* bounds);
+
+/** @brief Extends the bounds with a point.
+ * @param bounds The bounds.
+ * @param point The point. Components past the fourth are ignored.
+ * @param dim The number of components of the point.
+ */
+void
+bounds_add(bounds_t* bounds, const float* point, uint32_t dim);
+
+/** @brief Extends a box, without extreme points, with a point.
+ * @param lower The least of every component so far, or infinity.
+ * @param upper The greatest of every component so far, or -infinity.
+ * @param point The point.
+ * @param dim The number of components of the point.
+ */
+void
+bounds_extend(float lower[4],
+	float upper[4],
+	const float* point,
+	uint32_t dim);
+
+/** @brief Extends the bounds with those of points that came after its own.
+ * Ties keep the earlier extreme points, so merging the bounds of consecutive
+ * runs of points gives the bounds of the whole.
+ * @param bounds The bounds.
+ * @param later The bounds of the later points.
+ */
+void
+bounds_merge(bounds_t* bounds, const bounds_t* later);
+
+/** @brief Grows a bounding sphere with Ritter's method: from the pair of
+ * extreme points along x, y or z furthest apart, enlarging the sphere just
+ * enough for every point outside it in turn. The same pass finds the sphere
+ * about the center of the box, and the smaller of the two is kept. Within a
+ * few percent of the smallest sphere for typical meshes.
+ * @param bounds The bounds of the points.
+ * @param points The points, dim floats each.
+ * @param count The number of points.
+ * @param dim The number of components of every point. Only the first three
+ * are used; missing ones are 0.
+ * @param center Output center. 0 if there are no points.
+ * @param radius Output radius. 0 if there are no points.
+ */
+void
+bounds_sphere(const bounds_t* bounds,
+	const float* points,
+	uint32_t count,
+	uint32_t dim,
+	float center[3],
+	float* radius);
+
+#endif
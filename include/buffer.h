@@ -19,6 +19,13 @@ typedef struct {
 	unsigned int length;
 } buffer_t;
 
+/** Converts the buffer, which must hold one number and nothing else, to a 
+ * float. Independent of the locale; see fastfloat_parse.
+ * @param src The buffer.
+ * @param dest Receives the value. Left untouched on failure.
+ * @return SUCCESS, or PARSING_FAILURE if the buffer does not hold exactly a 
+ * number, such as "1.0x" or "1e".
+ */
 int
 buffer_get_float(buffer_t src, float* dest);
 int 
@@ -29,5 +36,12 @@ int
 buffer_get_str(buffer_t src, char* dest);
 int 
 buffer_cmp(buffer_t src, char* str);
+/** Compares the whole buffer against a C-string.
+ * @param src The buffer.
+ * @param str The string.
+ * @return 1 if the buffer holds exactly the string, 0 otherwise.
+ */
+int 
+buffer_equ(buffer_t src, const char* str);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,137 @@
+/**
+ * @file bvh.h
+ * @author green
+ * @date 10/16/2026
+ * @brief Bounding volume hierarchies for casting rays against a mesh.
+ * The reflection and refraction of illum models 3 to 8 trace rays into the
+ * scene. A bounding volume hierarchy lets a ray skip every triangle whose
+ * box it misses. The hierarchy is built top-down with the surface area
+ * heuristic over up to sixteen bins per axis, and stored depth first in
+ * 32-byte nodes, the first child right after its parent. The largest nodes are
+ * binned across threads and the subtrees under them built in parallel; the
+ * tree does not depend on the thread count.
+ */
+#ifndef BVH_H_INCLUDED
+#define BVH_H_INCLUDED
+
+#include <stdint.h>
+#include "obj.h"
+
+/** The number of bins along each axis when choosing a split. */
+#define BVH_BINS 16
+
+/** The most triangles a leaf holds unless its triangles cannot be told
+ * apart. */
+#define BVH_MAX_LEAF 8
+
+/** The deepest a node can be; deeper spans become leaves. Also the size of
+ * the traversal stack. */
+#define BVH_MAX_DEPTH 64
+
+/** @struct bvh_node_t
+ * @brief One node: the box of its triangles and where its children or
+ * triangles are. 32 bytes.
+ */
+typedef struct {
+	float lower[3];
+	/** For an inner node, the index of its second child; the first is the
+	 * next node. For a leaf, its first triangle. */
+	uint32_t offset;
+	float upper[3];
+	/** The number of triangles of a leaf, 0 for an inner node. */
+	uint32_t count;
+} bvh_node_t;
+
+/** @struct bvh_t
+ * @brief A hierarchy and the triangles of its leaves, in leaf order.
+ */
+typedef struct {
+	bvh_node_t* nodes;
+	uint32_t num_nodes;
+	/** The depth of the deepest node; the root is at 0. */
+	uint32_t depth;
+	/** The face of every triangle. */
+	uint32_t* faces;
+	/** The three corner positions of every triangle, nine floats each. */
+	float* vertices;
+	uint32_t num_triangles;
+} bvh_t;
+
+/** @struct bvh_ray_t
+ * @brief The points origin + t * direction for t in [t_min, t_max].
+ */
+typedef struct {
+	float origin[3];
+	/** Need not be of unit length; t is in its lengths. */
+	float direction[3];
+	float t_min;
+	float t_max;
+} bvh_ray_t;
+
+/** @struct bvh_hit_t
+ * @brief Where a ray meets a triangle.
+ */
+typedef struct {
+	float t;
+	/** The barycentric coordinates of the hit for the second and third
+	 * corners of the face. */
+	float u;
+	float v;
+	uint32_t face;
+} bvh_hit_t;
+
+/** @brief Builds the hierarchy of the triangles of a mesh.
+ * @param mesh The mesh, read with OBJ_TRIANGULATE, with at least three
+ * position components. Only the first three are used.
+ * @param num_threads The number of threads to use, or 0 for one per
+ * processor.
+ * @param out Output hierarchy. Zeroed on failure.
+ * @return [SUCCESS, INVALID_DIMS if a face is not a triangle or there are
+ * fewer than three position components, MEMORY_REFUSED]
+ */
+int
+bvh_build(const mesh_t* mesh, uint32_t num_threads, bvh_t* out);
+
+/** @brief Finds the first triangle along a ray. Triangles are hit from either
+ * side.
+ * @param bvh The hierarchy.
+ * @param ray The ray.
+ * @param hit Output hit, with the least t. Untouched if there is none.
+ * @return 1 if the ray hits a triangle, 0 otherwise.
+ */
+int
+bvh_closest_hit(const bvh_t* bvh, const bvh_ray_t* ray, bvh_hit_t* hit);
+
+/** @brief Tests whether a ray hits any triangle, stopping at the first one
+ * found, as for shadow rays.
+ * @param bvh The hierarchy.
+ * @param ray The ray.
+ * @return 1 if the ray hits a triangle, 0 otherwise.
+ */
+int
+bvh_any_hit(const bvh_t* bvh, const bvh_ray_t* ray);
+
+/** @brief Makes the ray along a segment, with t from 0 at one end to 1 at the
+ * other.
+ * @param from The start of the segment.
+ * @param to The end of the segment.
+ * @param ray Output ray.
+ */
+static inline void bvh_segment(const float from[3],
+	const float to[3],
+	bvh_ray_t* ray) {
+	for (int k = 0; k < 3; k++) {
+		ray->origin[k] = from[k];
+		ray->direction[k] = to[k] - from[k];
+	}
+	ray->t_min = 0.0f;
+	ray->t_max = 1.0f;
+}
+
+/** @brief Frees the arrays of a hierarchy.
+ * @param bvh The hierarchy.
+ */
+void
+bvh_destroy(bvh_t* bvh);
+
+#endif
@@ -0,0 +1,94 @@
+/**
+ * @file classify.h
+ * @author green
+ * @date 10/16/2026
+ * @brief Bulk classification of .obj lines.
+ * Counts the vertex, texture, normal, face and object lines of a file in one
+ * sweep, without tokenizing any line, so the arrays of a mesh can be sized 
+ * before it is parsed. The sweep finds the newlines 16 (SSE2) or 32 (AVX2) 
+ * bytes at a time and tests the first bytes of every line it finds. The 
+ * kernel is chosen at runtime from the processor's CPUID feature bits, with a
+ * portable scalar kernel for every other processor.
+ */
+#ifndef CLASSIFY_H_INCLUDED
+#define CLASSIFY_H_INCLUDED
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/** @enum classify_kernel_t
+ * @brief The implementations of the classifier.
+ */
+typedef enum {
+	/** The fastest kernel the processor supports. */
+	CLASSIFY_AUTO,
+	CLASSIFY_SCALAR,
+	CLASSIFY_SSE2,
+	CLASSIFY_AVX2
+} classify_kernel_t;
+
+/** @struct line_counts_t
+ * @brief The number of lines of each type. A line's type is its first token,
+ * which must start the line and be followed by a space or tab.
+ */
+typedef struct {
+	uint32_t lines;
+	uint32_t vertices;
+	uint32_t textures;
+	uint32_t normals;
+	uint32_t faces;
+	uint32_t objects;
+} line_counts_t;
+
+/** @struct line_index_t
+ * @brief The offset of the first byte of every line.
+ */
+typedef struct {
+	size_t* starts;
+	uint32_t count;
+	uint32_t capacity;
+} line_index_t;
+
+/** @brief Gets the kernel CLASSIFY_AUTO runs on this processor.
+ * @return CLASSIFY_AVX2, CLASSIFY_SSE2 or CLASSIFY_SCALAR.
+ */
+classify_kernel_t
+classify_best(void);
+
+/** @brief Gets the name of a kernel.
+ * @param kernel The kernel.
+ * @return "auto", "scalar", "sse2" or "avx2".
+ */
+const char*
+classify_name(classify_kernel_t kernel);
+
+/** @brief Counts the lines of each type in a block of memory.
+ * @param data The lines. Need not be NUL-terminated.
+ * @param size The number of bytes of data.
+ * @param kernel The kernel to use. Kernels the processor does not support 
+ * fall back to the best one it does.
+ * @param counts Output counts.
+ * @param index Output line starts, or NULL if they are not needed. Must be 
+ * zero-initialized or hold a previous index; free starts when done.
+ * @return [SUCCESS, MEMORY_REFUSED]
+ */
+int
+classify_lines(const char* data, 
+	size_t size, 
+	classify_kernel_t kernel, 
+	line_counts_t* counts, 
+	line_index_t* index);
+
+/** @brief Counts the lines of each type in a file, from its current position
+ * to its end, reading it in fixed-size blocks.
+ * @param file The opened file.
+ * @param counts Output counts.
+ * @param index Output line starts, relative to the starting position, or NULL 
+ * if they are not needed. Same requirements as for classify_lines.
+ * @return [SUCCESS, INVALID_FILE, MEMORY_REFUSED]
+ */
+int
+classify_file(FILE* file, line_counts_t* counts, line_index_t* index);
+
+#endif
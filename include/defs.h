@@ -55,7 +55,8 @@ enum return_codes {
     INVALID_FILE,
     INVALID_DIMS,
 	PARSING_FAILURE,
-    NOT_FOUND
+    NOT_FOUND,
+    INDEX_OUT_OF_RANGE
 };
 
 /** Prints a readable description of a given return code.
@@ -78,6 +79,8 @@ static inline char* errstr(int return_code) {
 			return "Improperly formatted text structure";
 		case NOT_FOUND:
 			return "Desired element could not be found";
+		case INDEX_OUT_OF_RANGE:
+			return "Index refers to an element that does not exist";
         default: break;
     }
     return "Undefined";
@@ -0,0 +1,31 @@
+/**
+ * @file fastfloat.h
+ * @author green
+ * @date 10/16/2026
+ * @brief Locale-independent conversion of decimal text to single-precision 
+ * floats. Correctly rounded (round-half-to-even), like strtof in the "C" 
+ * locale, without copying or NUL-terminating the input.
+ */
+#ifndef FASTFLOAT_H_INCLUDED
+#define FASTFLOAT_H_INCLUDED
+
+/** Parses the longest prefix of a character range that forms a decimal 
+ * floating-point number: an optional sign, digits with an optional '.' 
+ * separator, and an optional exponent. "inf", "infinity" and "nan" are 
+ * accepted in any case.
+ * 
+ * Most inputs are converted by a short exact path or by the Eisel-Lemire 
+ * algorithm (one 64x128-bit multiplication). The rare inputs those cannot 
+ * decide are converted exactly with arbitrary-precision decimal arithmetic.
+ * 
+ * @param first The first character.
+ * @param last One past the last character. The range need not be 
+ * NUL-terminated.
+ * @param dest Receives the value. Left untouched on failure.
+ * @returns One past the last character of the number, or NULL if the range 
+ * does not start with a number.
+ */
+const char* 
+fastfloat_parse(const char* first, const char* last, float* dest);
+
+#endif
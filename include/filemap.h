@@ -0,0 +1,41 @@
+/**
+ * @file filemap.h
+ * @author green
+ * @date 10/16/2026
+ * @brief Read-only views of whole files.
+ * Maps a file into memory so it can be parsed in place. On POSIX systems the
+ * file is memory-mapped, so a page-cache resident file is read without any 
+ * copies or read() calls. Elsewhere the file is read into a heap buffer.
+ */
+#ifndef FILEMAP_H_INCLUDED
+#define FILEMAP_H_INCLUDED
+
+#include <stddef.h>
+
+/** @struct filemap_t
+ * @brief A read-only view of a whole file.
+ */
+typedef struct {
+	/** The file contents. Not NUL-terminated. NULL for an empty file. */
+	const char* data;
+	/** The number of bytes in the file. */
+	size_t size;
+	/** 1 if data is a memory mapping, 0 if it is a heap buffer. */
+	int mapped;
+} filemap_t;
+
+/** @brief Maps the file at the provided filename.
+ * @param fn Filename of the file.
+ * @param map Output view of the file.
+ * @return [SUCCESS, INVALID_FILE, MEMORY_REFUSED]
+ */
+int
+filemap_open(const char* fn, filemap_t* map);
+
+/** @brief Releases the view of a file.
+ * @param map The view of the file.
+ */
+void
+filemap_close(filemap_t* map);
+
+#endif
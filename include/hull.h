@@ -0,0 +1,50 @@
+/**
+ * @file hull.h
+ * @author green
+ * @date 10/16/2026
+ * @brief Convex hulls of meshes and convexity tests.
+ * Hulls are found with quickhull: a tetrahedron of extreme points is grown
+ * one point at a time, always the point furthest outside some face, whose
+ * visible faces are replaced by a fan to their horizon. Every point waits in
+ * a list threaded through one array, in the face it is furthest outside of,
+ * so no point costs an allocation. Assigning the points to the tetrahedron's
+ * faces, which touches every point, is split across threads; the hull does
+ * not depend on the thread count.
+ */
+#ifndef HULL_H_INCLUDED
+#define HULL_H_INCLUDED
+
+#include <stdint.h>
+#include "obj.h"
+
+/** @brief Finds the convex hull of the positions of a mesh.
+ * Every position counts, whether or not a face uses it. Points within a
+ * small tolerance of the hull, scaled to the coordinates, are left inside.
+ * @param mesh The mesh, with at least three position components. Only the
+ * first three are used.
+ * @param num_threads The number of threads to use, or 0 for one per
+ * processor.
+ * @param out Output hull: its vertices, in the order of the positions they
+ * come from, with three components, and its triangles, wound
+ * counterclockwise seen from outside. Has bounds but no normals, texture
+ * coordinates, ranges or name. Initialized even on failure.
+ * @return [SUCCESS, INVALID_DIMS if there are fewer than three components or
+ * the positions are coplanar, MEMORY_REFUSED]
+ */
+int
+hull_build(const mesh_t* mesh, uint32_t num_threads, mesh_t* out);
+
+/** @brief Tests whether a mesh is the surface of a convex solid: closed, with
+ * every edge shared by two faces wound against each other, the faces of
+ * every edge bending outward, and the mean of its vertices behind every
+ * face. Most meshes that are not convex fail in one pass over the corners;
+ * the rest also sort the edges. Faces that share an edge must share its
+ * position indices.
+ * @param mesh The mesh, with at least three position components.
+ * @return 1 if the mesh is convex, 0 otherwise, including when it has no
+ * faces or fewer than three components.
+ */
+int
+obj_is_convex(const mesh_t* mesh);
+
+#endif
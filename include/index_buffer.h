@@ -0,0 +1,81 @@
+/**
+ * @file index_buffer.h
+ * @author green
+ * @date 10/16/2026
+ * @brief Index buffers of the narrowest width that holds every vertex.
+ * Meshes of fewer than 65536 vertices, which covers most props, get 16-bit 
+ * indices at half the memory of 32-bit ones; 0xFFFF stays free as the 
+ * primitive restart index. The chosen width is reported so 
+ * the caller can bind the matching GPU index type.
+ */
+#ifndef INDEX_BUFFER_H_INCLUDED
+#define INDEX_BUFFER_H_INCLUDED
+
+#include <stdint.h>
+#include "obj.h"
+#include "weld.h"
+
+/** @struct index_buffer_t
+ * @brief 0-based indices of one width.
+ */
+typedef struct {
+	/** uint16_t indices if width is 2, uint32_t indices if it is 4. */
+	void* data;
+	uint32_t count;
+	/** The number of bytes per index: 2 or 4. */
+	uint32_t width;
+} index_buffer_t;
+
+/** @brief Copies indices into a buffer of the narrowest width that holds 
+ * every vertex: 16 bits for fewer than 65536 vertices, so that no index is
+ * the primitive restart value 0xFFFF, and 32 bits otherwise.
+ * @param indices The indices.
+ * @param count The number of indices.
+ * @param num_vertices The number of vertices the indices refer to.
+ * @param base Subtracted from every index: 1 for the mesh's 1-based face
+ * indices, 0 for indices that are already 0-based.
+ * @param out Output buffer. Zeroed on failure.
+ * @return [SUCCESS, MEMORY_REFUSED]
+ */
+int
+index_buffer_build(const uint32_t* indices, 
+	uint32_t count, 
+	uint32_t num_vertices, 
+	uint32_t base,
+	index_buffer_t* out);
+
+/** @brief Builds the index buffer of a welded mesh.
+ * @param weld The welded mesh.
+ * @param out Output buffer. Zeroed on failure.
+ * @return [SUCCESS, MEMORY_REFUSED]
+ */
+int
+index_buffer_from_weld(const weld_t* weld, index_buffer_t* out);
+
+/** @brief Builds an index buffer from the position indices of a mesh, which
+ * form a triangle list when it was read with OBJ_TRIANGULATE.
+ * @param mesh The mesh.
+ * @param out Output buffer. Zeroed on failure.
+ * @return [SUCCESS, MEMORY_REFUSED]
+ */
+int
+index_buffer_from_mesh(const mesh_t* mesh, index_buffer_t* out);
+
+/** @brief Gets one index of a buffer of either width.
+ * @param buffer The buffer.
+ * @param i The position of the index.
+ * @return The index.
+ */
+static inline uint32_t
+index_buffer_get(const index_buffer_t* buffer, uint32_t i) {
+	return buffer->width == 2 ? ((const uint16_t*)buffer->data)[i] 
+		: ((const uint32_t*)buffer->data)[i];
+}
+
+/** @brief Frees an index buffer.
+ * @param buffer The buffer.
+ */
+void
+index_buffer_destroy(index_buffer_t* buffer);
+
+#endif
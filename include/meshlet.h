@@ -0,0 +1,115 @@
+/**
+ * @file meshlet.h
+ * @author green
+ * @date 10/16/2026
+ * @brief Partitioning triangle lists into meshlets for batched culling.
+ * A meshlet is a small cluster of neighbouring triangles with its own short
+ * vertex list, a bounding sphere and a cone bounding its normals. A culling
+ * pass can reject a whole meshlet that is off screen or faces away from the
+ * camera with one test, instead of testing every face. Meshlets are grown
+ * across shared vertices from seeds taken in Morton order, so they stay
+ * compact and neighbouring meshlets lie close together.
+ */
+#ifndef MESHLET_H_INCLUDED
+#define MESHLET_H_INCLUDED
+
+#include <stdint.h>
+#include <math.h>
+
+/** The default largest number of vertices of a meshlet. */
+#define MESHLET_MAX_VERTICES 64
+
+/** The default largest number of triangles of a meshlet. */
+#define MESHLET_MAX_TRIANGLES 124
+
+/** @struct meshlet_t
+ * @brief One meshlet: where its vertices and triangles start in the arrays
+ * of its meshlets_t, and its bounds.
+ */
+typedef struct {
+	uint32_t vertex_offset;
+	uint32_t triangle_offset;
+	uint32_t vertex_count;
+	uint32_t triangle_count;
+	/** The bounding sphere of the vertices. */
+	float center[3];
+	float radius;
+	/** The cone of the triangles' normals: the sine of the largest angle 
+	 * between the axis and a normal is cone_cutoff. The apex places the cone 
+	 * so that meshlet_is_backfacing holds for perspective cameras. 
+	 * cone_cutoff is 1 when the normals spread too far for the meshlet ever
+	 * to face away. */
+	float cone_apex[3];
+	float cone_axis[3];
+	float cone_cutoff;
+} meshlet_t;
+
+/** @struct meshlets_t
+ * @brief Every meshlet of a triangle list, in flat arrays.
+ */
+typedef struct {
+	meshlet_t* meshlets;
+	uint32_t num_meshlets;
+	/** The mesh vertex of every meshlet vertex. */
+	uint32_t* vertices;
+	uint32_t num_vertices;
+	/** Three meshlet vertices per triangle, numbered from 0 within each
+	 * meshlet. */
+	uint8_t* triangles;
+	uint32_t num_triangles;
+} meshlets_t;
+
+/** @brief Partitions a triangle list into meshlets.
+ * @param indices 0-based vertex indices, three per triangle, such as those of
+ * a weld_t read with OBJ_TRIANGULATE.
+ * @param count The number of indices, a multiple of three.
+ * @param vertices stride floats per vertex, starting with the position.
+ * @param stride The number of floats per vertex.
+ * @param dim The number of position components, at most 3 of which are used.
+ * @param num_vertices The number of vertices.
+ * @param max_vertices The largest number of vertices of a meshlet, in
+ * [3, 256]; MESHLET_MAX_VERTICES suits most hardware.
+ * @param max_triangles The largest number of triangles of a meshlet, at
+ * least 1; MESHLET_MAX_TRIANGLES suits most hardware.
+ * @param out Output meshlets. Zeroed on failure.
+ * @return [SUCCESS, INVALID_DIMS if count is not a multiple of three or a
+ * limit is out of range, MEMORY_REFUSED]
+ */
+int
+meshlet_build(const uint32_t* indices,
+	uint32_t count,
+	const float* vertices,
+	uint32_t stride,
+	uint32_t dim,
+	uint32_t num_vertices,
+	uint32_t max_vertices,
+	uint32_t max_triangles,
+	meshlets_t* out);
+
+/** @brief Tests whether every triangle of a meshlet faces away from a
+ * perspective camera, so that back-face culling would drop them all.
+ * @param meshlet The meshlet.
+ * @param camera The position of the camera.
+ * @return 1 if the whole meshlet can be culled, 0 otherwise.
+ */
+static inline int meshlet_is_backfacing(const meshlet_t* meshlet,
+	const float camera[3]) {
+	float d[3];
+	float length = 0.0f;
+	float dot = 0.0f;
+	for (int k = 0; k < 3; k++) {
+		d[k] = meshlet->cone_apex[k] - camera[k];
+		length += d[k] * d[k];
+		dot += d[k] * meshlet->cone_axis[k];
+	}
+	return meshlet->cone_cutoff < 1.0f && length > 0.0f &&
+		dot >= meshlet->cone_cutoff * sqrtf(length);
+}
+
+/** @brief Frees the arrays of a set of meshlets.
+ * @param meshlets The meshlets.
+ */
+void
+meshlets_destroy(meshlets_t* meshlets);
+
+#endif
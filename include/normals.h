@@ -0,0 +1,57 @@
+/**
+ * @file normals.h
+ * @author green
+ * @date 10/16/2026
+ * @brief Generating flat and smooth normals for meshes read without them.
+ * Face normals come from cross products taken four triangles at a time with
+ * SIMD. A smooth normal is the sum of the face normals around a position,
+ * each as long as twice its face's area, so large faces weigh more than
+ * slivers. Positions are split across threads; every position's sums are
+ * taken in corner order, so the result does not depend on the thread count.
+ */
+#ifndef NORMALS_H_INCLUDED
+#define NORMALS_H_INCLUDED
+
+#include <stdint.h>
+#include "obj.h"
+
+/** A crease angle that never splits a smoothing group. */
+#define NORMALS_NO_CREASE 3.14159265f
+
+/** @enum normals_mode
+ * @brief The normals normals_generate gives a mesh.
+ */
+typedef enum normals_mode {
+	/** One normal per face. */
+	NORMALS_FLAT,
+	/** One normal per position and smoothing group, split at creases. */
+	NORMALS_SMOOTH
+} normals_mode;
+
+/** @brief Replaces the normals of a mesh with generated ones.
+ * The mesh's normals, face_norms and views are replaced and norm_flag is set.
+ * With NORMALS_SMOOTH, corners that share a position share a normal when
+ * their faces are in the same nonzero smoothing group (any group when the
+ * mesh has no face_smoothing) and, unless the crease angle is
+ * NORMALS_NO_CREASE, every face contributing to a corner's normal is within
+ * the crease angle of the corner's own face. Faces in group 0 are flat.
+ * Positions are shared by index only, so duplicated positions split the
+ * shading. A degenerate face with no other face to share with gets a zero
+ * normal.
+ * @param mesh The mesh. Its vertex_dim must be at least 3 if it has faces;
+ * further normal components are 0. A mesh without faces is left untouched.
+ * @param mode NORMALS_FLAT or NORMALS_SMOOTH.
+ * @param crease_angle The largest angle, in radians, between two faces that
+ * are smoothed together, or NORMALS_NO_CREASE.
+ * @param num_threads The number of threads to use, or 0 for one per
+ * processor.
+ * @return [SUCCESS, INVALID_DIMS if the mesh has faces and fewer than three
+ * position components, MEMORY_REFUSED]
+ */
+int
+normals_generate(mesh_t* mesh,
+	normals_mode mode,
+	float crease_angle,
+	uint32_t num_threads);
+
+#endif
@@ -37,9 +37,12 @@ typedef struct {
 
 /** @struct face_t
  * @brief Represents a geometric face with a list of indices.
+ * The index arrays point into the mesh's compressed-sparse-row face arrays; 
+ * prefer obj_face_size() and obj_face_indices() and its siblings.
  */
 typedef struct {
-    /* The material this face uses. NULL for nothing. */
+    /* The material this face uses, in the mesh's mtllib. NULL for nothing, 
+    * or if no library defines the material. */
     mtl_t* material;
     /* Array of positional indices. */
     uint32_t* indices;
@@ -49,25 +52,73 @@ typedef struct {
     uint32_t* norms;
 } face_t;
 
+/** @struct obj_range_t
+ * @brief A named run of faces: a "g" group, an "o" object or a "usemtl" 
+ * material. A range starts at its line and ends at the next line of its 
+ * kind. Faces before the first such line are in no range, and a range 
+ * without faces is dropped. With OBJ_TRIANGULATE, the faces are the 
+ * triangles of the faces read.
+ */
+typedef struct {
+    /* The rest of the "o" or "usemtl" line, or the names of the "g" line 
+    * separated by spaces; empty for a "g" line without names. */
+    char* name;
+    /* The material of a "usemtl" range, in the mesh's mtllib; NULL if no 
+    * library defines it, and for groups and objects. */
+    mtl_t* material;
+    /* The faces [first_face, first_face + num_faces). */
+    uint32_t first_face;
+    uint32_t num_faces;
+    /* The bounds of the positions of the faces, as in mesh_t. */
+    float aabb_min[4];
+    float aabb_max[4];
+} obj_range_t;
+
 /** @struct mesh_t
  * @brief Entirely represents a geometric object.
  * Contains a list of vertices, normals, texture coordinates and faces.
  */
 typedef struct {
-    /* The dimension of every face component. */
+    /* The largest number of corners of any face. Faces may mix triangles, 
+    * quads and larger polygons. */
     uint32_t face_dim;
     /* The dimension of every vertex AND normal component. Vertices and normal 
 	vectors have the same dimension. */
     uint32_t vertex_dim;
     /* The dimension of every texture component. */
     uint32_t tex_dim;
-    /* Array of vertex structures. */
+    /* Contiguous vertex positions, vertex_dim floats per vertex. Can be 
+    * uploaded to the GPU as is. */
+    float* positions;
+    /* Contiguous normal vectors, vertex_dim floats per normal. */
+    float* normals;
+    /* Contiguous texture coordinates, tex_dim floats per coordinate. */
+    float* texcoords;
+    /* Array of vertex structures. Each one points into positions. */
     vertex_t* vertex_data;
-    /* Array of normal structures. */
+    /* Array of normal structures. Each one points into normals. */
     normal_t* normal_data;
-    /* Array of texture structures. */
+    /* Array of texture structures. Each one points into texcoords. */
     texture_t* texture_data;
-    /* Array of face structures. */
+    /* Face storage in compressed-sparse-row form. The corners of face i are
+    * [face_offsets[i], face_offsets[i + 1]) in each of the index arrays. 
+    * Holds num_faces + 1 offsets. */
+    uint32_t* face_offsets;
+    /* Position index of every corner, or NULL without pos_flag. */
+    uint32_t* face_indices;
+    /* Texture index of every corner, or NULL without tex_flag. */
+    uint32_t* face_texs;
+    /* Normal index of every corner, or NULL without norm_flag. */
+    uint32_t* face_norms;
+    /* Smoothing group of every face from the "s" lines, 0 for "s off", or 
+    * NULL if the file has no "s" lines. Faces before the first "s" line are 
+    * in group 0. */
+    uint32_t* face_smoothing;
+    /* MikkTSpace tangent of every corner, four floats each: the direction
+    * and the sign of the bitangent. NULL unless read with OBJ_TANGENTS or 
+    * filled by tangents_generate in tangents.h. */
+    float* tangents;
+    /* Array of face structures. Each one points into the face arrays. */
     face_t* face_data;
     /* Number of vertices. */
     uint32_t num_vertices;
@@ -77,9 +128,36 @@ typedef struct {
     uint32_t num_textures;
     /* Number of faces. */
     uint32_t num_faces;
+    /* Number of face corners across every face. */
+    uint32_t num_corners;
+    /* The least and greatest of every position component, up to four; 0 
+    * past vertex_dim and in a mesh without positions. Accumulated with SIMD 
+    * comparisons as the positions are read. */
+    float aabb_min[4];
+    float aabb_max[4];
+    /* A sphere around every position, grown with Ritter's method from the 
+    * extreme positions found while reading; see bounds_sphere in bounds.h. 
+    * Takes one pass over the positions once they are read. */
+    float sphere_center[3];
+    float sphere_radius;
+    /* The "g" groups and "o" objects, in file order, with their bounds. The
+    * bounds are accumulated as the faces are read, except by 
+    * obj_read_parallel, which takes them in one pass across threads once 
+    * the chunks are merged. */
+    obj_range_t* groups;
+    uint32_t num_groups;
+    obj_range_t* objects;
+    uint32_t num_objects;
+    /* The "usemtl" runs of faces, in file order, with their bounds; after 
+    * obj_sort_materials, one range per material. */
+    obj_range_t* materials;
+    uint32_t num_materials;
     /* C-string name of the object. */
     char* name;
-    /* Map of material libraries. */
+    /* The materials of every "mtllib" line, read from the directory of the 
+    * .obj file once it is parsed, or from the working directory when there 
+    * is no file name. Where libraries define a material twice, the first 
+    * wins. Has no map if the file has no "mtllib" lines. */
 	mtllib_t mtllib;
     /* The face flag. Determines what attributes are used in every face 
 	* definition. */
@@ -99,6 +177,89 @@ typedef struct {
     } face_flag;
 } mesh_t;
 
+/** @enum obj_read_flags
+ * @brief Bitflags that configure how a mesh is read.
+ */
+typedef enum obj_read_flags {
+    /* Reads the file in a single pass, growing every array geometrically as 
+    * lines arrive and trimming them once the file ends. Without this flag the 
+    * file is read twice: once to count and size every component, and once to 
+    * parse it. */
+    OBJ_SINGLE_PASS = (1 << 0),
+    /* Splits every face into triangles as it is read, so face_indices, 
+    * face_texs and face_norms hold a flat triangle list and face_dim is 3. A
+    * face of n corners becomes n - 2 triangles with the same winding: a fan 
+    * if it is convex, otherwise ear clipping. Faces of fewer than three 
+    * corners are dropped. obj_read_parallel splits the faces after merging
+    * its chunks. */
+    OBJ_TRIANGULATE = (1 << 1),
+    /* Gives every face one normal, the direction of its area, if the file 
+    * has no normals. The normals are computed across threads once the faces
+    * are read; see normals_generate in normals.h. A mesh with fewer than 
+    * three position components fails with INVALID_DIMS. */
+    OBJ_FLAT_NORMALS = (1 << 2),
+    /* Gives every vertex the area-weighted mean of the normals of its faces,
+    * if the file has no normals. Only faces in the same smoothing group share
+    * a normal, and faces in group 0 ("s off") stay flat; a file without "s" 
+    * lines is smoothed throughout. Takes precedence over OBJ_FLAT_NORMALS. 
+    * normals_generate also takes a crease angle. */
+    OBJ_SMOOTH_NORMALS = (1 << 3),
+    /* Computes the MikkTSpace tangent of every corner into tangents once the
+    * normals are in place, if the file has texture coordinates and normals 
+    * (read or generated); otherwise tangents stays NULL. Implies 
+    * OBJ_TRIANGULATE. */
+    OBJ_TANGENTS = (1 << 4),
+    /* Sorts the faces by material once they are read; see 
+    * obj_sort_materials. */
+    OBJ_SORT_MATERIALS = (1 << 5)
+} obj_read_flags;
+
+/** Gets the number of corners of a face.
+ *
+ * @param mesh The mesh object.
+ * @param face The index of the face.
+ * @return The number of corners of the face.
+ */
+static inline uint32_t obj_face_size(const mesh_t* mesh, uint32_t face) {
+    return mesh->face_offsets[face + 1] - mesh->face_offsets[face];
+}
+
+/** Gets the position indices of a face.
+ *
+ * @param mesh The mesh object.
+ * @param face The index of the face.
+ * @return obj_face_size() position indices, or NULL without pos_flag.
+ */
+static inline const uint32_t* obj_face_indices(const mesh_t* mesh, 
+    uint32_t face) {
+    return mesh->face_indices 
+        ? mesh->face_indices + mesh->face_offsets[face] : NULL;
+}
+
+/** Gets the texture indices of a face.
+ *
+ * @param mesh The mesh object.
+ * @param face The index of the face.
+ * @return obj_face_size() texture indices, or NULL without tex_flag.
+ */
+static inline const uint32_t* obj_face_texs(const mesh_t* mesh, 
+    uint32_t face) {
+    return mesh->face_texs 
+        ? mesh->face_texs + mesh->face_offsets[face] : NULL;
+}
+
+/** Gets the normal indices of a face.
+ *
+ * @param mesh The mesh object.
+ * @param face The index of the face.
+ * @return obj_face_size() normal indices, or NULL without norm_flag.
+ */
+static inline const uint32_t* obj_face_norms(const mesh_t* mesh, 
+    uint32_t face) {
+    return mesh->face_norms 
+        ? mesh->face_norms + mesh->face_offsets[face] : NULL;
+}
+
 /** Prints the object's contents  to standard output.
  *
  * @param data Pointer to the object to print to screen.
@@ -124,6 +285,85 @@ void obj_fwrite(const mesh_t* mesh, const char* fn);
  */
 int obj_read(const char* fn, mesh_t* mesh);
 
+/** Reads a .obj file from the provided filename and stores the relevant data to
+ * a mesh_t object, configured with a set of obj_read_flags. Negative face 
+ * indices are resolved against the elements read so far; an index to an 
+ * element that has not been read yet is out of range.
+ *
+ * @param fn Filename to the .obj file.
+ * @param data Pointer to the stack-allocated mesh object.
+ * @param flags Bitwise OR of obj_read_flags values, or 0 for the default.
+ * @return Can return either: [SUCCESS, INVALID_FILE, INVALID_DIMS, 
+ * PARSING_FAILURE, INDEX_OUT_OF_RANGE, MEMORY_REFUSED].
+ */
+int obj_read_ex(const char* fn, mesh_t* mesh, uint32_t flags);
+
+/** Reads a .obj file by mapping it into memory and parsing the lines in place.
+ * A file resident in the page cache is read without copying any of its lines
+ * and without any read() calls. Always reads in a single pass.
+ *
+ * @param fn Filename to the .obj file.
+ * @param data Pointer to the stack-allocated mesh object.
+ * @return Can return either: [SUCCESS, INVALID_FILE, INVALID_DIMS, 
+ * PARSING_FAILURE, INDEX_OUT_OF_RANGE, MEMORY_REFUSED].
+ */
+int obj_read_mmap(const char* fn, mesh_t* mesh);
+
+/** Reads a .obj file held in memory, such as a blob from an asset database,
+ * in a single pass without copying its lines.
+ *
+ * @param data The file contents. Need not be NUL-terminated.
+ * @param size The number of bytes of data.
+ * @param mesh Pointer to the stack-allocated mesh object.
+ * @return Can return either: [SUCCESS, INVALID_DIMS, PARSING_FAILURE, 
+ * INDEX_OUT_OF_RANGE, MEMORY_REFUSED].
+ */
+int obj_read_memory(const char* data, size_t size, mesh_t* mesh);
+
+/** Reads a .obj file from a descriptor, which need not be seekable: pipes and
+ * sockets work. The input is read once through a fixed-size ring buffer (see 
+ * OBJ_FD_BUFFER_SIZE in parse.h), which bounds the length of a line.
+ *
+ * @param fd The descriptor. Left open.
+ * @param mesh Pointer to the stack-allocated mesh object.
+ * @return Can return either: [SUCCESS, INVALID_FILE, INVALID_DIMS, 
+ * PARSING_FAILURE, INDEX_OUT_OF_RANGE, MEMORY_REFUSED].
+ */
+int obj_read_fd(int fd, mesh_t* mesh);
+
+/** Reads a .obj file across several threads. The mapped file is split into 
+ * newline-aligned chunks which are parsed concurrently into chunk-local 
+ * arrays. A prefix sum over the per-chunk counts then places every chunk into
+ * the final arrays, again in parallel, and relative (negative) face indices 
+ * are fixed up against the counts of the preceding chunks. Small files are 
+ * read on the calling thread.
+ *
+ * @param fn Filename to the .obj file.
+ * @param mesh Pointer to the stack-allocated mesh object.
+ * @param flags Bitwise OR of obj_read_flags values, or 0 for the default.
+ * @param num_threads The number of threads to use, or 0 for one per processor.
+ * @return Can return either: [SUCCESS, INVALID_FILE, INVALID_DIMS, 
+ * PARSING_FAILURE, INDEX_OUT_OF_RANGE, MEMORY_REFUSED].
+ */
+int obj_read_parallel(const char* fn, 
+    mesh_t* mesh, 
+    uint32_t flags, 
+    uint32_t num_threads);
+
+/** Sorts the faces of a mesh by material, so that each material is drawn 
+ * with one range of faces. Materials keep the order they are first used in,
+ * after the faces without one, and faces keep their order within a 
+ * material. The "usemtl" ranges merge into one per material name. Groups and
+ * objects that mix materials split into one range per material they use, 
+ * in the order of their faces. Every per-face and per-corner array moves 
+ * with its faces. Takes one counting sort over the faces.
+ *
+ * @param mesh The mesh object.
+ * @return Can return either: [SUCCESS, MEMORY_REFUSED]. The mesh is 
+ * untouched on failure.
+ */
+int obj_sort_materials(mesh_t* mesh);
+
 /** Initializes all values of the mesh object to 0.
  *
  * @param data Mesh object.
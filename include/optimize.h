@@ -0,0 +1,158 @@
+/**
+ * @file optimize.h
+ * @author green
+ * @date 10/16/2026
+ * @brief Reordering triangle lists and vertices for the GPU's caches.
+ * Scanned meshes list their triangles in scan order, which keeps evicting 
+ * vertices from the post-transform cache before their other triangles are 
+ * drawn. Reordering the triangles with Forsyth's linear-speed algorithm keeps
+ * the vertices of neighbouring triangles in the cache. Afterwards the 
+ * vertices can be renumbered in the order they are first drawn, so fetching 
+ * them walks memory forwards, and the triangles can be clustered so that the
+ * outer surfaces are drawn before those they hide.
+ */
+#ifndef OPTIMIZE_H_INCLUDED
+#define OPTIMIZE_H_INCLUDED
+
+#include <stdint.h>
+
+/** The number of entries of the FIFO cache the triangle order is scored 
+ * against. */
+#define OPTIMIZE_CACHE_SIZE 16
+
+/** The number of entries of the FIFO cache that optimize_vertex_cache 
+ * measures, the size of a typical hardware post-transform cache. */
+#define OPTIMIZE_FIFO_SIZE 16
+
+/** The size of a cache line of the simulated vertex fetch cache, in bytes. 
+ */
+#define OPTIMIZE_FETCH_LINE 64
+
+/** The number of lines of the simulated vertex fetch cache. */
+#define OPTIMIZE_FETCH_LINES 128
+
+/** @struct cache_stats_t
+ * @brief How often a triangle list misses the post-transform cache.
+ */
+typedef struct {
+	/** Average cache miss ratio: vertices transformed per triangle. 3 at 
+	 * worst; about 0.5 at best for large regular meshes. */
+	float acmr;
+	/** Average transform to vertex ratio: vertices transformed per vertex
+	 * used. 1 at best. */
+	float atvr;
+} cache_stats_t;
+
+/** @brief Simulates a FIFO post-transform cache over a triangle list.
+ * @param indices 0-based vertex indices, three per triangle.
+ * @param count The number of indices.
+ * @param num_vertices The number of vertices.
+ * @param cache_size The number of entries of the cache.
+ * @return The miss ratios; both 0 for an empty list or a failed allocation.
+ */
+cache_stats_t
+optimize_cache_stats(const uint32_t* indices, 
+	uint32_t count, 
+	uint32_t num_vertices, 
+	uint32_t cache_size);
+
+/** @brief Reorders the triangles of a list for the post-transform cache. The
+ * triangles are kept whole with their winding, and the vertices are not 
+ * renumbered.
+ * @param indices 0-based vertex indices, three per triangle. Reordered in 
+ * place.
+ * @param count The number of indices, a multiple of three.
+ * @param num_vertices The number of vertices.
+ * @param before Output miss ratios of the original order, measured with an
+ * OPTIMIZE_FIFO_SIZE cache, or NULL.
+ * @param after Output miss ratios of the new order, or NULL.
+ * @return [SUCCESS, INVALID_DIMS if count is not a multiple of three, 
+ * MEMORY_REFUSED]
+ */
+int
+optimize_vertex_cache(uint32_t* indices, 
+	uint32_t count, 
+	uint32_t num_vertices, 
+	cache_stats_t* before, 
+	cache_stats_t* after);
+
+/** @struct fetch_stats_t
+ * @brief How much vertex memory a triangle list fetches.
+ */
+typedef struct {
+	/** The number of bytes fetched from memory. */
+	uint64_t bytes;
+	/** The bytes fetched per byte of vertex used. 1 at best; higher when a 
+	 * line is fetched for part of a vertex or fetched again after eviction.
+	 */
+	float overfetch;
+} fetch_stats_t;
+
+/** @brief Simulates a vertex fetch cache of OPTIMIZE_FETCH_LINES lines of
+ * OPTIMIZE_FETCH_LINE bytes, evicted first in first out, over a triangle list 
+ * drawn from tightly packed vertices.
+ * @param indices 0-based vertex indices.
+ * @param count The number of indices.
+ * @param num_vertices The number of vertices.
+ * @param vertex_size The size of a vertex in bytes.
+ * @return The bytes fetched; all 0 for an empty list or a failed allocation.
+ */
+fetch_stats_t
+optimize_fetch_stats(const uint32_t* indices, 
+	uint32_t count, 
+	uint32_t num_vertices, 
+	uint32_t vertex_size);
+
+/** @brief Renumbers the vertices in the order the indices first use them and
+ * moves them to match, so that drawing fetches vertex memory forwards. Run it
+ * after the triangles have been reordered. Unused vertices move to the end.
+ * First-use order places each vertex next to those first drawn around the 
+ * same time, not next to those drawn with it again later. A list whose 
+ * vertices were already laid out close to draw order, such as rows that the
+ * triangle order sweeps in strips, can therefore fetch a few percent more 
+ * than before. It pays off when the layout is far from draw order.
+ * @param vertices stride floats per vertex. Reordered in place.
+ * @param stride The number of floats per vertex.
+ * @param indices 0-based vertex indices. Renumbered in place.
+ * @param count The number of indices.
+ * @param num_vertices The number of vertices.
+ * @param num_used Output number of vertices the indices use, or NULL.
+ * @return [SUCCESS, MEMORY_REFUSED]
+ */
+int
+optimize_vertex_fetch(float* vertices, 
+	uint32_t stride, 
+	uint32_t* indices, 
+	uint32_t count, 
+	uint32_t num_vertices, 
+	uint32_t* num_used);
+
+/** @brief Reorders a triangle list so that, from most directions, surfaces 
+ * facing outwards are drawn first and hide what is behind them from the 
+ * pixel shader. Run it after optimize_vertex_cache: the list is cut into 
+ * clusters where the cache would restart anyway or where a cluster keeps its 
+ * miss ratio within threshold times that of the surrounding run, and the 
+ * clusters are sorted by how far they face away from the mesh's centroid. 
+ * Clusters are kept whole, so the cache behaves as before within each one.
+ * @param indices 0-based vertex indices, three per triangle. Reordered in 
+ * place.
+ * @param count The number of indices, a multiple of three.
+ * @param vertices stride floats per vertex, starting with the position.
+ * @param stride The number of floats per vertex.
+ * @param dim The number of position components, at most 3 of which are used.
+ * @param num_vertices The number of vertices.
+ * @param threshold How much the cache miss ratio may grow for smaller 
+ * clusters, at least 1. 1.05 is a good start.
+ * @return [SUCCESS, INVALID_DIMS if count is not a multiple of three, 
+ * MEMORY_REFUSED]
+ */
+int
+optimize_overdraw(uint32_t* indices, 
+	uint32_t count, 
+	const float* vertices, 
+	uint32_t stride, 
+	uint32_t dim, 
+	uint32_t num_vertices, 
+	float threshold);
+
+#endif
@@ -0,0 +1,110 @@
+/**
+ * @file pack.h
+ * @author green
+ * @date 10/16/2026
+ * @brief Packing vertex attributes into caller-described interleaved buffers.
+ * A layout lists which attributes a vertex holds, where each one sits and how
+ * its components are stored, e.g. position, normal and texture coordinate in
+ * 32 bytes, or only the position for a depth pass. Every attribute is packed
+ * for all vertices in one strided loop.
+ */
+#ifndef PACK_H_INCLUDED
+#define PACK_H_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+#include "obj.h"
+#include "weld.h"
+
+/** @enum pack_attribute_t
+ * @brief The attributes of a vertex.
+ */
+typedef enum {
+	PACK_POSITION,
+	PACK_TEXCOORD,
+	PACK_NORMAL,
+	/** The tangent and the sign of the bitangent; see tangents.h. */
+	PACK_TANGENT
+} pack_attribute_t;
+
+/** @enum pack_type_t
+ * @brief How a component is stored. The normalized integer types clamp to 
+ * [-1, 1] (signed) or [0, 1] (unsigned) and round to nearest.
+ */
+typedef enum {
+	PACK_FLOAT32,
+	PACK_FLOAT16,
+	PACK_SNORM16,
+	PACK_UNORM16,
+	PACK_SNORM8,
+	PACK_UNORM8
+} pack_type_t;
+
+/** @struct pack_element_t
+ * @brief One attribute of a vertex in a layout.
+ */
+typedef struct {
+	pack_attribute_t attribute;
+	pack_type_t type;
+	/** The number of components to write, 1 to 4. Components the mesh does 
+	 * not have are written as 0, except a fourth position component, which 
+	 * is 1. */
+	uint32_t components;
+	/** The byte offset of the attribute within a vertex. */
+	uint32_t offset;
+} pack_element_t;
+
+/** @struct pack_layout_t
+ * @brief The layout of one interleaved vertex.
+ */
+typedef struct {
+	const pack_element_t* elements;
+	uint32_t num_elements;
+	/** The number of bytes from one vertex to the next. */
+	uint32_t stride;
+} pack_layout_t;
+
+/** @brief Gets the number of bytes of one component of a type.
+ * @param type The type.
+ * @return 4, 2 or 1.
+ */
+uint32_t
+pack_type_size(pack_type_t type);
+
+/** @brief Converts a float to an IEEE 754 half-precision float, rounding to
+ * nearest even.
+ * @param value The float.
+ * @return The bits of the half.
+ */
+uint16_t
+pack_half(float value);
+
+/** @brief Converts an IEEE 754 half-precision float to a float. Exact.
+ * @param half The bits of the half.
+ * @return The float.
+ */
+float
+pack_unhalf(uint16_t half);
+
+/** @brief Packs one vertex per welded vertex into an interleaved buffer.
+ * @param weld The welded vertices.
+ * @param layout The layout of a vertex.
+ * @param dest The buffer. Holds weld->num_vertices * layout->stride bytes.
+ * @return [SUCCESS, INVALID_DIMS if an element does not fit in the stride or
+ * has 0 or more than 4 components, NOT_FOUND if the weld lacks an attribute]
+ */
+int
+pack_weld(const weld_t* weld, const pack_layout_t* layout, void* dest);
+
+/** @brief Packs one vertex per face corner, for drawing without indices, into
+ * an interleaved buffer.
+ * @param mesh The mesh.
+ * @param layout The layout of a vertex.
+ * @param dest The buffer. Holds mesh->num_corners * layout->stride bytes.
+ * @return [SUCCESS, INVALID_DIMS if an element does not fit in the stride or
+ * has 0 or more than 4 components, NOT_FOUND if the mesh lacks an attribute]
+ */
+int
+pack_corners(const mesh_t* mesh, const pack_layout_t* layout, void* dest);
+
+#endif
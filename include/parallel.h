@@ -0,0 +1,46 @@
+/**
+ * @file parallel.h
+ * @author green
+ * @date 10/16/2026
+ * @brief A minimal fork-join helper for splitting work across threads.
+ * Uses POSIX threads where available. Builds without them (Windows, or with 
+ * OBJ_NO_THREADS defined) run every task on the calling thread.
+ */
+#ifndef PARALLEL_H_INCLUDED
+#define PARALLEL_H_INCLUDED
+
+#include <stdint.h>
+
+/** The largest number of threads parallel_for will start. */
+#define MAX_THREADS 64
+
+/** A task run by parallel_for.
+ * @param ctx The context passed to parallel_for.
+ * @param task The index of the task, in [0, num_tasks).
+ */
+typedef void (*parallel_task_t)(void* ctx, uint32_t task);
+
+/** @brief Gets the number of threads worth starting on this machine.
+ * @return The number of online processors, at least 1 and at most MAX_THREADS.
+ */
+uint32_t
+parallel_threads(void);
+
+/** @brief Runs num_tasks tasks across up to num_threads threads and waits for 
+ * all of them to finish.
+ * Tasks are handed out in order; the calling thread runs tasks as well. 
+ * @param num_tasks The number of tasks.
+ * @param num_threads The number of threads to use, or 0 for 
+ * parallel_threads().
+ * @param task The task function.
+ * @param ctx The context passed to every task.
+ * @return [SUCCESS]. Falls back to running tasks on the calling thread if 
+ * threads cannot be started.
+ */
+int
+parallel_for(uint32_t num_tasks, 
+	uint32_t num_threads, 
+	parallel_task_t task, 
+	void* ctx);
+
+#endif
@@ -0,0 +1,195 @@
+/**
+ * @file parse.h
+ * @author green
+ * @date 10/16/2026
+ * @brief Streaming (SAX-style) parsing of .obj files.
+ * The parser calls a set of user callbacks once per directive with the values
+ * already converted, instead of building a mesh_t. Pipelines that only need
+ * bounds, hashes or statistics pay for no allocation beyond a little scratch
+ * space. obj_read and the other mesh readers are built on this parser.
+ */
+#ifndef PARSE_H_INCLUDED
+#define PARSE_H_INCLUDED
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/** The largest number of components a vertex, normal or texture line may have.
+ */
+#define OBJ_MAX_COMPONENTS 4
+
+/** The size of the ring buffer obj_parse_fd reads through. Longer lines are
+ * set aside in a buffer that grows to fit them. */
+#define OBJ_FD_BUFFER_SIZE (1 << 16)
+
+/** @struct obj_face_event_t
+ * @brief One face directive. Indices are 1-based; negative (relative) indices
+ * have already been resolved against the elements read so far.
+ */
+typedef struct {
+	/** The number of corners. */
+	uint32_t size;
+	/** Which indices every corner has: pos_flag, tex_flag and norm_flag. */
+	uint8_t flag;
+	/** The position, texture and normal index of every corner. NULL for the
+	 * indices the face does not have. */
+	const uint32_t* indices;
+	const uint32_t* texs;
+	const uint32_t* norms;
+	/** For every corner, bit k is set when index k (position, texture, normal)
+	 * was written as a relative index. */
+	const uint8_t* relative;
+} obj_face_event_t;
+
+/** @struct obj_callbacks_t
+ * @brief The callbacks invoked by the parser. Any callback may be NULL to skip
+ * its directive. Every callback receives the user pointer given to the parser
+ * and the 1-based line number of the directive, and returns SUCCESS to keep
+ * parsing or any other return code to stop with that code. Pointers passed to
+ * a callback are only valid until it returns.
+ */
+typedef struct {
+	/** A "v" line with 1 to OBJ_MAX_COMPONENTS components. */
+	int (*vertex)(void* user, const float* values, uint32_t dim,
+		uint32_t line);
+	/** A "vt" line with 1 to OBJ_MAX_COMPONENTS components. */
+	int (*texcoord)(void* user, const float* values, uint32_t dim,
+		uint32_t line);
+	/** A "vn" line with 1 to OBJ_MAX_COMPONENTS components. */
+	int (*normal)(void* user, const float* values, uint32_t dim,
+		uint32_t line);
+	/** An "f" line. */
+	int (*face)(void* user, const obj_face_event_t* face, uint32_t line);
+	/** A "g" line with every group name it lists; none for the default group.
+	 */
+	int (*group)(void* user, const char* const* names, uint32_t count,
+		uint32_t line);
+	/** An "o" line, with the rest of the line as the name. */
+	int (*object)(void* user, const char* name, uint32_t line);
+	/** A "usemtl" line, with the rest of the line as the material name. */
+	int (*material)(void* user, const char* name, uint32_t line);
+	/** A "mtllib" line, with the rest of the line as the library name. */
+	int (*library)(void* user, const char* name, uint32_t line);
+	/** An "s" line; "off" is group 0. */
+	int (*smoothing)(void* user, uint32_t group, uint32_t line);
+	/** Called once when parsing fails, with the failure and its line. If NULL,
+	 * the failure is printed. */
+	void (*error)(void* user, int code, uint32_t line);
+} obj_callbacks_t;
+
+/** @enum obj_stream_flags
+ * @brief Options of the parser.
+ */
+enum obj_stream_flags {
+	/** Do not reject indices past the elements read so far, or relative
+	 * indices before the first one. For parsing a piece of a file whose
+	 * earlier elements are elsewhere; the caller checks the indices once the
+	 * preceding counts are known. A relative index before the first element
+	 * is passed as its value modulo 2^32. */
+	OBJ_STREAM_DEFER_RANGE = 1 << 0
+};
+
+/** @struct obj_stream_t
+ * @brief The state of a parser that is fed one line at a time.
+ */
+typedef struct {
+	const obj_callbacks_t* callbacks;
+	void* user;
+	uint32_t flags;
+	/** The number of vertices, texture coordinates and normals so far. */
+	uint32_t num_vertices;
+	uint32_t num_textures;
+	uint32_t num_normals;
+	/** The number of lines so far. */
+	uint32_t line_number;
+	/** Scratch space for the face being parsed. */
+	uint32_t* corners[3];
+	uint8_t* relative;
+	uint32_t corner_cap;
+	/** Scratch space for names. */
+	char* text;
+	uint32_t text_cap;
+	const char** names;
+	uint32_t names_cap;
+} obj_stream_t;
+
+/** @brief Prepares a parser that is fed one line at a time.
+ * @param stream The parser.
+ * @param callbacks The callbacks. Must outlive the parser.
+ * @param user Passed to every callback.
+ * @param flags Bitwise OR of obj_stream_flags values, or 0 for the default.
+ */
+void
+obj_stream_init(obj_stream_t* stream,
+	const obj_callbacks_t* callbacks,
+	void* user,
+	uint32_t flags);
+
+/** @brief Parses one line. Lines of unknown types are skipped. A failure is
+ * reported through the error callback.
+ * @param stream The parser.
+ * @param line The line, without its newline character. Need not be
+ * NUL-terminated.
+ * @param length The number of characters in the line.
+ * @return [SUCCESS, INVALID_DIMS, PARSING_FAILURE, INDEX_OUT_OF_RANGE,
+ * MEMORY_REFUSED], or the code a callback stopped with.
+ */
+int
+obj_stream_line(obj_stream_t* stream, const char* line, size_t length);
+
+/** @brief Releases the scratch space of a parser.
+ * @param stream The parser.
+ */
+void
+obj_stream_destroy(obj_stream_t* stream);
+
+/** @brief Parses an opened .obj file from its current position to its end.
+ * @param file The file.
+ * @param callbacks The callbacks.
+ * @param user Passed to every callback.
+ * @param flags Bitwise OR of obj_stream_flags values, or 0 for the default.
+ * @return [SUCCESS, INVALID_DIMS, PARSING_FAILURE, INDEX_OUT_OF_RANGE,
+ * MEMORY_REFUSED], or the code a callback stopped with.
+ */
+int
+obj_parse_stream(FILE* file,
+	const obj_callbacks_t* callbacks,
+	void* user,
+	uint32_t flags);
+
+/** @brief Parses a .obj file held in memory.
+ * @param data The file contents. Need not be NUL-terminated.
+ * @param size The number of bytes of data.
+ * @param callbacks The callbacks.
+ * @param user Passed to every callback.
+ * @param flags Bitwise OR of obj_stream_flags values, or 0 for the default.
+ * @return [SUCCESS, INVALID_DIMS, PARSING_FAILURE, INDEX_OUT_OF_RANGE,
+ * MEMORY_REFUSED], or the code a callback stopped with.
+ */
+int
+obj_parse_span(const char* data,
+	size_t size,
+	const obj_callbacks_t* callbacks,
+	void* user,
+	uint32_t flags);
+
+/** @brief Parses a .obj file from a descriptor until the end of its input.
+ * The descriptor need not be seekable, so pipes and sockets work; it is read
+ * through a ring buffer of OBJ_FD_BUFFER_SIZE bytes and never rewound. 
+ * Lines longer than the ring are parsed like the others, as obj_parse_stream
+ * does; only the start of a long comment is kept.
+ * @param fd The descriptor. Left open.
+ * @param callbacks The callbacks.
+ * @param user Passed to every callback.
+ * @param flags Bitwise OR of obj_stream_flags values, or 0 for the default.
+ * @return [SUCCESS, INVALID_FILE, INVALID_DIMS, PARSING_FAILURE,
+ * INDEX_OUT_OF_RANGE, MEMORY_REFUSED], or the code a callback stopped with.
+ */
+int
+obj_parse_fd(int fd,
+	const obj_callbacks_t* callbacks,
+	void* user,
+	uint32_t flags);
+
+#endif
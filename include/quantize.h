@@ -0,0 +1,115 @@
+/**
+ * @file quantize.h
+ * @author green
+ * @date 10/16/2026
+ * @brief Compressed vertex attributes.
+ * Positions become 16-bit unsigned integers relative to the mesh's bounding 
+ * box, normals become two 8- or 16-bit signed integers on the octahedron and 
+ * texture coordinates become half floats: a half to a quarter of the memory 
+ * and bandwidth of 32-bit floats. The conversions run on SSE2 (and F16C for 
+ * half floats) where the processor has them. Every attribute reports how far
+ * its decoded values are from the originals, so the precision can be chosen 
+ * per asset.
+ */
+#ifndef QUANTIZE_H_INCLUDED
+#define QUANTIZE_H_INCLUDED
+
+#include <stdint.h>
+#include "obj.h"
+
+/** @enum quantize_kernel_t
+ * @brief The implementations of the conversions.
+ */
+typedef enum {
+	/** The fastest kernel the processor supports. */
+	QUANTIZE_AUTO,
+	QUANTIZE_SCALAR,
+	QUANTIZE_SSE2,
+	/** SSE2, with F16C instructions for half floats. */
+	QUANTIZE_F16C
+} quantize_kernel_t;
+
+/** @struct quantize_error_t
+ * @brief How far decoded values are from the originals. Positions and texture
+ * coordinates measure the absolute difference of each component, in the 
+ * attribute's units; normals measure the angle, in degrees.
+ */
+typedef struct {
+	float max;
+	/** The root mean square. */
+	float rms;
+} quantize_error_t;
+
+/** @struct quantized_t
+ * @brief The compressed attributes of a mesh, in the same order as the mesh's
+ * arrays, so the face indices still apply.
+ */
+typedef struct {
+	/** vertex_dim values per position. A component decodes to 
+	 * origin + value * scale. */
+	uint16_t* positions;
+	uint32_t num_positions;
+	uint32_t position_dim;
+	/** The minimum corner of the bounding box. */
+	float origin[4];
+	/** The size of the bounding box divided by 65535. */
+	float scale[4];
+	/** Two signed values per normal, on the octahedron. int8_t if normal_bits
+	 * is 8, int16_t if it is 16. */
+	void* normals;
+	uint32_t num_normals;
+	uint32_t normal_bits;
+	/** tex_dim half floats per texture coordinate. */
+	uint16_t* texcoords;
+	uint32_t num_texcoords;
+	uint32_t texcoord_dim;
+	quantize_error_t position_error;
+	quantize_error_t normal_error;
+	quantize_error_t texcoord_error;
+} quantized_t;
+
+/** @brief Gets the kernel QUANTIZE_AUTO runs on this processor.
+ * @return QUANTIZE_F16C, QUANTIZE_SSE2 or QUANTIZE_SCALAR.
+ */
+quantize_kernel_t
+quantize_best(void);
+
+/** @brief Gets the name of a kernel.
+ * @param kernel The kernel.
+ * @return "auto", "scalar", "sse2" or "f16c".
+ */
+const char*
+quantize_name(quantize_kernel_t kernel);
+
+/** @brief Compresses the positions, normals and texture coordinates of a mesh
+ * and measures the error of each.
+ * @param mesh The mesh. Normals must have at least three components; only the
+ * first three are encoded. Positions are encoded within mesh->aabb_min and
+ * mesh->aabb_max, which must bound them.
+ * @param normal_bits 8 or 16.
+ * @param kernel The kernel to use. Kernels the processor does not support 
+ * fall back to the best one it does. Every kernel gives the same values.
+ * @param out Output attributes. Zeroed on failure.
+ * @return [SUCCESS, INVALID_DIMS, MEMORY_REFUSED]
+ */
+int
+quantize_mesh(const mesh_t* mesh, 
+	uint32_t normal_bits, 
+	quantize_kernel_t kernel, 
+	quantized_t* out);
+
+/** @brief Decodes an octahedral normal.
+ * @param x The first value, divided by its largest magnitude (127 or 32767).
+ * @param y The second value, likewise.
+ * @param normal Output unit normal.
+ */
+void
+quantize_decode_normal(float x, float y, float normal[3]);
+
+/** @brief Frees compressed attributes.
+ * @param quantized The attributes.
+ */
+void
+quantized_destroy(quantized_t* quantized);
+
+#endif
@@ -0,0 +1,89 @@
+/**
+ * @file ringbuf.h
+ * @author green
+ * @date 10/16/2026
+ * @brief A bounded ring buffer of bytes read from a file descriptor.
+ * Lets a line-oriented parser consume pipes, sockets and other descriptors
+ * that cannot be rewound or mapped, in a fixed amount of memory. Lines are
+ * handed out in place, or through a scratch copy when they wrap around the
+ * end of the ring.
+ */
+#ifndef RINGBUF_H_INCLUDED
+#define RINGBUF_H_INCLUDED
+
+#include <stddef.h>
+
+/** @struct ringbuf_t
+ * @brief A ring of bytes. The positions count every byte that has passed 
+ * through the ring and are reduced modulo the capacity to index it.
+ */
+typedef struct {
+	char* data;
+	/** The size of data. A power of two. */
+	size_t capacity;
+	/** The position of the first unconsumed byte. */
+	size_t head;
+	/** The position one past the last byte read. */
+	size_t tail;
+	/** The position up to which the buffered bytes hold no newline. */
+	size_t scanned;
+	/** Holds a line that wraps around the end of data. capacity bytes. */
+	char* line;
+} ringbuf_t;
+
+/** @brief Allocates a ring buffer.
+ * @param ring The ring buffer.
+ * @param capacity The capacity in bytes, rounded up to a power of two. Bounds
+ * the length of a line that ringbuf_line hands out.
+ * @return [SUCCESS, MEMORY_REFUSED]
+ */
+int
+ringbuf_init(ringbuf_t* ring, size_t capacity);
+
+/** @brief Frees a ring buffer.
+ * @param ring The ring buffer.
+ */
+void
+ringbuf_destroy(ringbuf_t* ring);
+
+/** @brief Reads once from a descriptor into the free space of the ring.
+ * Retries reads interrupted by a signal.
+ * @param ring The ring buffer.
+ * @param fd The descriptor.
+ * @param count Receives the number of bytes read; 0 at the end of the input
+ * or when the ring is full.
+ * @return [SUCCESS, INVALID_FILE]
+ */
+int
+ringbuf_fill(ringbuf_t* ring, int fd, size_t* count);
+
+/** @brief Takes the next line out of the ring.
+ * @param ring The ring buffer.
+ * @param last 1 once the input has ended, so that the bytes after the last
+ * newline form a line of their own.
+ * @param length Receives the length of the line, without its newline.
+ * @return The line, valid until the next call on the ring, or NULL if no
+ * complete line is buffered.
+ */
+const char*
+ringbuf_line(ringbuf_t* ring, int last, size_t* length);
+
+/** @brief Moves every buffered byte out of the ring, leaving it empty. Lets
+ * the caller set aside the start of a line longer than the ring.
+ * @param ring The ring buffer.
+ * @param dest Receives the bytes, or NULL to drop them.
+ * @return The number of bytes moved.
+ */
+size_t
+ringbuf_drain(ringbuf_t* ring, char* dest);
+
+/** @brief Determines if the ring has no room left.
+ * @param ring The ring buffer.
+ * @return 1 if every byte of the ring is buffered.
+ */
+static inline int
+ringbuf_full(const ringbuf_t* ring) {
+	return ring->tail - ring->head == ring->capacity;
+}
+
+#endif
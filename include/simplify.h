@@ -0,0 +1,71 @@
+/**
+ * @file simplify.h
+ * @author green
+ * @date 10/16/2026
+ * @brief Quadric error simplification of triangle meshes into chains of LODs.
+ * Every level is an index list into one welded vertex buffer shared with the
+ * full-resolution mesh, so a chain costs one upload of vertices plus a
+ * shrinking index buffer per level. Edges are collapsed cheapest first from
+ * a binary heap, each onto one of its two vertices, measuring the cost with
+ * Garland and Heckbert's quadric error metric. Mesh borders, UV and normal
+ * seams and material boundaries are kept: their vertices only slide along
+ * them, and the corners where they meet never move.
+ */
+#ifndef SIMPLIFY_H_INCLUDED
+#define SIMPLIFY_H_INCLUDED
+
+#include <stdint.h>
+#include "obj.h"
+#include "weld.h"
+
+/** @struct lod_t
+ * @brief One level of detail.
+ */
+typedef struct {
+	/** 0-based indices into the chain's welded vertices, three per triangle.
+	 */
+	uint32_t* indices;
+	uint32_t num_indices;
+	/** The largest root mean square distance, in model units, of the surface
+	 * any collapse so far moved away from. */
+	float error;
+} lod_t;
+
+/** @struct lod_chain_t
+ * @brief Levels of detail sharing a vertex buffer.
+ */
+typedef struct {
+	/** The welded vertices and, in indices, the full-resolution triangles. */
+	weld_t weld;
+	/** The levels, from the most detailed to the coarsest. */
+	lod_t* levels;
+	uint32_t num_levels;
+} lod_chain_t;
+
+/** @brief Simplifies a triangulated mesh into a chain of levels of detail.
+ * Each level continues from the previous one. A level stops short of its
+ * budget when no collapse is left that keeps the borders, seams and material
+ * boundaries and folds no triangle over.
+ * @param mesh The mesh, read with OBJ_TRIANGULATE. Faces with different
+ * face_t.material pointers are kept apart by a material boundary.
+ * @param ratios The triangle budget of every level as a fraction of the
+ * mesh's triangles, such as 0.5, 0.25 and 0.125. Each in (0, 1] and no larger
+ * than the one before.
+ * @param num_ratios The number of levels.
+ * @param chain Output levels. Zeroed on failure.
+ * @return [SUCCESS, INVALID_DIMS if the mesh is not triangulated or has no
+ * positions, or a ratio is out of order, MEMORY_REFUSED]
+ */
+int
+simplify_lod_chain(const mesh_t* mesh,
+	const float* ratios,
+	uint32_t num_ratios,
+	lod_chain_t* chain);
+
+/** @brief Frees the vertices and levels of a chain.
+ * @param chain The chain.
+ */
+void
+lod_chain_destroy(lod_chain_t* chain);
+
+#endif
@@ -0,0 +1,53 @@
+/**
+ * @file tangents.h
+ * @author green
+ * @date 10/16/2026
+ * @brief MikkTSpace tangent frames for normal and bump mapping.
+ * Follows Mikkelsen's reference implementation with its default 180 degree
+ * angular threshold, so normal maps baked by MikkTSpace tools shade without
+ * seams. Corners with equal position, texture coordinate and normal are one
+ * vertex; around every vertex, the triangles reachable across shared edges
+ * whose texture mapping has the same orientation share one tangent, the
+ * angle-weighted mean of their tangents projected onto the normal's plane.
+ * Matching the corners into vertices, the triangle frames, edge pairing and
+ * the averages are split across threads. Grouping the triangles walks the
+ * mesh in order on one thread, as the reference does, so the result does not
+ * depend on the thread count.
+ */
+#ifndef TANGENTS_H_INCLUDED
+#define TANGENTS_H_INCLUDED
+
+#include <stdint.h>
+#include "obj.h"
+
+/** @brief Computes the tangent of every corner of a triangulated mesh into
+ * mesh->tangents, replacing any there.
+ * Normals are normalized before use. Corners of triangles with coinciding
+ * positions copy the tangent of their vertex's first corner in another
+ * triangle, or get (1, 0, 0) with a sign of 1, as do corners of triangles
+ * with no texture area and no neighbour to take one from.
+ * @param mesh The mesh, read with OBJ_TRIANGULATE, with at least three
+ * position components and two texture components.
+ * @param num_threads The number of threads to use, or 0 for one per
+ * processor.
+ * @return [SUCCESS, INVALID_DIMS if a face is not a triangle or a dimension is
+ * too small, NOT_FOUND if the mesh has no texture coordinates or normals,
+ * MEMORY_REFUSED]
+ */
+int
+tangents_generate(mesh_t* mesh, uint32_t num_threads);
+
+/** @brief Derives the bitangent of a corner from its normal and tangent.
+ * @param normal The unit normal.
+ * @param tangent The tangent and the sign of the bitangent.
+ * @param out Output bitangent: the sign times normal x tangent.
+ */
+static inline void tangents_bitangent(const float normal[3],
+	const float tangent[4],
+	float out[3]) {
+	out[0] = tangent[3] * (normal[1] * tangent[2] - normal[2] * tangent[1]);
+	out[1] = tangent[3] * (normal[2] * tangent[0] - normal[0] * tangent[2]);
+	out[2] = tangent[3] * (normal[0] * tangent[1] - normal[1] * tangent[0]);
+}
+
+#endif
@@ -0,0 +1,60 @@
+/**
+ * @file triangulate.h
+ * @author green
+ * @date 10/16/2026
+ * @brief Splitting polygons into triangles.
+ * Convex polygons are split into a fan around their first corner. Concave 
+ * polygons are split by ear clipping in the plane that best fits them. Either
+ * way a polygon of n corners yields n - 2 triangles with its own winding.
+ */
+#ifndef TRIANGULATE_H_INCLUDED
+#define TRIANGULATE_H_INCLUDED
+
+#include <stdint.h>
+
+/** @struct triangulator_t
+ * @brief Scratch space for splitting polygons, reused from one polygon to the
+ * next.
+ */
+typedef struct {
+	/** The corners of the triangles of the last polygon, as corner numbers in
+	 * [0, size). Three per triangle. */
+	uint32_t* triangles;
+	/** The corners projected onto the polygon's plane. Two floats each. */
+	float* points;
+	/** The ring of corners not yet clipped. */
+	uint32_t* prev;
+	uint32_t* next;
+	uint32_t capacity;
+} triangulator_t;
+
+/** @brief Prepares the scratch space.
+ * @param triangulator The scratch space.
+ */
+void
+triangulator_init(triangulator_t* triangulator);
+
+/** @brief Frees the scratch space.
+ * @param triangulator The scratch space.
+ */
+void
+triangulator_destroy(triangulator_t* triangulator);
+
+/** @brief Splits a polygon into size - 2 triangles, written to 
+ * triangulator->triangles.
+ * @param triangulator The scratch space.
+ * @param positions Contiguous positions, dim floats each.
+ * @param dim The number of floats per position, at least 2. Only the first 
+ * three are used.
+ * @param indices The 1-based position index of every corner.
+ * @param size The number of corners, at least 3.
+ * @return [SUCCESS, MEMORY_REFUSED]
+ */
+int
+triangulate_polygon(triangulator_t* triangulator,
+	const float* positions,
+	uint32_t dim,
+	const uint32_t* indices,
+	uint32_t size);
+
+#endif
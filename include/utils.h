@@ -3,6 +3,7 @@
 
 #include <stdio.h>
 #include <stdint.h>
+#include <stddef.h>
 #include "defs.h"
 
 typedef enum {
@@ -43,6 +44,37 @@ void* buffer,
 const uint32_t dim, 
 const type_t dataformat);
 
+/** Ensures a heap array can hold at least the required number of elements. 
+ * The capacity grows geometrically (doubling), so appending n elements one at a 
+ * time costs O(n) amortized copies.
+ * 
+ * @param data Pointer to the heap array. May point to NULL.
+ * @param capacity Pointer to the current capacity, in elements.
+ * @param required The number of elements the array must be able to hold.
+ * @param size The byte size of a single element.
+ * @returns SUCCESS, MEMORY_REFUSED.
+ */
+int 
+array_reserve(void** data, 
+uint32_t* capacity, 
+const uint32_t required, 
+const size_t size);
+
+/** Shrinks a heap array down to the number of elements actually used. An 
+ * array with no used elements is freed and set to NULL.
+ * 
+ * @param data Pointer to the heap array.
+ * @param capacity Pointer to the current capacity, in elements.
+ * @param used The number of used elements.
+ * @param size The byte size of a single element.
+ * @returns SUCCESS, MEMORY_REFUSED.
+ */
+int 
+array_trim(void** data, 
+uint32_t* capacity, 
+const uint32_t used, 
+const size_t size);
+
 /** Prints a dimension of numbers to standard output.
  * 
  * @param data The data to print.
@@ -0,0 +1,67 @@
+/**
+ * @file weld.h
+ * @author green
+ * @date 10/16/2026
+ * @brief Welding a mesh into a single-indexed vertex buffer.
+ * A .obj corner indexes its position, texture coordinate and normal 
+ * separately, while a GPU draws from one index per vertex. Welding gives every
+ * distinct (position, texture, normal) triplet one interleaved vertex and 
+ * every corner one index to it. Read with OBJ_TRIANGULATE, the indices form a
+ * triangle list ready for upload. A mesh with tangents splits a triplet 
+ * whose corners have different tangents.
+ */
+#ifndef WELD_H_INCLUDED
+#define WELD_H_INCLUDED
+
+#include <stdint.h>
+#include "obj.h"
+
+/** The bit of weld_t.flag set when every vertex has a tangent. */
+#define WELD_TANGENT_FLAG (1 << 3)
+
+/** @struct weld_t
+ * @brief Interleaved vertices and the index of every corner.
+ */
+typedef struct {
+	/** stride floats per vertex: the position, then the texture coordinate 
+	 * with tex_flag, then the normal with norm_flag, then the four floats of
+	 * the tangent with WELD_TANGENT_FLAG. */
+	float* vertices;
+	/** The 0-based vertex of every corner of the mesh, in corner order. */
+	uint32_t* indices;
+	uint32_t num_vertices;
+	uint32_t num_indices;
+	/** The number of floats per vertex. */
+	uint32_t stride;
+	/** Offsets within a vertex, in floats. Meaningful only with the 
+	 * corresponding bit of flag. */
+	uint32_t texcoord_offset;
+	uint32_t normal_offset;
+	uint32_t tangent_offset;
+	/** The attributes of every vertex: the mesh's face flag, plus 
+	 * WELD_TANGENT_FLAG if the mesh has tangents. */
+	uint8_t flag;
+	/** num_vertices / num_indices: the lower, the more corners share a 
+	 * vertex. 1 when nothing was shared. */
+	float ratio;
+} weld_t;
+
+/** @brief Welds the corners of a mesh into interleaved vertices, using an 
+ * open-addressing hash table of triplets sized from the number of corners.
+ * With tangents, a slot also keeps the first corner of its vertex, and 
+ * corners match only if their tangents are bitwise equal.
+ * The vertices appear in the order of the first corner that uses them.
+ * @param mesh The mesh.
+ * @param weld Output vertices and indices. Zeroed on failure.
+ * @return [SUCCESS, MEMORY_REFUSED]
+ */
+int
+weld_mesh(const mesh_t* mesh, weld_t* weld);
+
+/** @brief Frees the vertices and indices of a weld.
+ * @param weld The weld.
+ */
+void
+weld_destroy(weld_t* weld);
+
+#endif
@@ -0,0 +1,204 @@
+#include "bounds.h"
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define BOUNDS_X86
+#include <immintrin.h>
+#endif
+
+// -----------------------------------------------------------------------------
+// Static utility
+// -----------------------------------------------------------------------------
+
+/** Copies up to four components of a point, padded with 0.
+ */
+static inline void load_point(const float* point, uint32_t dim, float out[4]) {
+	out[0] = out[1] = out[2] = out[3] = 0.0f;
+	memcpy(out, point, (dim < 4 ? dim : 4) * sizeof *out);
+}
+
+#ifdef BOUNDS_X86
+/** Extends a box with a point.
+ * @returns A mask with bit k set if the point lowered component k and bit
+ * k + 4 set if it raised it.
+ */
+__attribute__((target("sse2")))
+static int extend_sse2(float lower[4], float upper[4], const float p[4]) {
+	__m128 v = _mm_loadu_ps(p);
+	__m128 lo = _mm_loadu_ps(lower);
+	__m128 hi = _mm_loadu_ps(upper);
+	int mask = _mm_movemask_ps(_mm_cmplt_ps(v, lo))
+		| _mm_movemask_ps(_mm_cmpgt_ps(v, hi)) << 4;
+	if (mask) {
+		// minps and maxps keep their second operand unless the first is
+		// strictly beyond it, so ties keep the earlier value.
+		_mm_storeu_ps(lower, _mm_min_ps(v, lo));
+		_mm_storeu_ps(upper, _mm_max_ps(v, hi));
+	}
+	return mask;
+}
+#endif
+
+/** Extends a box with a point, one component at a time.
+ * @returns The mask of extend_sse2.
+ */
+static int extend_scalar(float lower[4], float upper[4], const float p[4]) {
+	int mask = 0;
+	for (uint32_t k = 0; k < 4; k++) {
+		if (p[k] < lower[k]) {
+			lower[k] = p[k];
+			mask |= 1 << k;
+		}
+		if (p[k] > upper[k]) {
+			upper[k] = p[k];
+			mask |= 1 << (k + 4);
+		}
+	}
+	return mask;
+}
+
+static inline int extend(float lower[4], float upper[4], const float p[4]) {
+#ifdef BOUNDS_X86
+	return extend_sse2(lower, upper, p);
+#else
+	return extend_scalar(lower, upper, p);
+#endif
+}
+
+// -----------------------------------------------------------------------------
+// Implementation
+// -----------------------------------------------------------------------------
+
+void
+bounds_init(bounds_t* bounds) {
+	memset(bounds, 0, sizeof *bounds);
+	for (uint32_t k = 0; k < 4; k++) {
+		bounds->lower[k] = INFINITY;
+		bounds->upper[k] = -INFINITY;
+	}
+}
+
+void
+bounds_add(bounds_t* bounds, const float* point, uint32_t dim) {
+	float p[4];
+	if (bounds->count == 0) {
+		bounds_init(bounds);
+	}
+	load_point(point, dim, p);
+	int mask = extend(bounds->lower, bounds->upper, p);
+	// Only a point that extends the box along x, y or z is a new extreme.
+	for (uint32_t k = 0; mask && k < 3; k++) {
+		if (mask & (1 << k)) {
+			memcpy(bounds->extremes[2 * k], p, 3 * sizeof *p);
+		}
+		if (mask & (1 << (k + 4))) {
+			memcpy(bounds->extremes[2 * k + 1], p, 3 * sizeof *p);
+		}
+	}
+	bounds->count++;
+}
+
+void
+bounds_extend(float lower[4],
+	float upper[4],
+	const float* point,
+	uint32_t dim) {
+	float p[4];
+	load_point(point, dim, p);
+	extend(lower, upper, p);
+}
+
+void
+bounds_merge(bounds_t* bounds, const bounds_t* later) {
+	float lower[4], upper[4];
+	if (later->count == 0) {
+		return;
+	}
+	if (bounds->count == 0) {
+		*bounds = *later;
+		return;
+	}
+	memcpy(lower, bounds->lower, sizeof lower);
+	memcpy(upper, bounds->upper, sizeof upper);
+	extend_scalar(bounds->lower, bounds->upper, later->lower);
+	extend_scalar(bounds->lower, bounds->upper, later->upper);
+	for (uint32_t k = 0; k < 3; k++) {
+		if (later->lower[k] < lower[k]) {
+			memcpy(bounds->extremes[2 * k], later->extremes[2 * k],
+				sizeof bounds->extremes[0]);
+		}
+		if (later->upper[k] > upper[k]) {
+			memcpy(bounds->extremes[2 * k + 1], later->extremes[2 * k + 1],
+				sizeof bounds->extremes[0]);
+		}
+	}
+	bounds->count += later->count;
+}
+
+void
+bounds_sphere(const bounds_t* bounds,
+	const float* points,
+	uint32_t count,
+	uint32_t dim,
+	float center[3],
+	float* radius) {
+	center[0] = center[1] = center[2] = 0.0f;
+	*radius = 0.0f;
+	if (bounds->count == 0 || count == 0) {
+		return;
+	}
+	// Start from the extreme pair furthest apart.
+	float best = -1.0f;
+	for (uint32_t k = 0; k < 3; k++) {
+		const float* a = bounds->extremes[2 * k];
+		const float* b = bounds->extremes[2 * k + 1];
+		float d[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+		float distance = d[0] * d[0] + d[1] * d[1] + d[2] * d[2];
+		if (distance > best) {
+			best = distance;
+			for (uint32_t j = 0; j < 3; j++) {
+				center[j] = (a[j] + b[j]) * 0.5f;
+			}
+			*radius = sqrtf(distance) * 0.5f;
+		}
+	}
+	// The sphere about the center of the box is tracked alongside; it is the
+	// smaller for box-like point sets, on which Ritter's does worst.
+	float middle[3], reach = 0.0f;
+	for (uint32_t j = 0; j < 3; j++) {
+		middle[j] = (bounds->lower[j] + bounds->upper[j]) * 0.5f;
+	}
+	for (uint32_t i = 0; i < count; i++) {
+		float p[4];
+		load_point(points + (size_t)i * dim, dim, p);
+		float m[3] = { p[0] - middle[0], p[1] - middle[1], p[2] - middle[2] };
+		float to_middle = m[0] * m[0] + m[1] * m[1] + m[2] * m[2];
+		reach = to_middle > reach ? to_middle : reach;
+		float d[3] = { p[0] - center[0], p[1] - center[1], p[2] - center[2] };
+		float distance = d[0] * d[0] + d[1] * d[1] + d[2] * d[2];
+		if (distance <= *radius * *radius) {
+			continue;
+		}
+		// The new sphere touches the point and the far side of the old one.
+		distance = sqrtf(distance);
+		float grown = (*radius + distance) * 0.5f;
+		float shift = (grown - *radius) / distance;
+		for (uint32_t j = 0; j < 3; j++) {
+			center[j] += shift * d[j];
+		}
+		*radius = grown;
+	}
+	if ((reach = sqrtf(reach)) < *radius) {
+		memcpy(center, middle, sizeof middle);
+		*radius = reach;
+	}
+	// Rounding the center can leave a point a few ulps of the coordinates
+	// outside.
+	float magnitude = *radius;
+	for (uint32_t j = 0; j < 3; j++) {
+		magnitude += fabsf(center[j]);
+	}
+	*radius += 4.0f * FLT_EPSILON * magnitude;
+}
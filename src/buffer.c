@@ -1,5 +1,6 @@
 #include "buffer.h"
 #include "defs.h"
+#include "fastfloat.h"
 #include <string.h>
 #include <stdlib.h>
 
@@ -7,45 +8,13 @@
 
 int
 buffer_get_float(buffer_t src, float* dest) {
-	if (src.length > MAX_TEMP_SIZE) {
-		return PARSING_FAILURE; // Not enough characters
-	}
-	char numstr[MAX_TEMP_SIZE] = {0};
-	unsigned int i = 0;
-	for (; i < MAX_TEMP_SIZE; i++) {
-		switch (buffer_start(src)[i]) {
-			case '0':
-			case '1':
-			case '2':
-			case '3':
-			case '4':
-			case '5':
-			case '6':
-			case '7':
-			case '8':
-			case '9':
-			case '+':
-			case '-':
-			case 'e':
-			case 'E':
-				numstr[i] = buffer_start(src)[i];
-				break;
-			case '.':
-			case ',':
-				numstr[i] = '.';
-				break;
-            default:
-				goto loop_exit;
-				break;
-		}
-	}
-loop_exit: ;
-	char* errptr;
-	numstr[i] = '\0';
-	*dest = (float) strtod((const char*) numstr, (char**) &errptr);
-	if (*errptr != '\0') {
+	// The whole token must be the number, as for face corners.
+	float value;
+	if (fastfloat_parse(buffer_start(src), buffer_end(src), &value) 
+		!= buffer_end(src)) {
 		return PARSING_FAILURE;
 	}
+	*dest = value;
 	return SUCCESS;
 }
 int 
@@ -53,9 +22,9 @@ buffer_get_int(buffer_t src, int* dest) {
 	if (src.length > MAX_TEMP_SIZE) {
 		return 1; // Not enough characters
 	}
-	char numstr[MAX_TEMP_SIZE] = {0};
+	char numstr[MAX_TEMP_SIZE + 1] = {0};
 	unsigned int i = 0;
-	for (; i < MAX_TEMP_SIZE; i++) {
+	for (; i < src.length; i++) {
 		switch (buffer_start(src)[i]) {
 			case '0':
 			case '1':
@@ -96,9 +65,9 @@ buffer_get_uint(buffer_t src, unsigned int* dest) {
 	if (src.length > MAX_TEMP_SIZE) {
 		return 1; // Not enough characters
 	}
-	char numstr[MAX_TEMP_SIZE] = {0};
+	char numstr[MAX_TEMP_SIZE + 1] = {0};
 	unsigned int i = 0;
-	for (; i < MAX_TEMP_SIZE; i++) {
+	for (; i < src.length; i++) {
 		switch (buffer_start(src)[i]) {
 			case '0':
 			case '1':
@@ -142,4 +111,9 @@ int buffer_get_str(buffer_t src, char* restrict dest) {
 }
 int buffer_cmp(buffer_t src, char* restrict str) {
 	return strncmp(buffer_start(src), str, src.length) == 0;
+}
+int buffer_equ(buffer_t src, const char* str) {
+	size_t length = strlen(str);
+	return src.length == length 
+		&& memcmp(buffer_start(src), str, length) == 0;
 }
\ No newline at end of file
@@ -0,0 +1,818 @@
+#include "bvh.h"
+#include "defs.h"
+#include "parallel.h"
+#include "utils.h"
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define BVH_X86
+#include <immintrin.h>
+#endif
+
+// -----------------------------------------------------------------------------
+// Static utility
+// -----------------------------------------------------------------------------
+
+/* The number of tasks per thread when splitting even shares of work. */
+#define TASKS_PER_THREAD 4
+
+/* The cost of visiting a node, relative to testing one triangle. */
+#define TRAVERSAL_COST 1.0f
+
+/* Spans with fewer triangles are binned on one thread. */
+#define PARALLEL_BINNING 16384
+
+/* Marks a node of the top levels whose subtree is built by a job. */
+#define JOB_NODE UINT32_MAX
+
+/** @struct bin_t
+ * @brief The triangles whose centroids fall in one bin, and their box.
+ */
+typedef struct {
+	float lower[4];
+	float upper[4];
+	uint32_t count;
+} bin_t;
+
+/** @struct prim_t
+ * @brief A triangle's box and centroid. Nodes are split by moving these, so
+ * that every pass over a span reads memory in order.
+ */
+typedef struct {
+	/** Padded with 0 for SIMD loads. */
+	float lower[4];
+	float upper[4];
+	float centroid[4];
+	uint32_t triangle;
+} prim_t;
+
+/** @struct span_t
+ * @brief A run of triangles to split: their box and the box of their
+ * centroids.
+ */
+typedef struct {
+	uint32_t begin;
+	uint32_t end;
+	float lower[3];
+	float upper[3];
+	float centroid_lower[3];
+	float centroid_upper[3];
+} span_t;
+
+/** @struct node_list_t
+ * @brief A growable list of nodes.
+ */
+typedef struct {
+	bvh_node_t* nodes;
+	uint32_t num_nodes;
+	uint32_t capacity;
+} node_list_t;
+
+/** @struct job_t
+ * @brief A subtree below the top levels, built on its own with nodes
+ * numbered from its root.
+ */
+typedef struct {
+	span_t span;
+	uint32_t depth;
+	node_list_t list;
+	uint32_t max_depth;
+	int code;
+} job_t;
+
+/** @struct builder_t
+ * @brief The state of the construction.
+ */
+typedef struct {
+	const mesh_t* mesh;
+	/** The triangles, reordered so that every node's are consecutive. */
+	prim_t* prims;
+	uint32_t num_triangles;
+	uint32_t num_threads;
+	uint32_t num_tasks;
+	/** Spans of at most this many triangles are built as jobs. */
+	uint32_t grain;
+	job_t* jobs;
+	uint32_t num_jobs;
+	uint32_t job_cap;
+	/** The span being binned across threads, and the bins of every task. */
+	const span_t* span;
+	bin_t (*task_bins)[3][BVH_BINS];
+} builder_t;
+
+static void task_range(uint32_t count,
+	uint32_t task,
+	uint32_t num_tasks,
+	uint32_t* begin,
+	uint32_t* end) {
+	*begin = (uint32_t)((uint64_t)count * task / num_tasks);
+	*end = (uint32_t)((uint64_t)count * (task + 1) / num_tasks);
+}
+
+static inline void empty_box(float lower[3], float upper[3]) {
+	for (uint32_t k = 0; k < 3; k++) {
+		lower[k] = INFINITY;
+		upper[k] = -INFINITY;
+	}
+}
+
+static inline void grow_box(float lower[3],
+	float upper[3],
+	const float* other_lower,
+	const float* other_upper) {
+	for (uint32_t k = 0; k < 3; k++) {
+		lower[k] = other_lower[k] < lower[k] ? other_lower[k] : lower[k];
+		upper[k] = other_upper[k] > upper[k] ? other_upper[k] : upper[k];
+	}
+}
+
+/** Half the surface area of a box, 0 if it is empty. */
+static inline float half_area(const float lower[3], const float upper[3]) {
+	float d[3];
+	for (uint32_t k = 0; k < 3; k++) {
+		d[k] = upper[k] - lower[k];
+		if (!(d[k] >= 0.0f)) {
+			return 0.0f;
+		}
+	}
+	return d[0] * d[1] + d[1] * d[2] + d[2] * d[0];
+}
+
+/** The number of bins for a span. Small spans get one per triangle, which
+ * is as fine as it needs to be and saves sweeping empty bins. */
+static inline uint32_t span_bins(const span_t* span) {
+	uint32_t count = span->end - span->begin;
+	return count < BVH_BINS ? count : BVH_BINS;
+}
+
+/** The scale from a centroid coordinate to its bin along every axis, 0 for
+ * axes along which the centroids do not spread. */
+static void bin_scales(const span_t* span, float scale[3]) {
+	for (uint32_t k = 0; k < 3; k++) {
+		float extent = span->centroid_upper[k] - span->centroid_lower[k];
+		scale[k] = extent > 0.0f ? span_bins(span) / extent : 0.0f;
+	}
+}
+
+static inline uint32_t bin_of(float centroid,
+	float lower,
+	float scale,
+	uint32_t num_bins) {
+	uint32_t bin = (uint32_t)((centroid - lower) * scale);
+	return bin < num_bins ? bin : num_bins - 1;
+}
+
+#ifdef BVH_X86
+/** Bins triangles as bin_triangles does, finding the bins along all three
+ * axes at once and growing every bin with one minimum and one maximum.
+ */
+__attribute__((target("sse2")))
+static void bin_sse2(const prim_t* prims,
+	uint32_t count,
+	const span_t* span,
+	const float scale[3],
+	uint32_t num_bins,
+	bin_t bins[3][BVH_BINS]) {
+	__m128 lower = _mm_setr_ps(span->centroid_lower[0],
+		span->centroid_lower[1], span->centroid_lower[2], 0.0f);
+	__m128 factor = _mm_setr_ps(scale[0], scale[1], scale[2], 0.0f);
+	__m128i last = _mm_set1_epi32((int)num_bins - 1);
+	for (uint32_t i = 0; i < count; i++) {
+		const prim_t* prim = &prims[i];
+		__m128 box_lower = _mm_loadu_ps(prim->lower);
+		__m128 box_upper = _mm_loadu_ps(prim->upper);
+		__m128i index = _mm_cvttps_epi32(_mm_mul_ps(_mm_sub_ps(
+			_mm_loadu_ps(prim->centroid), lower), factor));
+		__m128i over = _mm_cmpgt_epi32(index, last);
+		index = _mm_or_si128(_mm_andnot_si128(over, index),
+			_mm_and_si128(over, last));
+		int32_t b[4];
+		_mm_storeu_si128((__m128i*)b, index);
+		for (uint32_t k = 0; k < 3; k++) {
+			if (scale[k] == 0.0f) {
+				continue;
+			}
+			bin_t* bin = &bins[k][b[k]];
+			_mm_storeu_ps(bin->lower, _mm_min_ps(box_lower,
+				_mm_loadu_ps(bin->lower)));
+			_mm_storeu_ps(bin->upper, _mm_max_ps(box_upper,
+				_mm_loadu_ps(bin->upper)));
+			bin->count++;
+		}
+	}
+}
+#endif
+
+/** Bins some of the triangles of a span by their centroids, along every axis
+ * they spread along.
+ */
+static void bin_triangles(const builder_t* builder,
+	const span_t* span,
+	uint32_t begin,
+	uint32_t end,
+	bin_t bins[3][BVH_BINS]) {
+	float scale[3];
+	uint32_t num_bins = span_bins(span);
+	bin_scales(span, scale);
+	for (uint32_t k = 0; k < 3; k++) {
+		for (uint32_t b = 0; b < num_bins; b++) {
+			memset(&bins[k][b], 0, sizeof bins[k][b]);
+			empty_box(bins[k][b].lower, bins[k][b].upper);
+		}
+	}
+#ifdef BVH_X86
+	bin_sse2(builder->prims + begin, end - begin, span, scale, num_bins,
+		bins);
+#else
+	for (uint32_t i = begin; i < end; i++) {
+		const prim_t* prim = &builder->prims[i];
+		for (uint32_t k = 0; k < 3; k++) {
+			if (scale[k] == 0.0f) {
+				continue;
+			}
+			bin_t* bin = &bins[k][bin_of(prim->centroid[k],
+				span->centroid_lower[k], scale[k], num_bins)];
+			grow_box(bin->lower, bin->upper, prim->lower, prim->upper);
+			bin->count++;
+		}
+	}
+#endif
+}
+
+/** Worker that bins an even share of the span being binned across threads.
+ * @param ctx The builder_t.
+ * @param task The index of the share.
+ */
+static void bin_share(void* ctx, uint32_t task) {
+	builder_t* builder = ctx;
+	const span_t* span = builder->span;
+	uint32_t begin, end;
+	task_range(span->end - span->begin, task, builder->num_tasks, &begin,
+		&end);
+	bin_triangles(builder, span, span->begin + begin, span->begin + end,
+		builder->task_bins[task]);
+}
+
+/** Bins the triangles of a span, across threads if it is large. The bins
+ * are the same either way.
+ */
+static void bin_span(builder_t* builder,
+	const span_t* span,
+	int parallel,
+	bin_t bins[3][BVH_BINS]) {
+	if (!parallel || builder->num_threads < 2 ||
+		span->end - span->begin < PARALLEL_BINNING) {
+		bin_triangles(builder, span, span->begin, span->end, bins);
+		return;
+	}
+	builder->span = span;
+	parallel_for(builder->num_tasks, builder->num_threads, bin_share,
+		builder);
+	memcpy(bins, builder->task_bins[0], sizeof(bin_t) * 3 * BVH_BINS);
+	for (uint32_t t = 1; t < builder->num_tasks; t++) {
+		for (uint32_t k = 0; k < 3; k++) {
+			for (uint32_t b = 0; b < BVH_BINS; b++) {
+				const bin_t* bin = &builder->task_bins[t][k][b];
+				grow_box(bins[k][b].lower, bins[k][b].upper, bin->lower,
+					bin->upper);
+				bins[k][b].count += bin->count;
+			}
+		}
+	}
+}
+
+/** Finds the cheapest split between two bins.
+ * @param bins The binned triangles.
+ * @param num_bins The number of bins along every axis.
+ * @param axis Output axis.
+ * @param split Output last bin of the first child.
+ * @returns The summed area times count of both children, or infinity if
+ * no split leaves triangles on both sides.
+ */
+static float best_split(bin_t bins[3][BVH_BINS],
+	uint32_t num_bins,
+	uint32_t* axis,
+	uint32_t* split) {
+	float best = INFINITY;
+	for (uint32_t k = 0; k < 3; k++) {
+		float right_cost[BVH_BINS];
+		float lower[3], upper[3];
+		uint32_t count = 0;
+		empty_box(lower, upper);
+		float cost = INFINITY;
+		// Empty bins change neither side.
+		for (uint32_t b = num_bins - 1; b > 0; b--) {
+			if (bins[k][b].count) {
+				grow_box(lower, upper, bins[k][b].lower, bins[k][b].upper);
+				count += bins[k][b].count;
+				cost = half_area(lower, upper) * count;
+			}
+			right_cost[b - 1] = cost;
+		}
+		empty_box(lower, upper);
+		count = 0;
+		for (uint32_t b = 0; b + 1 < num_bins; b++) {
+			if (!bins[k][b].count) {
+				continue;
+			}
+			grow_box(lower, upper, bins[k][b].lower, bins[k][b].upper);
+			count += bins[k][b].count;
+			cost = half_area(lower, upper) * count + right_cost[b];
+			if (cost < best) {
+				best = cost;
+				*axis = k;
+				*split = b;
+			}
+		}
+	}
+	return best;
+}
+
+/** Splits a span at a bin. The boxes of both halves are the unions of
+ * their bins; their centroid boxes are gathered as the triangles are moved.
+ */
+static void partition_binned(builder_t* builder,
+	const span_t* span,
+	bin_t bins[3][BVH_BINS],
+	uint32_t axis,
+	uint32_t split,
+	span_t* left,
+	span_t* right) {
+	float scale[3];
+	uint32_t num_bins = span_bins(span);
+	bin_scales(span, scale);
+	empty_box(left->lower, left->upper);
+	empty_box(right->lower, right->upper);
+	for (uint32_t b = 0; b < num_bins; b++) {
+		span_t* half = b <= split ? left : right;
+		grow_box(half->lower, half->upper, bins[axis][b].lower,
+			bins[axis][b].upper);
+	}
+	empty_box(left->centroid_lower, left->centroid_upper);
+	empty_box(right->centroid_lower, right->centroid_upper);
+	prim_t* prims = builder->prims;
+	uint32_t i = span->begin, j = span->end;
+	while (i < j) {
+		const float* centroid = prims[i].centroid;
+		if (bin_of(centroid[axis], span->centroid_lower[axis], scale[axis],
+			num_bins) <= split) {
+			grow_box(left->centroid_lower, left->centroid_upper, centroid,
+				centroid);
+			i++;
+		} else {
+			grow_box(right->centroid_lower, right->centroid_upper, centroid,
+				centroid);
+			prim_t prim = prims[i];
+			prims[i] = prims[--j];
+			prims[j] = prim;
+		}
+	}
+	left->begin = span->begin;
+	left->end = right->begin = i;
+	right->end = span->end;
+}
+
+/** Computes the box and centroid box of a span from its triangles.
+ */
+static void bound_span(const builder_t* builder, span_t* span) {
+	empty_box(span->lower, span->upper);
+	empty_box(span->centroid_lower, span->centroid_upper);
+	for (uint32_t i = span->begin; i < span->end; i++) {
+		const prim_t* prim = &builder->prims[i];
+		grow_box(span->lower, span->upper, prim->lower, prim->upper);
+		grow_box(span->centroid_lower, span->centroid_upper, prim->centroid,
+			prim->centroid);
+	}
+}
+
+/** Chooses how to split a span: at the cheapest bin if that beats a leaf,
+ * in half if its triangles cannot be binned apart but are too many for a
+ * leaf.
+ * @returns 1 if the span is split into left and right, 0 for a leaf.
+ */
+static int split_span(builder_t* builder,
+	const span_t* span,
+	uint32_t depth,
+	int parallel,
+	span_t* left,
+	span_t* right) {
+	uint32_t count = span->end - span->begin;
+	if (count <= 2 || depth + 1 >= BVH_MAX_DEPTH) {
+		return 0;
+	}
+	bin_t bins[3][BVH_BINS];
+	uint32_t axis = 0, split = 0;
+	bin_span(builder, span, parallel, bins);
+	float cost = best_split(bins, span_bins(span), &axis, &split);
+	if (cost == INFINITY) {
+		if (count <= BVH_MAX_LEAF) {
+			return 0;
+		}
+		left->begin = span->begin;
+		left->end = right->begin = span->begin + count / 2;
+		right->end = span->end;
+		bound_span(builder, left);
+		bound_span(builder, right);
+		return 1;
+	}
+	float area = half_area(span->lower, span->upper);
+	if (count <= BVH_MAX_LEAF && TRAVERSAL_COST * area + cost >= area * count) {
+		return 0;
+	}
+	partition_binned(builder, span, bins, axis, split, left, right);
+	return 1;
+}
+
+/** Appends a node to a list.
+ * @returns The index of the node, or UINT32_MAX if out of memory.
+ */
+static uint32_t push_node(node_list_t* list,
+	const span_t* span,
+	uint32_t offset,
+	uint32_t count) {
+	if (array_reserve((void**)&list->nodes, &list->capacity,
+		list->num_nodes + 1, sizeof *list->nodes) != SUCCESS) {
+		return UINT32_MAX;
+	}
+	bvh_node_t* node = &list->nodes[list->num_nodes];
+	memcpy(node->lower, span->lower, sizeof node->lower);
+	memcpy(node->upper, span->upper, sizeof node->upper);
+	node->offset = offset;
+	node->count = count;
+	return list->num_nodes++;
+}
+
+/** Builds the subtree of a span depth first into a list. In the top levels,
+ * spans small enough are left to jobs.
+ * @param builder The builder.
+ * @param list The nodes so far.
+ * @param span The span.
+ * @param depth The depth of its node.
+ * @param top Set for the top levels.
+ * @param max_depth The depth of the deepest node so far.
+ * @returns SUCCESS or MEMORY_REFUSED.
+ */
+static int build_node(builder_t* builder,
+	node_list_t* list,
+	const span_t* span,
+	uint32_t depth,
+	int top,
+	uint32_t* max_depth) {
+	int code;
+	span_t left, right;
+	if (top && span->end - span->begin <= builder->grain) {
+		if ((code = array_reserve((void**)&builder->jobs, &builder->job_cap,
+			builder->num_jobs + 1, sizeof *builder->jobs)) != SUCCESS) {
+			return code;
+		}
+		builder->jobs[builder->num_jobs] = (job_t) {
+			.span = *span, .depth = depth
+		};
+		return push_node(list, span, builder->num_jobs++, JOB_NODE)
+			== UINT32_MAX ? MEMORY_REFUSED : SUCCESS;
+	}
+	*max_depth = depth > *max_depth ? depth : *max_depth;
+	if (!split_span(builder, span, depth, top, &left, &right)) {
+		return push_node(list, span, span->begin, span->end - span->begin)
+			== UINT32_MAX ? MEMORY_REFUSED : SUCCESS;
+	}
+	uint32_t node = push_node(list, span, 0, 0);
+	if (node == UINT32_MAX) {
+		return MEMORY_REFUSED;
+	}
+	if ((code = build_node(builder, list, &left, depth + 1, top, max_depth))
+		!= SUCCESS) {
+		return code;
+	}
+	list->nodes[node].offset = list->num_nodes;
+	return build_node(builder, list, &right, depth + 1, top, max_depth);
+}
+
+/** Worker that builds the subtree of one job.
+ * @param ctx The builder_t.
+ * @param task The index of the job.
+ */
+static void build_job(void* ctx, uint32_t task) {
+	builder_t* builder = ctx;
+	job_t* job = &builder->jobs[task];
+	job->code = build_node(builder, &job->list, &job->span, job->depth, 0,
+		&job->max_depth);
+}
+
+/** Worker that bounds an even share of the triangles.
+ * @param ctx The builder_t.
+ * @param task The index of the share.
+ */
+static void bound_triangles(void* ctx, uint32_t task) {
+	builder_t* builder = ctx;
+	const mesh_t* mesh = builder->mesh;
+	uint32_t begin, end;
+	task_range(builder->num_triangles, task, builder->num_tasks, &begin,
+		&end);
+	for (uint32_t t = begin; t < end; t++) {
+		prim_t* prim = &builder->prims[t];
+		memset(prim, 0, sizeof *prim);
+		empty_box(prim->lower, prim->upper);
+		for (uint32_t j = 0; j < 3; j++) {
+			const float* p = mesh->positions + (size_t)(mesh->face_indices[
+				3 * (size_t)t + j] - 1) * mesh->vertex_dim;
+			grow_box(prim->lower, prim->upper, p, p);
+		}
+		for (uint32_t k = 0; k < 3; k++) {
+			prim->centroid[k] = (prim->lower[k] + prim->upper[k]) * 0.5f;
+		}
+		prim->triangle = t;
+	}
+}
+
+/** Splices the subtrees of the jobs into the top levels, depth first.
+ * @returns SUCCESS or MEMORY_REFUSED.
+ */
+static int splice_jobs(const builder_t* builder,
+	const node_list_t* top,
+	bvh_t* out) {
+	uint32_t* index = malloc((size_t)top->num_nodes * sizeof *index + 1);
+	if (!index) {
+		return MEMORY_REFUSED;
+	}
+	uint32_t total = 0;
+	for (uint32_t i = 0; i < top->num_nodes; i++) {
+		const bvh_node_t* node = &top->nodes[i];
+		index[i] = total;
+		total += node->count == JOB_NODE
+			? builder->jobs[node->offset].list.num_nodes : 1;
+	}
+	if (!(out->nodes = malloc((size_t)total * sizeof *out->nodes + 1))) {
+		free(index);
+		return MEMORY_REFUSED;
+	}
+	for (uint32_t i = 0; i < top->num_nodes; i++) {
+		const bvh_node_t* node = &top->nodes[i];
+		bvh_node_t* target = out->nodes + index[i];
+		if (node->count != JOB_NODE) {
+			*target = *node;
+			if (node->count == 0) {
+				target->offset = index[node->offset];
+			}
+			continue;
+		}
+		const node_list_t* list = &builder->jobs[node->offset].list;
+		memcpy(target, list->nodes, list->num_nodes * sizeof *target);
+		for (uint32_t j = 0; j < list->num_nodes; j++) {
+			if (target[j].count == 0) {
+				target[j].offset += index[i];
+			}
+		}
+	}
+	out->num_nodes = total;
+	free(index);
+	return SUCCESS;
+}
+
+/** Intersects a ray with a triangle, after Moller and Trumbore.
+ * @returns 1 if the ray meets the triangle within [t_min, t_max].
+ */
+static inline int hit_triangle(const float* v,
+	const bvh_ray_t* ray,
+	float t_max,
+	float* t,
+	float* u,
+	float* w) {
+	float e1[3], e2[3], s[3], p[3], q[3];
+	for (uint32_t k = 0; k < 3; k++) {
+		e1[k] = v[3 + k] - v[k];
+		e2[k] = v[6 + k] - v[k];
+		s[k] = ray->origin[k] - v[k];
+	}
+	const float* d = ray->direction;
+	p[0] = d[1] * e2[2] - d[2] * e2[1];
+	p[1] = d[2] * e2[0] - d[0] * e2[2];
+	p[2] = d[0] * e2[1] - d[1] * e2[0];
+	float det = e1[0] * p[0] + e1[1] * p[1] + e1[2] * p[2];
+	if (det == 0.0f) {
+		return 0;
+	}
+	float inv = 1.0f / det;
+	float a = (s[0] * p[0] + s[1] * p[1] + s[2] * p[2]) * inv;
+	if (a < 0.0f || a > 1.0f) {
+		return 0;
+	}
+	q[0] = s[1] * e1[2] - s[2] * e1[1];
+	q[1] = s[2] * e1[0] - s[0] * e1[2];
+	q[2] = s[0] * e1[1] - s[1] * e1[0];
+	float b = (d[0] * q[0] + d[1] * q[1] + d[2] * q[2]) * inv;
+	if (b < 0.0f || a + b > 1.0f) {
+		return 0;
+	}
+	float distance = (e2[0] * q[0] + e2[1] * q[1] + e2[2] * q[2]) * inv;
+	if (!(distance >= ray->t_min && distance <= t_max)) {
+		return 0;
+	}
+	*t = distance;
+	*u = a;
+	*w = b;
+	return 1;
+}
+
+/** Intersects a ray with a node's box.
+ * @param entry Output t where the ray enters the box.
+ * @returns 1 if the ray meets the box within [t_min, t_max].
+ */
+static inline int hit_box(const bvh_node_t* node,
+	const bvh_ray_t* ray,
+	const float inverse[3],
+	float t_max,
+	float* entry) {
+	float near = ray->t_min, far = t_max;
+	for (uint32_t k = 0; k < 3; k++) {
+		float a = (node->lower[k] - ray->origin[k]) * inverse[k];
+		float b = (node->upper[k] - ray->origin[k]) * inverse[k];
+		// A ray lying in a slab's plane gives a NaN, which no comparison
+		// lets through.
+		float enter = a < b ? a : b, leave = a < b ? b : a;
+		near = enter > near ? enter : near;
+		far = leave < far ? leave : far;
+	}
+	*entry = near;
+	// Rounding can put the far side of a box a few ulps before a hit on it.
+	return near <= far * (1.0f + 4.0f * FLT_EPSILON);
+}
+
+/** Walks the hierarchy nearest child first, skipping nodes past the
+ * closest hit so far.
+ * @param hit Output hit, or NULL to stop at the first hit.
+ * @returns 1 if the ray hits a triangle, 0 otherwise.
+ */
+static int traverse(const bvh_t* bvh, const bvh_ray_t* ray, bvh_hit_t* hit) {
+	uint32_t stack[BVH_MAX_DEPTH];
+	float entries[BVH_MAX_DEPTH];
+	uint32_t size = 0;
+	float inverse[3], t_max = ray->t_max, entry;
+	int found = 0;
+	for (uint32_t k = 0; k < 3; k++) {
+		inverse[k] = 1.0f / ray->direction[k];
+	}
+	if (!bvh->num_nodes ||
+		!hit_box(&bvh->nodes[0], ray, inverse, t_max, &entry)) {
+		return 0;
+	}
+	uint32_t index = 0;
+	for (;;) {
+		const bvh_node_t* node = &bvh->nodes[index];
+		if (node->count) {
+			for (uint32_t i = node->offset; i < node->offset + node->count;
+				i++) {
+				float t, u, v;
+				if (!hit_triangle(bvh->vertices + 9 * (size_t)i, ray, t_max,
+					&t, &u, &v)) {
+					continue;
+				}
+				if (!hit) {
+					return 1;
+				}
+				found = 1;
+				t_max = t;
+				*hit = (bvh_hit_t) { .t = t, .u = u, .v = v,
+					.face = bvh->faces[i] };
+			}
+		} else {
+			uint32_t first = index + 1, second = node->offset;
+			float first_entry, second_entry;
+			int first_hit = hit_box(&bvh->nodes[first], ray, inverse, t_max,
+				&first_entry);
+			int second_hit = hit_box(&bvh->nodes[second], ray, inverse,
+				t_max, &second_entry);
+			if (first_hit && second_hit) {
+				if (second_entry < first_entry) {
+					stack[size] = first;
+					entries[size++] = first_entry;
+					index = second;
+				} else {
+					stack[size] = second;
+					entries[size++] = second_entry;
+					index = first;
+				}
+				continue;
+			}
+			if (first_hit || second_hit) {
+				index = first_hit ? first : second;
+				continue;
+			}
+		}
+		// Resume at the nearest node put aside that is not past the closest
+		// hit.
+		while (size && entries[size - 1] > t_max * (1.0f + 4.0f * FLT_EPSILON)) {
+			size--;
+		}
+		if (!size) {
+			break;
+		}
+		index = stack[--size];
+	}
+	return found;
+}
+
+// -----------------------------------------------------------------------------
+// Implementation
+// -----------------------------------------------------------------------------
+
+int
+bvh_build(const mesh_t* mesh, uint32_t num_threads, bvh_t* out) {
+	memset(out, 0, sizeof *out);
+	if (mesh->vertex_dim < 3 || mesh->num_corners != mesh->num_faces * 3 ||
+		(mesh->num_faces && (mesh->face_dim != 3 || !mesh->face_indices))) {
+		return INVALID_DIMS;
+	}
+	if (mesh->num_faces == 0) {
+		return SUCCESS;
+	}
+	if (num_threads == 0) {
+		num_threads = parallel_threads();
+	}
+	uint32_t n = mesh->num_faces;
+	builder_t builder = {
+		.mesh = mesh,
+		.num_triangles = n,
+		.num_threads = num_threads,
+		.num_tasks = num_threads * TASKS_PER_THREAD,
+		// One thread builds the whole tree as one job.
+		.grain = num_threads > 1 ? n / (num_threads * TASKS_PER_THREAD) : n
+	};
+	node_list_t top = {0};
+	int code = SUCCESS;
+	builder.prims = malloc((size_t)n * sizeof *builder.prims + 1);
+	builder.task_bins = malloc(builder.num_tasks * sizeof *builder.task_bins);
+	out->faces = malloc((size_t)n * sizeof *out->faces + 1);
+	out->vertices = malloc((size_t)n * 9 * sizeof *out->vertices + 1);
+	if (!builder.prims || !builder.task_bins || !out->faces || !out->vertices) {
+		code = MEMORY_REFUSED;
+	}
+
+	if (code == SUCCESS) {
+		parallel_for(builder.num_tasks, num_threads, bound_triangles,
+			&builder);
+		span_t root = { .begin = 0, .end = n };
+		bound_span(&builder, &root);
+		code = build_node(&builder, &top, &root, 0, 1, &out->depth);
+	}
+	if (code == SUCCESS) {
+		parallel_for(builder.num_jobs, num_threads, build_job, &builder);
+		for (uint32_t j = 0; j < builder.num_jobs; j++) {
+			if (builder.jobs[j].code != SUCCESS) {
+				code = builder.jobs[j].code;
+			}
+			if (builder.jobs[j].max_depth > out->depth) {
+				out->depth = builder.jobs[j].max_depth;
+			}
+		}
+	}
+	if (code == SUCCESS) {
+		code = splice_jobs(&builder, &top, out);
+	}
+	if (code == SUCCESS) {
+		// The leaves' triangles, in leaf order, for traversal to read in turn.
+		for (uint32_t i = 0; i < n; i++) {
+			uint32_t t = builder.prims[i].triangle;
+			out->faces[i] = t;
+			for (uint32_t j = 0; j < 3; j++) {
+				memcpy(out->vertices + 9 * (size_t)i + 3 * j, mesh->positions
+					+ (size_t)(mesh->face_indices[3 * (size_t)t + j] - 1)
+					* mesh->vertex_dim, 3 * sizeof(float));
+			}
+		}
+		out->num_triangles = n;
+	}
+
+	for (uint32_t j = 0; j < builder.num_jobs; j++) {
+		free(builder.jobs[j].list.nodes);
+	}
+	free(builder.jobs);
+	free(top.nodes);
+	free(builder.prims);
+	free(builder.task_bins);
+	if (code != SUCCESS) {
+		bvh_destroy(out);
+	}
+	return code;
+}
+
+int
+bvh_closest_hit(const bvh_t* bvh, const bvh_ray_t* ray, bvh_hit_t* hit) {
+	return traverse(bvh, ray, hit);
+}
+
+int
+bvh_any_hit(const bvh_t* bvh, const bvh_ray_t* ray) {
+	return traverse(bvh, ray, NULL);
+}
+
+void
+bvh_destroy(bvh_t* bvh) {
+	free(bvh->nodes);
+	free(bvh->faces);
+	free(bvh->vertices);
+	memset(bvh, 0, sizeof *bvh);
+}
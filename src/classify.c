@@ -0,0 +1,294 @@
+#include "classify.h"
+#include "defs.h"
+#include "utils.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define CLASSIFY_X86
+#include <immintrin.h>
+#endif
+
+// -----------------------------------------------------------------------------
+// Static utility
+// -----------------------------------------------------------------------------
+
+/* The number of bytes classify_file reads at once. */
+#define CLASSIFY_BLOCK (1 << 16)
+
+/* Line starts that need the bytes up to 2 past them; the bytes before the end
+ * of a block are carried into the next. */
+#define CLASSIFY_CARRY 3
+
+static inline int is_blank(char c) {
+	return c == ' ' || c == '\t';
+}
+
+/** Classifies the line starting at p.
+ * @param p The first byte of the line. p[0], p[1] and p[2] must be readable.
+ * @param counts The counts to add the line to.
+ */
+static inline void classify_start(const char* p, line_counts_t* counts) {
+	counts->lines++;
+	if (p[0] == 'v') {
+		if (is_blank(p[1])) {
+			counts->vertices++;
+		} else if (p[1] == 't' && is_blank(p[2])) {
+			counts->textures++;
+		} else if (p[1] == 'n' && is_blank(p[2])) {
+			counts->normals++;
+		}
+	} else if (p[0] == 'f' && is_blank(p[1])) {
+		counts->faces++;
+	} else if (p[0] == 'o' && is_blank(p[1])) {
+		counts->objects++;
+	}
+}
+
+/** Records the offset of a line start.
+ * @returns SUCCESS or MEMORY_REFUSED.
+ */
+static inline int index_push(line_index_t* index, size_t offset) {
+	if (index->count == index->capacity && 
+		array_reserve((void**)&index->starts, &index->capacity, 
+		index->count + 1, sizeof *index->starts) != SUCCESS) {
+		return MEMORY_REFUSED;
+	}
+	index->starts[index->count++] = offset;
+	return SUCCESS;
+}
+
+/** Classifies the line starting at p near the end of the data, where fewer 
+ * than 3 bytes may remain.
+ * @returns SUCCESS or MEMORY_REFUSED.
+ */
+static int classify_padded(const char* data, size_t p, size_t size, 
+	size_t origin, line_counts_t* counts, line_index_t* index) {
+	char padded[CLASSIFY_CARRY] = {0};
+	size_t available = size - p < CLASSIFY_CARRY ? size - p : CLASSIFY_CARRY;
+	memcpy(padded, data + p, available);
+	classify_start(padded, counts);
+	return index ? index_push(index, origin + p) : SUCCESS;
+}
+
+/** Classifies every line that starts in [begin, end), one byte at a time.
+ * data[begin - 1] through data[end + 1] must be readable and begin >= 1.
+ * @param origin The offset of data[0], added to every line start.
+ * @returns SUCCESS or MEMORY_REFUSED.
+ */
+static int classify_scalar(const char* data, size_t begin, size_t end, 
+	size_t origin, line_counts_t* counts, line_index_t* index) {
+	for (size_t p = begin; p < end; p++) {
+		if (data[p - 1] != '\n') {
+			continue;
+		}
+		classify_start(data + p, counts);
+		if (index && index_push(index, origin + p) != SUCCESS) {
+			return MEMORY_REFUSED;
+		}
+	}
+	return SUCCESS;
+}
+
+#ifdef CLASSIFY_X86
+/** Classifies the lines whose starts are flagged in a block's mask. Bit i 
+ * describes the byte at p + i.
+ * @returns SUCCESS or MEMORY_REFUSED.
+ */
+static inline int classify_mask(const char* data, size_t p, uint32_t starts,
+	size_t origin, line_counts_t* counts, line_index_t* index) {
+	for (; starts; starts &= starts - 1) {
+		size_t start = p + (size_t)__builtin_ctz(starts);
+		classify_start(data + start, counts);
+		if (index && index_push(index, origin + start) != SUCCESS) {
+			return MEMORY_REFUSED;
+		}
+	}
+	return SUCCESS;
+}
+
+/** The SSE2 kernel; same contract as classify_scalar. */
+__attribute__((target("sse2")))
+static int classify_sse2(const char* data, size_t begin, size_t end, 
+	size_t origin, line_counts_t* counts, line_index_t* index) {
+	const __m128i newline = _mm_set1_epi8('\n');
+	size_t p = begin;
+	for (; p + 16 <= end; p += 16) {
+		__m128i before = _mm_loadu_si128((const __m128i*)(data + p - 1));
+		uint32_t starts = (uint32_t)_mm_movemask_epi8(
+			_mm_cmpeq_epi8(before, newline));
+		if (starts && 
+			classify_mask(data, p, starts, origin, counts, index) != SUCCESS) {
+			return MEMORY_REFUSED;
+		}
+	}
+	return classify_scalar(data, p, end, origin, counts, index);
+}
+
+/** The AVX2 kernel; same contract as classify_scalar. */
+__attribute__((target("avx2")))
+static int classify_avx2(const char* data, size_t begin, size_t end, 
+	size_t origin, line_counts_t* counts, line_index_t* index) {
+	const __m256i newline = _mm256_set1_epi8('\n');
+	size_t p = begin;
+	for (; p + 32 <= end; p += 32) {
+		__m256i before = _mm256_loadu_si256((const __m256i*)(data + p - 1));
+		uint32_t starts = (uint32_t)_mm256_movemask_epi8(
+			_mm256_cmpeq_epi8(before, newline));
+		if (starts && 
+			classify_mask(data, p, starts, origin, counts, index) != SUCCESS) {
+			_mm256_zeroupper();
+			return MEMORY_REFUSED;
+		}
+	}
+	// Leaving the upper halves of the registers dirty slows down every SSE 
+	// instruction that runs afterwards.
+	_mm256_zeroupper();
+	return classify_scalar(data, p, end, origin, counts, index);
+}
+#endif
+
+typedef int (*classify_range_t)(const char* data, size_t begin, size_t end, 
+	size_t origin, line_counts_t* counts, line_index_t* index);
+
+/** Picks the implementation of a kernel, falling back to the best kernel the
+ * processor supports.
+ */
+static classify_range_t classify_range(classify_kernel_t kernel) {
+	classify_kernel_t best = classify_best();
+	if (kernel == CLASSIFY_AUTO || kernel > best) {
+		kernel = best;
+	}
+	switch (kernel) {
+#ifdef CLASSIFY_X86
+		case CLASSIFY_AVX2:
+			return classify_avx2;
+		case CLASSIFY_SSE2:
+			return classify_sse2;
+#endif
+		default:
+			return classify_scalar;
+	}
+}
+
+// -----------------------------------------------------------------------------
+// Implementation
+// -----------------------------------------------------------------------------
+
+classify_kernel_t
+classify_best(void) {
+#ifdef CLASSIFY_X86
+	// Reads the CPUID feature bits, including the OS support for the AVX 
+	// registers.
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		return CLASSIFY_AVX2;
+	}
+	if (__builtin_cpu_supports("sse2")) {
+		return CLASSIFY_SSE2;
+	}
+#endif
+	return CLASSIFY_SCALAR;
+}
+
+const char*
+classify_name(classify_kernel_t kernel) {
+	switch (kernel) {
+		case CLASSIFY_AUTO:
+			return "auto";
+		case CLASSIFY_SSE2:
+			return "sse2";
+		case CLASSIFY_AVX2:
+			return "avx2";
+		default:
+			return "scalar";
+	}
+}
+
+int
+classify_lines(const char* data, 
+	size_t size, 
+	classify_kernel_t kernel, 
+	line_counts_t* counts, 
+	line_index_t* index) {
+	*counts = (line_counts_t) {0};
+	if (index) {
+		index->count = 0;
+	}
+	if (size == 0) {
+		return SUCCESS;
+	}
+	if (classify_padded(data, 0, size, 0, counts, index) != SUCCESS) {
+		return MEMORY_REFUSED;
+	}
+	// Every start before size - 2 has its next two bytes in the data.
+	size_t end = size > CLASSIFY_CARRY ? size - 2 : 1;
+	if (end > 1 && 
+		classify_range(kernel)(data, 1, end, 0, counts, index) != SUCCESS) {
+		return MEMORY_REFUSED;
+	}
+	for (size_t p = end; p < size; p++) {
+		if (data[p - 1] == '\n' && 
+			classify_padded(data, p, size, 0, counts, index) != SUCCESS) {
+			return MEMORY_REFUSED;
+		}
+	}
+	return SUCCESS;
+}
+
+int
+classify_file(FILE* file, line_counts_t* counts, line_index_t* index) {
+	char* buffer = malloc(CLASSIFY_BLOCK + CLASSIFY_CARRY);
+	if (!buffer) {
+		return MEMORY_REFUSED;
+	}
+	classify_range_t range = classify_range(CLASSIFY_AUTO);
+	*counts = (line_counts_t) {0};
+	if (index) {
+		index->count = 0;
+	}
+	// buffer[0] is at offset origin of the file, and every line start before
+	// buffer[begin] has been classified.
+	size_t origin = 0;
+	size_t keep = 0;
+	size_t begin = 0;
+	int code = SUCCESS;
+	for (;;) {
+		size_t n = fread(buffer + keep, 1, CLASSIFY_BLOCK, file);
+		size_t total = keep + n;
+		if (begin == 0 && total > 0) {
+			if ((code = classify_padded(buffer, 0, total, origin, counts, 
+				index)) != SUCCESS) {
+				break;
+			}
+			begin = 1;
+		}
+		if (n == 0) {
+			// The end of the file; the last starts have fewer bytes after them.
+			for (size_t p = begin; p < total && code == SUCCESS; p++) {
+				if (buffer[p - 1] == '\n') {
+					code = classify_padded(buffer, p, total, origin, counts, 
+						index);
+				}
+			}
+			if (ferror(file)) {
+				code = INVALID_FILE;
+			}
+			break;
+		}
+		if (total < CLASSIFY_CARRY + 1) {
+			keep = total;
+			continue;
+		}
+		if ((code = range(buffer, begin, total - 2, origin, counts, index)) 
+			!= SUCCESS) {
+			break;
+		}
+		memmove(buffer, buffer + total - CLASSIFY_CARRY, CLASSIFY_CARRY);
+		origin += total - CLASSIFY_CARRY;
+		keep = CLASSIFY_CARRY;
+		begin = 1;
+	}
+	free(buffer);
+	return code;
+}
@@ -0,0 +1,635 @@
+#include "fastfloat.h"
+#include <float.h>
+#include <stdint.h>
+#include <string.h>
+
+// -----------------------------------------------------------------------------
+// Static utility
+// -----------------------------------------------------------------------------
+
+/* The IEEE-754 binary32 format. */
+#define MANTISSA_BITS 23
+#define EXPONENT_BIAS 127
+#define INFINITE_POWER 0xFF
+
+/* Decimal exponents outside of this range always round to zero or infinity,
+ * even with 19 significant digits. */
+#define SMALLEST_POWER_OF_TEN -64
+#define LARGEST_POWER_OF_TEN 38
+
+/* A 64-bit integer holds any 19 decimal digits. */
+#define MAX_DIGITS 19
+
+/* The number of digits kept by the exact fallback. Enough to represent every
+ * halfway point between two floats exactly. */
+#define DECIMAL_DIGITS 800
+
+/* The largest shift applied to a decimal at once, so a 64-bit accumulator 
+ * never overflows. */
+#define MAX_SHIFT 60
+
+/* Exponents beyond this are clamped; they already over- or underflow. */
+#define MAX_EXPONENT 100000
+
+/** The powers of five from SMALLEST_POWER_OF_TEN to LARGEST_POWER_OF_TEN, 
+ * normalized so that the most significant bit is set, as 128-bit values 
+ * split into their high and low halves. Negative powers are rounded up.
+ */
+static const uint64_t power_of_five[][2] = {
+	{ 0xa87fea27a539e9a5u, 0x3f2398d747b36224u }, /* 5^-64 */
+	{ 0xd29fe4b18e88640eu, 0x8eec7f0d19a03aadu }, /* 5^-63 */
+	{ 0x83a3eeeef9153e89u, 0x1953cf68300424acu }, /* 5^-62 */
+	{ 0xa48ceaaab75a8e2bu, 0x5fa8c3423c052dd7u }, /* 5^-61 */
+	{ 0xcdb02555653131b6u, 0x3792f412cb06794du }, /* 5^-60 */
+	{ 0x808e17555f3ebf11u, 0xe2bbd88bbee40bd0u }, /* 5^-59 */
+	{ 0xa0b19d2ab70e6ed6u, 0x5b6aceaeae9d0ec4u }, /* 5^-58 */
+	{ 0xc8de047564d20a8bu, 0xf245825a5a445275u }, /* 5^-57 */
+	{ 0xfb158592be068d2eu, 0xeed6e2f0f0d56712u }, /* 5^-56 */
+	{ 0x9ced737bb6c4183du, 0x55464dd69685606bu }, /* 5^-55 */
+	{ 0xc428d05aa4751e4cu, 0xaa97e14c3c26b886u }, /* 5^-54 */
+	{ 0xf53304714d9265dfu, 0xd53dd99f4b3066a8u }, /* 5^-53 */
+	{ 0x993fe2c6d07b7fabu, 0xe546a8038efe4029u }, /* 5^-52 */
+	{ 0xbf8fdb78849a5f96u, 0xde98520472bdd033u }, /* 5^-51 */
+	{ 0xef73d256a5c0f77cu, 0x963e66858f6d4440u }, /* 5^-50 */
+	{ 0x95a8637627989aadu, 0xdde7001379a44aa8u }, /* 5^-49 */
+	{ 0xbb127c53b17ec159u, 0x5560c018580d5d52u }, /* 5^-48 */
+	{ 0xe9d71b689dde71afu, 0xaab8f01e6e10b4a6u }, /* 5^-47 */
+	{ 0x9226712162ab070du, 0xcab3961304ca70e8u }, /* 5^-46 */
+	{ 0xb6b00d69bb55c8d1u, 0x3d607b97c5fd0d22u }, /* 5^-45 */
+	{ 0xe45c10c42a2b3b05u, 0x8cb89a7db77c506au }, /* 5^-44 */
+	{ 0x8eb98a7a9a5b04e3u, 0x77f3608e92adb242u }, /* 5^-43 */
+	{ 0xb267ed1940f1c61cu, 0x55f038b237591ed3u }, /* 5^-42 */
+	{ 0xdf01e85f912e37a3u, 0x6b6c46dec52f6688u }, /* 5^-41 */
+	{ 0x8b61313bbabce2c6u, 0x2323ac4b3b3da015u }, /* 5^-40 */
+	{ 0xae397d8aa96c1b77u, 0xabec975e0a0d081au }, /* 5^-39 */
+	{ 0xd9c7dced53c72255u, 0x96e7bd358c904a21u }, /* 5^-38 */
+	{ 0x881cea14545c7575u, 0x7e50d64177da2e54u }, /* 5^-37 */
+	{ 0xaa242499697392d2u, 0xdde50bd1d5d0b9e9u }, /* 5^-36 */
+	{ 0xd4ad2dbfc3d07787u, 0x955e4ec64b44e864u }, /* 5^-35 */
+	{ 0x84ec3c97da624ab4u, 0xbd5af13bef0b113eu }, /* 5^-34 */
+	{ 0xa6274bbdd0fadd61u, 0xecb1ad8aeacdd58eu }, /* 5^-33 */
+	{ 0xcfb11ead453994bau, 0x67de18eda5814af2u }, /* 5^-32 */
+	{ 0x81ceb32c4b43fcf4u, 0x80eacf948770ced7u }, /* 5^-31 */
+	{ 0xa2425ff75e14fc31u, 0xa1258379a94d028du }, /* 5^-30 */
+	{ 0xcad2f7f5359a3b3eu, 0x096ee45813a04330u }, /* 5^-29 */
+	{ 0xfd87b5f28300ca0du, 0x8bca9d6e188853fcu }, /* 5^-28 */
+	{ 0x9e74d1b791e07e48u, 0x775ea264cf55347eu }, /* 5^-27 */
+	{ 0xc612062576589ddau, 0x95364afe032a819eu }, /* 5^-26 */
+	{ 0xf79687aed3eec551u, 0x3a83ddbd83f52205u }, /* 5^-25 */
+	{ 0x9abe14cd44753b52u, 0xc4926a9672793543u }, /* 5^-24 */
+	{ 0xc16d9a0095928a27u, 0x75b7053c0f178294u }, /* 5^-23 */
+	{ 0xf1c90080baf72cb1u, 0x5324c68b12dd6339u }, /* 5^-22 */
+	{ 0x971da05074da7beeu, 0xd3f6fc16ebca5e04u }, /* 5^-21 */
+	{ 0xbce5086492111aeau, 0x88f4bb1ca6bcf585u }, /* 5^-20 */
+	{ 0xec1e4a7db69561a5u, 0x2b31e9e3d06c32e6u }, /* 5^-19 */
+	{ 0x9392ee8e921d5d07u, 0x3aff322e62439fd0u }, /* 5^-18 */
+	{ 0xb877aa3236a4b449u, 0x09befeb9fad487c3u }, /* 5^-17 */
+	{ 0xe69594bec44de15bu, 0x4c2ebe687989a9b4u }, /* 5^-16 */
+	{ 0x901d7cf73ab0acd9u, 0x0f9d37014bf60a11u }, /* 5^-15 */
+	{ 0xb424dc35095cd80fu, 0x538484c19ef38c95u }, /* 5^-14 */
+	{ 0xe12e13424bb40e13u, 0x2865a5f206b06fbau }, /* 5^-13 */
+	{ 0x8cbccc096f5088cbu, 0xf93f87b7442e45d4u }, /* 5^-12 */
+	{ 0xafebff0bcb24aafeu, 0xf78f69a51539d749u }, /* 5^-11 */
+	{ 0xdbe6fecebdedd5beu, 0xb573440e5a884d1cu }, /* 5^-10 */
+	{ 0x89705f4136b4a597u, 0x31680a88f8953031u }, /* 5^-9 */
+	{ 0xabcc77118461cefcu, 0xfdc20d2b36ba7c3eu }, /* 5^-8 */
+	{ 0xd6bf94d5e57a42bcu, 0x3d32907604691b4du }, /* 5^-7 */
+	{ 0x8637bd05af6c69b5u, 0xa63f9a49c2c1b110u }, /* 5^-6 */
+	{ 0xa7c5ac471b478423u, 0x0fcf80dc33721d54u }, /* 5^-5 */
+	{ 0xd1b71758e219652bu, 0xd3c36113404ea4a9u }, /* 5^-4 */
+	{ 0x83126e978d4fdf3bu, 0x645a1cac083126eau }, /* 5^-3 */
+	{ 0xa3d70a3d70a3d70au, 0x3d70a3d70a3d70a4u }, /* 5^-2 */
+	{ 0xccccccccccccccccu, 0xcccccccccccccccdu }, /* 5^-1 */
+	{ 0x8000000000000000u, 0x0000000000000000u }, /* 5^0 */
+	{ 0xa000000000000000u, 0x0000000000000000u }, /* 5^1 */
+	{ 0xc800000000000000u, 0x0000000000000000u }, /* 5^2 */
+	{ 0xfa00000000000000u, 0x0000000000000000u }, /* 5^3 */
+	{ 0x9c40000000000000u, 0x0000000000000000u }, /* 5^4 */
+	{ 0xc350000000000000u, 0x0000000000000000u }, /* 5^5 */
+	{ 0xf424000000000000u, 0x0000000000000000u }, /* 5^6 */
+	{ 0x9896800000000000u, 0x0000000000000000u }, /* 5^7 */
+	{ 0xbebc200000000000u, 0x0000000000000000u }, /* 5^8 */
+	{ 0xee6b280000000000u, 0x0000000000000000u }, /* 5^9 */
+	{ 0x9502f90000000000u, 0x0000000000000000u }, /* 5^10 */
+	{ 0xba43b74000000000u, 0x0000000000000000u }, /* 5^11 */
+	{ 0xe8d4a51000000000u, 0x0000000000000000u }, /* 5^12 */
+	{ 0x9184e72a00000000u, 0x0000000000000000u }, /* 5^13 */
+	{ 0xb5e620f480000000u, 0x0000000000000000u }, /* 5^14 */
+	{ 0xe35fa931a0000000u, 0x0000000000000000u }, /* 5^15 */
+	{ 0x8e1bc9bf04000000u, 0x0000000000000000u }, /* 5^16 */
+	{ 0xb1a2bc2ec5000000u, 0x0000000000000000u }, /* 5^17 */
+	{ 0xde0b6b3a76400000u, 0x0000000000000000u }, /* 5^18 */
+	{ 0x8ac7230489e80000u, 0x0000000000000000u }, /* 5^19 */
+	{ 0xad78ebc5ac620000u, 0x0000000000000000u }, /* 5^20 */
+	{ 0xd8d726b7177a8000u, 0x0000000000000000u }, /* 5^21 */
+	{ 0x878678326eac9000u, 0x0000000000000000u }, /* 5^22 */
+	{ 0xa968163f0a57b400u, 0x0000000000000000u }, /* 5^23 */
+	{ 0xd3c21bcecceda100u, 0x0000000000000000u }, /* 5^24 */
+	{ 0x84595161401484a0u, 0x0000000000000000u }, /* 5^25 */
+	{ 0xa56fa5b99019a5c8u, 0x0000000000000000u }, /* 5^26 */
+	{ 0xcecb8f27f4200f3au, 0x0000000000000000u }, /* 5^27 */
+	{ 0x813f3978f8940984u, 0x4000000000000000u }, /* 5^28 */
+	{ 0xa18f07d736b90be5u, 0x5000000000000000u }, /* 5^29 */
+	{ 0xc9f2c9cd04674edeu, 0xa400000000000000u }, /* 5^30 */
+	{ 0xfc6f7c4045812296u, 0x4d00000000000000u }, /* 5^31 */
+	{ 0x9dc5ada82b70b59du, 0xf020000000000000u }, /* 5^32 */
+	{ 0xc5371912364ce305u, 0x6c28000000000000u }, /* 5^33 */
+	{ 0xf684df56c3e01bc6u, 0xc732000000000000u }, /* 5^34 */
+	{ 0x9a130b963a6c115cu, 0x3c7f400000000000u }, /* 5^35 */
+	{ 0xc097ce7bc90715b3u, 0x4b9f100000000000u }, /* 5^36 */
+	{ 0xf0bdc21abb48db20u, 0x1e86d40000000000u }, /* 5^37 */
+	{ 0x96769950b50d88f4u, 0x1314448000000000u }, /* 5^38 */
+};
+
+/* The powers of ten a float holds exactly. */
+static const float exact_power_of_ten[] = {
+	1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f
+};
+
+static inline int is_digit(char c) {
+	return c >= '0' && c <= '9';
+}
+
+static inline int is_separator(char c) {
+	return c == '.';
+}
+
+static inline float make_float(int negative, uint32_t power2, uint32_t mantissa) {
+	uint32_t bits = (negative ? 1u << 31 : 0) | power2 << MANTISSA_BITS | mantissa;
+	float value;
+	memcpy(&value, &bits, sizeof value);
+	return value;
+}
+
+/** Multiplies two 64-bit values into a 128-bit one.
+ * @param a The first factor.
+ * @param b The second factor.
+ * @param high Receives the high 64 bits of the product.
+ * @returns The low 64 bits of the product.
+ */
+static inline uint64_t full_multiply(uint64_t a, uint64_t b, uint64_t* high) {
+#if defined(__SIZEOF_INT128__)
+	__extension__ typedef unsigned __int128 uint128_t;
+	uint128_t product = (uint128_t)a * b;
+	*high = (uint64_t)(product >> 64);
+	return (uint64_t)product;
+#else
+	uint64_t a_lo = (uint32_t)a, a_hi = a >> 32;
+	uint64_t b_lo = (uint32_t)b, b_hi = b >> 32;
+	uint64_t lo_lo = a_lo * b_lo;
+	uint64_t hi_lo = a_hi * b_lo;
+	uint64_t lo_hi = a_lo * b_hi;
+	uint64_t cross = (lo_lo >> 32) + (uint32_t)hi_lo + lo_hi;
+	*high = a_hi * b_hi + (hi_lo >> 32) + (cross >> 32);
+	return (cross << 32) | (uint32_t)lo_lo;
+#endif
+}
+
+static inline int leading_zeros(uint64_t value) {
+	int count = 0;
+	while (!(value & (UINT64_C(1) << 63))) {
+		value <<= 1;
+		count++;
+	}
+	return count;
+}
+
+/** Converts w * 10^q to a float with the Eisel-Lemire algorithm.
+ * @param w The decimal significand. Must not be 0.
+ * @param q The decimal exponent.
+ * @param power2 Receives the biased binary exponent.
+ * @param mantissa Receives the mantissa, without the implicit bit.
+ * @returns 1 on success, or 0 if the product is too close to a halfway point 
+ * to be rounded without more precision.
+ */
+static int eisel_lemire(uint64_t w, int64_t q, uint32_t* power2, 
+	uint32_t* mantissa) {
+	if (q < SMALLEST_POWER_OF_TEN) {
+		*power2 = 0;
+		*mantissa = 0;
+		return 1;
+	}
+	if (q > LARGEST_POWER_OF_TEN) {
+		*power2 = INFINITE_POWER;
+		*mantissa = 0;
+		return 1;
+	}
+	int lz = leading_zeros(w);
+	w <<= lz;
+
+	// The product's top MANTISSA_BITS + 3 bits are all that matter, unless 
+	// the bits below them are all ones and a carry could still reach them.
+	const uint64_t* power = power_of_five[q - SMALLEST_POWER_OF_TEN];
+	const uint64_t precision_mask = UINT64_MAX >> (MANTISSA_BITS + 3);
+	uint64_t high;
+	uint64_t low = full_multiply(w, power[0], &high);
+	if ((high & precision_mask) == precision_mask) {
+		uint64_t second_high;
+		full_multiply(w, power[1], &second_high);
+		low += second_high;
+		if (second_high > low) {
+			high++;
+		}
+	}
+	if (low == UINT64_MAX && (q < -27 || q > 55)) {
+		return 0;
+	}
+
+	int upperbit = (int)(high >> 63);
+	uint64_t m = high >> (upperbit + 64 - MANTISSA_BITS - 3);
+	// floor(log2(10^q)) + 63, computed as q * log2(10) in fixed point.
+	int32_t binary = (int32_t)((((152170 + 65536) * q) >> 16) + 63);
+	int32_t exponent = binary + upperbit - lz + EXPONENT_BIAS;
+
+	if (exponent <= 0) {
+		// Subnormal: shift the mantissa down into place and round.
+		if (-exponent + 1 >= 64) {
+			*power2 = 0;
+			*mantissa = 0;
+			return 1;
+		}
+		m >>= -exponent + 1;
+		m += m & 1;
+		m >>= 1;
+		*power2 = m < (UINT64_C(1) << MANTISSA_BITS) ? 0 : 1;
+		*mantissa = (uint32_t)(m & ((UINT64_C(1) << MANTISSA_BITS) - 1));
+		return 1;
+	}
+
+	// Exactly halfway between two floats: round to even. Only small powers 
+	// of ten can produce an exact halfway product.
+	if (low <= 1 && q >= -17 && q <= 10 && (m & 3) == 1 &&
+		(m << (upperbit + 64 - MANTISSA_BITS - 3)) == high) {
+		m &= ~UINT64_C(1);
+	}
+	m += m & 1;
+	m >>= 1;
+	if (m >= (UINT64_C(2) << MANTISSA_BITS)) {
+		m = UINT64_C(1) << MANTISSA_BITS;
+		exponent++;
+	}
+	m &= ~(UINT64_C(1) << MANTISSA_BITS);
+	if (exponent >= INFINITE_POWER) {
+		exponent = INFINITE_POWER;
+		m = 0;
+	}
+	*power2 = (uint32_t)exponent;
+	*mantissa = (uint32_t)m;
+	return 1;
+}
+
+/** An arbitrary-precision decimal 0.d[0]d[1]...d[nd-1] * 10^dp, used when the
+ * fast paths cannot decide how to round.
+ */
+typedef struct {
+	uint8_t d[DECIMAL_DIGITS];
+	int nd;
+	int dp;
+	/* Set if nonzero digits were dropped past d[nd - 1]. */
+	int truncated;
+} decimal_t;
+
+static void decimal_trim(decimal_t* a) {
+	while (a->nd > 0 && a->d[a->nd - 1] == 0) {
+		a->nd--;
+	}
+	if (a->nd == 0) {
+		a->dp = 0;
+	}
+}
+
+/** Multiplies a decimal by 2^k.
+ * @param a The decimal.
+ * @param k The shift, at most MAX_SHIFT.
+ */
+static void decimal_left_shift(decimal_t* a, unsigned int k) {
+	// 2^MAX_SHIFT has 19 digits, so at most 19 digits are added.
+	uint8_t digits[DECIMAL_DIGITS + MAX_DIGITS];
+	int w = a->nd + MAX_DIGITS;
+	uint64_t n = 0;
+	for (int r = a->nd - 1; r >= 0; r--) {
+		n += (uint64_t)a->d[r] << k;
+		digits[--w] = (uint8_t)(n % 10);
+		n /= 10;
+	}
+	while (n > 0) {
+		digits[--w] = (uint8_t)(n % 10);
+		n /= 10;
+	}
+	int count = a->nd + MAX_DIGITS - w;
+	a->dp += count - a->nd;
+	if (count > DECIMAL_DIGITS) {
+		for (int i = DECIMAL_DIGITS; i < count; i++) {
+			if (digits[w + i]) {
+				a->truncated = 1;
+			}
+		}
+		count = DECIMAL_DIGITS;
+	}
+	memcpy(a->d, digits + w, (size_t)count);
+	a->nd = count;
+	decimal_trim(a);
+}
+
+/** Divides a decimal by 2^k.
+ * @param a The decimal.
+ * @param k The shift, at most MAX_SHIFT.
+ */
+static void decimal_right_shift(decimal_t* a, unsigned int k) {
+	int r = 0;
+	int w = 0;
+	uint64_t n = 0;
+	// Pick up enough leading digits to cover the first shift.
+	for (; n >> k == 0; r++) {
+		if (r >= a->nd) {
+			if (n == 0) {
+				a->nd = 0;
+				return;
+			}
+			while (n >> k == 0) {
+				n *= 10;
+				r++;
+			}
+			break;
+		}
+		n = n * 10 + a->d[r];
+	}
+	a->dp -= r - 1;
+	const uint64_t mask = (UINT64_C(1) << k) - 1;
+	for (; r < a->nd; r++) {
+		a->d[w++] = (uint8_t)(n >> k);
+		n = (n & mask) * 10 + a->d[r];
+	}
+	while (n > 0) {
+		uint8_t digit = (uint8_t)(n >> k);
+		if (w < DECIMAL_DIGITS) {
+			a->d[w++] = digit;
+		} else if (digit > 0) {
+			a->truncated = 1;
+		}
+		n = (n & mask) * 10;
+	}
+	a->nd = w;
+	decimal_trim(a);
+}
+
+/** Multiplies a decimal by 2^shift, which may be negative. */
+static void decimal_shift(decimal_t* a, int shift) {
+	if (a->nd == 0) {
+		return;
+	}
+	for (; shift > MAX_SHIFT; shift -= MAX_SHIFT) {
+		decimal_left_shift(a, MAX_SHIFT);
+	}
+	for (; shift < -MAX_SHIFT; shift += MAX_SHIFT) {
+		decimal_right_shift(a, MAX_SHIFT);
+	}
+	if (shift > 0) {
+		decimal_left_shift(a, (unsigned int)shift);
+	} else if (shift < 0) {
+		decimal_right_shift(a, (unsigned int)-shift);
+	}
+}
+
+/** Rounds a decimal below 2^64 to the nearest integer, ties to even. */
+static uint64_t decimal_round(const decimal_t* a) {
+	uint64_t n = 0;
+	int i = 0;
+	for (; i < a->dp && i < a->nd; i++) {
+		n = n * 10 + a->d[i];
+	}
+	for (; i < a->dp; i++) {
+		n *= 10;
+	}
+	if (a->dp >= 0 && a->dp < a->nd) {
+		int up = a->d[a->dp] > 5;
+		if (a->d[a->dp] == 5) {
+			up = a->dp + 1 < a->nd || a->truncated || (n & 1);
+		}
+		n += up;
+	}
+	return n;
+}
+
+/** Converts a decimal to a float exactly by scaling it with powers of two 
+ * until the mantissa bits are integral.
+ * @param a The decimal. Destroyed.
+ * @param power2 Receives the biased binary exponent.
+ * @param mantissa Receives the mantissa, without the implicit bit.
+ */
+static void decimal_to_float(decimal_t* a, uint32_t* power2, 
+	uint32_t* mantissa) {
+	static const int shifts[] = { 1, 3, 6, 9, 13, 16, 19, 23, 26 };
+	const int shift_count = (int)(sizeof shifts / sizeof *shifts);
+	if (a->nd == 0 || a->dp < SMALLEST_POWER_OF_TEN) {
+		*power2 = 0;
+		*mantissa = 0;
+		return;
+	}
+	if (a->dp > LARGEST_POWER_OF_TEN + 1) {
+		*power2 = INFINITE_POWER;
+		*mantissa = 0;
+		return;
+	}
+	// Scale into [0.5, 1).
+	int exponent = 0;
+	while (a->dp > 0) {
+		int n = a->dp >= shift_count ? 27 : shifts[a->dp];
+		decimal_shift(a, -n);
+		exponent += n;
+	}
+	while (a->dp < 0 || (a->dp == 0 && a->d[0] < 5)) {
+		int n = -a->dp >= shift_count ? 27 : shifts[-a->dp];
+		decimal_shift(a, n);
+		exponent -= n;
+	}
+	// Floats are scaled into [1, 2).
+	exponent--;
+	const int minimum = 1 - EXPONENT_BIAS;
+	if (exponent < minimum) {
+		decimal_shift(a, -(minimum - exponent));
+		exponent = minimum;
+	}
+	if (exponent + EXPONENT_BIAS >= INFINITE_POWER) {
+		*power2 = INFINITE_POWER;
+		*mantissa = 0;
+		return;
+	}
+	decimal_shift(a, MANTISSA_BITS + 1);
+	uint64_t m = decimal_round(a);
+	if (m == UINT64_C(2) << MANTISSA_BITS) {
+		m >>= 1;
+		exponent++;
+		if (exponent + EXPONENT_BIAS >= INFINITE_POWER) {
+			*power2 = INFINITE_POWER;
+			*mantissa = 0;
+			return;
+		}
+	}
+	// Without the implicit bit the value is subnormal.
+	*power2 = m & (UINT64_C(1) << MANTISSA_BITS) 
+		? (uint32_t)(exponent + EXPONENT_BIAS) : 0;
+	*mantissa = (uint32_t)(m & ((UINT64_C(1) << MANTISSA_BITS) - 1));
+}
+
+/** Loads every digit of a mantissa into a decimal.
+ * @param a The decimal.
+ * @param first The first digit or separator of the mantissa.
+ * @param last One past the end of the mantissa.
+ * @param exponent The explicit decimal exponent.
+ */
+static void decimal_load(decimal_t* a, const char* first, const char* last,
+	int64_t exponent) {
+	a->nd = 0;
+	a->dp = 0;
+	a->truncated = 0;
+	int seen_separator = 0;
+	for (const char* p = first; p < last; p++) {
+		if (is_separator(*p)) {
+			seen_separator = 1;
+			continue;
+		}
+		if (!seen_separator) {
+			a->dp++;
+		}
+		if (a->nd == 0 && *p == '0') {
+			// Leading zeros only move the decimal point.
+			a->dp--;
+			continue;
+		}
+		if (a->nd < DECIMAL_DIGITS) {
+			a->d[a->nd++] = (uint8_t)(*p - '0');
+		} else if (*p != '0') {
+			a->truncated = 1;
+		}
+	}
+	a->dp += (int)exponent;
+	decimal_trim(a);
+}
+
+/** Matches a case-insensitive word at the start of a range.
+ * @returns One past the word, or NULL if it does not match.
+ */
+static const char* match_word(const char* first, const char* last, 
+	const char* word) {
+	for (; *word; word++, first++) {
+		if (first >= last || (*first | 0x20) != *word) {
+			return NULL;
+		}
+	}
+	return first;
+}
+
+// -----------------------------------------------------------------------------
+// Implementation
+// -----------------------------------------------------------------------------
+
+const char* 
+fastfloat_parse(const char* first, const char* last, float* dest) {
+	const char* p = first;
+	int negative = 0;
+	if (p < last && (*p == '-' || *p == '+')) {
+		negative = *p == '-';
+		p++;
+	}
+	if (p < last && ((*p | 0x20) == 'i' || (*p | 0x20) == 'n')) {
+		const char* end;
+		if ((end = match_word(p, last, "nan"))) {
+			*dest = make_float(negative, INFINITE_POWER, 1u << (MANTISSA_BITS - 1));
+			return end;
+		}
+		if ((end = match_word(p, last, "inf"))) {
+			const char* longer = match_word(end, last, "inity");
+			*dest = make_float(negative, INFINITE_POWER, 0);
+			return longer ? longer : end;
+		}
+		return NULL;
+	}
+
+	// Accumulate up to MAX_DIGITS significant digits; anything beyond only 
+	// moves the decimal point.
+	const char* mantissa = p;
+	uint64_t w = 0;
+	int digits = 0;
+	int significant = 0;
+	int64_t exponent = 0;
+	int seen_separator = 0;
+	for (; p < last; p++) {
+		if (is_digit(*p)) {
+			digits++;
+			if (significant == 0 && *p == '0') {
+				exponent -= seen_separator;
+				continue;
+			}
+			if (significant < MAX_DIGITS) {
+				w = w * 10 + (uint64_t)(*p - '0');
+				exponent -= seen_separator;
+			} else {
+				exponent += !seen_separator;
+			}
+			significant++;
+		} else if (is_separator(*p) && !seen_separator) {
+			seen_separator = 1;
+		} else {
+			break;
+		}
+	}
+	if (digits == 0) {
+		return NULL;
+	}
+	const char* mantissa_end = p;
+	int64_t explicit_exponent = 0;
+	if (p < last && (*p | 0x20) == 'e') {
+		const char* e = p + 1;
+		int exponent_negative = 0;
+		if (e < last && (*e == '-' || *e == '+')) {
+			exponent_negative = *e == '-';
+			e++;
+		}
+		if (e < last && is_digit(*e)) {
+			for (; e < last && is_digit(*e); e++) {
+				if (explicit_exponent < MAX_EXPONENT) {
+					explicit_exponent = explicit_exponent * 10 + (*e - '0');
+				}
+			}
+			if (exponent_negative) {
+				explicit_exponent = -explicit_exponent;
+			}
+			exponent += explicit_exponent;
+			p = e;
+		}
+	}
+
+	if (w == 0) {
+		*dest = make_float(negative, 0, 0);
+		return p;
+	}
+#if FLT_EVAL_METHOD == 0
+	// Both w and 10^|q| are exact floats, so one correctly rounded operation
+	// gives the correctly rounded result.
+	if (significant <= MAX_DIGITS && w <= (UINT64_C(1) << (MANTISSA_BITS + 1)) 
+		&& exponent >= -10 && exponent <= 10) {
+		float value = (float)w;
+		value = exponent < 0 ? value / exact_power_of_ten[-exponent] 
+			: value * exact_power_of_ten[exponent];
+		*dest = negative ? -value : value;
+		return p;
+	}
+#endif
+	uint32_t power2, mantissa_bits;
+	int decided = eisel_lemire(w, exponent, &power2, &mantissa_bits);
+	if (decided && significant > MAX_DIGITS) {
+		// The dropped digits put the value between w and w + 1.
+		uint32_t upper_power2, upper_mantissa;
+		decided = eisel_lemire(w + 1, exponent, &upper_power2, 
+			&upper_mantissa) && upper_power2 == power2 && 
+			upper_mantissa == mantissa_bits;
+	}
+	if (!decided) {
+		decimal_t decimal;
+		decimal_load(&decimal, mantissa, mantissa_end, explicit_exponent);
+		decimal_to_float(&decimal, &power2, &mantissa_bits);
+	}
+	*dest = make_float(negative, power2, mantissa_bits);
+	return p;
+}
@@ -0,0 +1,113 @@
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "filemap.h"
+#include "defs.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// -----------------------------------------------------------------------------
+// Static utility
+// -----------------------------------------------------------------------------
+
+/** Reads the whole file into a heap buffer. Used where mmap is unavailable.
+ * @param fn Filename of the file.
+ * @param map Output view of the file.
+ * @return [SUCCESS, INVALID_FILE, MEMORY_REFUSED]
+ */
+static int
+filemap_read(const char* fn, filemap_t* map) {
+	FILE* file = fopen(fn, "rb");
+	if (!file) {
+		return INVALID_FILE;
+	}
+	if (fseek(file, 0, SEEK_END) != 0) {
+		fclose(file);
+		return INVALID_FILE;
+	}
+	long size = ftell(file);
+	if (size < 0 || fseek(file, 0, SEEK_SET) != 0) {
+		fclose(file);
+		return INVALID_FILE;
+	}
+	if (size == 0) {
+		fclose(file);
+		return SUCCESS;
+	}
+	char* data = malloc((size_t)size);
+	if (!data) {
+		fclose(file);
+		return MEMORY_REFUSED;
+	}
+	if (fread(data, 1, (size_t)size, file) != (size_t)size) {
+		free(data);
+		fclose(file);
+		return INVALID_FILE;
+	}
+	fclose(file);
+	map->data = data;
+	map->size = (size_t)size;
+	return SUCCESS;
+}
+
+// -----------------------------------------------------------------------------
+// Implementation
+// -----------------------------------------------------------------------------
+int
+filemap_open(const char* fn, filemap_t* map) {
+	*map = (filemap_t) { .data = NULL, .size = 0, .mapped = 0 };
+#ifdef _WIN32
+	return filemap_read(fn, map);
+#else
+	int fd = open(fn, O_RDONLY);
+	if (fd < 0) {
+		return INVALID_FILE;
+	}
+	struct stat info;
+	if (fstat(fd, &info) != 0) {
+		close(fd);
+		return INVALID_FILE;
+	}
+	if (!S_ISREG(info.st_mode)) {
+		// Pipes and devices cannot be mapped.
+		close(fd);
+		return filemap_read(fn, map);
+	}
+	if (info.st_size == 0) {
+		close(fd);
+		return SUCCESS;
+	}
+	void* data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 
+		0);
+	close(fd);
+	if (data == MAP_FAILED) {
+		return filemap_read(fn, map);
+	}
+	posix_madvise(data, (size_t)info.st_size, POSIX_MADV_SEQUENTIAL);
+	map->data = data;
+	map->size = (size_t)info.st_size;
+	map->mapped = 1;
+	return SUCCESS;
+#endif
+}
+
+void
+filemap_close(filemap_t* map) {
+#ifndef _WIN32
+	if (map->mapped) {
+		munmap((void*)map->data, map->size);
+	} else
+#endif
+	{
+		free((void*)map->data);
+	}
+	*map = (filemap_t) { .data = NULL, .size = 0, .mapped = 0 };
+}
@@ -0,0 +1,875 @@
+#include "hull.h"
+#include "bounds.h"
+#include "defs.h"
+#include "parallel.h"
+#include "utils.h"
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// -----------------------------------------------------------------------------
+// Static utility
+// -----------------------------------------------------------------------------
+
+/* The number of tasks per thread when splitting even shares of work. */
+#define TASKS_PER_THREAD 4
+
+/* Ends a conflict list and marks a point that is no face's. */
+#define NONE UINT32_MAX
+
+/** @struct hull_face_t
+ * @brief A triangle of the hull so far and the points outside it.
+ */
+typedef struct {
+	/** Counterclockwise seen from outside. */
+	uint32_t v[3];
+	/** The face across the edge from v[i] to v[(i + 1) % 3]. */
+	uint32_t neighbor[3];
+	/** The unit outward normal and the distance of the plane from the
+	 * origin along it. */
+	double normal[3];
+	double offset;
+	/** The first point of the list of points further outside this face than
+	 * any other, and the furthest of them. */
+	uint32_t head;
+	uint32_t furthest;
+	double distance;
+	uint8_t alive;
+	uint8_t visible;
+} hull_face_t;
+
+/** @struct horizon_t
+ * @brief An edge between the faces the eye sees and one it does not, from a
+ * seen face, as that face winds it.
+ */
+typedef struct {
+	uint32_t from;
+	uint32_t to;
+	/** The unseen face across the edge. */
+	uint32_t face;
+} horizon_t;
+
+/** @struct visit_t
+ * @brief A face on the stack of the search for the horizon, and how many of
+ * its edges are left to cross.
+ */
+typedef struct {
+	uint32_t face;
+	uint32_t edge;
+	uint32_t left;
+} visit_t;
+
+/** @struct extremes_t
+ * @brief The first points with the least and greatest x, y and z.
+ */
+typedef struct {
+	uint32_t index[6];
+} extremes_t;
+
+/** @struct furthest_t
+ * @brief The first point furthest from something, and how far.
+ */
+typedef struct {
+	double distance;
+	uint32_t index;
+} furthest_t;
+
+/** @struct hull_builder_t
+ * @brief The hull being grown and the state of the parallel passes.
+ */
+typedef struct {
+	/** Every position, three doubles each. */
+	double* points;
+	uint32_t num_points;
+	/** How far outside a face a point must be to count. */
+	double epsilon;
+	hull_face_t* faces;
+	uint32_t num_faces;
+	uint32_t face_cap;
+	/** The next point of the list each point is in. */
+	uint32_t* next;
+	/** The face each point is furthest outside of, and how far. */
+	uint32_t* owner;
+	double* distance;
+	/** The new face starting at each vertex while the horizon is linked. */
+	uint32_t* fan;
+	horizon_t* horizon;
+	uint32_t horizon_cap;
+	visit_t* stack;
+	uint32_t stack_cap;
+	/** The faces the point being added sees. */
+	uint32_t* seen;
+	uint32_t num_seen;
+	uint32_t seen_cap;
+	uint32_t num_tasks;
+	/** The line or plane the furthest point is looked for from: one point
+	 * and a direction, or a normal and an offset. */
+	double origin[3];
+	double axis[3];
+	double plane_offset;
+	int from_plane;
+	extremes_t* task_extremes;
+	furthest_t* task_furthest;
+} hull_builder_t;
+
+static void task_range(uint32_t count,
+	uint32_t task,
+	uint32_t num_tasks,
+	uint32_t* begin,
+	uint32_t* end) {
+	*begin = (uint32_t)((uint64_t)count * task / num_tasks);
+	*end = (uint32_t)((uint64_t)count * (task + 1) / num_tasks);
+}
+
+static inline double dot3(const double a[3], const double b[3]) {
+	return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+static inline void cross3(const double a[3], const double b[3], double out[3]) {
+	out[0] = a[1] * b[2] - a[2] * b[1];
+	out[1] = a[2] * b[0] - a[0] * b[2];
+	out[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+static inline void sub3(const double a[3], const double b[3], double out[3]) {
+	out[0] = a[0] - b[0];
+	out[1] = a[1] - b[1];
+	out[2] = a[2] - b[2];
+}
+
+static inline const double* point_at(const hull_builder_t* builder,
+	uint32_t i) {
+	return builder->points + 3 * (size_t)i;
+}
+
+static inline double face_distance(const hull_face_t* face, const double* p) {
+	return dot3(face->normal, p) - face->offset;
+}
+
+/** The distance of a point from the line through origin along the unit axis,
+ * or from the plane with normal axis and offset plane_offset, of a builder.
+ */
+static double query_distance(const hull_builder_t* builder, const double* p) {
+	if (builder->from_plane) {
+		return fabs(dot3(builder->axis, p) - builder->plane_offset);
+	}
+	double d[3], c[3];
+	sub3(p, builder->origin, d);
+	cross3(d, builder->axis, c);
+	return sqrt(dot3(c, c));
+}
+
+/** Finds the extreme points of one task's share of the points.
+ */
+static void extreme_share(void* ctx, uint32_t task) {
+	hull_builder_t* builder = ctx;
+	uint32_t begin, end;
+	task_range(builder->num_points, task, builder->num_tasks, &begin, &end);
+	extremes_t* extremes = &builder->task_extremes[task];
+	for (uint32_t k = 0; k < 6; k++) {
+		extremes->index[k] = begin < end ? begin : NONE;
+	}
+	for (uint32_t i = begin + 1; i < end; i++) {
+		const double* p = point_at(builder, i);
+		for (uint32_t k = 0; k < 3; k++) {
+			if (p[k] < point_at(builder, extremes->index[2 * k])[k]) {
+				extremes->index[2 * k] = i;
+			}
+			if (p[k] > point_at(builder, extremes->index[2 * k + 1])[k]) {
+				extremes->index[2 * k + 1] = i;
+			}
+		}
+	}
+}
+
+/** Finds the first point of one task's share furthest from the line or plane
+ * of the builder.
+ */
+static void furthest_share(void* ctx, uint32_t task) {
+	hull_builder_t* builder = ctx;
+	uint32_t begin, end;
+	task_range(builder->num_points, task, builder->num_tasks, &begin, &end);
+	furthest_t best = { -1.0, NONE };
+	for (uint32_t i = begin; i < end; i++) {
+		double d = query_distance(builder, point_at(builder, i));
+		if (d > best.distance) {
+			best.distance = d;
+			best.index = i;
+		}
+	}
+	builder->task_furthest[task] = best;
+}
+
+/** Finds the point furthest from the line or plane of the builder, the
+ * first of them on ties, whatever the number of tasks.
+ */
+static furthest_t find_furthest(hull_builder_t* builder,
+	uint32_t num_threads) {
+	parallel_for(builder->num_tasks, num_threads, furthest_share, builder);
+	furthest_t best = { -1.0, NONE };
+	for (uint32_t t = 0; t < builder->num_tasks; t++) {
+		if (builder->task_furthest[t].distance > best.distance) {
+			best = builder->task_furthest[t];
+		}
+	}
+	return best;
+}
+
+/** Assigns one task's share of the points to the face of the first
+ * tetrahedron they are furthest outside of, if any.
+ */
+static void partition_share(void* ctx, uint32_t task) {
+	hull_builder_t* builder = ctx;
+	uint32_t begin, end;
+	task_range(builder->num_points, task, builder->num_tasks, &begin, &end);
+	for (uint32_t i = begin; i < end; i++) {
+		const double* p = point_at(builder, i);
+		uint32_t owner = NONE;
+		double best = builder->epsilon;
+		for (uint32_t f = 0; f < 4; f++) {
+			double d = face_distance(&builder->faces[f], p);
+			if (d > best) {
+				best = d;
+				owner = f;
+			}
+		}
+		builder->owner[i] = owner;
+		builder->distance[i] = best;
+	}
+}
+
+/** Puts a point in the list of a face.
+ */
+static inline void push_conflict(hull_builder_t* builder,
+	uint32_t face,
+	uint32_t point,
+	double distance) {
+	hull_face_t* f = &builder->faces[face];
+	builder->next[point] = f->head;
+	f->head = point;
+	if (distance > f->distance ||
+		(distance == f->distance && point < f->furthest)) {
+		f->distance = distance;
+		f->furthest = point;
+	}
+}
+
+/** Appends the face a, b, c to the hull, with its plane and no points or
+ * neighbors.
+ * @return The index of the face, or NONE if it could not be allocated.
+ */
+static uint32_t add_face(hull_builder_t* builder,
+	uint32_t a,
+	uint32_t b,
+	uint32_t c) {
+	if (array_reserve((void**)&builder->faces, &builder->face_cap,
+		builder->num_faces + 1, sizeof *builder->faces) != SUCCESS) {
+		return NONE;
+	}
+	hull_face_t* face = &builder->faces[builder->num_faces];
+	memset(face, 0, sizeof *face);
+	face->v[0] = a;
+	face->v[1] = b;
+	face->v[2] = c;
+	face->neighbor[0] = face->neighbor[1] = face->neighbor[2] = NONE;
+	face->head = face->furthest = NONE;
+	face->distance = -1.0;
+	face->alive = 1;
+	double ab[3], ac[3];
+	sub3(point_at(builder, b), point_at(builder, a), ab);
+	sub3(point_at(builder, c), point_at(builder, a), ac);
+	cross3(ab, ac, face->normal);
+	double length = sqrt(dot3(face->normal, face->normal));
+	// A sliver with no area keeps a zero normal, so no point is outside it.
+	for (uint32_t k = 0; length > 0.0 && k < 3; k++) {
+		face->normal[k] /= length;
+	}
+	face->offset = dot3(face->normal, point_at(builder, a));
+	return builder->num_faces++;
+}
+
+/** The edge of a face that runs from one vertex to another, or 3 if none
+ * does.
+ */
+static inline uint32_t find_edge(const hull_face_t* face,
+	uint32_t from,
+	uint32_t to) {
+	for (uint32_t e = 0; e < 3; e++) {
+		if (face->v[e] == from && face->v[(e + 1) % 3] == to) {
+			return e;
+		}
+	}
+	return 3;
+}
+
+/** Builds the first tetrahedron from the extreme points, the point furthest
+ * from the line between them and the point furthest from their plane.
+ * @return [SUCCESS, INVALID_DIMS if the points are coplanar,
+ * MEMORY_REFUSED]
+ */
+static int build_simplex(hull_builder_t* builder, uint32_t num_threads) {
+	parallel_for(builder->num_tasks, num_threads, extreme_share, builder);
+	extremes_t extremes = {{ 0, 0, 0, 0, 0, 0 }};
+	for (uint32_t t = 0; t < builder->num_tasks; t++) {
+		const extremes_t* later = &builder->task_extremes[t];
+		for (uint32_t k = 0; later->index[0] != NONE && k < 3; k++) {
+			if (point_at(builder, later->index[2 * k])[k] <
+				point_at(builder, extremes.index[2 * k])[k]) {
+				extremes.index[2 * k] = later->index[2 * k];
+			}
+			if (point_at(builder, later->index[2 * k + 1])[k] >
+				point_at(builder, extremes.index[2 * k + 1])[k]) {
+				extremes.index[2 * k + 1] = later->index[2 * k + 1];
+			}
+		}
+	}
+
+	// The extreme pair furthest apart spans the first edge.
+	uint32_t a = 0, b = 0;
+	double span = -1.0;
+	for (uint32_t k = 0; k < 3; k++) {
+		double d[3];
+		sub3(point_at(builder, extremes.index[2 * k + 1]),
+			point_at(builder, extremes.index[2 * k]), d);
+		if (dot3(d, d) > span) {
+			span = dot3(d, d);
+			a = extremes.index[2 * k];
+			b = extremes.index[2 * k + 1];
+		}
+	}
+	if (sqrt(span) <= builder->epsilon) {
+		return INVALID_DIMS;
+	}
+	memcpy(builder->origin, point_at(builder, a), sizeof builder->origin);
+	sub3(point_at(builder, b), point_at(builder, a), builder->axis);
+	for (uint32_t k = 0; k < 3; k++) {
+		builder->axis[k] /= sqrt(span);
+	}
+	builder->from_plane = 0;
+	furthest_t c = find_furthest(builder, num_threads);
+	if (c.distance <= builder->epsilon) {
+		return INVALID_DIMS;
+	}
+
+	double ab[3], ac[3];
+	sub3(point_at(builder, b), point_at(builder, a), ab);
+	sub3(point_at(builder, c.index), point_at(builder, a), ac);
+	cross3(ab, ac, builder->axis);
+	double length = sqrt(dot3(builder->axis, builder->axis));
+	for (uint32_t k = 0; k < 3; k++) {
+		builder->axis[k] /= length;
+	}
+	builder->plane_offset = dot3(builder->axis, point_at(builder, a));
+	builder->from_plane = 1;
+	furthest_t d = find_furthest(builder, num_threads);
+	if (d.distance <= builder->epsilon) {
+		return INVALID_DIMS;
+	}
+
+	// Wind the base away from the apex; the sides wind its edges back.
+	uint32_t base[3] = { a, b, c.index };
+	if (dot3(builder->axis, point_at(builder, d.index)) >
+		builder->plane_offset) {
+		base[1] = c.index;
+		base[2] = b;
+	}
+	if (add_face(builder, base[0], base[1], base[2]) == NONE ||
+		add_face(builder, base[1], base[0], d.index) == NONE ||
+		add_face(builder, base[2], base[1], d.index) == NONE ||
+		add_face(builder, base[0], base[2], d.index) == NONE) {
+		return MEMORY_REFUSED;
+	}
+	for (uint32_t f = 0; f < 4; f++) {
+		hull_face_t* face = &builder->faces[f];
+		for (uint32_t e = 0; e < 3; e++) {
+			for (uint32_t g = 0; g < 4; g++) {
+				if (find_edge(&builder->faces[g], face->v[(e + 1) % 3],
+					face->v[e]) < 3) {
+					face->neighbor[e] = g;
+				}
+			}
+		}
+	}
+	return SUCCESS;
+}
+
+/** Marks a face the point being added sees.
+ * @return [SUCCESS, MEMORY_REFUSED]
+ */
+static int see_face(hull_builder_t* builder, uint32_t face) {
+	if (array_reserve((void**)&builder->seen, &builder->seen_cap,
+		builder->num_seen + 1, sizeof *builder->seen) != SUCCESS) {
+		return MEMORY_REFUSED;
+	}
+	builder->faces[face].visible = 1;
+	builder->seen[builder->num_seen++] = face;
+	return SUCCESS;
+}
+
+/** Finds the faces a point sees from the face it is furthest outside of,
+ * crossing the edges of every face in winding order so that the horizon
+ * comes out as a loop, counterclockwise seen from the point.
+ * @return [SUCCESS, MEMORY_REFUSED]
+ */
+static int find_horizon(hull_builder_t* builder,
+	uint32_t first,
+	const double* eye,
+	uint32_t* num_horizon) {
+	uint32_t depth = 0;
+	*num_horizon = 0;
+	builder->num_seen = 0;
+	if (array_reserve((void**)&builder->stack, &builder->stack_cap, 1,
+		sizeof *builder->stack) != SUCCESS || see_face(builder, first)
+		!= SUCCESS) {
+		return MEMORY_REFUSED;
+	}
+	builder->stack[depth++] = (visit_t){ first, 0, 3 };
+	while (depth) {
+		visit_t* top = &builder->stack[depth - 1];
+		if (top->left == 0) {
+			depth--;
+			continue;
+		}
+		uint32_t face = top->face;
+		uint32_t edge = top->edge;
+		top->edge = (top->edge + 1) % 3;
+		top->left--;
+		uint32_t other = builder->faces[face].neighbor[edge];
+		hull_face_t* across = &builder->faces[other];
+		if (across->visible) {
+			continue;
+		}
+		if (face_distance(across, eye) > builder->epsilon) {
+			if (see_face(builder, other) != SUCCESS ||
+				array_reserve((void**)&builder->stack, &builder->stack_cap,
+				depth + 1, sizeof *builder->stack) != SUCCESS) {
+				return MEMORY_REFUSED;
+			}
+			// Carry on round the next face from past the edge crossed.
+			uint32_t back = 0;
+			while (across->neighbor[back] != face) {
+				back++;
+			}
+			builder->stack[depth++] = (visit_t){ other, (back + 1) % 3, 2 };
+			continue;
+		}
+		if (array_reserve((void**)&builder->horizon, &builder->horizon_cap,
+			*num_horizon + 1, sizeof *builder->horizon) != SUCCESS) {
+			return MEMORY_REFUSED;
+		}
+		const hull_face_t* seen = &builder->faces[face];
+		builder->horizon[(*num_horizon)++] = (horizon_t){ seen->v[edge],
+			seen->v[(edge + 1) % 3], other };
+	}
+	return SUCCESS;
+}
+
+/** Adds the point furthest outside a face to the hull: replaces the faces it
+ * sees with a fan from it to their horizon, and hands their points to the
+ * new faces.
+ * @return [SUCCESS, MEMORY_REFUSED]
+ */
+static int add_point(hull_builder_t* builder, uint32_t first) {
+	uint32_t eye = builder->faces[first].furthest;
+	const double* p = point_at(builder, eye);
+	uint32_t num_horizon;
+	int code = find_horizon(builder, first, p, &num_horizon);
+	if (code != SUCCESS) {
+		return code;
+	}
+
+	uint32_t fan_first = builder->num_faces;
+	for (uint32_t h = 0; h < num_horizon; h++) {
+		horizon_t edge = builder->horizon[h];
+		uint32_t face = add_face(builder, edge.from, edge.to, eye);
+		if (face == NONE) {
+			return MEMORY_REFUSED;
+		}
+		hull_face_t* outside = &builder->faces[edge.face];
+		outside->neighbor[find_edge(outside, edge.to, edge.from)] = face;
+		builder->faces[face].neighbor[0] = edge.face;
+		builder->fan[edge.from] = face;
+	}
+	// Every new face meets the one starting where it ends, and the one ending
+	// where it starts.
+	for (uint32_t f = fan_first; f < builder->num_faces; f++) {
+		hull_face_t* face = &builder->faces[f];
+		face->neighbor[1] = builder->fan[face->v[1]];
+		builder->faces[face->neighbor[1]].neighbor[2] = f;
+	}
+	for (uint32_t f = fan_first; f < builder->num_faces; f++) {
+		builder->fan[builder->faces[f].v[0]] = NONE;
+	}
+
+	// The points of the faces seen go to the new face they are furthest
+	// outside of.
+	for (uint32_t s = 0; s < builder->num_seen; s++) {
+		hull_face_t* face = &builder->faces[builder->seen[s]];
+		face->visible = 0;
+		face->alive = 0;
+		for (uint32_t i = face->head, next; i != NONE; i = next) {
+			next = builder->next[i];
+			if (i == eye) {
+				continue;
+			}
+			const double* q = point_at(builder, i);
+			uint32_t owner = NONE;
+			double best = builder->epsilon;
+			for (uint32_t g = fan_first; g < builder->num_faces; g++) {
+				double d = face_distance(&builder->faces[g], q);
+				if (d > best) {
+					best = d;
+					owner = g;
+				}
+			}
+			if (owner != NONE) {
+				push_conflict(builder, owner, i, best);
+			}
+		}
+		face->head = NONE;
+	}
+	return SUCCESS;
+}
+
+/** Copies the faces of the hull, and the points they use in the order they
+ * came, into a mesh.
+ * @return [SUCCESS, MEMORY_REFUSED]
+ */
+static int emit_hull(const hull_builder_t* builder, mesh_t* out) {
+	uint32_t* remap = builder->owner;
+	uint32_t num_faces = 0, num_vertices = 0;
+	for (uint32_t i = 0; i < builder->num_points; i++) {
+		remap[i] = NONE;
+	}
+	for (uint32_t f = 0; f < builder->num_faces; f++) {
+		if (builder->faces[f].alive) {
+			num_faces++;
+			for (uint32_t j = 0; j < 3; j++) {
+				remap[builder->faces[f].v[j]] = 0;
+			}
+		}
+	}
+	for (uint32_t i = 0; i < builder->num_points; i++) {
+		if (remap[i] != NONE) {
+			remap[i] = num_vertices++;
+		}
+	}
+
+	out->positions = malloc((size_t)num_vertices * 3 * sizeof(float) + 1);
+	out->vertex_data = malloc((size_t)num_vertices * sizeof(vertex_t) + 1);
+	out->face_offsets = malloc(((size_t)num_faces + 1) * sizeof(uint32_t));
+	out->face_indices = malloc((size_t)num_faces * 3 * sizeof(uint32_t) + 1);
+	out->face_data = malloc((size_t)num_faces * sizeof(face_t) + 1);
+	if (!out->positions || !out->vertex_data || !out->face_offsets ||
+		!out->face_indices || !out->face_data) {
+		return MEMORY_REFUSED;
+	}
+	out->face_dim = 3;
+	out->vertex_dim = 3;
+	out->num_vertices = num_vertices;
+	out->num_faces = num_faces;
+	out->num_corners = num_faces * 3;
+	out->face_flag.flag = pos_flag;
+
+	bounds_t bounds;
+	bounds_init(&bounds);
+	for (uint32_t i = 0; i < builder->num_points; i++) {
+		if (remap[i] == NONE) {
+			continue;
+		}
+		float* pos = out->positions + 3 * (size_t)remap[i];
+		for (uint32_t k = 0; k < 3; k++) {
+			pos[k] = (float)point_at(builder, i)[k];
+		}
+		out->vertex_data[remap[i]].pos = pos;
+		bounds_add(&bounds, pos, 3);
+	}
+	for (uint32_t f = 0, n = 0; f < builder->num_faces; f++) {
+		const hull_face_t* face = &builder->faces[f];
+		if (!face->alive) {
+			continue;
+		}
+		out->face_offsets[n] = 3 * n;
+		for (uint32_t j = 0; j < 3; j++) {
+			out->face_indices[3 * n + j] = remap[face->v[j]] + 1;
+		}
+		out->face_data[n] = (face_t){ NULL, out->face_indices + 3 * n, NULL,
+			NULL };
+		n++;
+	}
+	out->face_offsets[num_faces] = 3 * num_faces;
+	for (uint32_t k = 0; k < 4; k++) {
+		out->aabb_min[k] = bounds.count ? bounds.lower[k] : 0.0f;
+		out->aabb_max[k] = bounds.count ? bounds.upper[k] : 0.0f;
+	}
+	bounds_sphere(&bounds, out->positions, num_vertices, 3,
+		out->sphere_center, &out->sphere_radius);
+	return SUCCESS;
+}
+
+/** @struct edge_t
+ * @brief A face's edge between two positions, lowest first, for pairing it
+ * with the edge of the face across.
+ */
+typedef struct {
+	uint32_t low;
+	uint32_t high;
+	/** 1 if the face winds the edge from high to low. */
+	uint32_t reversed;
+	uint32_t face;
+} edge_t;
+
+static int compare_edges(const void* a, const void* b) {
+	const edge_t* x = a;
+	const edge_t* y = b;
+	if (x->low != y->low) {
+		return x->low < y->low ? -1 : 1;
+	}
+	if (x->high != y->high) {
+		return x->high < y->high ? -1 : 1;
+	}
+	return x->reversed < y->reversed ? -1 : x->reversed > y->reversed;
+}
+
+static inline void load_position(const mesh_t* mesh,
+	uint32_t index,
+	double out[3]) {
+	const float* p = mesh->positions + (size_t)(index - 1) * mesh->vertex_dim;
+	out[0] = p[0];
+	out[1] = p[1];
+	out[2] = p[2];
+}
+
+/** Finds the plane of a face with Newell's method, which suits polygons that
+ * are not quite flat.
+ * @param normal Output unit normal, along the winding's right-hand side.
+ * @param offset Output distance of the plane from the origin.
+ */
+static void face_plane(const mesh_t* mesh,
+	uint32_t face,
+	double normal[3],
+	double* offset) {
+	const uint32_t* indices = obj_face_indices(mesh, face);
+	uint32_t size = obj_face_size(mesh, face);
+	double center[3] = { 0.0, 0.0, 0.0 };
+	normal[0] = normal[1] = normal[2] = 0.0;
+	for (uint32_t i = 0; i < size; i++) {
+		double p[3], q[3];
+		load_position(mesh, indices[i], p);
+		load_position(mesh, indices[(i + 1) % size], q);
+		normal[0] += (p[1] - q[1]) * (p[2] + q[2]);
+		normal[1] += (p[2] - q[2]) * (p[0] + q[0]);
+		normal[2] += (p[0] - q[0]) * (p[1] + q[1]);
+		for (uint32_t k = 0; k < 3; k++) {
+			center[k] += p[k] / size;
+		}
+	}
+	double length = sqrt(dot3(normal, normal));
+	for (uint32_t k = 0; length > 0.0 && k < 3; k++) {
+		normal[k] /= length;
+	}
+	*offset = dot3(normal, center);
+}
+
+/** Tests whether every corner of a face is behind a plane, within a
+ * tolerance.
+ */
+static int face_behind(const mesh_t* mesh,
+	uint32_t face,
+	const double normal[3],
+	double offset,
+	double epsilon) {
+	const uint32_t* indices = obj_face_indices(mesh, face);
+	for (uint32_t i = 0; i < obj_face_size(mesh, face); i++) {
+		double p[3];
+		load_position(mesh, indices[i], p);
+		if (dot3(normal, p) - offset > epsilon) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+// -----------------------------------------------------------------------------
+// Implementation
+// -----------------------------------------------------------------------------
+
+int
+hull_build(const mesh_t* mesh, uint32_t num_threads, mesh_t* out) {
+	memset(out, 0, sizeof *out);
+	obj_init(out);
+	if (mesh->vertex_dim < 3) {
+		return INVALID_DIMS;
+	}
+	if (mesh->num_vertices < 4) {
+		return INVALID_DIMS;
+	}
+	if (num_threads == 0) {
+		num_threads = parallel_threads();
+	}
+	uint32_t n = mesh->num_vertices;
+	hull_builder_t builder = {
+		.num_points = n,
+		.num_tasks = num_threads * TASKS_PER_THREAD
+	};
+	int code = SUCCESS;
+	builder.points = malloc((size_t)n * 3 * sizeof *builder.points + 1);
+	builder.next = malloc((size_t)n * sizeof *builder.next + 1);
+	builder.owner = malloc((size_t)n * sizeof *builder.owner + 1);
+	builder.distance = malloc((size_t)n * sizeof *builder.distance + 1);
+	builder.fan = malloc((size_t)n * sizeof *builder.fan + 1);
+	builder.task_extremes = malloc(builder.num_tasks *
+		sizeof *builder.task_extremes);
+	builder.task_furthest = malloc(builder.num_tasks *
+		sizeof *builder.task_furthest);
+	if (!builder.points || !builder.next || !builder.owner ||
+		!builder.distance || !builder.fan || !builder.task_extremes ||
+		!builder.task_furthest) {
+		code = MEMORY_REFUSED;
+	}
+
+	if (code == SUCCESS) {
+		// Points rounded to floats while parsing can stray a few ulps of the
+		// coordinates from a face they lie on.
+		double scale[3] = { 0.0, 0.0, 0.0 };
+		for (uint32_t i = 0; i < n; i++) {
+			const float* p = mesh->positions + (size_t)i * mesh->vertex_dim;
+			for (uint32_t k = 0; k < 3; k++) {
+				builder.points[3 * (size_t)i + k] = p[k];
+				scale[k] = fabs(p[k]) > scale[k] ? fabs(p[k]) : scale[k];
+			}
+			builder.fan[i] = NONE;
+		}
+		builder.epsilon = 3.0 * FLT_EPSILON * (scale[0] + scale[1] + scale[2]);
+		code = build_simplex(&builder, num_threads);
+	}
+	if (code == SUCCESS) {
+		// The one pass over every point, split across threads. The lists are
+		// linked in order afterwards so they do not depend on the split.
+		parallel_for(builder.num_tasks, num_threads, partition_share,
+			&builder);
+		for (uint32_t f = 0; f < 4; f++) {
+			for (uint32_t j = 0; j < 3; j++) {
+				builder.owner[builder.faces[f].v[j]] = NONE;
+			}
+		}
+		for (uint32_t i = n; i-- > 0;) {
+			if (builder.owner[i] != NONE) {
+				push_conflict(&builder, builder.owner[i], i,
+					builder.distance[i]);
+			}
+		}
+		// New faces are appended, so one pass reaches every face made.
+		for (uint32_t f = 0; code == SUCCESS && f < builder.num_faces; f++) {
+			if (builder.faces[f].alive && builder.faces[f].head != NONE) {
+				code = add_point(&builder, f);
+			}
+		}
+	}
+	if (code == SUCCESS) {
+		code = emit_hull(&builder, out);
+	}
+
+	free(builder.points);
+	free(builder.next);
+	free(builder.owner);
+	free(builder.distance);
+	free(builder.fan);
+	free(builder.faces);
+	free(builder.horizon);
+	free(builder.stack);
+	free(builder.seen);
+	free(builder.task_extremes);
+	free(builder.task_furthest);
+	if (code != SUCCESS) {
+		obj_destroy(out);
+		memset(out, 0, sizeof *out);
+		obj_init(out);
+	}
+	return code;
+}
+
+int
+obj_is_convex(const mesh_t* mesh) {
+	if (mesh->vertex_dim < 3 || mesh->num_faces == 0 || !mesh->face_indices) {
+		return 0;
+	}
+	uint32_t num_edges = mesh->num_corners;
+	double scale[3] = { 0.0, 0.0, 0.0 }, center[3] = { 0.0, 0.0, 0.0 };
+	double volume = 0.0;
+	for (uint32_t f = 0; f < mesh->num_faces; f++) {
+		const uint32_t* indices = obj_face_indices(mesh, f);
+		uint32_t size = obj_face_size(mesh, f);
+		double first[3];
+		load_position(mesh, indices[0], first);
+		for (uint32_t i = 0; i < size; i++) {
+			double p[3], q[3], c[3];
+			load_position(mesh, indices[i], p);
+			load_position(mesh, indices[(i + 1) % size], q);
+			for (uint32_t k = 0; k < 3; k++) {
+				scale[k] = fabs(p[k]) > scale[k] ? fabs(p[k]) : scale[k];
+				center[k] += p[k] / num_edges;
+			}
+			// Six times the signed volume of the fan from the first corner.
+			cross3(p, q, c);
+			volume += dot3(first, c);
+		}
+	}
+	double epsilon = 64.0 * FLT_EPSILON * (scale[0] + scale[1] + scale[2]);
+	// Outward faces enclose a positive volume; inward ones are turned round.
+	double sense = volume > 0.0 ? 1.0 : -1.0;
+	int convex = volume != 0.0;
+
+	// The mean of the corners of a convex solid lies behind all of its faces.
+	// This rejects most meshes before the edges are sorted, and those that
+	// are several solids, each bending outward, after.
+	for (uint32_t f = 0; convex && f < mesh->num_faces; f++) {
+		double normal[3], offset;
+		face_plane(mesh, f, normal, &offset);
+		convex = sense * (dot3(normal, center) - offset) < 0.0;
+	}
+	edge_t* edges = NULL;
+	if (convex && !(edges = malloc((size_t)num_edges * sizeof *edges + 1))) {
+		convex = 0;
+	}
+	for (uint32_t f = 0, e = 0; convex && f < mesh->num_faces; f++) {
+		const uint32_t* indices = obj_face_indices(mesh, f);
+		uint32_t size = obj_face_size(mesh, f);
+		for (uint32_t i = 0; i < size; i++) {
+			uint32_t a = indices[i], b = indices[(i + 1) % size];
+			edges[e++] = (edge_t){ a < b ? a : b, a < b ? b : a, a > b, f };
+		}
+	}
+
+	// Every edge is wound once each way, by exactly two faces.
+	if (convex) {
+		qsort(edges, num_edges, sizeof *edges, compare_edges);
+	}
+	for (uint32_t e = 0; convex && e < num_edges; e += 2) {
+		const edge_t* x = &edges[e];
+		const edge_t* y = &edges[e + 1];
+		if (e + 1 >= num_edges || x->low == x->high || y->low != x->low ||
+			y->high != x->high || x->reversed || !y->reversed ||
+			(e + 2 < num_edges && edges[e + 2].low == x->low &&
+			edges[e + 2].high == x->high)) {
+			convex = 0;
+			break;
+		}
+		// The faces of the edge bend outward: each lies behind the other.
+		double normal[3], offset;
+		face_plane(mesh, x->face, normal, &offset);
+		for (uint32_t k = 0; k < 3; k++) {
+			normal[k] *= sense;
+		}
+		convex = face_behind(mesh, y->face, normal, sense * offset, epsilon);
+		face_plane(mesh, y->face, normal, &offset);
+		for (uint32_t k = 0; k < 3; k++) {
+			normal[k] *= sense;
+		}
+		convex = convex &&
+			face_behind(mesh, x->face, normal, sense * offset, epsilon);
+	}
+	free(edges);
+	return convex;
+}
@@ -0,0 +1,58 @@
+#include "index_buffer.h"
+#include "defs.h"
+#include <stdlib.h>
+#include <string.h>
+
+// -----------------------------------------------------------------------------
+// Implementation
+// -----------------------------------------------------------------------------
+
+int
+index_buffer_build(const uint32_t* indices, 
+	uint32_t count, 
+	uint32_t num_vertices, 
+	uint32_t base,
+	index_buffer_t* out) {
+	*out = (index_buffer_t) {
+		.count = count,
+		// 0xFFFF is the primitive restart index of 16-bit buffers.
+		.width = num_vertices < 65536 ? 2 : 4
+	};
+	if (!(out->data = malloc((size_t)count * out->width + 1))) {
+		out->count = 0;
+		return MEMORY_REFUSED;
+	}
+	if (out->width == 2) {
+		uint16_t* data = out->data;
+		for (uint32_t i = 0; i < count; i++) {
+			data[i] = (uint16_t)(indices[i] - base);
+		}
+	} else if (base == 0) {
+		memcpy(out->data, indices, (size_t)count * sizeof *indices);
+	} else {
+		uint32_t* data = out->data;
+		for (uint32_t i = 0; i < count; i++) {
+			data[i] = indices[i] - base;
+		}
+	}
+	return SUCCESS;
+}
+
+int
+index_buffer_from_weld(const weld_t* weld, index_buffer_t* out) {
+	return index_buffer_build(weld->indices, weld->num_indices, 
+		weld->num_vertices, 0, out);
+}
+
+int
+index_buffer_from_mesh(const mesh_t* mesh, index_buffer_t* out) {
+	return index_buffer_build(mesh->face_indices, 
+		mesh->face_indices ? mesh->num_corners : 0, mesh->num_vertices, 1, 
+		out);
+}
+
+void
+index_buffer_destroy(index_buffer_t* buffer) {
+	free(buffer->data);
+	*buffer = (index_buffer_t) {0};
+}
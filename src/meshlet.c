@@ -0,0 +1,498 @@
+#include "meshlet.h"
+#include "defs.h"
+#include "utils.h"
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// -----------------------------------------------------------------------------
+// Static utility
+// -----------------------------------------------------------------------------
+
+/* Not in the meshlet being built. */
+#define NO_LOCAL UINT32_MAX
+
+/** @struct morton_t
+ * @brief A triangle and the Morton code of its centroid.
+ */
+typedef struct {
+	uint32_t code;
+	uint32_t triangle;
+} morton_t;
+
+/** @struct builder_t
+ * @brief The state of the partitioning.
+ */
+typedef struct {
+	const uint32_t* indices;
+	const float* vertices;
+	uint32_t stride;
+	uint32_t dim;
+	/** The triangles around every vertex: triangles[offsets[v]] through
+	 * triangles[offsets[v + 1]]. */
+	uint32_t* offsets;
+	uint32_t* triangles;
+	/** Three coordinates per triangle. */
+	float* centroids;
+	uint8_t* used;
+	/** The index of every vertex within the meshlet being built, or NO_LOCAL.
+	 */
+	uint32_t* local;
+	/** The triangles next to the meshlet being built, and the meshlet that
+	 * last queued each triangle. */
+	uint32_t* frontier;
+	uint32_t frontier_size;
+	uint32_t frontier_cap;
+	uint32_t* queued;
+	/** The mean centroid of the meshlet being built. */
+	float center[3];
+} builder_t;
+
+static int compare_morton(const void* a, const void* b) {
+	const morton_t* x = a;
+	const morton_t* y = b;
+	if (x->code != y->code) {
+		return x->code < y->code ? -1 : 1;
+	}
+	return x->triangle < y->triangle ? -1 : x->triangle > y->triangle;
+}
+
+/** Spreads the low 10 bits of a number out to every third bit. */
+static uint32_t spread_bits(uint32_t x) {
+	x &= 0x3FF;
+	x = (x | (x << 16)) & 0x030000FF;
+	x = (x | (x << 8)) & 0x0300F00F;
+	x = (x | (x << 4)) & 0x030C30C3;
+	x = (x | (x << 2)) & 0x09249249;
+	return x;
+}
+
+static inline void get_point(const builder_t* b, uint32_t v, float p[3]) {
+	const float* src = b->vertices + (size_t)v * b->stride;
+	for (uint32_t k = 0; k < 3; k++) {
+		p[k] = k < b->dim ? src[k] : 0.0f;
+	}
+}
+
+/** Sorts the triangles by the Morton code of their centroids within the
+ * bounds of the mesh.
+ * @returns SUCCESS or MEMORY_REFUSED.
+ */
+static int sort_morton(const builder_t* b,
+	uint32_t num_triangles,
+	morton_t** out) {
+	morton_t* order = malloc((size_t)num_triangles * sizeof *order + 1);
+	if (!order) {
+		return MEMORY_REFUSED;
+	}
+	float low[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+	float high[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	for (uint32_t t = 0; t < num_triangles; t++) {
+		for (uint32_t k = 0; k < 3; k++) {
+			float c = b->centroids[3 * t + k];
+			low[k] = c < low[k] ? c : low[k];
+			high[k] = c > high[k] ? c : high[k];
+		}
+	}
+	for (uint32_t t = 0; t < num_triangles; t++) {
+		uint32_t code = 0;
+		for (uint32_t k = 0; k < 3; k++) {
+			float extent = high[k] - low[k];
+			float unit = extent > 0.0f
+				? (b->centroids[3 * t + k] - low[k]) / extent : 0.0f;
+			code |= spread_bits((uint32_t)(unit * 1023.0f)) << k;
+		}
+		order[t] = (morton_t) { code, t };
+	}
+	qsort(order, num_triangles, sizeof *order, compare_morton);
+	*out = order;
+	return SUCCESS;
+}
+
+/** @returns The number of distinct vertices of a triangle not yet in the
+ * meshlet. */
+static inline uint32_t new_vertices(const builder_t* b, uint32_t t) {
+	const uint32_t* tri = b->indices + 3 * (size_t)t;
+	uint32_t added = 0;
+	for (uint32_t j = 0; j < 3; j++) {
+		added += b->local[tri[j]] == NO_LOCAL && (j == 0 || tri[j] != tri[0])
+			&& (j < 2 || tri[j] != tri[1]);
+	}
+	return added;
+}
+
+/** Picks the frontier triangle adding the fewest vertices, the closest to the
+ * meshlet's centre among those, and drops used triangles from the frontier.
+ * @returns The triangle, or UINT32_MAX if the frontier is empty.
+ */
+static uint32_t pick_frontier(builder_t* b) {
+	uint32_t best = UINT32_MAX;
+	uint32_t best_new = 4;
+	float best_distance = FLT_MAX;
+	uint32_t kept = 0;
+	for (uint32_t i = 0; i < b->frontier_size; i++) {
+		uint32_t t = b->frontier[i];
+		if (b->used[t]) {
+			continue;
+		}
+		b->frontier[kept++] = t;
+		uint32_t added = new_vertices(b, t);
+		float distance = 0.0f;
+		for (uint32_t k = 0; k < 3; k++) {
+			float d = b->centroids[3 * t + k] - b->center[k];
+			distance += d * d;
+		}
+		if (added < best_new || (added == best_new &&
+			distance < best_distance)) {
+			best = t;
+			best_new = added;
+			best_distance = distance;
+		}
+	}
+	b->frontier_size = kept;
+	return best;
+}
+
+/** Computes the bounding sphere of a meshlet's vertices with Ritter's method:
+ * a sphere through the pair of extreme points farthest apart along an axis,
+ * grown to take in every point outside it.
+ */
+static void bound_sphere(const builder_t* b,
+	const uint32_t* vertices,
+	uint32_t count,
+	meshlet_t* meshlet) {
+	uint32_t low[3] = { 0, 0, 0 };
+	uint32_t high[3] = { 0, 0, 0 };
+	float p[3], q[3];
+	for (uint32_t i = 0; i < count; i++) {
+		get_point(b, vertices[i], p);
+		for (uint32_t k = 0; k < 3; k++) {
+			get_point(b, vertices[low[k]], q);
+			low[k] = p[k] < q[k] ? i : low[k];
+			get_point(b, vertices[high[k]], q);
+			high[k] = p[k] > q[k] ? i : high[k];
+		}
+	}
+	float best = -1.0f;
+	for (uint32_t k = 0; k < 3; k++) {
+		get_point(b, vertices[low[k]], p);
+		get_point(b, vertices[high[k]], q);
+		float span = 0.0f;
+		for (uint32_t j = 0; j < 3; j++) {
+			span += (q[j] - p[j]) * (q[j] - p[j]);
+		}
+		if (span > best) {
+			best = span;
+			for (uint32_t j = 0; j < 3; j++) {
+				meshlet->center[j] = 0.5f * (p[j] + q[j]);
+			}
+			meshlet->radius = 0.5f * sqrtf(span);
+		}
+	}
+	for (uint32_t i = 0; i < count; i++) {
+		get_point(b, vertices[i], p);
+		float distance = 0.0f;
+		for (uint32_t k = 0; k < 3; k++) {
+			distance += (p[k] - meshlet->center[k])
+				* (p[k] - meshlet->center[k]);
+		}
+		distance = sqrtf(distance);
+		if (distance > meshlet->radius) {
+			float grown = 0.5f * (meshlet->radius + distance);
+			float shift = (grown - meshlet->radius) / distance;
+			for (uint32_t k = 0; k < 3; k++) {
+				meshlet->center[k] += (p[k] - meshlet->center[k]) * shift;
+			}
+			meshlet->radius = grown;
+		}
+	}
+	// Absorbs rounding, so every vertex tests as inside.
+	meshlet->radius *= 1.0f + 1e-5f;
+}
+
+/** Computes the unit normal of a meshlet triangle and its first corner.
+ * @returns 0 for a degenerate triangle, 1 otherwise.
+ */
+static int local_normal(const builder_t* b,
+	const uint32_t* vertices,
+	const uint8_t* tri,
+	float n[3],
+	float corner[3]) {
+	float p[3][3];
+	for (uint32_t j = 0; j < 3; j++) {
+		get_point(b, vertices[tri[j]], p[j]);
+	}
+	float e[3], f[3];
+	for (uint32_t k = 0; k < 3; k++) {
+		e[k] = p[1][k] - p[0][k];
+		f[k] = p[2][k] - p[0][k];
+	}
+	n[0] = e[1] * f[2] - e[2] * f[1];
+	n[1] = e[2] * f[0] - e[0] * f[2];
+	n[2] = e[0] * f[1] - e[1] * f[0];
+	float length = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+	if (length == 0.0f) {
+		return 0;
+	}
+	for (uint32_t k = 0; k < 3; k++) {
+		n[k] /= length;
+	}
+	memcpy(corner, p[0], sizeof p[0]);
+	return 1;
+}
+
+/** Computes the cone of a meshlet's normals: the axis is the mean of the unit
+ * normals and the cutoff the sine of the widest angle from it. The apex is
+ * moved back along the axis until every triangle's plane lies in front of it,
+ * so a camera that sees the apex from behind sees every triangle from behind.
+ */
+static void bound_cone(const builder_t* b,
+	const uint32_t* vertices,
+	const uint8_t* triangles,
+	uint32_t count,
+	meshlet_t* meshlet) {
+	float axis[3] = { 0.0f, 0.0f, 0.0f };
+	float n[3], corner[3];
+	for (uint32_t i = 0; i < count; i++) {
+		if (local_normal(b, vertices, triangles + 3 * i, n, corner)) {
+			for (uint32_t k = 0; k < 3; k++) {
+				axis[k] += n[k];
+			}
+		}
+	}
+	float length = sqrtf(axis[0] * axis[0] + axis[1] * axis[1]
+		+ axis[2] * axis[2]);
+	memcpy(meshlet->cone_apex, meshlet->center, sizeof meshlet->center);
+	memset(meshlet->cone_axis, 0, sizeof meshlet->cone_axis);
+	meshlet->cone_cutoff = 1.0f;
+	if (length == 0.0f) {
+		return;
+	}
+	for (uint32_t k = 0; k < 3; k++) {
+		axis[k] /= length;
+	}
+
+	float min_dot = 1.0f;
+	float max_t = 0.0f;
+	for (uint32_t i = 0; i < count; i++) {
+		if (!local_normal(b, vertices, triangles + 3 * i, n, corner)) {
+			continue;
+		}
+		float dot = 0.0f;
+		float offset = 0.0f;
+		for (uint32_t k = 0; k < 3; k++) {
+			dot += n[k] * axis[k];
+			offset += (meshlet->center[k] - corner[k]) * n[k];
+		}
+		min_dot = dot < min_dot ? dot : min_dot;
+		if (dot > 0.0f && offset / dot > max_t) {
+			max_t = offset / dot;
+		}
+	}
+	// A normal at right angles to the axis or beyond can face any camera.
+	if (min_dot <= 0.0f) {
+		return;
+	}
+	memcpy(meshlet->cone_axis, axis, sizeof axis);
+	meshlet->cone_cutoff = sqrtf(1.0f - min_dot * min_dot);
+	for (uint32_t k = 0; k < 3; k++) {
+		meshlet->cone_apex[k] = meshlet->center[k] - axis[k] * max_t;
+	}
+}
+
+/** Computes the bounds of a finished meshlet and takes its vertices out of
+ * the local numbering. */
+static void finish_meshlet(builder_t* b,
+	const meshlets_t* out,
+	meshlet_t* meshlet) {
+	const uint32_t* vertices = out->vertices + meshlet->vertex_offset;
+	bound_sphere(b, vertices, meshlet->vertex_count, meshlet);
+	bound_cone(b, vertices, out->triangles + meshlet->triangle_offset,
+		meshlet->triangle_count, meshlet);
+	for (uint32_t i = 0; i < meshlet->vertex_count; i++) {
+		b->local[vertices[i]] = NO_LOCAL;
+	}
+}
+
+static void free_builder(builder_t* b) {
+	free(b->offsets);
+	free(b->triangles);
+	free(b->centroids);
+	free(b->used);
+	free(b->local);
+	free(b->frontier);
+	free(b->queued);
+}
+
+/** Builds the triangle lists of every vertex and the triangle centroids.
+ * @returns SUCCESS or MEMORY_REFUSED.
+ */
+static int init_builder(builder_t* b, uint32_t count, uint32_t num_vertices) {
+	uint32_t num_triangles = count / 3;
+	b->offsets = calloc((size_t)num_vertices + 2, sizeof *b->offsets);
+	b->triangles = malloc((size_t)count * sizeof *b->triangles + 1);
+	b->centroids = malloc((size_t)num_triangles * 3 * sizeof *b->centroids
+		+ 1);
+	b->used = calloc((size_t)num_triangles + 1, sizeof *b->used);
+	b->local = malloc((size_t)num_vertices * sizeof *b->local + 1);
+	b->queued = calloc((size_t)num_triangles + 1, sizeof *b->queued);
+	if (!b->offsets || !b->triangles || !b->centroids || !b->used ||
+		!b->local || !b->queued) {
+		return MEMORY_REFUSED;
+	}
+	memset(b->local, 0xFF, (size_t)num_vertices * sizeof *b->local);
+	for (uint32_t i = 0; i < count; i++) {
+		b->offsets[b->indices[i] + 2]++;
+	}
+	for (uint32_t v = 0; v < num_vertices; v++) {
+		b->offsets[v + 2] += b->offsets[v + 1];
+	}
+	for (uint32_t i = 0; i < count; i++) {
+		b->triangles[b->offsets[b->indices[i] + 1]++] = i / 3;
+	}
+	for (uint32_t t = 0; t < num_triangles; t++) {
+		float p[3];
+		float* c = b->centroids + 3 * (size_t)t;
+		c[0] = c[1] = c[2] = 0.0f;
+		for (uint32_t j = 0; j < 3; j++) {
+			get_point(b, b->indices[3 * (size_t)t + j], p);
+			for (uint32_t k = 0; k < 3; k++) {
+				c[k] += p[k] / 3.0f;
+			}
+		}
+	}
+	return SUCCESS;
+}
+
+// -----------------------------------------------------------------------------
+// Implementation
+// -----------------------------------------------------------------------------
+
+int
+meshlet_build(const uint32_t* indices,
+	uint32_t count,
+	const float* vertices,
+	uint32_t stride,
+	uint32_t dim,
+	uint32_t num_vertices,
+	uint32_t max_vertices,
+	uint32_t max_triangles,
+	meshlets_t* out) {
+	int code;
+	uint32_t num_triangles = count / 3;
+	*out = (meshlets_t) {0};
+	if (count % 3 != 0 || max_vertices < 3 || max_vertices > 256 ||
+		max_triangles == 0) {
+		return INVALID_DIMS;
+	}
+	builder_t b = {
+		.indices = indices,
+		.vertices = vertices,
+		.stride = stride,
+		.dim = dim
+	};
+	morton_t* order = NULL;
+	out->meshlets = malloc((size_t)num_triangles * sizeof *out->meshlets + 1);
+	out->vertices = malloc((size_t)count * sizeof *out->vertices + 1);
+	out->triangles = malloc((size_t)count * sizeof *out->triangles + 1);
+	if (!out->meshlets || !out->vertices || !out->triangles ||
+		(code = init_builder(&b, count, num_vertices)) != SUCCESS ||
+		(code = sort_morton(&b, num_triangles, &order)) != SUCCESS) {
+		free_builder(&b);
+		meshlets_destroy(out);
+		return MEMORY_REFUSED;
+	}
+
+	meshlet_t* meshlet = NULL;
+	uint32_t cursor = 0;
+	uint32_t placed = 0;
+	while (placed < num_triangles) {
+		if (!meshlet) {
+			meshlet = out->meshlets + out->num_meshlets;
+			*meshlet = (meshlet_t) {
+				.vertex_offset = out->num_vertices,
+				.triangle_offset = out->num_triangles
+			};
+			b.frontier_size = 0;
+		}
+		uint32_t t = pick_frontier(&b);
+		if (t == UINT32_MAX) {
+			// The meshlet's surface ran out: carry on at the next triangle
+			// in Morton order, which is likely close by.
+			while (b.used[order[cursor].triangle]) {
+				cursor++;
+			}
+			t = order[cursor].triangle;
+		}
+		if (meshlet->triangle_count == max_triangles ||
+			meshlet->vertex_count + new_vertices(&b, t) > max_vertices) {
+			finish_meshlet(&b, out, meshlet);
+			out->num_meshlets++;
+			meshlet = NULL;
+			continue;
+		}
+
+		const uint32_t* tri = indices + 3 * (size_t)t;
+		for (uint32_t j = 0; j < 3; j++) {
+			uint32_t v = tri[j];
+			if (b.local[v] == NO_LOCAL) {
+				b.local[v] = meshlet->vertex_count++;
+				out->vertices[out->num_vertices++] = v;
+				// Every unused triangle of a new vertex can join next.
+				for (uint32_t i = b.offsets[v]; i < b.offsets[v + 1]; i++) {
+					uint32_t other = b.triangles[i];
+					if (b.used[other] ||
+						b.queued[other] == out->num_meshlets + 1) {
+						continue;
+					}
+					if (array_reserve((void**)&b.frontier, &b.frontier_cap,
+						b.frontier_size + 1, sizeof *b.frontier) != SUCCESS) {
+						free(order);
+						free_builder(&b);
+						meshlets_destroy(out);
+						return MEMORY_REFUSED;
+					}
+					b.queued[other] = out->num_meshlets + 1;
+					b.frontier[b.frontier_size++] = other;
+				}
+			}
+			out->triangles[out->num_triangles++] = (uint8_t)b.local[v];
+		}
+		b.used[t] = 1;
+		placed++;
+		meshlet->triangle_count++;
+		float weight = 1.0f / (float)meshlet->triangle_count;
+		for (uint32_t k = 0; k < 3; k++) {
+			b.center[k] += (b.centroids[3 * (size_t)t + k] - b.center[k])
+				* weight;
+		}
+	}
+	if (meshlet) {
+		finish_meshlet(&b, out, meshlet);
+		out->num_meshlets++;
+	}
+	free(order);
+	free_builder(&b);
+	// Shrink the arrays from their bounds to what was used.
+	uint32_t cap = num_triangles;
+	code = array_trim((void**)&out->meshlets, &cap, out->num_meshlets,
+		sizeof *out->meshlets);
+	cap = count;
+	if (code == SUCCESS) {
+		code = array_trim((void**)&out->vertices, &cap, out->num_vertices,
+			sizeof *out->vertices);
+	}
+	if (code != SUCCESS) {
+		meshlets_destroy(out);
+	}
+	return code;
+}
+
+void
+meshlets_destroy(meshlets_t* meshlets) {
+	free(meshlets->meshlets);
+	free(meshlets->vertices);
+	free(meshlets->triangles);
+	*meshlets = (meshlets_t) {0};
+}
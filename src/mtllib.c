@@ -1145,6 +1145,11 @@ int mtllib_read(const char* fn, mtllib_t* lib) {
 	// when we exit, we need to add the curr_mat
 	map_insert(&lib->map, curr_mat.name, curr_mat);
 
+	// the materials hold copies of every token
+	for (unsigned int cmd_i = 0; cmd_i < n_commands; cmd_i++) {
+		tokenlist_destroy(&cmd_list[cmd_i].parameters);
+	}
+	tokenlist_destroy(&lines);
 	free(mtltext);
 
     return SUCCESS;
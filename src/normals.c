@@ -0,0 +1,497 @@
+#include "normals.h"
+#include "parallel.h"
+#include "defs.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define NORMALS_X86
+#include <immintrin.h>
+#endif
+
+// -----------------------------------------------------------------------------
+// Static utility
+// -----------------------------------------------------------------------------
+
+/* The number of tasks per thread, so that uneven shares still balance. */
+#define TASKS_PER_THREAD 4
+
+/** State shared by the tasks of one normals_generate call. */
+typedef struct {
+	const mesh_t* mesh;
+	normals_mode mode;
+	/* Set when a crease angle splits groups; the cosine of the angle. */
+	int creased;
+	float min_cos;
+	uint32_t num_tasks;
+	/* The normal of every face, as long as twice its area, and its unit
+	 * normal; three floats each. */
+	float* face_normals;
+	float* face_units;
+	/* The face of every corner. */
+	uint32_t* corner_faces;
+	/* The corners around every position, in corner order. The corners of
+	 * position v are [vertex_offsets[v], vertex_offsets[v + 1]). */
+	uint32_t* vertex_offsets;
+	uint32_t* vertex_corners;
+	/* The summed face normals of every smooth corner, and its normal among
+	 * the distinct normals of its position. */
+	float* corner_sums;
+	uint32_t* ordinals;
+	/* The first normal of every position; first the number of its normals,
+	 * at index v + 1. */
+	uint32_t* firsts;
+	/* The normal of every flat face. */
+	uint32_t* flat;
+	/* The output normals, vertex_dim floats each, and corner normal indices.
+	 */
+	float* normals;
+	uint32_t* face_norms;
+} normals_state_t;
+
+/** Gets the share of count items of a task.
+ */
+static void task_range(uint32_t count,
+	uint32_t task,
+	uint32_t num_tasks,
+	uint32_t* begin,
+	uint32_t* end) {
+	*begin = (uint32_t)((uint64_t)count * task / num_tasks);
+	*end = (uint32_t)((uint64_t)count * (task + 1) / num_tasks);
+}
+
+/** Gets the smoothing group of a face; 0 for a flat face.
+ */
+static inline uint32_t face_group(const normals_state_t* state, uint32_t face) {
+	if (state->mode == NORMALS_FLAT) {
+		return 0;
+	}
+	return state->mesh->face_smoothing ? state->mesh->face_smoothing[face] : 1;
+}
+
+/** Scales a vector to unit length, or writes zeros if it has none.
+ * @param v Three floats.
+ * @param dim The number of floats to write, at least 3.
+ * @param out Output normal.
+ */
+static void write_unit(const float* v, uint32_t dim, float* out) {
+	float length = sqrtf(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+	float inv = length > 0.0f ? 1.0f / length : 0.0f;
+	for (uint32_t k = 0; k < 3; k++) {
+		out[k] = v[k] * inv;
+	}
+	for (uint32_t k = 3; k < dim; k++) {
+		out[k] = 0.0f;
+	}
+}
+
+/** Sums the cross products of a polygon's fan, which is twice its area
+ * along its normal for any planar polygon, convex or not.
+ * @param mesh The mesh.
+ * @param face The face.
+ * @param out Output normal.
+ */
+static void polygon_normal(const mesh_t* mesh, uint32_t face, float* out) {
+	const uint32_t* indices = mesh->face_indices + mesh->face_offsets[face];
+	uint32_t size = obj_face_size(mesh, face);
+	uint32_t dim = mesh->vertex_dim;
+	out[0] = out[1] = out[2] = 0.0f;
+	if (size < 3) {
+		return;
+	}
+	const float* a = mesh->positions + (size_t)(indices[0] - 1) * dim;
+	for (uint32_t j = 1; j + 1 < size; j++) {
+		const float* b = mesh->positions + (size_t)(indices[j] - 1) * dim;
+		const float* c = mesh->positions + (size_t)(indices[j + 1] - 1) * dim;
+		float e[3], f[3], n[3];
+		for (uint32_t k = 0; k < 3; k++) {
+			e[k] = b[k] - a[k];
+			f[k] = c[k] - a[k];
+		}
+		n[0] = e[1] * f[2] - e[2] * f[1];
+		n[1] = e[2] * f[0] - e[0] * f[2];
+		n[2] = e[0] * f[1] - e[1] * f[0];
+		// The first term is copied, so a triangle matches the SIMD path to
+		// the sign of a zero.
+		for (uint32_t k = 0; k < 3; k++) {
+			out[k] = j == 1 ? n[k] : out[k] + n[k];
+		}
+	}
+}
+
+#ifdef NORMALS_X86
+/** Takes the normals of four triangles at a time, with the components of
+ * the four in one vector each.
+ * @param mesh The mesh. Every face must be a triangle.
+ * @param begin The first face.
+ * @param end One past the last face.
+ * @param normals Output normals as long as twice the areas.
+ * @param units Output unit normals.
+ * @return The first face left to the scalar loop.
+ */
+__attribute__((target("sse2")))
+static uint32_t triangle_normals_sse2(const mesh_t* mesh,
+	uint32_t begin,
+	uint32_t end,
+	float* normals,
+	float* units) {
+	const uint32_t dim = mesh->vertex_dim;
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	uint32_t face = begin;
+	for (; face + 4 <= end; face += 4) {
+		const uint32_t* indices = mesh->face_indices + (size_t)face * 3;
+		__m128 p[3][3];
+		for (uint32_t j = 0; j < 3; j++) {
+			const float* q[4];
+			for (uint32_t t = 0; t < 4; t++) {
+				q[t] = mesh->positions + (size_t)(indices[3 * t + j] - 1) * dim;
+			}
+			for (uint32_t k = 0; k < 3; k++) {
+				p[j][k] = _mm_setr_ps(q[0][k], q[1][k], q[2][k], q[3][k]);
+			}
+		}
+		__m128 e[3], f[3];
+		for (uint32_t k = 0; k < 3; k++) {
+			e[k] = _mm_sub_ps(p[1][k], p[0][k]);
+			f[k] = _mm_sub_ps(p[2][k], p[0][k]);
+		}
+		__m128 n[3];
+		n[0] = _mm_sub_ps(_mm_mul_ps(e[1], f[2]), _mm_mul_ps(e[2], f[1]));
+		n[1] = _mm_sub_ps(_mm_mul_ps(e[2], f[0]), _mm_mul_ps(e[0], f[2]));
+		n[2] = _mm_sub_ps(_mm_mul_ps(e[0], f[1]), _mm_mul_ps(e[1], f[0]));
+		__m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(
+			_mm_mul_ps(n[0], n[0]), _mm_mul_ps(n[1], n[1])),
+			_mm_mul_ps(n[2], n[2])));
+		__m128 inv = _mm_and_ps(_mm_div_ps(one, length),
+			_mm_cmpgt_ps(length, zero));
+		float out[2][3][4];
+		for (uint32_t k = 0; k < 3; k++) {
+			_mm_storeu_ps(out[0][k], n[k]);
+			_mm_storeu_ps(out[1][k], _mm_mul_ps(n[k], inv));
+		}
+		for (uint32_t t = 0; t < 4; t++) {
+			for (uint32_t k = 0; k < 3; k++) {
+				normals[3 * (face + t) + k] = out[0][k][t];
+				units[3 * (face + t) + k] = out[1][k][t];
+			}
+		}
+	}
+	return face;
+}
+#endif
+
+/** Worker that takes the normals of a share of the faces.
+ * @param ctx The normals_state_t.
+ * @param task The index of the share.
+ */
+static void face_normals(void* ctx, uint32_t task) {
+	normals_state_t* state = ctx;
+	const mesh_t* mesh = state->mesh;
+	uint32_t begin, end;
+	task_range(mesh->num_faces, task, state->num_tasks, &begin, &end);
+#ifdef NORMALS_X86
+	if (mesh->face_dim == 3 && mesh->num_corners == mesh->num_faces * 3) {
+		begin = triangle_normals_sse2(mesh, begin, end, state->face_normals,
+			state->face_units);
+	}
+#endif
+	for (uint32_t i = begin; i < end; i++) {
+		polygon_normal(mesh, i, state->face_normals + 3 * (size_t)i);
+		write_unit(state->face_normals + 3 * (size_t)i, 3,
+			state->face_units + 3 * (size_t)i);
+	}
+}
+
+/** Sums the normals of the faces around a position that a corner's normal
+ * shares.
+ * @param state The state.
+ * @param begin The first corner of the position in vertex_corners.
+ * @param end One past its last corner.
+ * @param face The corner's face.
+ * @param group The corner's smoothing group, not 0.
+ * @param out Output sum.
+ */
+static void sum_faces(const normals_state_t* state,
+	uint32_t begin,
+	uint32_t end,
+	uint32_t face,
+	uint32_t group,
+	float* out) {
+	const float* unit = state->face_units + 3 * (size_t)face;
+	int creased = state->creased &&
+		(unit[0] != 0.0f || unit[1] != 0.0f || unit[2] != 0.0f);
+	out[0] = out[1] = out[2] = 0.0f;
+	for (uint32_t j = begin; j < end; j++) {
+		uint32_t other = state->corner_faces[state->vertex_corners[j]];
+		if (face_group(state, other) != group) {
+			continue;
+		}
+		const float* u = state->face_units + 3 * (size_t)other;
+		if (creased &&
+			unit[0] * u[0] + unit[1] * u[1] + unit[2] * u[2] < state->min_cos) {
+			continue;
+		}
+		const float* n = state->face_normals + 3 * (size_t)other;
+		out[0] += n[0];
+		out[1] += n[1];
+		out[2] += n[2];
+	}
+}
+
+/** Worker that sums the normal of every smooth corner of a share of the
+ * positions and numbers the distinct normals of each position.
+ * @param ctx The normals_state_t.
+ * @param task The index of the share.
+ */
+static void smooth_positions(void* ctx, uint32_t task) {
+	normals_state_t* state = ctx;
+	uint32_t first, last;
+	task_range(state->mesh->num_vertices, task, state->num_tasks, &first,
+		&last);
+	for (uint32_t v = first; v < last; v++) {
+		uint32_t begin = state->vertex_offsets[v];
+		uint32_t end = state->vertex_offsets[v + 1];
+		uint32_t distinct = 0;
+		for (uint32_t i = begin; i < end; i++) {
+			uint32_t corner = state->vertex_corners[i];
+			uint32_t face = state->corner_faces[corner];
+			uint32_t group = face_group(state, face);
+			float* sum = state->corner_sums + 3 * (size_t)corner;
+			if (group == 0) {
+				continue;
+			}
+			// Without creases the sum depends on the group alone.
+			uint32_t same = i;
+			for (uint32_t j = begin; j < i && !state->creased; j++) {
+				if (face_group(state,
+					state->corner_faces[state->vertex_corners[j]]) == group) {
+					same = j;
+					break;
+				}
+			}
+			if (same != i) {
+				uint32_t other = state->vertex_corners[same];
+				memcpy(sum, state->corner_sums + 3 * (size_t)other,
+					3 * sizeof *sum);
+				state->ordinals[corner] = state->ordinals[other];
+				continue;
+			}
+			sum_faces(state, begin, end, face, group, sum);
+			// Corners summing the same faces share a normal.
+			uint32_t ordinal = distinct;
+			for (uint32_t j = begin; j < i; j++) {
+				uint32_t other = state->vertex_corners[j];
+				if (face_group(state, state->corner_faces[other]) != 0 &&
+					memcmp(sum, state->corner_sums + 3 * (size_t)other,
+					3 * sizeof *sum) == 0) {
+					ordinal = state->ordinals[other];
+					break;
+				}
+			}
+			distinct += ordinal == distinct;
+			state->ordinals[corner] = ordinal;
+		}
+		state->firsts[v + 1] = distinct;
+	}
+}
+
+/** Worker that writes the normals and corner indices of a share of the
+ * positions and the normals of a share of the flat faces.
+ * @param ctx The normals_state_t.
+ * @param task The index of the share.
+ */
+static void write_normals(void* ctx, uint32_t task) {
+	normals_state_t* state = ctx;
+	const mesh_t* mesh = state->mesh;
+	const uint32_t dim = mesh->vertex_dim;
+	uint32_t first, last;
+	task_range(mesh->num_vertices, task, state->num_tasks, &first, &last);
+	for (uint32_t v = first; v < last && state->mode == NORMALS_SMOOTH; v++) {
+		uint32_t written = 0;
+		for (uint32_t i = state->vertex_offsets[v];
+			i < state->vertex_offsets[v + 1]; i++) {
+			uint32_t corner = state->vertex_corners[i];
+			uint32_t face = state->corner_faces[corner];
+			if (face_group(state, face) == 0) {
+				state->face_norms[corner] = state->flat[face] + 1;
+				continue;
+			}
+			uint32_t index = state->firsts[v] + state->ordinals[corner];
+			// Ordinals are numbered in corner order.
+			if (state->ordinals[corner] == written) {
+				write_unit(state->corner_sums + 3 * (size_t)corner, dim,
+					state->normals + (size_t)index * dim);
+				written++;
+			}
+			state->face_norms[corner] = index + 1;
+		}
+	}
+	task_range(mesh->num_faces, task, state->num_tasks, &first, &last);
+	for (uint32_t i = first; i < last; i++) {
+		if (face_group(state, i) != 0) {
+			continue;
+		}
+		write_unit(state->face_normals + 3 * (size_t)i, dim,
+			state->normals + (size_t)state->flat[i] * dim);
+		if (state->mode == NORMALS_FLAT) {
+			for (uint32_t c = mesh->face_offsets[i];
+				c < mesh->face_offsets[i + 1]; c++) {
+				state->face_norms[c] = state->flat[i] + 1;
+			}
+		}
+	}
+}
+
+/** Lists the corners around every position, in corner order, and the face
+ * of every corner.
+ * @param state The state, with its arrays allocated.
+ */
+static void link_corners(normals_state_t* state) {
+	const mesh_t* mesh = state->mesh;
+	uint32_t* offsets = state->vertex_offsets;
+	memset(offsets, 0, ((size_t)mesh->num_vertices + 1) * sizeof *offsets);
+	for (uint32_t c = 0; c < mesh->num_corners; c++) {
+		offsets[mesh->face_indices[c] - 1]++;
+	}
+	for (uint32_t v = 0; v < mesh->num_vertices; v++) {
+		offsets[v + 1] += offsets[v];
+	}
+	// offsets[v] is now one past the corners of v; fill them back to front.
+	for (uint32_t c = mesh->num_corners; c-- > 0;) {
+		state->vertex_corners[--offsets[mesh->face_indices[c] - 1]] = c;
+	}
+	for (uint32_t i = 0; i < mesh->num_faces; i++) {
+		for (uint32_t c = mesh->face_offsets[i];
+			c < mesh->face_offsets[i + 1]; c++) {
+			state->corner_faces[c] = i;
+		}
+	}
+}
+
+/** Replaces the normals of a mesh with generated ones and points its views
+ * at them.
+ * @param mesh The mesh.
+ * @param normals The normals.
+ * @param num_normals The number of normals.
+ * @param face_norms The normal index of every corner.
+ * @return [SUCCESS, MEMORY_REFUSED]. The mesh is untouched on failure.
+ */
+static int install_normals(mesh_t* mesh,
+	float* normals,
+	uint32_t num_normals,
+	uint32_t* face_norms) {
+	normal_t* views = malloc((size_t)num_normals * sizeof *views + 1);
+	if (!views) {
+		return MEMORY_REFUSED;
+	}
+	for (uint32_t i = 0; i < num_normals; i++) {
+		views[i].norm = normals + (size_t)i * mesh->vertex_dim;
+	}
+	free(mesh->normals);
+	free(mesh->normal_data);
+	free(mesh->face_norms);
+	mesh->normals = normals;
+	mesh->normal_data = views;
+	mesh->num_normals = num_normals;
+	mesh->face_norms = face_norms;
+	mesh->face_flag.flag |= norm_flag;
+	for (uint32_t i = 0; mesh->face_data && i < mesh->num_faces; i++) {
+		mesh->face_data[i].norms = face_norms + mesh->face_offsets[i];
+	}
+	return SUCCESS;
+}
+
+// -----------------------------------------------------------------------------
+// Implementation
+// -----------------------------------------------------------------------------
+int
+normals_generate(mesh_t* mesh,
+	normals_mode mode,
+	float crease_angle,
+	uint32_t num_threads) {
+	if (mesh->num_faces == 0 || !mesh->face_indices) {
+		return SUCCESS;
+	}
+	if (mesh->vertex_dim < 3) {
+		return INVALID_DIMS;
+	}
+	if (num_threads == 0) {
+		num_threads = parallel_threads();
+	}
+	normals_state_t state = {
+		.mesh = mesh,
+		.mode = mode,
+		.creased = crease_angle < NORMALS_NO_CREASE,
+		.min_cos = cosf(crease_angle),
+		.num_tasks = num_threads * TASKS_PER_THREAD
+	};
+	size_t faces = mesh->num_faces;
+	size_t corners = mesh->num_corners;
+	size_t vertices = mesh->num_vertices;
+	int smooth = mode == NORMALS_SMOOTH;
+	state.face_normals = malloc(faces * 3 * sizeof(float) + 1);
+	state.face_units = malloc(faces * 3 * sizeof(float) + 1);
+	state.flat = malloc(faces * sizeof *state.flat + 1);
+	state.face_norms = malloc(corners * sizeof *state.face_norms + 1);
+	if (smooth) {
+		state.corner_faces = malloc(corners * sizeof *state.corner_faces + 1);
+		state.vertex_offsets = malloc((vertices + 1)
+			* sizeof *state.vertex_offsets);
+		state.vertex_corners = malloc(corners
+			* sizeof *state.vertex_corners + 1);
+		state.corner_sums = malloc(corners * 3 * sizeof(float) + 1);
+		state.ordinals = malloc(corners * sizeof *state.ordinals + 1);
+		state.firsts = calloc(vertices + 1, sizeof *state.firsts);
+	}
+	int code = SUCCESS;
+	if (!state.face_normals || !state.face_units || !state.flat ||
+		!state.face_norms || (smooth && (!state.corner_faces ||
+		!state.vertex_offsets || !state.vertex_corners ||
+		!state.corner_sums || !state.ordinals || !state.firsts))) {
+		code = MEMORY_REFUSED;
+	}
+
+	if (code == SUCCESS) {
+		parallel_for(state.num_tasks, num_threads, face_normals, &state);
+		if (smooth) {
+			link_corners(&state);
+			parallel_for(state.num_tasks, num_threads, smooth_positions,
+				&state);
+			for (size_t v = 0; v < vertices; v++) {
+				state.firsts[v + 1] += state.firsts[v];
+			}
+		}
+		// Flat faces take the normals after those of the positions.
+		uint32_t total = smooth ? state.firsts[vertices] : 0;
+		for (uint32_t i = 0; i < mesh->num_faces; i++) {
+			if (face_group(&state, i) == 0) {
+				state.flat[i] = total++;
+			}
+		}
+		state.normals = malloc((size_t)total * mesh->vertex_dim
+			* sizeof *state.normals + 1);
+		if (!state.normals) {
+			code = MEMORY_REFUSED;
+		} else {
+			parallel_for(state.num_tasks, num_threads, write_normals, &state);
+			code = install_normals(mesh, state.normals, total,
+				state.face_norms);
+		}
+	}
+	if (code != SUCCESS) {
+		free(state.normals);
+		free(state.face_norms);
+	}
+	free(state.face_normals);
+	free(state.face_units);
+	free(state.flat);
+	free(state.corner_faces);
+	free(state.vertex_offsets);
+	free(state.vertex_corners);
+	free(state.corner_sums);
+	free(state.ordinals);
+	free(state.firsts);
+	return code;
+}
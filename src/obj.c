@@ -1,213 +1,1586 @@
 #include "obj.h"
+#include "bounds.h"
+#include "buffer.h"
+#include "classify.h"
+#include "filemap.h"
+#include "normals.h"
+#include "parallel.h"
+#include "parse.h"
+#include "tangents.h"
+#include "triangulate.h"
+#include <math.h>
 
 // -----------------------------------------------------------------------------
 // Static utility
 // -----------------------------------------------------------------------------
 
-/** Gets the dimension of the mesh component based on the ASCII text. Each value
-*  in the component must be separated by a single space character " ".
- * @param buffer The text line fetched by the .obj file.
- * @returns The number of dimensions in this line.
-*/
-static uint32_t get_dim(char buffer[MAX_LINE_LEN]) {
-    uint32_t dim = 0;
-    char* token = strtok(buffer, " ");
-    do {
-        token = strtok(NULL, " ");
-        dim++;
-    }  while (token);
-    dim--;
-    return dim;
-}
-
-/** Checks if the retrieved dimension from the raw text matches the expected 
- * dimension.
- * @param expected The expected dimension.
- * @param retrieved The retrieved dimension number.
- * @param line The line fetched from the .obj file.
- * @returns SUCCESS, INVALID_DIMS.
-*/
-static int check_dim(uint32_t* expected, uint32_t* retrieved, char* line) {
-    *retrieved = get_dim(line);
-    if (*expected != 0 && *retrieved != *expected) {
+/** Points every vertex, normal, texture and face structure into the mesh's 
+ * contiguous arrays. Allocates one array of structures per attribute.
+ * @param mesh The mesh object, with its contiguous arrays filled.
+ * @returns SUCCESS or MEMORY_REFUSED.
+ */
+static int bind_views(mesh_t* mesh) {
+    free(mesh->vertex_data);
+    free(mesh->normal_data);
+    free(mesh->texture_data);
+    free(mesh->face_data);
+    mesh->vertex_data = calloc(mesh->num_vertices, sizeof *mesh->vertex_data);
+    mesh->normal_data = calloc(mesh->num_normals, sizeof *mesh->normal_data);
+    mesh->texture_data = calloc(mesh->num_textures, 
+        sizeof *mesh->texture_data);
+    mesh->face_data = calloc(mesh->num_faces, sizeof *mesh->face_data);
+    if ((mesh->num_vertices && !mesh->vertex_data) ||
+        (mesh->num_normals && !mesh->normal_data) ||
+        (mesh->num_textures && !mesh->texture_data) ||
+        (mesh->num_faces && !mesh->face_data)) {
+        return MEMORY_REFUSED;
+    }
+    for (uint32_t i = 0; i < mesh->num_vertices; i++) {
+        mesh->vertex_data[i].pos = mesh->positions 
+            + (size_t)i * mesh->vertex_dim;
+    }
+    for (uint32_t i = 0; i < mesh->num_normals; i++) {
+        mesh->normal_data[i].norm = mesh->normals 
+            + (size_t)i * mesh->vertex_dim;
+    }
+    for (uint32_t i = 0; i < mesh->num_textures; i++) {
+        mesh->texture_data[i].tex = mesh->texcoords 
+            + (size_t)i * mesh->tex_dim;
+    }
+    for (uint32_t i = 0; i < mesh->num_faces; i++) {
+        mesh->face_data[i] = (face_t) {
+            .material = NULL,
+            .indices = (uint32_t*)obj_face_indices(mesh, i),
+            .texs = (uint32_t*)obj_face_texs(mesh, i),
+            .norms = (uint32_t*)obj_face_norms(mesh, i)
+        };
+    }
+    return SUCCESS;
+}
+
+/** A mesh whose arrays grow as lines arrive, with the capacities of its 
+ * arrays. The user data of mesh_callbacks. */
+typedef struct {
+    /* The mesh being read. */
+    mesh_t* mesh;
+    /* Capacity of the positions, in floats. */
+    uint32_t vertex_cap;
+    /* Capacity of the normals, in floats. */
+    uint32_t normal_cap;
+    /* Capacity of the texture coordinates, in floats. */
+    uint32_t texture_cap;
+    /* Capacity of the face offsets. */
+    uint32_t face_cap;
+    /* Capacities of the position, texture and normal corner indices. */
+    uint32_t index_cap;
+    uint32_t tex_cap;
+    uint32_t norm_cap;
+    /* Expected final counts of each component, used to size the arrays the 
+    * first time they are allocated. 0 when unknown. */
+    uint32_t vertex_hint;
+    uint32_t normal_hint;
+    uint32_t texture_hint;
+    uint32_t face_hint;
+    uint32_t corner_hint;
+    /* Set to record which corners used relative (negative) indices. The 
+    * parallel reader resolves those against chunk-local counts and fixes them
+    * up once the counts of the preceding chunks are known. The lines must be
+    * parsed with OBJ_STREAM_DEFER_RANGE. */
+    int record_fixups;
+    /* Corner slots holding relative position, texture and normal indices. */
+    uint32_t* fixups[3];
+    uint32_t num_fixups[3];
+    uint32_t fixup_cap[3];
+    /* The number of positions, textures and normals the preceding chunks 
+    * must hold for every index to be in range, and the line that needs the 
+    * most. Only used when recording fix-ups. */
+    uint32_t deficit[3];
+    uint32_t deficit_line[3];
+    /* Set to split every face into triangles as it arrives. */
+    int triangulate;
+    triangulator_t triangulator;
+    /* The smoothing group of the faces being read, the capacity of the face 
+    * smoothing groups, and the number of faces read before the first "s" 
+    * line. */
+    uint32_t smoothing;
+    uint32_t smoothing_cap;
+    uint32_t smoothing_start;
+    /* The bounds of the positions read so far. */
+    bounds_t bounds;
+    /* The capacities of the groups, objects and materials. */
+    uint32_t group_cap;
+    uint32_t object_cap;
+    uint32_t material_cap;
+    /* The rest of every "mtllib" line, loaded once the file is parsed. */
+    char** libraries;
+    uint32_t num_libraries;
+    uint32_t library_cap;
+    /* The file being read, whose directory holds its material libraries; 
+    * NULL for the working directory. */
+    const char* path;
+} obj_growth_t;
+
+/* The kinds of face ranges of a mesh. */
+enum { RANGE_GROUPS, RANGE_OBJECTS, RANGE_MATERIALS, RANGE_KINDS };
+
+/** Gets the ranges of one kind of a mesh.
+ * @param mesh The mesh object.
+ * @param kind The kind of range.
+ * @param count Output pointer to the number of ranges.
+ * @returns Pointer to the ranges.
+ */
+static obj_range_t** mesh_ranges(mesh_t* mesh, 
+    uint32_t kind, 
+    uint32_t** count) {
+    switch (kind) {
+    case RANGE_GROUPS:
+        *count = &mesh->num_groups;
+        return &mesh->groups;
+    case RANGE_OBJECTS:
+        *count = &mesh->num_objects;
+        return &mesh->objects;
+    default:
+        *count = &mesh->num_materials;
+        return &mesh->materials;
+    }
+}
+
+/** Picks the number of elements to reserve for an array.
+ * @param required The number of elements the array must hold now.
+ * @param hint The expected final number of elements, or 0 if unknown.
+ * @returns The larger of the two.
+ */
+static uint32_t hinted(uint32_t required, uint32_t hint) {
+    return required > hint ? required : hint;
+}
+
+/** Takes the expected final number of every component from the line counts.
+ * Faces are expected to be triangles; larger faces grow the corner arrays.
+ * @param growth The capacities of the mesh arrays.
+ * @param counts The line counts of the file.
+ */
+static void presize(obj_growth_t* growth, const line_counts_t* counts) {
+    growth->vertex_hint = counts->vertices;
+    growth->normal_hint = counts->normals;
+    growth->texture_hint = counts->textures;
+    growth->face_hint = counts->faces;
+    growth->corner_hint = counts->faces * 3;
+}
+
+/** Appends the components of a vertex, normal or texture line to a growable 
+ * contiguous array, checking them against the expected dimension.
+ * @param values The components.
+ * @param dim The number of components.
+ * @param expected Pointer to the expected dimension. Set if it is still 0.
+ * @param array Pointer to the contiguous array of components.
+ * @param count Pointer to the number of elements (not floats) in the array.
+ * @param capacity Pointer to the capacity of the array, in floats.
+ * @param hint The expected final number of elements, or 0 if unknown.
+ * @returns SUCCESS, INVALID_DIMS or MEMORY_REFUSED.
+ */
+static int push_components(const float* values, 
+    uint32_t dim,
+    uint32_t* expected, 
+    float** array, 
+    uint32_t* count, 
+    uint32_t* capacity,
+    uint32_t hint) {
+    int code;
+    if (*expected != 0 && dim != *expected) {
         return INVALID_DIMS;
     }
-    *expected = *retrieved;
+    *expected = dim;
+    if ((code = array_reserve((void**)array, capacity, 
+        hinted(*count + 1, hint) * dim, sizeof **array)) != SUCCESS) {
+        return code;
+    }
+    memcpy(*array + (size_t)*count * dim, values, dim * sizeof **array);
+    (*count)++;
     return SUCCESS;
 }
 
-/** Determines the byte size of what the type represents. For example, a type_t 
- * of TYPE_UINT will return sizeof(uint32_t).
- * @param t The type to find the size of.
- * @returns The byte size of the represented primitive, or 0 if the type could 
- * not be determined.
-*/
-static uint32_t sizeof_typet(type_t t) {
-    switch(t) {
-        case TYPE_UINT:
-            return sizeof(uint32_t);
-        break;
-        case TYPE_FLOAT:
-            return sizeof(float);
-        break;
-        case TYPE_STR:
-            return sizeof(const char*);
-        break;
-        default: break;
-    }
-    return 0;
-}
-
-/**
- * @brief Get the face flag.
- * Ensures face definitions across the file are consistent.
- *
- * @param face_str_element The face element. Usually "1/2/3".
- * @param line The line number.
- * @returns The flag. The face flag is an integer.
- */
-static uint32_t get_face_flag(const char* face_str_element, uint32_t line) {
-    const char* ptr = face_str_element;
-    uint32_t first_pass = 1;
-    uint32_t size = 0;
-    uint32_t flag = 0;
-    uint32_t shift = 0;
-    uint32_t prev_flag = 0;
-    uint32_t curr_flag = 0;
-    while (*ptr != '\0' && *ptr != '\n') {
-        while (*ptr != ' ' && *ptr != '\n' && *ptr != '\0') {
-            flag = 1 << shift;
-            size = 0;
-            // Keep counting even if we are on a space, and the last character 
-			// is 'f'.
-            while (*ptr != '/' && *ptr != '\0' && *ptr != '\n' && (*ptr != ' ' 
-				|| *(ptr - 1) == 'f')) {
-                ptr++;
-                size++;
+static int push_vertex(void* user, 
+    const float* values, 
+    uint32_t dim, 
+    uint32_t line) {
+    obj_growth_t* growth = user;
+    mesh_t* mesh = growth->mesh;
+    int code;
+    (void)line;
+    if ((code = push_components(values, dim, &mesh->vertex_dim, 
+        &mesh->positions, &mesh->num_vertices, &growth->vertex_cap, 
+        growth->vertex_hint)) != SUCCESS) {
+        return code;
+    }
+    bounds_add(&growth->bounds, values, dim);
+    return SUCCESS;
+}
+
+static int push_normal(void* user, 
+    const float* values, 
+    uint32_t dim, 
+    uint32_t line) {
+    obj_growth_t* growth = user;
+    mesh_t* mesh = growth->mesh;
+    (void)line;
+    return push_components(values, dim, &mesh->vertex_dim, &mesh->normals,
+        &mesh->num_normals, &growth->normal_cap, growth->normal_hint);
+}
+
+static int push_texcoord(void* user, 
+    const float* values, 
+    uint32_t dim, 
+    uint32_t line) {
+    obj_growth_t* growth = user;
+    mesh_t* mesh = growth->mesh;
+    (void)line;
+    return push_components(values, dim, &mesh->tex_dim, &mesh->texcoords,
+        &mesh->num_textures, &growth->texture_cap, growth->texture_hint);
+}
+
+/** Records how many elements the preceding chunks must hold for a deferred 
+ * index to be in range.
+ * @param growth The capacities of the mesh arrays.
+ * @param k The attribute: 0 for positions, 1 for textures, 2 for normals.
+ * @param index The index, resolved against chunk-local counts.
+ * @param relative 1 if the index was written as a relative index.
+ * @param count The chunk-local number of elements of the attribute.
+ * @param line The line of the face.
+ */
+static void record_deficit(obj_growth_t* growth, 
+    uint32_t k, 
+    uint32_t index, 
+    int relative,
+    uint32_t count,
+    uint32_t line) {
+    uint32_t deficit = 0;
+    if (relative && (index < 1 || index > count)) {
+        // The index wrapped around below 1.
+        deficit = 1u - index;
+    } else if (!relative && index > count) {
+        deficit = index - count;
+    }
+    if (deficit > growth->deficit[k]) {
+        growth->deficit[k] = deficit;
+        growth->deficit_line[k] = line;
+    }
+}
+
+/** Counts a face into the open group, object and material, extending their 
+ * bounds with the face's unless its indices are chunk-local.
+ * @param growth The capacities of the mesh arrays.
+ * @param face The face.
+ */
+static void extend_ranges(obj_growth_t* growth, const obj_face_event_t* face) {
+    mesh_t* mesh = growth->mesh;
+    obj_range_t* open[RANGE_KINDS];
+    int any = 0;
+    for (uint32_t k = 0; k < RANGE_KINDS; k++) {
+        uint32_t* count;
+        obj_range_t* ranges = *mesh_ranges(mesh, k, &count);
+        open[k] = *count ? &ranges[*count - 1] : NULL;
+        any |= open[k] != NULL;
+    }
+    if (!any) {
+        return;
+    }
+    bounds_t box = {0};
+    for (uint32_t j = 0; face->indices && !growth->record_fixups && 
+        j < face->size; j++) {
+        bounds_add(&box, mesh->positions 
+            + (size_t)(face->indices[j] - 1) * mesh->vertex_dim, 
+            mesh->vertex_dim);
+    }
+    for (uint32_t r = 0; r < RANGE_KINDS; r++) {
+        if (!open[r]) {
+            continue;
+        }
+        open[r]->num_faces++;
+        if (box.count) {
+            bounds_extend(open[r]->aabb_min, open[r]->aabb_max, box.lower, 4);
+            bounds_extend(open[r]->aabb_min, open[r]->aabb_max, box.upper, 4);
+        }
+    }
+}
+
+/** Appends one face to the mesh's compressed-sparse-row face arrays. Faces 
+ * may have any number of corners, but every face must reference the same 
+ * attributes.
+ * @param growth The capacities of the mesh arrays.
+ * @param face The face.
+ * @param line The line of the face.
+ * @returns SUCCESS, PARSING_FAILURE or MEMORY_REFUSED.
+ */
+static int append_face(obj_growth_t* growth, 
+    const obj_face_event_t* face, 
+    uint32_t line) {
+    mesh_t* mesh = growth->mesh;
+    int code;
+    if (mesh->num_faces > 0 && face->flag != mesh->face_flag.flag) {
+        return PARSING_FAILURE;
+    }
+    mesh->face_flag.flag = face->flag;
+
+    uint32_t corners = mesh->num_corners + face->size;
+    if ((code = array_reserve((void**)&mesh->face_offsets, &growth->face_cap, 
+        hinted(mesh->num_faces + 2, growth->face_hint + 1), 
+        sizeof *mesh->face_offsets)) != SUCCESS) {
+        return code;
+    }
+    if (mesh->face_smoothing && (code = array_reserve(
+        (void**)&mesh->face_smoothing, &growth->smoothing_cap, 
+        hinted(mesh->num_faces + 1, growth->face_hint), 
+        sizeof *mesh->face_smoothing)) != SUCCESS) {
+        return code;
+    }
+    uint32_t** members[3] = { 
+        &mesh->face_indices, &mesh->face_texs, &mesh->face_norms 
+    };
+    uint32_t* capacities[3] = { 
+        &growth->index_cap, &growth->tex_cap, &growth->norm_cap 
+    };
+    const uint32_t* sources[3] = { face->indices, face->texs, face->norms };
+    const uint32_t counts[3] = { 
+        mesh->num_vertices, mesh->num_textures, mesh->num_normals 
+    };
+    for (uint32_t k = 0; k < 3; k++) {
+        if (!sources[k]) {
+            continue;
+        }
+        if ((code = array_reserve((void**)members[k], capacities[k], 
+            hinted(corners, growth->corner_hint), sizeof **members[k])) 
+            != SUCCESS) {
+            return code;
+        }
+        memcpy(*members[k] + mesh->num_corners, sources[k], 
+            face->size * sizeof *sources[k]);
+        if (!growth->record_fixups) {
+            continue;
+        }
+        for (uint32_t j = 0; j < face->size; j++) {
+            int relative = (face->relative[j] >> k) & 1;
+            record_deficit(growth, k, sources[k][j], relative, counts[k], 
+                line);
+            if (!relative) {
+                continue;
             }
-            if (size > 0) {
-                curr_flag |= flag;
-            } else {
-                shift++;
-                ptr++;
+            if ((code = array_reserve((void**)&growth->fixups[k], 
+                &growth->fixup_cap[k], growth->num_fixups[k] + 1, 
+                sizeof *growth->fixups[k])) != SUCCESS) {
+                return code;
+            }
+            growth->fixups[k][growth->num_fixups[k]++] = mesh->num_corners + j;
+        }
+    }
+    mesh->face_offsets[mesh->num_faces] = mesh->num_corners;
+    mesh->face_offsets[mesh->num_faces + 1] = corners;
+    if (mesh->face_smoothing) {
+        mesh->face_smoothing[mesh->num_faces] = growth->smoothing;
+    }
+    extend_ranges(growth, face);
+    mesh->num_corners = corners;
+    mesh->num_faces++;
+    if (face->size > mesh->face_dim) {
+        mesh->face_dim = face->size;
+    }
+    return SUCCESS;
+}
+
+/** Appends the triangles of a face to the mesh. Faces with fewer than three 
+ * corners have no triangles and are dropped.
+ * @param growth The capacities of the mesh arrays.
+ * @param face The face. Its position indices must be in range.
+ * @param line The line of the face.
+ * @returns SUCCESS, PARSING_FAILURE or MEMORY_REFUSED.
+ */
+static int append_triangles(obj_growth_t* growth, 
+    const obj_face_event_t* face, 
+    uint32_t line) {
+    const mesh_t* mesh = growth->mesh;
+    int code;
+    if (face->size < 3) {
+        return SUCCESS;
+    }
+    if (face->size == 3) {
+        return append_face(growth, face, line);
+    }
+    if ((code = triangulate_polygon(&growth->triangulator, mesh->positions, 
+        mesh->vertex_dim, face->indices, face->size)) != SUCCESS) {
+        return code;
+    }
+    const uint32_t* corners = growth->triangulator.triangles;
+    const uint32_t* sources[3] = { face->indices, face->texs, face->norms };
+    uint32_t triangle[3][3];
+    uint8_t relative[3];
+    obj_face_event_t part = {
+        .size = 3,
+        .flag = face->flag,
+        .indices = face->indices ? triangle[0] : NULL,
+        .texs = face->texs ? triangle[1] : NULL,
+        .norms = face->norms ? triangle[2] : NULL,
+        .relative = relative
+    };
+    for (uint32_t t = 0; t + 2 < face->size; t++, corners += 3) {
+        for (uint32_t j = 0; j < 3; j++) {
+            for (uint32_t k = 0; k < 3; k++) {
+                triangle[k][j] = sources[k] ? sources[k][corners[j]] : 0;
             }
+            relative[j] = face->relative[corners[j]];
+        }
+        if ((code = append_face(growth, &part, line)) != SUCCESS) {
+            return code;
         }
-        if (first_pass) {
-            first_pass = !first_pass;
-            prev_flag = curr_flag;
+    }
+    return SUCCESS;
+}
+
+/** Appends a face to the mesh, split into triangles if the mesh is being 
+ * triangulated.
+ * @param user The obj_growth_t.
+ * @param face The face.
+ * @param line The line of the face.
+ * @returns SUCCESS, PARSING_FAILURE or MEMORY_REFUSED.
+ */
+static int push_face(void* user, const obj_face_event_t* face, uint32_t line) {
+    obj_growth_t* growth = user;
+    return growth->triangulate ? append_triangles(growth, face, line) 
+        : append_face(growth, face, line);
+}
+
+/** Starts a range of faces at the next face.
+ * @param ranges Pointer to the growable ranges.
+ * @param count Pointer to the number of ranges.
+ * @param capacity Pointer to the capacity of the ranges.
+ * @param names The names of the range, joined with spaces.
+ * @param num_names The number of names.
+ * @param first_face The next face.
+ * @returns SUCCESS or MEMORY_REFUSED.
+ */
+static int start_range(obj_range_t** ranges, 
+    uint32_t* count, 
+    uint32_t* capacity,
+    const char* const* names, 
+    uint32_t num_names,
+    uint32_t first_face) {
+    int code;
+    if ((code = array_reserve((void**)ranges, capacity, *count + 1, 
+        sizeof **ranges)) != SUCCESS) {
+        return code;
+    }
+    size_t length = 0;
+    for (uint32_t i = 0; i < num_names; i++) {
+        length += strlen(names[i]) + 1;
+    }
+    char* name = malloc(length + 1);
+    if (!name) {
+        return MEMORY_REFUSED;
+    }
+    name[0] = '\0';
+    for (uint32_t i = 0; i < num_names; i++) {
+        if (i > 0) {
+            strcat(name, " ");
         }
-        if (prev_flag != curr_flag) {
-            printf("Error: inconsistent face definitions at line %d, flag was \
-				%d, expected %d\n", line, curr_flag, prev_flag);
-            return 0;
+        strcat(name, names[i]);
+    }
+    obj_range_t* range = &(*ranges)[(*count)++];
+    *range = (obj_range_t) { .name = name, .first_face = first_face };
+    for (uint32_t k = 0; k < 4; k++) {
+        range->aabb_min[k] = INFINITY;
+        range->aabb_max[k] = -INFINITY;
+    }
+    return SUCCESS;
+}
+
+/** Starts a group. */
+static int push_group(void* user, 
+    const char* const* names, 
+    uint32_t count, 
+    uint32_t line) {
+    obj_growth_t* growth = user;
+    mesh_t* mesh = growth->mesh;
+    (void)line;
+    return start_range(&mesh->groups, &mesh->num_groups, &growth->group_cap,
+        names, count, mesh->num_faces);
+}
+
+/** Starts an object, naming the mesh after its first. */
+static int push_object(void* user, const char* name, uint32_t line) {
+    obj_growth_t* growth = user;
+    mesh_t* mesh = growth->mesh;
+    int code;
+    (void)line;
+    if ((code = start_range(&mesh->objects, &mesh->num_objects, 
+        &growth->object_cap, &name, 1, mesh->num_faces)) != SUCCESS) {
+        return code;
+    }
+    if (mesh->name) {
+        return SUCCESS;
+    }
+    if (!(mesh->name = malloc(strlen(name) + 1))) {
+        return MEMORY_REFUSED;
+    }
+    strcpy(mesh->name, name);
+    return SUCCESS;
+}
+
+/** Sets the smoothing group of the faces that follow. The first "s" line 
+ * starts the face smoothing groups, with every face before it in group 0. */
+static int push_smoothing(void* user, uint32_t group, uint32_t line) {
+    obj_growth_t* growth = user;
+    mesh_t* mesh = growth->mesh;
+    int code;
+    (void)line;
+    if (!mesh->face_smoothing) {
+        if ((code = array_reserve((void**)&mesh->face_smoothing, 
+            &growth->smoothing_cap, hinted(mesh->num_faces + 1, 
+            growth->face_hint), sizeof *mesh->face_smoothing)) != SUCCESS) {
+            return code;
         }
-        prev_flag = curr_flag;
-        curr_flag = 0;
-        flag = 0;
-        shift = 0;
-        ptr++;
+        memset(mesh->face_smoothing, 0, 
+            mesh->num_faces * sizeof *mesh->face_smoothing);
+        growth->smoothing_start = mesh->num_faces;
     }
-    return prev_flag;
+    growth->smoothing = group;
+    return SUCCESS;
+}
+
+/** Starts a run of faces with a material. */
+static int push_material(void* user, const char* name, uint32_t line) {
+    obj_growth_t* growth = user;
+    mesh_t* mesh = growth->mesh;
+    (void)line;
+    return start_range(&mesh->materials, &mesh->num_materials, 
+        &growth->material_cap, &name, 1, mesh->num_faces);
 }
 
-/**
- * @brief Gets the objects info (number of components and their dimensions).
+/** Keeps the names of material libraries to load once the file is parsed, 
+ * when every material is known to be in place. */
+static int push_library(void* user, const char* name, uint32_t line) {
+    obj_growth_t* growth = user;
+    char* copy;
+    int code;
+    (void)line;
+    if ((code = array_reserve((void**)&growth->libraries, 
+        &growth->library_cap, growth->num_libraries + 1, 
+        sizeof *growth->libraries)) != SUCCESS) {
+        return code;
+    }
+    if (!(copy = malloc(strlen(name) + 1))) {
+        return MEMORY_REFUSED;
+    }
+    strcpy(copy, name);
+    growth->libraries[growth->num_libraries++] = copy;
+    return SUCCESS;
+}
+
+/** Frees the names of the material libraries of a read. */
+static void free_libraries(obj_growth_t* growth) {
+    for (uint32_t i = 0; i < growth->num_libraries; i++) {
+        free(growth->libraries[i]);
+    }
+    free(growth->libraries);
+    growth->libraries = NULL;
+    growth->num_libraries = 0;
+}
+
+/** Builds a mesh_t from the parser's callbacks. */
+static const obj_callbacks_t mesh_callbacks = {
+    .vertex = push_vertex,
+    .texcoord = push_texcoord,
+    .normal = push_normal,
+    .face = push_face,
+    .group = push_group,
+    .object = push_object,
+    .material = push_material,
+    .library = push_library,
+    .smoothing = push_smoothing
+};
+
+/** Drops the ranges without faces.
+ * @param ranges The ranges.
+ * @param count Pointer to the number of ranges.
+ */
+static void drop_empty_ranges(obj_range_t* ranges, uint32_t* count) {
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < *count; i++) {
+        if (ranges[i].num_faces == 0) {
+            free(ranges[i].name);
+            continue;
+        }
+        // A range whose faces have no positions has no bounds.
+        for (uint32_t k = 0; k < 4; k++) {
+            if (ranges[i].aabb_min[k] > ranges[i].aabb_max[k]) {
+                ranges[i].aabb_min[k] = ranges[i].aabb_max[k] = 0.0f;
+            }
+        }
+        ranges[kept++] = ranges[i];
+    }
+    *count = kept;
+}
+
+/** Stores the bounds of the mesh and drops its empty ranges once every face
+ * is in place.
+ * @param mesh The mesh object.
+ * @param bounds The bounds of its positions.
+ */
+static void finish_bounds(mesh_t* mesh, const bounds_t* bounds) {
+    for (uint32_t k = 0; k < 4; k++) {
+        mesh->aabb_min[k] = bounds->count ? bounds->lower[k] : 0.0f;
+        mesh->aabb_max[k] = bounds->count ? bounds->upper[k] : 0.0f;
+    }
+    bounds_sphere(bounds, mesh->positions, mesh->num_vertices, 
+        mesh->vertex_dim, mesh->sphere_center, &mesh->sphere_radius);
+    drop_empty_ranges(mesh->groups, &mesh->num_groups);
+    drop_empty_ranges(mesh->objects, &mesh->num_objects);
+    drop_empty_ranges(mesh->materials, &mesh->num_materials);
+}
+
+/** Reads the material libraries of a file into its mesh. A library that 
+ * cannot be read is skipped with a warning; its materials stay unresolved.
+ * @param mesh The mesh object.
+ * @param path The file, whose directory holds the libraries, or NULL.
+ * @param names The rest of every "mtllib" line: library file names 
+ * separated by spaces.
+ * @param count The number of lines.
+ * @returns SUCCESS or MEMORY_REFUSED.
+ */
+static int load_libraries(mesh_t* mesh, 
+    const char* path, 
+    char* const* names, 
+    uint32_t count) {
+    size_t directory = 0;
+    for (size_t i = 0; path && path[i]; i++) {
+        if (path[i] == '/' || path[i] == '\\') {
+            directory = i + 1;
+        }
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        const char* name = names[i];
+        while (*name) {
+            size_t length = strcspn(name, " \t");
+            if (length == 0) {
+                name++;
+                continue;
+            }
+            if (!mesh->mtllib.map.buckets) {
+                if (mtllib_create(&mesh->mtllib) != SUCCESS) {
+                    return MEMORY_REFUSED;
+                }
+                char* first = malloc(length + 1);
+                if (!first) {
+                    return MEMORY_REFUSED;
+                }
+                memcpy(first, name, length);
+                first[length] = '\0';
+                mesh->mtllib.name = first;
+            }
+            char* file = malloc(directory + length + 1);
+            if (!file) {
+                return MEMORY_REFUSED;
+            }
+            if (directory) {
+                memcpy(file, path, directory);
+            }
+            memcpy(file + directory, name, length);
+            file[directory + length] = '\0';
+            if (mtllib_read(file, &mesh->mtllib) != SUCCESS) {
+                printf("Warning: cannot read material library \"%s\"\n", 
+                    file);
+            }
+            free(file);
+            name += length;
+        }
+    }
+    return SUCCESS;
+}
+
+/** Points the material ranges, and the face views, at their materials in the
+ * mesh's library. Every library must be loaded first: loading rehashes the 
+ * materials.
+ * @param mesh The mesh object, with its face views bound.
+ */
+static void bind_materials(mesh_t* mesh) {
+    for (uint32_t i = 0; i < mesh->num_materials; i++) {
+        obj_range_t* range = &mesh->materials[i];
+        range->material = NULL;
+        if (mesh->mtllib.map.buckets) {
+            map_at(&mesh->mtllib.map, range->name, &range->material);
+        }
+        for (uint32_t f = range->first_face; mesh->face_data && 
+            f < range->first_face + range->num_faces; f++) {
+            mesh->face_data[f].material = range->material;
+        }
+    }
+}
+
+/** Trims the arrays of a mesh read in a single pass, or destroys the mesh if
+ * reading it failed.
+ * @param mesh The mesh object.
+ * @param growth The capacities of the mesh arrays.
+ * @param code The result of reading the mesh.
+ * @returns The result of reading and trimming the mesh.
+ */
+static int finish_growth(mesh_t* mesh, obj_growth_t* growth, int code) {
+    for (uint32_t k = 0; k < 3; k++) {
+        free(growth->fixups[k]);
+        growth->fixups[k] = NULL;
+    }
+    triangulator_destroy(&growth->triangulator);
+
+    if (code == SUCCESS && ((code = array_trim((void**)&mesh->positions, 
+        &growth->vertex_cap, mesh->num_vertices * mesh->vertex_dim, 
+        sizeof *mesh->positions)) != SUCCESS ||
+        (code = array_trim((void**)&mesh->normals, 
+        &growth->normal_cap, mesh->num_normals * mesh->vertex_dim, 
+        sizeof *mesh->normals)) != SUCCESS ||
+        (code = array_trim((void**)&mesh->texcoords, 
+        &growth->texture_cap, mesh->num_textures * mesh->tex_dim, 
+        sizeof *mesh->texcoords)) != SUCCESS ||
+        (code = array_trim((void**)&mesh->face_offsets, &growth->face_cap, 
+        mesh->num_faces ? mesh->num_faces + 1 : 0, 
+        sizeof *mesh->face_offsets)) != SUCCESS ||
+        (code = array_trim((void**)&mesh->face_indices, &growth->index_cap, 
+        mesh->face_indices ? mesh->num_corners : 0, 
+        sizeof *mesh->face_indices)) != SUCCESS ||
+        (code = array_trim((void**)&mesh->face_texs, &growth->tex_cap, 
+        mesh->face_texs ? mesh->num_corners : 0, 
+        sizeof *mesh->face_texs)) != SUCCESS ||
+        (code = array_trim((void**)&mesh->face_norms, &growth->norm_cap, 
+        mesh->face_norms ? mesh->num_corners : 0, 
+        sizeof *mesh->face_norms)) != SUCCESS ||
+        (code = array_trim((void**)&mesh->face_smoothing, 
+        &growth->smoothing_cap, mesh->face_smoothing ? mesh->num_faces : 0, 
+        sizeof *mesh->face_smoothing)) != SUCCESS ||
+        (code = bind_views(mesh)) != SUCCESS)) {
+        printf("Error: %s\n", errstr(code));
+    }
+    if (code == SUCCESS) {
+        finish_bounds(mesh, &growth->bounds);
+        code = load_libraries(mesh, growth->path, growth->libraries, 
+            growth->num_libraries);
+    }
+    free_libraries(growth);
+    if (code == SUCCESS) {
+        bind_materials(mesh);
+    }
+    if (code != SUCCESS) {
+        obj_destroy(mesh);
+        obj_init(mesh);
+    }
+    return code;
+}
+
+/** Sorts the faces by material if the read flags ask for it, then generates
+ * the normals they ask for, if the file has none, then the tangents.
+ * @param mesh The mesh object.
+ * @param flags Bitwise OR of obj_read_flags values.
+ * @param num_threads The number of threads to use, or 0 for one per 
+ * processor.
+ * @param code The result of reading the mesh.
+ * @returns The result of reading the mesh and generating its attributes. 
+ * The mesh is destroyed on failure.
+ */
+static int finish_attributes(mesh_t* mesh, 
+    uint32_t flags, 
+    uint32_t num_threads, 
+    int code) {
+    if (code != SUCCESS) {
+        return code;
+    }
+    if (flags & OBJ_SORT_MATERIALS) {
+        code = obj_sort_materials(mesh);
+    }
+    if (code == SUCCESS && !(mesh->face_flag.flag & norm_flag) &&
+        flags & (OBJ_FLAT_NORMALS | OBJ_SMOOTH_NORMALS)) {
+        code = normals_generate(mesh, flags & OBJ_SMOOTH_NORMALS 
+            ? NORMALS_SMOOTH : NORMALS_FLAT, NORMALS_NO_CREASE, num_threads);
+    }
+    if (code == SUCCESS && flags & OBJ_TANGENTS && mesh->face_texs && 
+        mesh->face_norms) {
+        code = tangents_generate(mesh, num_threads);
+    }
+    if (code != SUCCESS) {
+        printf("Error: %s\n", errstr(code));
+        obj_destroy(mesh);
+        obj_init(mesh);
+    }
+    return code;
+}
+
+/** Reads the file in two passes. The first classifies every line in bulk to 
+ * count the components, then the file is rewound and parsed straight into 
+ * arrays presized from those counts.
  *
  * @param mesh The mesh object.
- * @param file The file object.
- * @param err_msg Output error message, if one is encountered.
- * @return A return code that can either be SUCCESS or INVALID_DIMS.
+ * @param file The opened .obj file.
+ * @param fn The name of the file, for its material libraries.
+ * @param flags Bitwise OR of obj_read_flags values.
+ * @return [SUCCESS, INVALID_FILE, INVALID_DIMS, PARSING_FAILURE, 
+ * INDEX_OUT_OF_RANGE, MEMORY_REFUSED].
  */
-static int obj_setinfo(mesh_t* mesh, FILE* file, char* err_msg) {
+static int obj_read_two_pass(mesh_t* mesh, 
+    FILE* file, 
+    const char* fn, 
+    uint32_t flags) {
     int RETURN_CODE = SUCCESS;
-    uint32_t tmp_num_verts = 0;
-    uint32_t tmp_num_faces = 0;
-    uint32_t tmp_num_norms = 0;
-    uint32_t tmp_num_texs = 0;
-    char buffer[MAX_LINE_LEN] = {0};
-    uint32_t line_number = 0;
-
-    int name_defined = 0;
-
-    while (fgets(buffer, sizeof(buffer), file)) {
-        line_number++;
-        const char* type;
-
-        char original_string_for_face[sizeof(buffer)];
-        char original_string_for_dim[sizeof(buffer)];
-        strcpy(original_string_for_face, buffer);
-        strcpy(original_string_for_dim, buffer);
-
-        type = strtok(buffer, " ");
-        uint32_t tmp = 0;
-
-        if (strequ(type, "v")) {
-            tmp_num_verts++;
-            if ((RETURN_CODE = check_dim(
-                &mesh->vertex_dim, 
-                &tmp, 
-                original_string_for_dim)) != SUCCESS) {
-                sprintf(err_msg, "Error: mismatch of vertex dimension at line \
-					%d: expected %d, got %d vertices\n",
-                    line_number, mesh->vertex_dim, tmp);
-                return RETURN_CODE;
+    obj_growth_t growth = { .mesh = mesh, .path = fn,
+        .triangulate = (flags & OBJ_TRIANGULATE) != 0 };
+    line_counts_t counts;
+
+    if ((RETURN_CODE = classify_file(file, &counts, NULL)) != SUCCESS) {
+        printf("Error: %s\n", errstr(RETURN_CODE));
+        return RETURN_CODE;
+    }
+    presize(&growth, &counts);
+
+    fstart(file);
+    RETURN_CODE = obj_parse_stream(file, &mesh_callbacks, &growth, 0);
+    return finish_growth(mesh, &growth, RETURN_CODE);
+}
+
+/** Reads the file in a single pass. Every array grows geometrically as lines
+ * arrive and is trimmed to its final size once the file has been read.
+ *
+ * @param mesh The mesh object.
+ * @param file The opened .obj file.
+ * @param fn The name of the file, for its material libraries.
+ * @param flags Bitwise OR of obj_read_flags values.
+ * @return [SUCCESS, INVALID_DIMS, PARSING_FAILURE, INDEX_OUT_OF_RANGE, 
+ * MEMORY_REFUSED].
+ */
+static int obj_read_single_pass(mesh_t* mesh, 
+    FILE* file, 
+    const char* fn, 
+    uint32_t flags) {
+    obj_growth_t growth = { .mesh = mesh, .path = fn,
+        .triangulate = (flags & OBJ_TRIANGULATE) != 0 };
+    int RETURN_CODE = obj_parse_stream(file, &mesh_callbacks, &growth, 0);
+    return finish_growth(mesh, &growth, RETURN_CODE);
+}
+
+/** Reads a whole .obj file held in memory in a single pass. The lines are 
+ * parsed in place; nothing is copied out of the data.
+ *
+ * @param mesh The mesh object.
+ * @param data The file contents. Need not be NUL-terminated.
+ * @param size The number of bytes of data.
+ * @param fn The name of the file, for its material libraries, or NULL.
+ * @param flags Bitwise OR of obj_read_flags values.
+ * @return [SUCCESS, INVALID_DIMS, PARSING_FAILURE, INDEX_OUT_OF_RANGE, 
+ * MEMORY_REFUSED].
+ */
+static int obj_read_span(mesh_t* mesh, 
+    const char* data, 
+    size_t size, 
+    const char* fn, 
+    uint32_t flags) {
+    obj_growth_t growth = { .mesh = mesh, .path = fn,
+        .triangulate = (flags & OBJ_TRIANGULATE) != 0 };
+    int code = obj_parse_span(data, size, &mesh_callbacks, &growth, 0);
+    return finish_growth(mesh, &growth, code);
+}
+
+/* Files smaller than this are not worth splitting across threads. */
+#define MIN_CHUNK_SIZE (1 << 16)
+
+/** One newline-aligned chunk of a file read in parallel. */
+typedef struct {
+    /* The lines of this chunk. */
+    const char* data;
+    size_t size;
+    /* Everything read from this chunk, with chunk-local counts. */
+    mesh_t mesh;
+    obj_growth_t growth;
+    int code;
+    /* The chunk-local line of the failure, if any. */
+    uint32_t error_line;
+    /* The number of each component in all of the preceding chunks. */
+    uint32_t vertex_base;
+    uint32_t normal_base;
+    uint32_t texture_base;
+    uint32_t face_base;
+    uint32_t corner_base;
+    /* The smoothing group in effect where this chunk starts. */
+    uint32_t smoothing_base;
+} obj_chunk_t;
+
+/** State shared by the workers of a parallel read. */
+typedef struct {
+    obj_chunk_t* chunks;
+    mesh_t* mesh;
+} obj_parallel_t;
+
+/** Keeps the chunk-local line of a failure for obj_read_parallel to report
+ * with its line in the whole file.
+ */
+static void chunk_error(void* user, int code, uint32_t line) {
+    obj_chunk_t* chunk = (obj_chunk_t*)((char*)user 
+        - offsetof(obj_chunk_t, growth));
+    (void)code;
+    chunk->error_line = line;
+}
+
+/** Worker for the first phase of a parallel read: reads one chunk into its 
+ * own growable mesh.
+ * @param ctx The obj_parallel_t.
+ * @param task The index of the chunk.
+ */
+static void read_chunk(void* ctx, uint32_t task) {
+    static const obj_callbacks_t chunk_callbacks = {
+        .vertex = push_vertex,
+        .texcoord = push_texcoord,
+        .normal = push_normal,
+        .face = push_face,
+        .group = push_group,
+        .object = push_object,
+        .material = push_material,
+        .library = push_library,
+        .smoothing = push_smoothing,
+        .error = chunk_error
+    };
+    obj_chunk_t* chunk = &((obj_parallel_t*)ctx)->chunks[task];
+    obj_init(&chunk->mesh);
+    chunk->growth = (obj_growth_t) { .mesh = &chunk->mesh, .record_fixups = 1 };
+    chunk->code = obj_parse_span(chunk->data, chunk->size, &chunk_callbacks,
+        &chunk->growth, OBJ_STREAM_DEFER_RANGE);
+}
+
+/** Worker for the second phase of a parallel read: copies one chunk into its
+ * place in the final mesh and fixes up its relative indices.
+ * @param ctx The obj_parallel_t.
+ * @param task The index of the chunk.
+ */
+static void merge_chunk(void* ctx, uint32_t task) {
+    obj_chunk_t* chunk = &((obj_parallel_t*)ctx)->chunks[task];
+    mesh_t* mesh = ((obj_parallel_t*)ctx)->mesh;
+    const mesh_t* local = &chunk->mesh;
+
+    if (local->num_vertices) {
+        memcpy(mesh->positions + (size_t)chunk->vertex_base * mesh->vertex_dim,
+            local->positions, 
+            (size_t)local->num_vertices * mesh->vertex_dim * sizeof(float));
+    }
+    if (local->num_normals) {
+        memcpy(mesh->normals + (size_t)chunk->normal_base * mesh->vertex_dim,
+            local->normals, 
+            (size_t)local->num_normals * mesh->vertex_dim * sizeof(float));
+    }
+    if (local->num_textures) {
+        memcpy(mesh->texcoords + (size_t)chunk->texture_base * mesh->tex_dim,
+            local->texcoords, 
+            (size_t)local->num_textures * mesh->tex_dim * sizeof(float));
+    }
+    for (uint32_t i = 0; i < local->num_faces; i++) {
+        mesh->face_offsets[chunk->face_base + i + 1] = chunk->corner_base 
+            + local->face_offsets[i + 1];
+    }
+    if (mesh->face_smoothing) {
+        // Faces before the chunk's first "s" line continue the group of the
+        // preceding chunks.
+        uint32_t* groups = mesh->face_smoothing + chunk->face_base;
+        uint32_t start = local->face_smoothing 
+            ? chunk->growth.smoothing_start : local->num_faces;
+        for (uint32_t i = 0; i < start; i++) {
+            groups[i] = chunk->smoothing_base;
+        }
+        if (start < local->num_faces) {
+            memcpy(groups + start, local->face_smoothing + start, 
+                (local->num_faces - start) * sizeof *groups);
+        }
+    }
+    uint32_t* const sources[3] = { 
+        local->face_indices, local->face_texs, local->face_norms 
+    };
+    uint32_t* const targets[3] = { 
+        mesh->face_indices, mesh->face_texs, mesh->face_norms 
+    };
+    const uint32_t bases[3] = { 
+        chunk->vertex_base, chunk->texture_base, chunk->normal_base 
+    };
+    for (uint32_t k = 0; k < 3; k++) {
+        if (!sources[k] || !local->num_corners) {
+            continue;
+        }
+        uint32_t* out = targets[k] + chunk->corner_base;
+        memcpy(out, sources[k], local->num_corners * sizeof *out);
+        for (uint32_t j = 0; j < chunk->growth.num_fixups[k]; j++) {
+            out[chunk->growth.fixups[k][j]] += bases[k];
+        }
+    }
+}
+
+/** Counts the lines before a position in a chunked file.
+ * @param data The file contents.
+ * @param chunk The chunk holding the position.
+ * @param line The chunk-local line number of the position.
+ * @returns The line number of the position within the whole file.
+ */
+static uint32_t global_line(const char* data, 
+    const obj_chunk_t* chunk, 
+    uint32_t line) {
+    for (const char* p = data; p < chunk->data; p++) {
+        line += *p == '\n';
+    }
+    return line;
+}
+
+/** Sums the chunk counts into each chunk's bases and validates that the 
+ * chunks agree on the dimensions of every component.
+ * @param mesh The final mesh. Receives the totals and dimensions.
+ * @param chunks The chunks.
+ * @param num_chunks The number of chunks.
+ * @param smoothed Output flag, set if any chunk has an "s" line.
+ * @returns SUCCESS, INVALID_DIMS or PARSING_FAILURE.
+ */
+static int sum_chunks(mesh_t* mesh, 
+    obj_chunk_t* chunks, 
+    uint32_t num_chunks, 
+    int* smoothed) {
+    uint32_t smoothing = 0;
+    *smoothed = 0;
+    for (uint32_t c = 0; c < num_chunks; c++) {
+        obj_chunk_t* chunk = &chunks[c];
+        const mesh_t* local = &chunk->mesh;
+        if ((local->vertex_dim && mesh->vertex_dim 
+            && local->vertex_dim != mesh->vertex_dim) ||
+            (local->tex_dim && mesh->tex_dim 
+            && local->tex_dim != mesh->tex_dim)) {
+            return INVALID_DIMS;
+        }
+        if (local->num_faces && mesh->num_faces 
+            && local->face_flag.flag != mesh->face_flag.flag) {
+            return PARSING_FAILURE;
+        }
+        if (local->vertex_dim) {
+            mesh->vertex_dim = local->vertex_dim;
+        }
+        if (local->tex_dim) {
+            mesh->tex_dim = local->tex_dim;
+        }
+        if (local->num_faces) {
+            mesh->face_flag.flag = local->face_flag.flag;
+        }
+        if (local->face_dim > mesh->face_dim) {
+            mesh->face_dim = local->face_dim;
+        }
+        chunk->vertex_base = mesh->num_vertices;
+        chunk->normal_base = mesh->num_normals;
+        chunk->texture_base = mesh->num_textures;
+        chunk->face_base = mesh->num_faces;
+        chunk->corner_base = mesh->num_corners;
+        chunk->smoothing_base = smoothing;
+        if (local->face_smoothing) {
+            smoothing = chunk->growth.smoothing;
+            *smoothed = 1;
+        }
+        mesh->num_vertices += local->num_vertices;
+        mesh->num_normals += local->num_normals;
+        mesh->num_textures += local->num_textures;
+        mesh->num_faces += local->num_faces;
+        mesh->num_corners += local->num_corners;
+    }
+    return SUCCESS;
+}
+
+/** Checks that the preceding chunks hold every element that the indices of 
+ * each chunk refer to.
+ * @param data The file contents.
+ * @param chunks The chunks, with their bases set.
+ * @param num_chunks The number of chunks.
+ * @returns SUCCESS or INDEX_OUT_OF_RANGE.
+ */
+static int check_chunks(const char* data, 
+    const obj_chunk_t* chunks, 
+    uint32_t num_chunks) {
+    for (uint32_t c = 0; c < num_chunks; c++) {
+        const obj_chunk_t* chunk = &chunks[c];
+        const uint32_t bases[3] = { 
+            chunk->vertex_base, chunk->texture_base, chunk->normal_base 
+        };
+        for (uint32_t k = 0; k < 3; k++) {
+            if (chunk->growth.deficit[k] > bases[k]) {
+                printf("Error: %s at line %u\n", errstr(INDEX_OUT_OF_RANGE),
+                    global_line(data, chunk, chunk->growth.deficit_line[k]));
+                return INDEX_OUT_OF_RANGE;
             }
-        } else if (strequ(type, "vn")) {
-            tmp_num_norms++;
-            if ((RETURN_CODE = check_dim(
-                &mesh->vertex_dim, 
-                &tmp, 
-                original_string_for_dim)) != SUCCESS) {
-                sprintf(err_msg, "Error: mismatch of vertex normal dimension \
-					at line %d: expected %d, got %d vertex normals (must be same \
-					dimensions as vertex dimension)\n",
-                    line_number, mesh->vertex_dim, tmp);
-                return RETURN_CODE;
+        }
+    }
+    return SUCCESS;
+}
+
+/** Allocates the arrays of the final mesh of a parallel read.
+ * @param mesh The final mesh, with its counts and dimensions set.
+ * @param smoothed Set if the file has "s" lines.
+ * @returns SUCCESS or MEMORY_REFUSED.
+ */
+static int alloc_merged(mesh_t* mesh, int smoothed) {
+    size_t corners = mesh->num_corners;
+    mesh->positions = malloc((size_t)mesh->num_vertices * mesh->vertex_dim 
+        * sizeof *mesh->positions + 1);
+    mesh->normals = malloc((size_t)mesh->num_normals * mesh->vertex_dim 
+        * sizeof *mesh->normals + 1);
+    mesh->texcoords = malloc((size_t)mesh->num_textures * mesh->tex_dim 
+        * sizeof *mesh->texcoords + 1);
+    mesh->face_offsets = calloc((size_t)mesh->num_faces + 1, 
+        sizeof *mesh->face_offsets);
+    if (mesh->face_flag.flag & pos_flag) {
+        mesh->face_indices = malloc(corners * sizeof *mesh->face_indices + 1);
+    }
+    if (mesh->face_flag.flag & tex_flag) {
+        mesh->face_texs = malloc(corners * sizeof *mesh->face_texs + 1);
+    }
+    if (mesh->face_flag.flag & norm_flag) {
+        mesh->face_norms = malloc(corners * sizeof *mesh->face_norms + 1);
+    }
+    if (smoothed) {
+        mesh->face_smoothing = malloc((size_t)mesh->num_faces 
+            * sizeof *mesh->face_smoothing + 1);
+    }
+    if (!mesh->positions || !mesh->normals || !mesh->texcoords ||
+        !mesh->face_offsets || (smoothed && !mesh->face_smoothing) ||
+        (mesh->face_flag.flag & pos_flag && !mesh->face_indices) ||
+        (mesh->face_flag.flag & tex_flag && !mesh->face_texs) ||
+        (mesh->face_flag.flag & norm_flag && !mesh->face_norms)) {
+        return MEMORY_REFUSED;
+    }
+    return SUCCESS;
+}
+
+/** Concatenates the ranges of one kind of the chunks into the final mesh. 
+ * Faces before a chunk's first range continue the last range of the 
+ * preceding chunks. Moves the range names out of the chunks.
+ * @param mesh The final mesh.
+ * @param chunks The chunks, with their bases set.
+ * @param num_chunks The number of chunks.
+ * @param kind The kind of range to merge.
+ * @returns SUCCESS or MEMORY_REFUSED.
+ */
+static int merge_ranges(mesh_t* mesh, 
+    obj_chunk_t* chunks, 
+    uint32_t num_chunks, 
+    uint32_t kind) {
+    uint32_t* count;
+    obj_range_t** ranges = mesh_ranges(mesh, kind, &count);
+    uint32_t total = 0;
+    for (uint32_t c = 0; c < num_chunks; c++) {
+        uint32_t* num;
+        mesh_ranges(&chunks[c].mesh, kind, &num);
+        total += *num;
+    }
+    if (total == 0) {
+        return SUCCESS;
+    }
+    if (!(*ranges = malloc((size_t)total * sizeof **ranges + 1))) {
+        return MEMORY_REFUSED;
+    }
+    for (uint32_t c = 0; c < num_chunks; c++) {
+        mesh_t* local = &chunks[c].mesh;
+        uint32_t* num;
+        obj_range_t* source = *mesh_ranges(local, kind, &num);
+        uint32_t leading = *num ? source[0].first_face : local->num_faces;
+        if (*count) {
+            (*ranges)[*count - 1].num_faces += leading;
+        }
+        for (uint32_t i = 0; i < *num; i++) {
+            obj_range_t* range = &(*ranges)[(*count)++];
+            *range = source[i];
+            range->first_face += chunks[c].face_base;
+            source[i].name = NULL;
+        }
+    }
+    return SUCCESS;
+}
+
+/** Moves the ranges of a mesh onto the triangles of their faces.
+ * @param ranges The ranges.
+ * @param count The number of ranges.
+ * @param firsts The first triangle of every face, and the number of 
+ * triangles last.
+ */
+static void remap_ranges(obj_range_t* ranges, 
+    uint32_t count, 
+    const uint32_t* firsts) {
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t end = ranges[i].first_face + ranges[i].num_faces;
+        ranges[i].num_faces = firsts[end] - firsts[ranges[i].first_face];
+        ranges[i].first_face = firsts[ranges[i].first_face];
+    }
+}
+
+/** State shared by the tasks that bound the ranges of a merged mesh. */
+typedef struct {
+    const mesh_t* mesh;
+    /* The groups, the objects and the materials. */
+    obj_range_t* ranges[RANGE_KINDS];
+    uint32_t counts[RANGE_KINDS];
+    uint32_t num_tasks;
+    /* The first and last range every task meets of every kind. */
+    uint32_t* starts[RANGE_KINDS];
+    uint32_t* stops[RANGE_KINDS];
+    /* The boxes of every task's part of the ranges it meets, at the index of
+     * the range plus the task: consecutive tasks share at most one range. */
+    float (*partials[RANGE_KINDS])[2][4];
+} obj_range_bounds_t;
+
+/** Worker that bounds the parts of the ranges within an even share of the 
+ * faces of a merged mesh.
+ * @param ctx The obj_range_bounds_t.
+ * @param task The index of the share.
+ */
+static void bound_ranges(void* ctx, uint32_t task) {
+    obj_range_bounds_t* state = ctx;
+    const mesh_t* mesh = state->mesh;
+    uint32_t begin = (uint32_t)((uint64_t)mesh->num_faces * task 
+        / state->num_tasks);
+    uint32_t end = (uint32_t)((uint64_t)mesh->num_faces * (task + 1) 
+        / state->num_tasks);
+    for (uint32_t k = 0; k < RANGE_KINDS; k++) {
+        const obj_range_t* ranges = state->ranges[k];
+        uint32_t r = 0;
+        while (r + 1 < state->counts[k] && ranges[r + 1].first_face <= begin) {
+            r++;
+        }
+        state->starts[k][task] = r;
+        float (*box)[4] = state->partials[k][r + task];
+        for (uint32_t j = 0; j < 4; j++) {
+            box[0][j] = INFINITY;
+            box[1][j] = -INFINITY;
+        }
+        for (uint32_t i = begin; i < end && state->counts[k]; i++) {
+            if (i < ranges[r].first_face) {
+                continue;
             }
-        } else if (strequ(type, "vt")){
-            tmp_num_texs++;
-            if ((RETURN_CODE = check_dim(
-                &mesh->tex_dim, 
-                &tmp, 
-                original_string_for_dim)) != SUCCESS) {
-                sprintf(err_msg, "Error: mismatch of vertex texture dimension \
-					at line %d: expected %d, got %d vertex texture components\n"
-					, line_number, mesh->tex_dim, tmp);
-                return RETURN_CODE;
+            while (i >= ranges[r].first_face + ranges[r].num_faces) {
+                r++;
+                box = state->partials[k][r + task];
+                for (uint32_t j = 0; j < 4; j++) {
+                    box[0][j] = INFINITY;
+                    box[1][j] = -INFINITY;
+                }
             }
-        } else if (strequ(type, "f")) {
-            tmp_num_faces++;
-            if ((RETURN_CODE = check_dim(
-                &mesh->face_dim, 
-                &tmp, 
-                original_string_for_dim)) != SUCCESS) {
-                sprintf(err_msg, "Error: mismatch of face dimension at line %d:\
-                 expected %d, got %d face components\n",
-                        line_number, mesh->tex_dim, tmp);
-                return RETURN_CODE;
+            for (uint32_t c = mesh->face_offsets[i]; 
+                c < mesh->face_offsets[i + 1]; c++) {
+                bounds_extend(box[0], box[1], mesh->positions 
+                    + (size_t)(mesh->face_indices[c] - 1) * mesh->vertex_dim, 
+                    mesh->vertex_dim);
             }
-            mesh->face_flag.flag = get_face_flag(
-                original_string_for_face, 
-                line_number);
-        } else if (strequ(type, "o") && !name_defined) {
-            char* tmp_name = strtok(NULL, "\n");
-            mesh->name = calloc(1, strlen(tmp_name));
-            if (!mesh->name) {
-                return MEMORY_REFUSED;
+        }
+        state->stops[k][task] = r;
+    }
+}
+
+/** Bounds every group, object and material of a merged mesh from the 
+ * positions of their faces, across several threads.
+ * @param mesh The mesh object, with its faces in place.
+ * @param num_threads The number of threads to use.
+ * @returns SUCCESS or MEMORY_REFUSED.
+ */
+static int bound_merged(mesh_t* mesh, uint32_t num_threads) {
+    int code = SUCCESS;
+    if ((!mesh->num_groups && !mesh->num_objects && !mesh->num_materials) || 
+        !mesh->face_indices) {
+        return SUCCESS;
+    }
+    obj_range_bounds_t state = { .mesh = mesh, .num_tasks = num_threads * 4 };
+    for (uint32_t k = 0; k < RANGE_KINDS; k++) {
+        uint32_t* count;
+        state.ranges[k] = *mesh_ranges(mesh, k, &count);
+        state.counts[k] = *count;
+    }
+    for (uint32_t k = 0; k < RANGE_KINDS; k++) {
+        state.starts[k] = malloc(state.num_tasks * sizeof *state.starts[k]);
+        state.stops[k] = malloc(state.num_tasks * sizeof *state.stops[k]);
+        state.partials[k] = malloc(((size_t)state.counts[k] + state.num_tasks)
+            * sizeof *state.partials[k]);
+        if (!state.starts[k] || !state.stops[k] || !state.partials[k]) {
+            code = MEMORY_REFUSED;
+        }
+    }
+    if (code == SUCCESS) {
+        parallel_for(state.num_tasks, num_threads, bound_ranges, &state);
+        for (uint32_t k = 0; k < RANGE_KINDS; k++) {
+            for (uint32_t t = 0; t < state.num_tasks; t++) {
+                for (uint32_t r = state.starts[k][t]; 
+                    r <= state.stops[k][t] && r < state.counts[k]; r++) {
+                    obj_range_t* range = &state.ranges[k][r];
+                    bounds_extend(range->aabb_min, range->aabb_max, 
+                        state.partials[k][r + t][0], 4);
+                    bounds_extend(range->aabb_min, range->aabb_max, 
+                        state.partials[k][r + t][1], 4);
+                }
             }
-            strcpy(mesh->name, tmp_name);
-            name_defined = !name_defined;
-        } else if (strequ(type, "mtllib")) {
-            // char* tmp_name = strtok(NULL, "\n");
-            // TODO: create a new entry in material library.
         }
     }
-    mesh->num_vertices = tmp_num_verts;
-    mesh->num_faces = tmp_num_faces;
-    mesh->num_normals = tmp_num_norms;
-    mesh->num_textures = tmp_num_texs;
+    for (uint32_t k = 0; k < RANGE_KINDS; k++) {
+        free(state.starts[k]);
+        free(state.stops[k]);
+        free(state.partials[k]);
+    }
+    return code;
+}
 
-    return RETURN_CODE;
+/** State shared by the tasks that split the faces of a merged mesh into 
+ * triangles. */
+typedef struct {
+    const mesh_t* mesh;
+    /* The first triangle of every face, and the number of triangles last. */
+    uint32_t* firsts;
+    /* The triangle corners' position, texture and normal indices. */
+    uint32_t* corners[3];
+    /* The smoothing group of every triangle, if the mesh has them. */
+    uint32_t* smoothing;
+    uint32_t num_tasks;
+    /* The result of every task. */
+    int* codes;
+} obj_triangulation_t;
+
+/** Worker that splits an even share of the faces of a merged mesh into 
+ * triangles.
+ * @param ctx The obj_triangulation_t.
+ * @param task The index of the share.
+ */
+static void triangulate_faces(void* ctx, uint32_t task) {
+    obj_triangulation_t* state = ctx;
+    const mesh_t* mesh = state->mesh;
+    const uint32_t* sources[3] = { 
+        mesh->face_indices, mesh->face_texs, mesh->face_norms 
+    };
+    uint32_t begin = (uint32_t)((uint64_t)mesh->num_faces * task 
+        / state->num_tasks);
+    uint32_t end = (uint32_t)((uint64_t)mesh->num_faces * (task + 1) 
+        / state->num_tasks);
+    triangulator_t triangulator;
+    triangulator_init(&triangulator);
+    state->codes[task] = SUCCESS;
+    for (uint32_t i = begin; i < end; i++) {
+        uint32_t size = obj_face_size(mesh, i);
+        uint32_t offset = mesh->face_offsets[i];
+        if (size < 3) {
+            continue;
+        }
+        if ((state->codes[task] = triangulate_polygon(&triangulator, 
+            mesh->positions, mesh->vertex_dim, mesh->face_indices + offset, 
+            size)) != SUCCESS) {
+            break;
+        }
+        size_t out = (size_t)state->firsts[i] * 3;
+        for (uint32_t t = 0; state->smoothing && t < size - 2; t++) {
+            state->smoothing[state->firsts[i] + t] = mesh->face_smoothing[i];
+        }
+        for (uint32_t j = 0; j < (size - 2) * 3; j++) {
+            uint32_t corner = offset + triangulator.triangles[j];
+            for (uint32_t k = 0; k < 3; k++) {
+                if (sources[k]) {
+                    state->corners[k][out + j] = sources[k][corner];
+                }
+            }
+        }
+    }
+    triangulator_destroy(&triangulator);
+}
+
+/** Splits every face of a merged mesh into triangles, across several 
+ * threads. Faces with fewer than three corners are dropped. The face views 
+ * must be bound afterwards.
+ * @param mesh The mesh object.
+ * @param num_threads The number of threads to use.
+ * @returns SUCCESS or MEMORY_REFUSED.
+ */
+static int triangulate_merged(mesh_t* mesh, uint32_t num_threads) {
+    int code = SUCCESS;
+    if (mesh->num_corners == mesh->num_faces * 3 && mesh->face_dim == 3) {
+        return SUCCESS;
+    }
+    obj_triangulation_t state = { .mesh = mesh, .num_tasks = num_threads * 4 };
+    state.firsts = malloc(((size_t)mesh->num_faces + 1) 
+        * sizeof *state.firsts);
+    state.codes = malloc(state.num_tasks * sizeof *state.codes);
+    if (!state.firsts || !state.codes) {
+        free(state.firsts);
+        free(state.codes);
+        return MEMORY_REFUSED;
+    }
+    uint32_t triangles = 0;
+    for (uint32_t i = 0; i < mesh->num_faces; i++) {
+        uint32_t size = obj_face_size(mesh, i);
+        state.firsts[i] = triangles;
+        triangles += size < 3 ? 0 : size - 2;
+    }
+    state.firsts[mesh->num_faces] = triangles;
+
+    uint32_t* offsets = malloc(((size_t)triangles + 1) * sizeof *offsets);
+    const uint32_t* sources[3] = { 
+        mesh->face_indices, mesh->face_texs, mesh->face_norms 
+    };
+    for (uint32_t k = 0; k < 3; k++) {
+        if (sources[k] && !(state.corners[k] = malloc((size_t)triangles * 3 
+            * sizeof *state.corners[k] + 1))) {
+            code = MEMORY_REFUSED;
+        }
+    }
+    if (mesh->face_smoothing && !(state.smoothing = malloc((size_t)triangles 
+        * sizeof *state.smoothing + 1))) {
+        code = MEMORY_REFUSED;
+    }
+    if (!offsets) {
+        code = MEMORY_REFUSED;
+    }
+    if (code == SUCCESS) {
+        parallel_for(state.num_tasks, num_threads, triangulate_faces, &state);
+        for (uint32_t t = 0; t < state.num_tasks && code == SUCCESS; t++) {
+            code = state.codes[t];
+        }
+    }
+    if (code != SUCCESS) {
+        for (uint32_t k = 0; k < 3; k++) {
+            free(state.corners[k]);
+        }
+        free(state.smoothing);
+        free(offsets);
+    } else {
+        for (uint32_t i = 0; i <= triangles; i++) {
+            offsets[i] = i * 3;
+        }
+        free(mesh->face_offsets);
+        free(mesh->face_indices);
+        free(mesh->face_texs);
+        free(mesh->face_norms);
+        mesh->face_offsets = offsets;
+        mesh->face_indices = state.corners[0];
+        mesh->face_texs = state.corners[1];
+        mesh->face_norms = state.corners[2];
+        if (state.smoothing) {
+            free(mesh->face_smoothing);
+            mesh->face_smoothing = state.smoothing;
+        }
+        mesh->num_faces = triangles;
+        mesh->num_corners = triangles * 3;
+        mesh->face_dim = triangles ? 3 : 0;
+        remap_ranges(mesh->groups, mesh->num_groups, state.firsts);
+        remap_ranges(mesh->objects, mesh->num_objects, state.firsts);
+        remap_ranges(mesh->materials, mesh->num_materials, state.firsts);
+    }
+    free(state.firsts);
+    free(state.codes);
+    return code;
+}
+
+/** A material range's name and index, for sorting the ranges by name. */
+typedef struct {
+    const char* name;
+    uint32_t range;
+} named_range_t;
+
+static int compare_named(const void* a, const void* b) {
+    const named_range_t* x = a;
+    const named_range_t* y = b;
+    int order = strcmp(x->name, y->name);
+    if (order != 0) {
+        return order;
+    }
+    return x->range < y->range ? -1 : x->range > y->range;
+}
+
+static int compare_first_face(const void* a, const void* b) {
+    const obj_range_t* x = a;
+    const obj_range_t* y = b;
+    return x->first_face < y->first_face ? -1 
+        : x->first_face > y->first_face;
+}
+
+/** Frees ranges made while sorting a mesh by material. */
+static void free_ranges(obj_range_t* ranges, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        free(ranges[i].name);
+    }
+    free(ranges);
+}
+
+/** Splits ranges of faces where the faces are about to be sorted by key: the
+ * faces of a range with one key stay together, so a range becomes one range
+ * per key it holds. The pieces are bounded from the positions of their faces
+ * and ordered by their first face after the sort.
+ * @param mesh The mesh object, not yet sorted.
+ * @param ranges The ranges.
+ * @param count The number of ranges.
+ * @param keys The key of every face.
+ * @param where The index of every face after the sort.
+ * @param num_keys The number of keys.
+ * @param out Output pieces, with names of their own.
+ * @param num_out Output number of pieces.
+ * @returns SUCCESS or MEMORY_REFUSED. Nothing is output on failure.
+ */
+static int split_ranges(const mesh_t* mesh, 
+    const obj_range_t* ranges, 
+    uint32_t count, 
+    const uint32_t* keys, 
+    const uint32_t* where, 
+    uint32_t num_keys,
+    obj_range_t** out, 
+    uint32_t* num_out) {
+    obj_range_t* pieces = NULL;
+    uint32_t num_pieces = 0, capacity = 0;
+    uint32_t* touched = malloc((size_t)num_keys * sizeof *touched + 1);
+    uint32_t* slot = malloc((size_t)num_keys * sizeof *slot + 1);
+    int code = touched && slot ? SUCCESS : MEMORY_REFUSED;
+    for (uint32_t k = 0; code == SUCCESS && k < num_keys; k++) {
+        slot[k] = UINT32_MAX;
+    }
+    for (uint32_t r = 0; code == SUCCESS && r < count; r++) {
+        const obj_range_t* range = &ranges[r];
+        uint32_t num_touched = 0;
+        for (uint32_t f = range->first_face; code == SUCCESS && 
+            f < range->first_face + range->num_faces; f++) {
+            uint32_t k = keys[f];
+            if (slot[k] == UINT32_MAX) {
+                if ((code = array_reserve((void**)&pieces, &capacity, 
+                    num_pieces + 1, sizeof *pieces)) != SUCCESS) {
+                    break;
+                }
+                char* name = malloc(strlen(range->name) + 1);
+                if (!name) {
+                    code = MEMORY_REFUSED;
+                    break;
+                }
+                strcpy(name, range->name);
+                obj_range_t* piece = &pieces[num_pieces];
+                *piece = (obj_range_t) { .name = name, 
+                    .material = range->material, .first_face = where[f] };
+                for (uint32_t j = 0; j < 4; j++) {
+                    piece->aabb_min[j] = INFINITY;
+                    piece->aabb_max[j] = -INFINITY;
+                }
+                slot[k] = num_pieces++;
+                touched[num_touched++] = k;
+            }
+            obj_range_t* piece = &pieces[slot[k]];
+            piece->num_faces++;
+            for (uint32_t c = mesh->face_offsets[f]; mesh->face_indices && 
+                c < mesh->face_offsets[f + 1]; c++) {
+                bounds_extend(piece->aabb_min, piece->aabb_max, 
+                    mesh->positions + (size_t)(mesh->face_indices[c] - 1) 
+                    * mesh->vertex_dim, mesh->vertex_dim);
+            }
+        }
+        for (uint32_t i = 0; i < num_touched; i++) {
+            slot[touched[i]] = UINT32_MAX;
+        }
+    }
+    free(touched);
+    free(slot);
+    if (code != SUCCESS) {
+        free_ranges(pieces, num_pieces);
+        return code;
+    }
+    if (num_pieces > 1) {
+        qsort(pieces, num_pieces, sizeof *pieces, compare_first_face);
+    }
+    // Drops none: every piece has a face. Clears the bounds of faces without
+    // positions.
+    drop_empty_ranges(pieces, &num_pieces);
+    *out = pieces;
+    *num_out = num_pieces;
+    return SUCCESS;
 }
 
 // -----------------------------------------------------------------------------
@@ -215,26 +1588,30 @@ static int obj_setinfo(mesh_t* mesh, FILE* file, char* err_msg) {
 // -----------------------------------------------------------------------------
 void obj_print(const mesh_t* mesh) {
     for (uint32_t i = 0; i < mesh->num_vertices; i++) {
-        buffer_print(mesh->vertex_data[i].pos, TYPE_FLOAT, mesh->vertex_dim);
+        buffer_print(mesh->positions + i * mesh->vertex_dim, TYPE_FLOAT, 
+            mesh->vertex_dim);
     }
     for (uint32_t i = 0; i < mesh->num_normals; i++) {
-        buffer_print(mesh->normal_data[i].norm, TYPE_FLOAT, mesh->vertex_dim);
+        buffer_print(mesh->normals + i * mesh->vertex_dim, TYPE_FLOAT, 
+            mesh->vertex_dim);
     }
     for (uint32_t i = 0; i < mesh->num_textures; i++) {
-        buffer_print(mesh->texture_data[i].tex, TYPE_FLOAT, mesh->tex_dim);
+        buffer_print(mesh->texcoords + i * mesh->tex_dim, TYPE_FLOAT, 
+            mesh->tex_dim);
     }
     for (uint32_t i = 0; i < mesh->num_faces; i++) {
+        uint32_t size = obj_face_size(mesh, i);
         if (mesh->face_flag.flag & pos_flag) {
             printf("Position Indices: \n");
-            buffer_print(mesh->face_data[i].indices, TYPE_UINT, mesh->face_dim);
+            buffer_print(obj_face_indices(mesh, i), TYPE_UINT, size);
         }
         if (mesh->face_flag.flag & tex_flag) {
             printf("Texture Indices: \n");
-            buffer_print(mesh->face_data[i].texs, TYPE_UINT, mesh->face_dim);
+            buffer_print(obj_face_texs(mesh, i), TYPE_UINT, size);
         }
         if (mesh->face_flag.flag & norm_flag) {
             printf("Normal Indices: \n");
-            buffer_print(mesh->face_data[i].norms, TYPE_UINT, mesh->face_dim);
+            buffer_print(obj_face_norms(mesh, i), TYPE_UINT, size);
         }
     }
 }
@@ -258,7 +1635,7 @@ void obj_fwrite(const mesh_t* mesh, const char* fn) {
         for (uint32_t i = 0; i < mesh->num_vertices; i++) {
             buffer_fwrite(
                 file, 
-                mesh->vertex_data[i].pos, 
+                mesh->positions + i * mesh->vertex_dim, 
                 TYPE_FLOAT, 
                 mesh->vertex_dim);
         }
@@ -271,7 +1648,7 @@ void obj_fwrite(const mesh_t* mesh, const char* fn) {
         for (uint32_t i = 0; i < mesh->num_normals; i++) {
             buffer_fwrite(
                 file, 
-                mesh->normal_data[i].norm, 
+                mesh->normals + i * mesh->vertex_dim, 
                 TYPE_FLOAT, 
                 mesh->vertex_dim);
         }
@@ -284,7 +1661,7 @@ void obj_fwrite(const mesh_t* mesh, const char* fn) {
         for (uint32_t i = 0; i < mesh->num_textures; i++) {
             buffer_fwrite(
                 file, 
-                mesh->texture_data[i].tex, 
+                mesh->texcoords + i * mesh->tex_dim, 
                 TYPE_FLOAT, 
                 mesh->tex_dim);
         }
@@ -292,57 +1669,276 @@ void obj_fwrite(const mesh_t* mesh, const char* fn) {
 
     fprintf(file, "*** Face mesh ***\n");
     for (uint32_t i = 0; i < mesh->num_faces; i++) {
+        uint32_t size = obj_face_size(mesh, i);
         fprintf(file, "*** Face %d ***\n", i+1);
         if (mesh->face_flag.flag & pos_flag) {
             fprintf(file, "Position Indices ->");
             buffer_fwrite(
                 file, 
-                mesh->face_data[i].indices, 
+                obj_face_indices(mesh, i), 
                 TYPE_UINT, 
-                mesh->face_dim);
+                size);
         }
 
         if (mesh->face_flag.flag & tex_flag) {
             fprintf(file, "Texture Indices ->");
-            buffer_fwrite(file, mesh->face_data[i].texs, TYPE_UINT, mesh->face_dim);
+            buffer_fwrite(file, obj_face_texs(mesh, i), TYPE_UINT, size);
         }
 
         if (mesh->face_flag.flag & norm_flag) {
             fprintf(file, "Normal Indices ->");
-            buffer_fwrite(file, mesh->face_data[i].norms, TYPE_UINT, mesh->face_dim);
+            buffer_fwrite(file, obj_face_norms(mesh, i), TYPE_UINT, size);
         }
     }
 
     fclose(file);
 }
 
-void obj_destroy(mesh_t* mesh) {
-    for (uint32_t i = 0; i < mesh->num_vertices; i++) {
-        free(mesh->vertex_data[i].pos);
+int obj_sort_materials(mesh_t* mesh) {
+    if (mesh->num_materials == 0) {
+        return SUCCESS;
     }
-    free(mesh->vertex_data);
-    for (uint32_t i = 0; i < mesh->num_normals; i++) {
-        free(mesh->normal_data[i].norm);
+    uint32_t num_ranges = mesh->num_materials;
+    uint32_t num_faces = mesh->num_faces;
+    size_t corners = mesh->num_corners;
+    int code = SUCCESS;
+    named_range_t* named = malloc(num_ranges * sizeof *named + 1);
+    uint32_t* ids = malloc(num_ranges * sizeof *ids + 1);
+    uint32_t* keys = malloc((size_t)num_faces * sizeof *keys + 1);
+    uint32_t* where = malloc((size_t)num_faces * sizeof *where + 1);
+    uint32_t* starts = NULL;
+    if (!named || !ids || !keys || !where) {
+        code = MEMORY_REFUSED;
     }
-    free(mesh->normal_data);
-    for (uint32_t i = 0; i < mesh->num_textures; i++) {
-        free(mesh->texture_data[i].tex);
+
+    // Ranges of the same name share a key, numbered by first use after key 0
+    // for the faces without a material.
+    uint32_t num_keys = 1;
+    if (code == SUCCESS) {
+        for (uint32_t r = 0; r < num_ranges; r++) {
+            named[r] = (named_range_t) { mesh->materials[r].name, r };
+        }
+        qsort(named, num_ranges, sizeof *named, compare_named);
+        for (uint32_t i = 0, leader = 0; i < num_ranges; i++) {
+            if (i == 0 || strcmp(named[i - 1].name, named[i].name) != 0) {
+                leader = named[i].range;
+            }
+            ids[named[i].range] = leader;
+        }
+        for (uint32_t r = 0; r < num_ranges; r++) {
+            ids[r] = ids[r] == r ? num_keys++ : ids[ids[r]];
+        }
+        memset(keys, 0, (size_t)num_faces * sizeof *keys);
+        for (uint32_t r = 0; r < num_ranges; r++) {
+            const obj_range_t* range = &mesh->materials[r];
+            for (uint32_t f = range->first_face; 
+                f < range->first_face + range->num_faces; f++) {
+                keys[f] = ids[r];
+            }
+        }
+        if (!(starts = calloc((size_t)num_keys + 1, sizeof *starts))) {
+            code = MEMORY_REFUSED;
+        }
     }
-    free(mesh->texture_data);
-    for (uint32_t i = 0; i < mesh->num_faces; i++) {
-        if (mesh->face_flag.flag & pos_flag) {
-            free(mesh->face_data[i].indices);
-		}
-        if (mesh->face_flag.flag & tex_flag) {
-            free(mesh->face_data[i].texs);
-		}
-        if (mesh->face_flag.flag & norm_flag) {
-            free(mesh->face_data[i].norms);
-		}
+    if (code == SUCCESS) {
+        // A counting sort: faces keep their order within a key.
+        for (uint32_t f = 0; f < num_faces; f++) {
+            starts[keys[f] + 1]++;
+        }
+        for (uint32_t k = 0; k < num_keys; k++) {
+            starts[k + 1] += starts[k];
+        }
+        for (uint32_t f = 0; f < num_faces; f++) {
+            where[f] = starts[keys[f]]++;
+        }
+        for (uint32_t k = num_keys; k > 0; k--) {
+            starts[k] = starts[k - 1];
+        }
+        starts[0] = 0;
+    }
+
+    uint32_t* offsets = NULL;
+    uint32_t* smoothing = NULL;
+    uint32_t* sorted[3] = { NULL, NULL, NULL };
+    float* tangents = NULL;
+    face_t* views = NULL;
+    obj_range_t* pieces[2] = { NULL, NULL };
+    uint32_t num_pieces[2] = { 0, 0 };
+    obj_range_t* materials = NULL;
+    uint32_t* const sources[3] = { 
+        mesh->face_indices, mesh->face_texs, mesh->face_norms 
+    };
+    if (code == SUCCESS) {
+        offsets = malloc(((size_t)num_faces + 1) * sizeof *offsets);
+        views = malloc((size_t)num_faces * sizeof *views + 1);
+        materials = calloc(num_keys, sizeof *materials);
+        if (!offsets || !views || !materials) {
+            code = MEMORY_REFUSED;
+        }
+        for (uint32_t k = 0; k < 3; k++) {
+            if (sources[k] && !(sorted[k] = malloc(corners 
+                * sizeof *sorted[k] + 1))) {
+                code = MEMORY_REFUSED;
+            }
+        }
+        if (mesh->face_smoothing && !(smoothing = malloc((size_t)num_faces 
+            * sizeof *smoothing + 1))) {
+            code = MEMORY_REFUSED;
+        }
+        if (mesh->tangents && !(tangents = malloc(corners * 4 
+            * sizeof *tangents + 1))) {
+            code = MEMORY_REFUSED;
+        }
+    }
+    if (code == SUCCESS && (code = split_ranges(mesh, mesh->groups, 
+        mesh->num_groups, keys, where, num_keys, &pieces[0], 
+        &num_pieces[0])) == SUCCESS) {
+        code = split_ranges(mesh, mesh->objects, mesh->num_objects, keys, 
+            where, num_keys, &pieces[1], &num_pieces[1]);
+    }
+
+    if (code == SUCCESS) {
+        // Offsets in sorted order, then every face's corners to its place.
+        offsets[0] = 0;
+        for (uint32_t f = 0; f < num_faces; f++) {
+            offsets[where[f] + 1] = obj_face_size(mesh, f);
+        }
+        for (uint32_t f = 0; f < num_faces; f++) {
+            offsets[f + 1] += offsets[f];
+        }
+        for (uint32_t f = 0; f < num_faces; f++) {
+            uint32_t from = mesh->face_offsets[f];
+            uint32_t to = offsets[where[f]];
+            uint32_t size = obj_face_size(mesh, f);
+            for (uint32_t k = 0; k < 3; k++) {
+                if (sorted[k]) {
+                    memcpy(sorted[k] + to, sources[k] + from, 
+                        size * sizeof *sorted[k]);
+                }
+            }
+            if (tangents) {
+                memcpy(tangents + (size_t)to * 4, mesh->tangents 
+                    + (size_t)from * 4, size * 4 * sizeof *tangents);
+            }
+            if (smoothing) {
+                smoothing[where[f]] = mesh->face_smoothing[f];
+            }
+        }
+        // One range per material, named after its first.
+        uint32_t num_materials = 0;
+        for (uint32_t r = 0; r < num_ranges; r++) {
+            obj_range_t* range = &mesh->materials[r];
+            obj_range_t* merged = &materials[ids[r] - 1];
+            if (!merged->name) {
+                *merged = (obj_range_t) { .name = range->name, 
+                    .material = range->material, 
+                    .first_face = starts[ids[r]],
+                    .num_faces = starts[ids[r] + 1] - starts[ids[r]] };
+                for (uint32_t j = 0; j < 4; j++) {
+                    merged->aabb_min[j] = INFINITY;
+                    merged->aabb_max[j] = -INFINITY;
+                }
+                num_materials++;
+            } else {
+                free(range->name);
+            }
+            bounds_extend(merged->aabb_min, merged->aabb_max, 
+                range->aabb_min, 4);
+            bounds_extend(merged->aabb_min, merged->aabb_max, 
+                range->aabb_max, 4);
+        }
+        free(mesh->materials);
+        mesh->materials = materials;
+        mesh->num_materials = num_materials;
+        drop_empty_ranges(mesh->materials, &mesh->num_materials);
+        materials = NULL;
+
+        for (uint32_t i = 0; i < mesh->num_groups; i++) {
+            free(mesh->groups[i].name);
+        }
+        for (uint32_t i = 0; i < mesh->num_objects; i++) {
+            free(mesh->objects[i].name);
+        }
+        free(mesh->groups);
+        free(mesh->objects);
+        mesh->groups = pieces[0];
+        mesh->num_groups = num_pieces[0];
+        mesh->objects = pieces[1];
+        mesh->num_objects = num_pieces[1];
+        pieces[0] = pieces[1] = NULL;
+        num_pieces[0] = num_pieces[1] = 0;
+
+        free(mesh->face_offsets);
+        free(mesh->face_indices);
+        free(mesh->face_texs);
+        free(mesh->face_norms);
+        free(mesh->face_smoothing);
+        free(mesh->tangents);
+        free(mesh->face_data);
+        mesh->face_offsets = offsets;
+        mesh->face_indices = sorted[0];
+        mesh->face_texs = sorted[1];
+        mesh->face_norms = sorted[2];
+        mesh->face_smoothing = smoothing;
+        mesh->tangents = tangents;
+        mesh->face_data = views;
+        for (uint32_t f = 0; f < num_faces; f++) {
+            mesh->face_data[f] = (face_t) {
+                .material = NULL,
+                .indices = (uint32_t*)obj_face_indices(mesh, f),
+                .texs = (uint32_t*)obj_face_texs(mesh, f),
+                .norms = (uint32_t*)obj_face_norms(mesh, f)
+            };
+        }
+        bind_materials(mesh);
+    } else {
+        free(offsets);
+        free(views);
+        for (uint32_t k = 0; k < 3; k++) {
+            free(sorted[k]);
+        }
+        free(smoothing);
+        free(tangents);
     }
+    free(materials);
+    free_ranges(pieces[0], num_pieces[0]);
+    free_ranges(pieces[1], num_pieces[1]);
+    free(named);
+    free(ids);
+    free(keys);
+    free(where);
+    free(starts);
+    return code;
+}
 
+void obj_destroy(mesh_t* mesh) {
+    free(mesh->positions);
+    free(mesh->normals);
+    free(mesh->texcoords);
+    free(mesh->vertex_data);
+    free(mesh->normal_data);
+    free(mesh->texture_data);
+    free(mesh->face_offsets);
+    free(mesh->face_indices);
+    free(mesh->face_texs);
+    free(mesh->face_norms);
+    free(mesh->face_smoothing);
+    free(mesh->tangents);
     free(mesh->face_data);
-    if (mesh->name && !mesh->name) {
+    for (uint32_t i = 0; i < mesh->num_groups; i++) {
+        free(mesh->groups[i].name);
+    }
+    for (uint32_t i = 0; i < mesh->num_objects; i++) {
+        free(mesh->objects[i].name);
+    }
+    for (uint32_t i = 0; i < mesh->num_materials; i++) {
+        free(mesh->materials[i].name);
+    }
+    free(mesh->groups);
+    free(mesh->objects);
+    free(mesh->materials);
+    mtllib_destroy(&mesh->mtllib);
+    if (mesh->name) {
         free(mesh->name);
 	}
 }
@@ -356,7 +1952,17 @@ void obj_init(mesh_t* mesh) {
     mesh->num_normals = 0;
     mesh->num_textures = 0;
     mesh->num_vertices = 0;
+    mesh->num_corners = 0;
 
+    mesh->positions = NULL;
+    mesh->normals = NULL;
+    mesh->texcoords = NULL;
+    mesh->face_offsets = NULL;
+    mesh->face_indices = NULL;
+    mesh->face_texs = NULL;
+    mesh->face_norms = NULL;
+    mesh->face_smoothing = NULL;
+    mesh->tangents = NULL;
     mesh->vertex_data = 0;
     mesh->face_data = 0;
     mesh->normal_data = 0;
@@ -364,198 +1970,198 @@ void obj_init(mesh_t* mesh) {
 
     mesh->face_flag.flag = 0;
 
+    memset(mesh->aabb_min, 0, sizeof mesh->aabb_min);
+    memset(mesh->aabb_max, 0, sizeof mesh->aabb_max);
+    memset(mesh->sphere_center, 0, sizeof mesh->sphere_center);
+    mesh->sphere_radius = 0.0f;
+    mesh->groups = NULL;
+    mesh->num_groups = 0;
+    mesh->objects = NULL;
+    mesh->num_objects = 0;
+    mesh->materials = NULL;
+    mesh->num_materials = 0;
+
     mesh->name = NULL;
+    memset(&mesh->mtllib, 0, sizeof mesh->mtllib);
 }
 
 int obj_read(const char* fn, mesh_t* mesh) {
+    return obj_read_ex(fn, mesh, 0);
+}
+
+int obj_read_ex(const char* fn, mesh_t* mesh, uint32_t flags) {
     obj_init(mesh);
+    if (flags & OBJ_TANGENTS) {
+        flags |= OBJ_TRIANGULATE;
+    }
     int RETURN_CODE = SUCCESS;
-    char err_msg[256];
 
 	// TODO: Error callbacks
     FILE* file = fopen(fn, "r");
     if (!file) {
         printf("Error: invalid, inaccessible, unavailable, or nonexistent file \"%s\"\n", fn);
-        RETURN_CODE = INVALID_FILE;
-        fclose(file);
+        return INVALID_FILE;
+    }
+
+    if (flags & OBJ_SINGLE_PASS) {
+        RETURN_CODE = obj_read_single_pass(mesh, file, fn, flags);
+    } else {
+        RETURN_CODE = obj_read_two_pass(mesh, file, fn, flags);
+    }
+
+    fclose(file);
+    return finish_attributes(mesh, flags, 0, RETURN_CODE);
+}
+
+int obj_read_mmap(const char* fn, mesh_t* mesh) {
+    obj_init(mesh);
+    int RETURN_CODE = SUCCESS;
+    filemap_t map;
+
+    if ((RETURN_CODE = filemap_open(fn, &map)) != SUCCESS) {
+        printf("Error: invalid, inaccessible, unavailable, or nonexistent file \"%s\"\n", fn);
         return RETURN_CODE;
     }
+    RETURN_CODE = obj_read_span(mesh, map.data, map.size, fn, 0);
+    filemap_close(&map);
+    return RETURN_CODE;
+}
 
-    if ((RETURN_CODE = obj_setinfo(mesh, file, err_msg)) != SUCCESS) {
-        printf("%s", err_msg);
-        fclose(file);
+int obj_read_memory(const char* data, size_t size, mesh_t* mesh) {
+    obj_init(mesh);
+    return obj_read_span(mesh, data, size, NULL, 0);
+}
+
+int obj_read_fd(int fd, mesh_t* mesh) {
+    obj_init(mesh);
+    obj_growth_t growth = { .mesh = mesh };
+    int RETURN_CODE = obj_parse_fd(fd, &mesh_callbacks, &growth, 0);
+    return finish_growth(mesh, &growth, RETURN_CODE);
+}
+
+int obj_read_parallel(const char* fn, 
+    mesh_t* mesh, 
+    uint32_t flags, 
+    uint32_t num_threads) {
+    obj_init(mesh);
+    if (flags & OBJ_TANGENTS) {
+        flags |= OBJ_TRIANGULATE;
+    }
+    int RETURN_CODE = SUCCESS;
+    filemap_t map;
+
+    if ((RETURN_CODE = filemap_open(fn, &map)) != SUCCESS) {
+        printf("Error: invalid, inaccessible, unavailable, or nonexistent file \"%s\"\n", fn);
         return RETURN_CODE;
     }
+    if (num_threads == 0) {
+        num_threads = parallel_threads();
+    }
+    uint32_t num_chunks = num_threads;
+    if (num_chunks > map.size / MIN_CHUNK_SIZE) {
+        num_chunks = (uint32_t)(map.size / MIN_CHUNK_SIZE);
+    }
+    if (num_chunks <= 1) {
+        RETURN_CODE = obj_read_span(mesh, map.data, map.size, fn, 
+            flags);
+        filemap_close(&map);
+        return finish_attributes(mesh, flags, num_threads, RETURN_CODE);
+    }
 
-    struct face_buffers {
-        uint32_t* pos_idx_buffer;
-        uint32_t* tex_idx_buffer;
-        uint32_t* norm_idx_buffer;
-        char** face_str_buffer;
-    } face_buffers;
-    void* generic_buffer;
-
-	// Memory allocations
-    // TODO: we exit without cleaning up. How can we do this properly?
-    if (!(face_buffers.pos_idx_buffer = calloc(mesh->face_dim, sizeof *face_buffers.pos_idx_buffer)) ||
-    !(face_buffers.tex_idx_buffer = calloc(mesh->face_dim, sizeof *face_buffers.tex_idx_buffer)) ||
-    !(face_buffers.norm_idx_buffer = calloc(mesh->face_dim, sizeof *face_buffers.norm_idx_buffer)) ||
-    !(face_buffers.face_str_buffer = calloc(mesh->face_dim, sizeof *face_buffers.face_str_buffer)) ||
-    !(generic_buffer = calloc(1, MAX_LINE_LEN)) ||
-    !(mesh->vertex_data = calloc(mesh->num_vertices, sizeof(vertex_t))) ||
-    !(mesh->normal_data = calloc(mesh->num_normals, sizeof(normal_t))) ||
-    !(mesh->texture_data = calloc(mesh->num_textures, sizeof(texture_t))) ||
-    !(mesh->face_data = calloc(mesh->num_faces, sizeof(face_t)))) {
-        fclose(file);
-        free(face_buffers.pos_idx_buffer);
-        free(face_buffers.tex_idx_buffer);
-        free(face_buffers.norm_idx_buffer);
-        free(face_buffers.face_str_buffer);
-        free(face_buffers.pos_idx_buffer);
+    obj_chunk_t* chunks = calloc(num_chunks, sizeof *chunks);
+    if (!chunks) {
+        filemap_close(&map);
         return MEMORY_REFUSED;
     }
-    for (uint32_t i = 0; i < mesh->face_dim; i++) {
-        if (!(face_buffers.face_str_buffer[i] = calloc(mesh->face_dim, sizeof *face_buffers.face_str_buffer[i]))) {
-            fclose(file);
-            return MEMORY_REFUSED;
+    // Split at the first newline after every evenly spaced boundary.
+    const char* end = map.data + map.size;
+    const char* begin = map.data;
+    for (uint32_t c = 0; c < num_chunks; c++) {
+        const char* stop = end;
+        if (c + 1 < num_chunks) {
+            stop = map.data + map.size / num_chunks * (c + 1);
+            if (stop < begin) {
+                stop = begin;
+            }
+            const char* newline = memchr(stop, '\n', (size_t)(end - stop));
+            stop = newline ? newline + 1 : end;
         }
+        chunks[c].data = begin;
+        chunks[c].size = (size_t)(stop - begin);
+        begin = stop;
     }
-    for (uint32_t i = 0; i < mesh->num_vertices; i++) {
-        if (!(mesh->vertex_data[i].pos = calloc(mesh->vertex_dim, sizeof *mesh->vertex_data[i].pos))) {
-            fclose(file);
-            return MEMORY_REFUSED;
+
+    obj_parallel_t state = { .chunks = chunks, .mesh = mesh };
+    parallel_for(num_chunks, num_threads, read_chunk, &state);
+
+    for (uint32_t c = 0; c < num_chunks && RETURN_CODE == SUCCESS; c++) {
+        if ((RETURN_CODE = chunks[c].code) != SUCCESS) {
+            printf("Error: %s at line %u\n", errstr(RETURN_CODE), 
+                global_line(map.data, &chunks[c], chunks[c].error_line));
         }
     }
-    for (uint32_t i = 0; i < mesh->num_normals; i++) {
-        if (!(mesh->normal_data[i].norm = calloc(mesh->vertex_dim, sizeof *mesh->normal_data[i].norm))) {
-            fclose(file);
-            return MEMORY_REFUSED;
-        }
+    int smoothed = 0;
+    bounds_t bounds = {0};
+    if (RETURN_CODE == SUCCESS && (RETURN_CODE = sum_chunks(mesh, chunks, 
+        num_chunks, &smoothed)) != SUCCESS) {
+        printf("Error: %s\n", errstr(RETURN_CODE));
     }
-    for (uint32_t i = 0; i < mesh->num_textures; i++) {
-        if (!(mesh->texture_data[i].tex = calloc(mesh->tex_dim, sizeof *mesh->texture_data[i].tex))) {
-            fclose(file);
-            return MEMORY_REFUSED;
-        }
+    if (RETURN_CODE == SUCCESS) {
+        RETURN_CODE = check_chunks(map.data, chunks, num_chunks);
     }
-    for (uint32_t i = 0; i < mesh->num_faces; i++) {
-        if (mesh->face_flag.flag & pos_flag) {
-            if (!(mesh->face_data[i].indices = calloc(mesh->face_dim, sizeof *mesh->face_data[i].indices))) {
-                fclose(file);
-                return MEMORY_REFUSED;
-            }
+    if (RETURN_CODE == SUCCESS &&
+        (RETURN_CODE = alloc_merged(mesh, smoothed)) == SUCCESS) {
+        parallel_for(num_chunks, num_threads, merge_chunk, &state);
+        // The object name is the first one in the file.
+        for (uint32_t c = 0; c < num_chunks && !mesh->name; c++) {
+            mesh->name = chunks[c].mesh.name;
+            chunks[c].mesh.name = NULL;
         }
-        if (mesh->face_flag.flag & norm_flag) {
-            if (!(mesh->face_data[i].norms = calloc(mesh->face_dim, sizeof *mesh->face_data[i].norms))) {
-                fclose(file);
-                return MEMORY_REFUSED;
-            }
+        for (uint32_t c = 0; c < num_chunks; c++) {
+            bounds_merge(&bounds, &chunks[c].growth.bounds);
         }
-        if (mesh->face_flag.flag & tex_flag) {
-            if (!(mesh->face_data[i].texs = calloc(mesh->face_dim, sizeof *mesh->face_data[i].texs))) {
-                fclose(file);
-                return MEMORY_REFUSED;
-            }
+        for (uint32_t k = 0; k < RANGE_KINDS && RETURN_CODE == SUCCESS; 
+            k++) {
+            RETURN_CODE = merge_ranges(mesh, chunks, num_chunks, k);
         }
-    }
-
-    // Read the file contents
-    char line_buffer[MAX_LINE_LEN];
-    char line_buffer_cpy[sizeof line_buffer];
-    uint32_t vi = 0, ti = 0, ni = 0, fi = 0;
-    fstart(file);
-    while (fgets(line_buffer, sizeof line_buffer, file)) {
-        void** generic_member;
-        uint32_t dim;
-        type_t dataformat;
-
-        strcpy(line_buffer_cpy, line_buffer);
-
-        const char* type = strtok(line_buffer, " ");
-
-        if (strequ(type, "v")) {
-            generic_member = (void**)(&mesh->vertex_data[vi].pos);
-            dim = mesh->vertex_dim;
-            dataformat = TYPE_FLOAT;
-            vi++;
-        } else if (strequ(type, "vt")) {
-            generic_member = (void**)(&mesh->texture_data[ti].tex);
-            dim = mesh->tex_dim;
-            dataformat = TYPE_FLOAT;
-            ti++;
-        } else if (strequ(type, "vn")) {
-            generic_member = (void**)(&mesh->normal_data[ni].norm);
-            dim = mesh->vertex_dim;
-            dataformat = TYPE_FLOAT;
-            ni++;
-        } else if (strequ(type, "f")) {
-            if (buffer_init(line_buffer_cpy, face_buffers.face_str_buffer, mesh->face_dim, TYPE_STR) != SUCCESS) {
-                continue;
-			}
-            for (uint32_t j = 0; j < mesh->face_dim; j++) {
-                char* buffer = strtok(face_buffers.face_str_buffer[j], "/");
-                if (mesh->face_flag.flag & pos_flag) {
-                    int pos_index = atoi(buffer);
-                    face_buffers.pos_idx_buffer[j] = pos_index;
-                    buffer = strtok(NULL, "/");
-                }
-                if (mesh->face_flag.flag & tex_flag) {
-                    int tex_index = atoi(buffer);
-                    face_buffers.tex_idx_buffer[j] = tex_index;
-                    buffer = strtok(NULL, "/");
-                }
-                if (mesh->face_flag.flag & norm_flag) {
-                    int norm_index = atoi(buffer);
-                    face_buffers.norm_idx_buffer[j] = norm_index;
-                    buffer = strtok(NULL, "/");
-                }
-            }
-            if (mesh->face_flag.flag & pos_flag) {
-                memcpy(mesh->face_data[fi].indices, face_buffers.pos_idx_buffer, sizeof *face_buffers.pos_idx_buffer * mesh->face_dim);
-			}
-            if (mesh->face_flag.flag & tex_flag) {
-                memcpy(mesh->face_data[fi].texs, face_buffers.tex_idx_buffer, sizeof *face_buffers.tex_idx_buffer * mesh->face_dim);
-			}
-            if (mesh->face_flag.flag & norm_flag) {
-                memcpy(mesh->face_data[fi].norms, face_buffers.norm_idx_buffer, sizeof *face_buffers.norm_idx_buffer * mesh->face_dim);
-			}
-			
-            memset(face_buffers.face_str_buffer, 0, sizeof *face_buffers.face_str_buffer * mesh->face_dim);
-            memset(face_buffers.pos_idx_buffer, 0, sizeof *face_buffers.pos_idx_buffer * mesh->face_dim);
-            memset(face_buffers.tex_idx_buffer, 0, sizeof *face_buffers.tex_idx_buffer * mesh->face_dim);
-            memset(face_buffers.norm_idx_buffer, 0, sizeof *face_buffers.norm_idx_buffer * mesh->face_dim);
-
-            fi++;
-            continue;
-        } else {
-            continue;
+        // Concave faces need positions from any chunk, so they are split 
+        // once the chunks are merged.
+        if (RETURN_CODE == SUCCESS && flags & OBJ_TRIANGULATE) {
+            RETURN_CODE = triangulate_merged(mesh, num_threads);
         }
-
-        if (!(generic_buffer = realloc(generic_buffer, sizeof_typet(dataformat) * dim))) {
-            RETURN_CODE = MEMORY_REFUSED;
-            return RETURN_CODE;
+        // So are the ranges bounded, which may span chunks.
+        if (RETURN_CODE == SUCCESS) {
+            RETURN_CODE = bound_merged(mesh, num_threads);
+        }
+        if (RETURN_CODE == SUCCESS) {
+            RETURN_CODE = bind_views(mesh);
+        }
+        if (RETURN_CODE == SUCCESS) {
+            finish_bounds(mesh, &bounds);
+        }
+        // The libraries load in file order once every chunk is in place.
+        for (uint32_t c = 0; c < num_chunks && RETURN_CODE == SUCCESS; c++) {
+            RETURN_CODE = load_libraries(mesh, fn, chunks[c].growth.libraries,
+                chunks[c].growth.num_libraries);
+        }
+        if (RETURN_CODE == SUCCESS) {
+            bind_materials(mesh);
         }
-
-        if (buffer_init(line_buffer_cpy, generic_buffer, dim, dataformat) != SUCCESS) {
-            continue;
-		}
-
-        memcpy(*generic_member, generic_buffer, sizeof_typet(dataformat) * dim);
-        memset(generic_buffer, 0, sizeof_typet(dataformat) * dim);
     }
 
-    free(generic_buffer);
-    for (uint32_t i = 0; i < mesh->face_dim; i++) {
-        free(face_buffers.face_str_buffer[i]);
-	}
-
-    free(face_buffers.face_str_buffer);
-    free(face_buffers.pos_idx_buffer);
-    free(face_buffers.tex_idx_buffer);
-    free(face_buffers.norm_idx_buffer);
-
-    fclose(file);
-
-    // Completed.
-    return RETURN_CODE;
+    for (uint32_t c = 0; c < num_chunks; c++) {
+        obj_growth_t* growth = &chunks[c].growth;
+        for (uint32_t k = 0; k < 3; k++) {
+            free(growth->fixups[k]);
+        }
+        free_libraries(growth);
+        obj_destroy(&chunks[c].mesh);
+    }
+    free(chunks);
+    filemap_close(&map);
+    if (RETURN_CODE != SUCCESS) {
+        obj_destroy(mesh);
+        obj_init(mesh);
+    }
+    return finish_attributes(mesh, flags, num_threads, RETURN_CODE);
 }
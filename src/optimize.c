@@ -0,0 +1,576 @@
+#include "optimize.h"
+#include "defs.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// -----------------------------------------------------------------------------
+// Static utility
+// -----------------------------------------------------------------------------
+
+/* Valences at or above this share the last row of the score table. */
+#define MAX_VALENCE 32
+
+/** @struct forsyth_vertex_t
+ * @brief The state of one vertex in the triangle reordering, kept together so
+ * that touching a vertex costs one cache line.
+ */
+typedef struct {
+	/** Its corners in triangles not yet emitted: corners[offset] through 
+	 * corners[offset + live]. */
+	uint32_t offset;
+	uint32_t live;
+	/** The number of vertices that had entered the cache when it last did;
+	 * 0 if it never has. */
+	uint32_t stamp;
+} forsyth_vertex_t;
+
+/** @struct forsyth_t
+ * @brief The state of the triangle reordering.
+ */
+typedef struct {
+	forsyth_vertex_t* vertices;
+	/** The corners of every vertex, as indices into the index list. */
+	uint32_t* corners;
+	/** Where every corner is in the list of its vertex, so that emitting a
+	 * triangle takes its corners out without a search. */
+	uint32_t* slots;
+	uint8_t* emitted;
+	/** Forsyth's score of a vertex by its valence and its cache position, 
+	 * so that scoring a vertex takes one lookup. The position past the cache
+	 * is for vertices outside it. */
+	float score_table[MAX_VALENCE][OPTIMIZE_CACHE_SIZE + 1];
+	/** The number of vertices that entered the cache so far, plus the size 
+	 * of the cache so that no vertex starts out cached. */
+	uint32_t clock;
+	/** The number of vertices with any triangles. */
+	uint32_t used;
+} forsyth_t;
+
+/** Fills the score table, following Forsyth: the three most recent vertices
+ * score a flat 0.75, older ones fall off with a power of 1.5, and vertices 
+ * with few triangles left are boosted so they get finished off.
+ */
+static void fill_tables(forsyth_t* state) {
+	float cache[OPTIMIZE_CACHE_SIZE + 1];
+	for (uint32_t i = 0; i <= OPTIMIZE_CACHE_SIZE; i++) {
+		cache[i] = i < 3 ? 0.75f : i == OPTIMIZE_CACHE_SIZE ? 0.0f 
+			: powf(1.0f - (float)(i - 3) / (OPTIMIZE_CACHE_SIZE - 3), 1.5f);
+	}
+	for (uint32_t v = 0; v < MAX_VALENCE; v++) {
+		float valence = v == 0 ? 0.0f : 2.0f / sqrtf((float)v);
+		for (uint32_t i = 0; i <= OPTIMIZE_CACHE_SIZE; i++) {
+			state->score_table[v][i] = valence + cache[i];
+		}
+	}
+}
+
+/** Scores a vertex with triangles left. */
+static inline float vertex_score(const forsyth_t* state, 
+	const forsyth_vertex_t* vertex) {
+	uint32_t live = vertex->live;
+	uint32_t position = state->clock - vertex->stamp;
+	return state->score_table[live < MAX_VALENCE ? live : MAX_VALENCE - 1]
+		[position < OPTIMIZE_CACHE_SIZE ? position : OPTIMIZE_CACHE_SIZE];
+}
+
+/** Turns a count of misses into the miss ratios, 0 for an empty list. */
+static cache_stats_t cache_ratios(uint32_t misses, 
+	uint32_t num_triangles, 
+	uint32_t used) {
+	cache_stats_t stats = {0.0f, 0.0f};
+	if (num_triangles > 0 && used > 0) {
+		stats.acmr = (float)misses / (float)num_triangles;
+		stats.atvr = (float)misses / (float)used;
+	}
+	return stats;
+}
+
+/** Frees the state of the reordering. */
+static void free_forsyth(forsyth_t* state) {
+	free(state->vertices);
+	free(state->corners);
+	free(state->slots);
+	free(state->emitted);
+}
+
+/** Builds the corner lists of every vertex. Counting the corners walks the
+ * original order, so the cache stamps, unused until the reordering starts, 
+ * simulate the OPTIMIZE_FIFO_SIZE cache over it on the way if asked to.
+ * @param before Output miss ratios of the original order, or NULL.
+ * @returns SUCCESS or MEMORY_REFUSED.
+ */
+static int init_forsyth(forsyth_t* state, 
+	const uint32_t* indices, 
+	uint32_t count, 
+	uint32_t num_vertices, 
+	cache_stats_t* before) {
+	uint32_t num_triangles = count / 3;
+	*state = (forsyth_t) {0};
+	state->vertices = calloc((size_t)num_vertices + 1, 
+		sizeof *state->vertices);
+	state->corners = malloc((size_t)count * sizeof *state->corners + 1);
+	state->slots = malloc((size_t)count * sizeof *state->slots + 1);
+	state->emitted = calloc((size_t)num_triangles + 1, 
+		sizeof *state->emitted);
+	if (!state->vertices || !state->corners || !state->slots || 
+		!state->emitted) {
+		free_forsyth(state);
+		return MEMORY_REFUSED;
+	}
+	fill_tables(state);
+	state->clock = OPTIMIZE_CACHE_SIZE;
+
+	forsyth_vertex_t* vertices = state->vertices;
+	uint32_t misses = 0;
+	for (uint32_t i = 0; i < count; i++) {
+		forsyth_vertex_t* vertex = &vertices[indices[i]];
+		vertex->live++;
+		if (before && (vertex->stamp == 0 || 
+			misses - vertex->stamp >= OPTIMIZE_FIFO_SIZE)) {
+			vertex->stamp = ++misses;
+		}
+	}
+	uint32_t sum = 0;
+	uint32_t used = 0;
+	for (uint32_t v = 0; v < num_vertices; v++) {
+		used += vertices[v].live != 0;
+		vertices[v].offset = sum;
+		sum += vertices[v].live;
+		vertices[v].live = 0;
+		vertices[v].stamp = 0;
+	}
+	state->used = used;
+	if (before) {
+		*before = cache_ratios(misses, count / 3, used);
+	}
+	for (uint32_t i = 0; i < count; i++) {
+		forsyth_vertex_t* vertex = &vertices[indices[i]];
+		state->slots[i] = vertex->live;
+		state->corners[vertex->offset + vertex->live++] = i;
+	}
+	return SUCCESS;
+}
+
+/** Drops a corner of an emitted triangle from the list of its vertex, by
+ * moving the last live corner into its slot.
+ */
+static inline void remove_corner(forsyth_t* state, 
+	forsyth_vertex_t* vertex, 
+	uint32_t corner) {
+	uint32_t* list = state->corners + vertex->offset;
+	uint32_t last = --vertex->live;
+	uint32_t slot = state->slots[corner];
+	uint32_t moved = list[last];
+	list[slot] = moved;
+	state->slots[moved] = slot;
+	list[last] = corner;
+	state->slots[corner] = last;
+}
+
+/** Scores the triangles left around a cached vertex and keeps the best.
+ * @param best The best triangle so far, updated.
+ * @param best_score Its score, updated.
+ */
+static inline void score_triangles(const forsyth_t* state, 
+	const uint32_t* indices, 
+	const forsyth_vertex_t* vertex, 
+	int64_t* best, 
+	float* best_score) {
+	static const uint8_t next[3] = { 1, 2, 0 };
+	const forsyth_vertex_t* vertices = state->vertices;
+	const uint32_t* list = state->corners + vertex->offset;
+	float own = vertex_score(state, vertex);
+	for (uint32_t k = 0; k < vertex->live; k++) {
+		uint32_t corner = list[k];
+		uint32_t t = corner / 3;
+		uint32_t j = corner - 3 * t;
+		const uint32_t* tri = indices + 3 * t;
+		float score = own + vertex_score(state, &vertices[tri[next[j]]]) 
+			+ vertex_score(state, &vertices[tri[next[next[j]]]]);
+		if (score > *best_score) {
+			*best_score = score;
+			*best = t;
+		}
+	}
+}
+
+/** @struct fifo_t
+ * @brief A simulated FIFO cache. An entry is cached while fewer than size 
+ * misses followed its own; stamps at or below floor predate the last flush.
+ */
+typedef struct {
+	uint32_t* stamp;
+	uint32_t misses;
+	uint32_t floor;
+	uint32_t size;
+} fifo_t;
+
+/** Looks an entry up in the cache, loading it on a miss.
+ * @returns 1 on a miss, 0 on a hit.
+ */
+static inline uint32_t fifo_touch(fifo_t* fifo, size_t entry) {
+	uint32_t stamp = fifo->stamp[entry];
+	if (stamp > fifo->floor && fifo->misses - stamp < fifo->size) {
+		return 0;
+	}
+	fifo->stamp[entry] = ++fifo->misses;
+	return 1;
+}
+
+/** Empties the cache. */
+static inline void fifo_flush(fifo_t* fifo) {
+	fifo->floor = fifo->misses;
+}
+
+static inline uint32_t fifo_triangle(fifo_t* fifo, const uint32_t* tri) {
+	return fifo_touch(fifo, tri[0]) + fifo_touch(fifo, tri[1]) 
+		+ fifo_touch(fifo, tri[2]);
+}
+
+/** @struct cluster_t
+ * @brief A run of triangles that optimize_overdraw moves as a whole.
+ */
+typedef struct {
+	/** How far the run faces away from the centroid of the mesh. */
+	float key;
+	uint32_t first;
+	uint32_t count;
+} cluster_t;
+
+/** Sorts clusters facing outwards first, and otherwise keeps their order. */
+static int compare_clusters(const void* a, const void* b) {
+	const cluster_t* x = a;
+	const cluster_t* y = b;
+	if (x->key != y->key) {
+		return x->key > y->key ? -1 : 1;
+	}
+	return x->first < y->first ? -1 : x->first > y->first;
+}
+
+/** Adds up the area-weighted centroid and the normal of some triangles. The
+ * weights are twice the areas, which cancels out.
+ * @param centroid Output sum of the weighted centroids, times three.
+ * @param normal Output sum of the unnormalized normals.
+ * @returns The sum of the weights.
+ */
+static double sum_triangles(const uint32_t* indices, 
+	uint32_t num_triangles, 
+	const float* vertices, 
+	uint32_t stride, 
+	uint32_t dim, 
+	double centroid[3], 
+	double normal[3]) {
+	double weight = 0.0;
+	for (uint32_t k = 0; k < 3; k++) {
+		centroid[k] = normal[k] = 0.0;
+	}
+	for (uint32_t t = 0; t < num_triangles; t++) {
+		double p[3][3];
+		for (uint32_t j = 0; j < 3; j++) {
+			const float* v = vertices + (size_t)indices[3 * t + j] * stride;
+			for (uint32_t k = 0; k < 3; k++) {
+				p[j][k] = k < dim ? v[k] : 0.0;
+			}
+		}
+		double e[2][3];
+		for (uint32_t k = 0; k < 3; k++) {
+			e[0][k] = p[1][k] - p[0][k];
+			e[1][k] = p[2][k] - p[0][k];
+		}
+		double n[3] = { e[0][1] * e[1][2] - e[0][2] * e[1][1],
+			e[0][2] * e[1][0] - e[0][0] * e[1][2],
+			e[0][0] * e[1][1] - e[0][1] * e[1][0] };
+		double area = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+		for (uint32_t k = 0; k < 3; k++) {
+			centroid[k] += area * (p[0][k] + p[1][k] + p[2][k]);
+			normal[k] += n[k];
+		}
+		weight += area;
+	}
+	return weight;
+}
+
+// -----------------------------------------------------------------------------
+// Implementation
+// -----------------------------------------------------------------------------
+
+cache_stats_t
+optimize_cache_stats(const uint32_t* indices, 
+	uint32_t count, 
+	uint32_t num_vertices, 
+	uint32_t cache_size) {
+	cache_stats_t stats = {0.0f, 0.0f};
+	if (count < 3 || cache_size == 0) {
+		return stats;
+	}
+	fifo_t fifo = { calloc((size_t)num_vertices + 1, sizeof(uint32_t)), 0, 0,
+		cache_size };
+	if (!fifo.stamp) {
+		return stats;
+	}
+	uint32_t used = 0;
+	for (uint32_t i = 0; i < count; i++) {
+		used += fifo.stamp[indices[i]] == 0;
+		fifo_touch(&fifo, indices[i]);
+	}
+	free(fifo.stamp);
+	return cache_ratios(fifo.misses, count / 3, used);
+}
+
+int
+optimize_vertex_cache(uint32_t* indices, 
+	uint32_t count, 
+	uint32_t num_vertices, 
+	cache_stats_t* before, 
+	cache_stats_t* after) {
+	int code;
+	uint32_t num_triangles = count / 3;
+	if (count % 3 != 0) {
+		return INVALID_DIMS;
+	}
+	forsyth_t state;
+	uint32_t* order = malloc((size_t)count * sizeof *order + 1);
+	if (!order) {
+		return MEMORY_REFUSED;
+	}
+	if ((code = init_forsyth(&state, indices, count, num_vertices, before)) 
+		!= SUCCESS) {
+		free(order);
+		return code;
+	}
+
+	// The vertices in the cache, in the order they entered it.
+	uint32_t ring[OPTIMIZE_CACHE_SIZE] = {0};
+	// Where to look for a triangle when the cache leads nowhere.
+	uint32_t cursor = 0;
+	int64_t best = -1;
+	for (uint32_t out = 0; out < num_triangles; out++) {
+		if (best < 0) {
+			while (state.emitted[cursor]) {
+				cursor++;
+			}
+			best = cursor;
+		}
+		uint32_t t = (uint32_t)best;
+		const uint32_t* tri = indices + 3 * t;
+		memcpy(order + 3 * out, tri, 3 * sizeof *tri);
+		state.emitted[t] = 1;
+		// The cache is a FIFO like the one optimize_cache_stats simulates: a
+		// vertex stays while fewer than OPTIMIZE_CACHE_SIZE enter after it.
+		for (uint32_t j = 0; j < 3; j++) {
+			forsyth_vertex_t* vertex = &state.vertices[tri[j]];
+			remove_corner(&state, vertex, 3 * t + j);
+			if (state.clock - vertex->stamp >= OPTIMIZE_CACHE_SIZE) {
+				ring[state.clock % OPTIMIZE_CACHE_SIZE] = tri[j];
+				vertex->stamp = ++state.clock;
+			}
+		}
+
+		float best_score = -1.0f;
+		best = -1;
+		for (uint32_t j = 0; j < 3; j++) {
+			score_triangles(&state, indices, &state.vertices[tri[j]], &best,
+				&best_score);
+		}
+		for (uint32_t i = 0; best < 0 && i < OPTIMIZE_CACHE_SIZE; i++) {
+			const forsyth_vertex_t* vertex = &state.vertices[ring[i]];
+			if (state.clock - vertex->stamp < OPTIMIZE_CACHE_SIZE) {
+				score_triangles(&state, indices, vertex, &best, &best_score);
+			}
+		}
+	}
+
+	memcpy(indices, order, (size_t)count * sizeof *indices);
+	free(order);
+	free_forsyth(&state);
+	// The cache the order was built against is the one measured, when they
+	// are the same size, so its misses are the ratios.
+	if (after && OPTIMIZE_CACHE_SIZE == OPTIMIZE_FIFO_SIZE) {
+		*after = cache_ratios(state.clock - OPTIMIZE_CACHE_SIZE, 
+			num_triangles, state.used);
+	} else if (after) {
+		*after = optimize_cache_stats(indices, count, num_vertices, 
+			OPTIMIZE_FIFO_SIZE);
+	}
+	return SUCCESS;
+}
+
+fetch_stats_t
+optimize_fetch_stats(const uint32_t* indices, 
+	uint32_t count, 
+	uint32_t num_vertices, 
+	uint32_t vertex_size) {
+	fetch_stats_t stats = {0, 0.0f};
+	size_t num_lines = ((size_t)num_vertices * vertex_size 
+		+ OPTIMIZE_FETCH_LINE - 1) / OPTIMIZE_FETCH_LINE;
+	if (count == 0 || vertex_size == 0) {
+		return stats;
+	}
+	fifo_t fifo = { calloc(num_lines + 1, sizeof(uint32_t)), 0, 0, 
+		OPTIMIZE_FETCH_LINES };
+	uint8_t* seen = calloc((size_t)num_vertices + 1, sizeof *seen);
+	if (!fifo.stamp || !seen) {
+		free(fifo.stamp);
+		free(seen);
+		return stats;
+	}
+	uint64_t used = 0;
+	for (uint32_t i = 0; i < count; i++) {
+		size_t start = (size_t)indices[i] * vertex_size;
+		size_t first = start / OPTIMIZE_FETCH_LINE;
+		size_t last = (start + vertex_size - 1) / OPTIMIZE_FETCH_LINE;
+		for (size_t line = first; line <= last; line++) {
+			fifo_touch(&fifo, line);
+		}
+		if (!seen[indices[i]]) {
+			seen[indices[i]] = 1;
+			used += vertex_size;
+		}
+	}
+	free(fifo.stamp);
+	free(seen);
+	stats.bytes = (uint64_t)fifo.misses * OPTIMIZE_FETCH_LINE;
+	stats.overfetch = (float)((double)stats.bytes / (double)used);
+	return stats;
+}
+
+int
+optimize_vertex_fetch(float* vertices, 
+	uint32_t stride, 
+	uint32_t* indices, 
+	uint32_t count, 
+	uint32_t num_vertices, 
+	uint32_t* num_used) {
+	uint32_t* remap = malloc((size_t)num_vertices * sizeof *remap + 1);
+	float* moved = malloc((size_t)num_vertices * stride * sizeof *moved + 1);
+	if (!remap || !moved) {
+		free(remap);
+		free(moved);
+		return MEMORY_REFUSED;
+	}
+	memset(remap, 0xFF, (size_t)num_vertices * sizeof *remap);
+	uint32_t next = 0;
+	for (uint32_t i = 0; i < count; i++) {
+		uint32_t v = indices[i];
+		if (remap[v] == UINT32_MAX) {
+			remap[v] = next++;
+		}
+		indices[i] = remap[v];
+	}
+	if (num_used) {
+		*num_used = next;
+	}
+	for (uint32_t v = 0; v < num_vertices; v++) {
+		if (remap[v] == UINT32_MAX) {
+			remap[v] = next++;
+		}
+		memcpy(moved + (size_t)remap[v] * stride, 
+			vertices + (size_t)v * stride, stride * sizeof *moved);
+	}
+	memcpy(vertices, moved, (size_t)num_vertices * stride * sizeof *moved);
+	free(remap);
+	free(moved);
+	return SUCCESS;
+}
+
+int
+optimize_overdraw(uint32_t* indices, 
+	uint32_t count, 
+	const float* vertices, 
+	uint32_t stride, 
+	uint32_t dim, 
+	uint32_t num_vertices, 
+	float threshold) {
+	uint32_t num_triangles = count / 3;
+	if (count % 3 != 0) {
+		return INVALID_DIMS;
+	}
+	if (num_triangles < 2) {
+		return SUCCESS;
+	}
+	fifo_t fifo = { calloc((size_t)num_vertices + 1, sizeof(uint32_t)), 0, 0,
+		OPTIMIZE_FIFO_SIZE };
+	uint32_t* hard = malloc(((size_t)num_triangles + 1) * sizeof *hard);
+	cluster_t* clusters = malloc((size_t)num_triangles * sizeof *clusters);
+	uint32_t* order = malloc((size_t)count * sizeof *order);
+	if (!fifo.stamp || !hard || !clusters || !order) {
+		free(fifo.stamp);
+		free(hard);
+		free(clusters);
+		free(order);
+		return MEMORY_REFUSED;
+	}
+
+	// A triangle that misses on every vertex starts over whatever the order.
+	uint32_t num_hard = 0;
+	for (uint32_t t = 0; t < num_triangles; t++) {
+		if (fifo_triangle(&fifo, indices + 3 * t) == 3 || t == 0) {
+			hard[num_hard++] = t;
+		}
+	}
+	hard[num_hard] = num_triangles;
+
+	// Within each run, cut wherever the cache has warmed up to within 
+	// threshold of the run's miss ratio, and start the next piece cold.
+	uint32_t num_clusters = 0;
+	for (uint32_t h = 0; h < num_hard; h++) {
+		uint32_t first = hard[h];
+		uint32_t end = hard[h + 1];
+		fifo_flush(&fifo);
+		uint32_t misses = 0;
+		for (uint32_t t = first; t < end; t++) {
+			misses += fifo_triangle(&fifo, indices + 3 * t);
+		}
+		float target = threshold * (float)misses / (float)(end - first);
+		fifo_flush(&fifo);
+		misses = 0;
+		for (uint32_t t = first; t < end; t++) {
+			misses += fifo_triangle(&fifo, indices + 3 * t);
+			if (t + 1 == end || (float)misses <= target 
+				* (float)(t + 1 - first)) {
+				clusters[num_clusters++] = (cluster_t) { 0.0f, first, 
+					t + 1 - first };
+				fifo_flush(&fifo);
+				misses = 0;
+				first = t + 1;
+			}
+		}
+	}
+	free(fifo.stamp);
+	free(hard);
+
+	double center[3], normal[3];
+	double weight = sum_triangles(indices, num_triangles, vertices, stride, 
+		dim, center, normal);
+	for (uint32_t k = 0; k < 3; k++) {
+		center[k] = weight > 0.0 ? center[k] / (3.0 * weight) : 0.0;
+	}
+	for (uint32_t c = 0; c < num_clusters; c++) {
+		double centroid[3];
+		double area = sum_triangles(indices + 3 * clusters[c].first, 
+			clusters[c].count, vertices, stride, dim, centroid, normal);
+		double length = sqrt(normal[0] * normal[0] + normal[1] * normal[1] 
+			+ normal[2] * normal[2]);
+		if (area > 0.0 && length > 0.0) {
+			double key = 0.0;
+			for (uint32_t k = 0; k < 3; k++) {
+				key += (centroid[k] / (3.0 * area) - center[k]) * normal[k];
+			}
+			clusters[c].key = (float)(key / length);
+		}
+	}
+	qsort(clusters, num_clusters, sizeof *clusters, compare_clusters);
+
+	uint32_t* out = order;
+	for (uint32_t c = 0; c < num_clusters; c++) {
+		size_t size = (size_t)3 * clusters[c].count;
+		memcpy(out, indices + 3 * (size_t)clusters[c].first, 
+			size * sizeof *out);
+		out += size;
+	}
+	memcpy(indices, order, (size_t)count * sizeof *indices);
+	free(clusters);
+	free(order);
+	return SUCCESS;
+}
@@ -0,0 +1,278 @@
+#include "pack.h"
+#include "defs.h"
+#include <math.h>
+#include <string.h>
+
+// -----------------------------------------------------------------------------
+// Static utility
+// -----------------------------------------------------------------------------
+
+/** @struct pack_source_t
+ * @brief Where the components of one attribute come from.
+ */
+typedef struct {
+	/** The first component of the first element. */
+	const float* base;
+	/** The number of floats from one element to the next. */
+	size_t stride;
+	/** The number of components of an element. */
+	uint32_t dim;
+	/** The 1-based element of every vertex, or NULL if vertex i is element i.
+	 */
+	const uint32_t* indices;
+} pack_source_t;
+
+/** Loads the components of a vertex's attribute, padded with 0 and w.
+ */
+static inline void load(const pack_source_t* src, 
+	uint32_t vertex, 
+	uint32_t components, 
+	float w, 
+	float out[4]) {
+	size_t element = src->indices ? src->indices[vertex] - 1 : vertex;
+	const float* in = src->base + element * src->stride;
+	out[0] = out[1] = out[2] = 0.0f;
+	out[3] = w;
+	for (uint32_t c = 0; c < components && c < src->dim; c++) {
+		out[c] = in[c];
+	}
+}
+
+static inline float clampf(float value, float low, float high) {
+	return value < low ? low : (value > high ? high : value);
+}
+
+/** Writes one attribute of every vertex.
+ * @param src The source of the attribute.
+ * @param element The element of the layout.
+ * @param w The value of a missing fourth component.
+ * @param count The number of vertices.
+ * @param dest The first byte of the attribute of the first vertex.
+ * @param stride The number of bytes from one vertex to the next.
+ */
+static void pack_element(const pack_source_t* src,
+	const pack_element_t* element,
+	float w,
+	uint32_t count,
+	uint8_t* dest,
+	uint32_t stride) {
+	uint32_t n = element->components;
+	float v[4];
+	switch (element->type) {
+	case PACK_FLOAT32:
+		for (uint32_t i = 0; i < count; i++, dest += stride) {
+			load(src, i, n, w, v);
+			memcpy(dest, v, n * sizeof *v);
+		}
+		break;
+	case PACK_FLOAT16:
+		for (uint32_t i = 0; i < count; i++, dest += stride) {
+			uint16_t out[4];
+			load(src, i, n, w, v);
+			for (uint32_t c = 0; c < n; c++) {
+				out[c] = pack_half(v[c]);
+			}
+			memcpy(dest, out, n * sizeof *out);
+		}
+		break;
+	case PACK_SNORM16:
+		for (uint32_t i = 0; i < count; i++, dest += stride) {
+			int16_t out[4];
+			load(src, i, n, w, v);
+			for (uint32_t c = 0; c < n; c++) {
+				out[c] = (int16_t)lrintf(clampf(v[c], -1.0f, 1.0f) * 32767.0f);
+			}
+			memcpy(dest, out, n * sizeof *out);
+		}
+		break;
+	case PACK_UNORM16:
+		for (uint32_t i = 0; i < count; i++, dest += stride) {
+			uint16_t out[4];
+			load(src, i, n, w, v);
+			for (uint32_t c = 0; c < n; c++) {
+				out[c] = (uint16_t)lrintf(clampf(v[c], 0.0f, 1.0f) * 65535.0f);
+			}
+			memcpy(dest, out, n * sizeof *out);
+		}
+		break;
+	case PACK_SNORM8:
+		for (uint32_t i = 0; i < count; i++, dest += stride) {
+			load(src, i, n, w, v);
+			for (uint32_t c = 0; c < n; c++) {
+				int8_t out = (int8_t)lrintf(clampf(v[c], -1.0f, 1.0f) * 127.0f);
+				memcpy(dest + c, &out, 1);
+			}
+		}
+		break;
+	case PACK_UNORM8:
+		for (uint32_t i = 0; i < count; i++, dest += stride) {
+			load(src, i, n, w, v);
+			for (uint32_t c = 0; c < n; c++) {
+				dest[c] = (uint8_t)lrintf(clampf(v[c], 0.0f, 1.0f) * 255.0f);
+			}
+		}
+		break;
+	}
+}
+
+/** Checks that every element of a layout fits in its stride.
+ * @returns SUCCESS or INVALID_DIMS.
+ */
+static int check_layout(const pack_layout_t* layout) {
+	for (uint32_t e = 0; e < layout->num_elements; e++) {
+		const pack_element_t* element = &layout->elements[e];
+		if (element->components == 0 || element->components > 4 ||
+			(uint64_t)element->offset + element->components 
+			* pack_type_size(element->type) > layout->stride) {
+			return INVALID_DIMS;
+		}
+	}
+	return SUCCESS;
+}
+
+/** Packs every element of a layout from one source per attribute.
+ * @param sources The sources of the position, texture, normal and tangent; a
+ * source with no base is missing.
+ * @returns SUCCESS, INVALID_DIMS or NOT_FOUND.
+ */
+static int pack_sources(const pack_source_t sources[4],
+	const pack_layout_t* layout,
+	uint32_t count,
+	void* dest) {
+	int code;
+	if ((code = check_layout(layout)) != SUCCESS) {
+		return code;
+	}
+	for (uint32_t e = 0; e < layout->num_elements; e++) {
+		if (!sources[layout->elements[e].attribute].base && count > 0) {
+			return NOT_FOUND;
+		}
+	}
+	for (uint32_t e = 0; e < layout->num_elements; e++) {
+		const pack_element_t* element = &layout->elements[e];
+		float w = element->attribute == PACK_POSITION ? 1.0f : 0.0f;
+		pack_element(&sources[element->attribute], element, w, count,
+			(uint8_t*)dest + element->offset, layout->stride);
+	}
+	return SUCCESS;
+}
+
+// -----------------------------------------------------------------------------
+// Implementation
+// -----------------------------------------------------------------------------
+
+uint32_t
+pack_type_size(pack_type_t type) {
+	switch (type) {
+	case PACK_FLOAT32:
+		return 4;
+	case PACK_FLOAT16:
+	case PACK_SNORM16:
+	case PACK_UNORM16:
+		return 2;
+	default:
+		return 1;
+	}
+}
+
+uint16_t
+pack_half(float value) {
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof bits);
+	uint16_t sign = (uint16_t)((bits >> 16) & 0x8000u);
+	uint32_t exponent = (bits >> 23) & 0xFFu;
+	uint32_t mantissa = bits & 0x7FFFFFu;
+	if (exponent == 0xFFu) {
+		// Infinity stays infinity; NaN stays a quiet NaN.
+		return (uint16_t)(sign | 0x7C00u | (mantissa ? 0x200u : 0u));
+	}
+	int32_t e = (int32_t)exponent - 127 + 15;
+	if (e >= 31) {
+		return (uint16_t)(sign | 0x7C00u);
+	}
+	if (e <= 0) {
+		if (e < -10) {
+			return sign;
+		}
+		// Subnormal: shift the mantissa, with its implicit bit, into place.
+		mantissa |= 0x800000u;
+		uint32_t shift = (uint32_t)(14 - e);
+		uint32_t half = mantissa >> shift;
+		uint32_t rest = mantissa & ((1u << shift) - 1);
+		uint32_t halfway = 1u << (shift - 1);
+		if (rest > halfway || (rest == halfway && (half & 1u))) {
+			half++;
+		}
+		return (uint16_t)(sign | half);
+	}
+	uint32_t half = ((uint32_t)e << 10) | (mantissa >> 13);
+	uint32_t rest = mantissa & 0x1FFFu;
+	// A carry out of the mantissa correctly bumps the exponent.
+	if (rest > 0x1000u || (rest == 0x1000u && (half & 1u))) {
+		half++;
+	}
+	return (uint16_t)(sign | half);
+}
+
+float
+pack_unhalf(uint16_t half) {
+	uint32_t sign = (uint32_t)(half & 0x8000u) << 16;
+	uint32_t exponent = (half >> 10) & 0x1Fu;
+	uint32_t mantissa = half & 0x3FFu;
+	uint32_t bits;
+	if (exponent == 0x1Fu) {
+		bits = sign | 0x7F800000u | (mantissa << 13);
+	} else if (exponent != 0) {
+		bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+	} else if (mantissa == 0) {
+		bits = sign;
+	} else {
+		// Subnormal: normalize the mantissa.
+		exponent = 127 - 15 + 1;
+		while (!(mantissa & 0x400u)) {
+			mantissa <<= 1;
+			exponent--;
+		}
+		bits = sign | (exponent << 23) | ((mantissa & 0x3FFu) << 13);
+	}
+	float value;
+	memcpy(&value, &bits, sizeof value);
+	return value;
+}
+
+int
+pack_weld(const weld_t* weld, const pack_layout_t* layout, void* dest) {
+	pack_source_t sources[4] = {
+		{ .base = weld->vertices, .stride = weld->stride, 
+			.dim = weld->texcoord_offset },
+		{ .base = weld->flag & tex_flag 
+			? weld->vertices + weld->texcoord_offset : NULL, 
+			.stride = weld->stride, 
+			.dim = weld->normal_offset - weld->texcoord_offset },
+		{ .base = weld->flag & norm_flag 
+			? weld->vertices + weld->normal_offset : NULL, 
+			.stride = weld->stride, 
+			.dim = weld->tangent_offset - weld->normal_offset },
+		{ .base = weld->flag & WELD_TANGENT_FLAG 
+			? weld->vertices + weld->tangent_offset : NULL, 
+			.stride = weld->stride, .dim = 4 }
+	};
+	return pack_sources(sources, layout, weld->num_vertices, dest);
+}
+
+int
+pack_corners(const mesh_t* mesh, const pack_layout_t* layout, void* dest) {
+	pack_source_t sources[4] = {
+		{ .base = mesh->face_indices ? mesh->positions : NULL, 
+			.stride = mesh->vertex_dim, .dim = mesh->vertex_dim, 
+			.indices = mesh->face_indices },
+		{ .base = mesh->face_texs ? mesh->texcoords : NULL, 
+			.stride = mesh->tex_dim, .dim = mesh->tex_dim, 
+			.indices = mesh->face_texs },
+		{ .base = mesh->face_norms ? mesh->normals : NULL, 
+			.stride = mesh->vertex_dim, .dim = mesh->vertex_dim, 
+			.indices = mesh->face_norms },
+		{ .base = mesh->tangents, .stride = 4, .dim = 4 }
+	};
+	return pack_sources(sources, layout, mesh->num_corners, dest);
+}
@@ -0,0 +1,110 @@
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "parallel.h"
+#include "defs.h"
+
+#if defined(_WIN32) && !defined(OBJ_NO_THREADS)
+#define OBJ_NO_THREADS
+#endif
+
+#ifndef OBJ_NO_THREADS
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+// -----------------------------------------------------------------------------
+// Static utility
+// -----------------------------------------------------------------------------
+
+#ifndef OBJ_NO_THREADS
+/** State shared by every thread of one parallel_for call. */
+typedef struct {
+	parallel_task_t task;
+	void* ctx;
+	uint32_t num_tasks;
+	/** The next task to hand out. */
+	uint32_t next;
+	pthread_mutex_t lock;
+} parallel_state_t;
+
+/** Runs tasks until none are left.
+ * @param arg The shared parallel_state_t.
+ * @return NULL.
+ */
+static void*
+parallel_worker(void* arg) {
+	parallel_state_t* state = arg;
+	for (;;) {
+		pthread_mutex_lock(&state->lock);
+		uint32_t task = state->next;
+		if (task < state->num_tasks) {
+			state->next++;
+		}
+		pthread_mutex_unlock(&state->lock);
+		if (task >= state->num_tasks) {
+			return NULL;
+		}
+		state->task(state->ctx, task);
+	}
+}
+#endif
+
+// -----------------------------------------------------------------------------
+// Implementation
+// -----------------------------------------------------------------------------
+uint32_t
+parallel_threads(void) {
+#ifdef OBJ_NO_THREADS
+	return 1;
+#else
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+	if (count < 1) {
+		return 1;
+	}
+	return count > MAX_THREADS ? MAX_THREADS : (uint32_t)count;
+#endif
+}
+
+int
+parallel_for(uint32_t num_tasks, 
+	uint32_t num_threads, 
+	parallel_task_t task, 
+	void* ctx) {
+	if (num_threads == 0) {
+		num_threads = parallel_threads();
+	}
+	if (num_threads > MAX_THREADS) {
+		num_threads = MAX_THREADS;
+	}
+	if (num_threads > num_tasks) {
+		num_threads = num_tasks;
+	}
+#ifndef OBJ_NO_THREADS
+	if (num_threads > 1) {
+		parallel_state_t state = { .task = task, .ctx = ctx, 
+			.num_tasks = num_tasks, .next = 0 };
+		pthread_t threads[MAX_THREADS];
+		uint32_t started = 0;
+		pthread_mutex_init(&state.lock, NULL);
+		// The calling thread is the last worker.
+		for (; started < num_threads - 1; started++) {
+			if (pthread_create(&threads[started], NULL, parallel_worker, 
+				&state) != 0) {
+				break;
+			}
+		}
+		parallel_worker(&state);
+		for (uint32_t i = 0; i < started; i++) {
+			pthread_join(threads[i], NULL);
+		}
+		pthread_mutex_destroy(&state.lock);
+		return SUCCESS;
+	}
+#endif
+	for (uint32_t i = 0; i < num_tasks; i++) {
+		task(ctx, i);
+	}
+	return SUCCESS;
+}
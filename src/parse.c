@@ -0,0 +1,602 @@
+#include "parse.h"
+#include "obj.h"
+#include "buffer.h"
+#include "utils.h"
+#include "ringbuf.h"
+#include <stdlib.h>
+#include <string.h>
+
+// -----------------------------------------------------------------------------
+// Static utility
+// -----------------------------------------------------------------------------
+
+/* Indices are clamped here while parsing; anything larger is out of range. */
+#define MAX_INDEX ((int64_t)UINT32_MAX + 1)
+
+/** Determines if the character separates tokens on a line.
+ * @param c The character.
+ * @returns 1 for a space, tab, carriage return, vertical tab or form feed.
+ */
+static inline int is_space(char c) {
+	return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+/** Splits the next whitespace separated token off the front of a line. A '#'
+ * at the start of a token comments out the rest of the line.
+ * @param line The remainder of the line. Advanced past the token.
+ * @param token Output token, pointing into the line.
+ * @returns 1 if a token was found, 0 at the end of the line.
+ */
+static int next_token(buffer_t* line, buffer_t* token) {
+	const char* p = buffer_start(*line);
+	const char* end = buffer_end(*line);
+	while (p < end && is_space(*p)) {
+		p++;
+	}
+	if (p == end || *p == '#') {
+		line->offset = line->length = 0;
+		line->data = end;
+		return 0;
+	}
+	const char* begin = p;
+	while (p < end && !is_space(*p)) {
+		p++;
+	}
+	*token = (buffer_t) { .data = begin, .offset = 0,
+		.length = (unsigned int)(p - begin) };
+	*line = (buffer_t) { .data = p, .offset = 0,
+		.length = (unsigned int)(end - p) };
+	return 1;
+}
+
+/** Reads every whitespace separated float left on the line.
+ * @param line The line, positioned right after its type token.
+ * @param out Output array of OBJ_MAX_COMPONENTS floats.
+ * @param dim Output number of floats read.
+ * @returns SUCCESS, INVALID_DIMS if the line has no components or too many,
+ * or PARSING_FAILURE if a component is not a number.
+ */
+static int read_components(buffer_t line, float* out, uint32_t* dim) {
+	buffer_t token;
+	*dim = 0;
+	while (next_token(&line, &token)) {
+		if (*dim == OBJ_MAX_COMPONENTS) {
+			return INVALID_DIMS;
+		}
+		if (buffer_get_float(token, &out[(*dim)++]) != SUCCESS) {
+			return PARSING_FAILURE;
+		}
+	}
+	return *dim ? SUCCESS : INVALID_DIMS;
+}
+
+/** Parses an optionally negative decimal index.
+ * @param p The first character.
+ * @param end One past the last character.
+ * @param value Output index, clamped to [-MAX_INDEX, MAX_INDEX].
+ * @returns One past the last digit, or NULL if there are no digits.
+ */
+static inline const char* read_index(const char* p,
+	const char* end,
+	int64_t* value) {
+	int negative = 0;
+	if (p < end && (*p == '-' || *p == '+')) {
+		negative = *p == '-';
+		p++;
+	}
+	const char* digits = p;
+	int64_t n = 0;
+	for (; p < end && (unsigned char)(*p - '0') < 10; p++) {
+		n = n * 10 + (*p - '0');
+		if (n > MAX_INDEX) {
+			n = MAX_INDEX;
+		}
+	}
+	*value = negative ? -n : n;
+	return p > digits ? p : NULL;
+}
+
+/** Reads a single "v", "v/t", "v//n" or "v/t/n" face corner in one scan,
+ * without modifying the token. Every '/' must be followed by an index, or
+ * by the second '/' of "v//n".
+ * @param token The corner token.
+ * @param values Output position, texture and normal indices. Absent indices
+ * are left untouched.
+ * @param flag Output face flag describing which indices were present.
+ * @returns SUCCESS or PARSING_FAILURE.
+ */
+static int read_corner(buffer_t token, int64_t values[3], uint8_t* flag) {
+	const char* p = buffer_start(token);
+	const char* end = buffer_end(token);
+	*flag = 0;
+	if (!(p = read_index(p, end, &values[0]))) {
+		return PARSING_FAILURE;
+	}
+	*flag = pos_flag;
+	for (uint32_t k = 1; k < 3 && p < end; k++) {
+		if (*p++ != '/') {
+			return PARSING_FAILURE;
+		}
+		const char* stop = read_index(p, end, &values[k]);
+		if (stop) {
+			*flag |= (uint8_t)(1 << k);
+			p = stop;
+		} else if (k == 2 || p == end || *p != '/') {
+			return PARSING_FAILURE;
+		}
+	}
+	return p == end ? SUCCESS : PARSING_FAILURE;
+}
+
+/** Grows the scratch space for the corners of a face.
+ * @param stream The parser.
+ * @param required The number of corners it must hold.
+ * @returns SUCCESS or MEMORY_REFUSED.
+ */
+static int reserve_corners(obj_stream_t* stream, uint32_t required) {
+	uint32_t capacity = stream->corner_cap;
+	for (uint32_t k = 0; k < 3; k++) {
+		capacity = stream->corner_cap;
+		if (array_reserve((void**)&stream->corners[k], &capacity, required,
+			sizeof *stream->corners[k]) != SUCCESS) {
+			return MEMORY_REFUSED;
+		}
+	}
+	capacity = stream->corner_cap;
+	if (array_reserve((void**)&stream->relative, &capacity, required,
+		sizeof *stream->relative) != SUCCESS) {
+		return MEMORY_REFUSED;
+	}
+	stream->corner_cap = capacity;
+	return SUCCESS;
+}
+
+/** Parses the corners of a face line into the stream's scratch space and
+ * passes them to the face callback.
+ * @param stream The parser.
+ * @param line The line, positioned right after its type token.
+ * @returns SUCCESS, INVALID_DIMS, PARSING_FAILURE, INDEX_OUT_OF_RANGE,
+ * MEMORY_REFUSED or the callback's code.
+ */
+static int parse_face(obj_stream_t* stream, buffer_t line) {
+	const uint32_t counts[3] = {
+		stream->num_vertices, stream->num_textures, stream->num_normals
+	};
+	uint32_t size = 0;
+	uint8_t face_flag = 0;
+	buffer_t token;
+	while (next_token(&line, &token)) {
+		int64_t values[3] = {0};
+		uint8_t flag;
+		int code;
+		if ((code = read_corner(token, values, &flag)) != SUCCESS) {
+			return code;
+		}
+		if (size > 0 && flag != face_flag) {
+			return PARSING_FAILURE;
+		}
+		face_flag = flag;
+		if (size == stream->corner_cap &&
+			reserve_corners(stream, size + 1) != SUCCESS) {
+			return MEMORY_REFUSED;
+		}
+		// Negative indices count back from the most recent element.
+		uint8_t relative = 0;
+		for (uint32_t k = 0; k < 3; k++) {
+			int64_t index = values[k];
+			if (!(flag & (1 << k))) {
+				stream->corners[k][size] = 0;
+				continue;
+			}
+			if (index < 0) {
+				index += (int64_t)counts[k] + 1;
+				relative |= (uint8_t)(1 << k);
+			}
+			if (values[k] == 0 || index > UINT32_MAX) {
+				return INDEX_OUT_OF_RANGE;
+			}
+			if ((index < 1 || index > counts[k]) &&
+				!(stream->flags & OBJ_STREAM_DEFER_RANGE)) {
+				return INDEX_OUT_OF_RANGE;
+			}
+			stream->corners[k][size] = (uint32_t)index;
+		}
+		stream->relative[size] = relative;
+		size++;
+	}
+	if (size == 0) {
+		return INVALID_DIMS;
+	}
+	if (!stream->callbacks->face) {
+		return SUCCESS;
+	}
+	const obj_face_event_t face = {
+		.size = size,
+		.flag = face_flag,
+		.indices = face_flag & pos_flag ? stream->corners[0] : NULL,
+		.texs = face_flag & tex_flag ? stream->corners[1] : NULL,
+		.norms = face_flag & norm_flag ? stream->corners[2] : NULL,
+		.relative = stream->relative
+	};
+	return stream->callbacks->face(stream->user, &face, stream->line_number);
+}
+
+/** Copies the rest of a line, without surrounding whitespace, into the
+ * stream's scratch space as a C-string.
+ * @param stream The parser.
+ * @param line The line, positioned right after its type token.
+ * @param name Output C-string.
+ * @returns SUCCESS or MEMORY_REFUSED.
+ */
+static int read_name(obj_stream_t* stream, buffer_t line, const char** name) {
+	const char* begin = buffer_start(line);
+	const char* end = buffer_end(line);
+	while (begin < end && is_space(*begin)) {
+		begin++;
+	}
+	while (end > begin && is_space(end[-1])) {
+		end--;
+	}
+	uint32_t length = (uint32_t)(end - begin);
+	if (array_reserve((void**)&stream->text, &stream->text_cap, length + 1,
+		sizeof *stream->text) != SUCCESS) {
+		return MEMORY_REFUSED;
+	}
+	memcpy(stream->text, begin, length);
+	stream->text[length] = '\0';
+	*name = stream->text;
+	return SUCCESS;
+}
+
+/** Splits the group names of a "g" line into C-strings and passes them to the
+ * group callback.
+ * @param stream The parser.
+ * @param line The line, positioned right after its type token.
+ * @returns SUCCESS, MEMORY_REFUSED or the callback's code.
+ */
+static int parse_group(obj_stream_t* stream, buffer_t line) {
+	uint32_t count = 0;
+	uint32_t length = 0;
+	buffer_t token;
+	if (array_reserve((void**)&stream->text, &stream->text_cap, line.length + 1,
+		sizeof *stream->text) != SUCCESS) {
+		return MEMORY_REFUSED;
+	}
+	while (next_token(&line, &token)) {
+		if (array_reserve((void**)&stream->names, &stream->names_cap,
+			count + 1, sizeof *stream->names) != SUCCESS) {
+			return MEMORY_REFUSED;
+		}
+		memcpy(stream->text + length, buffer_start(token), token.length);
+		stream->names[count++] = stream->text + length;
+		length += token.length;
+		stream->text[length++] = '\0';
+	}
+	return stream->callbacks->group(stream->user, stream->names, count,
+		stream->line_number);
+}
+
+/** Parses the group number of an "s" line.
+ * @param stream The parser.
+ * @param line The line, positioned right after its type token.
+ * @returns SUCCESS, PARSING_FAILURE or the callback's code.
+ */
+static int parse_smoothing(obj_stream_t* stream, buffer_t line) {
+	buffer_t token;
+	int64_t group = 0;
+	if (!next_token(&line, &token)) {
+		return PARSING_FAILURE;
+	}
+	if (!buffer_equ(token, "off") &&
+		(read_index(buffer_start(token), buffer_end(token), &group)
+		!= buffer_end(token) || group < 0 || group > UINT32_MAX)) {
+		return PARSING_FAILURE;
+	}
+	return stream->callbacks->smoothing(stream->user, (uint32_t)group,
+		stream->line_number);
+}
+
+/** Parses the components of a "v", "vt" or "vn" line and passes them to a
+ * callback.
+ * @param stream The parser.
+ * @param line The line, positioned right after its type token.
+ * @param callback The callback, or NULL.
+ * @param count The number of elements of this type so far. Incremented.
+ * @returns SUCCESS, INVALID_DIMS, PARSING_FAILURE or the callback's code.
+ */
+static int parse_components(obj_stream_t* stream,
+	buffer_t line,
+	int (*callback)(void*, const float*, uint32_t, uint32_t),
+	uint32_t* count) {
+	float values[OBJ_MAX_COMPONENTS];
+	uint32_t dim;
+	int code;
+	if ((code = read_components(line, values, &dim)) != SUCCESS ||
+		(callback && (code = callback(stream->user, values, dim,
+		stream->line_number)) != SUCCESS)) {
+		return code;
+	}
+	(*count)++;
+	return SUCCESS;
+}
+
+/** Passes the rest of a line, as a name, to a callback.
+ * @param stream The parser.
+ * @param line The line, positioned right after its type token.
+ * @param callback The callback, or NULL.
+ * @returns SUCCESS, MEMORY_REFUSED or the callback's code.
+ */
+static int parse_name(obj_stream_t* stream,
+	buffer_t line,
+	int (*callback)(void*, const char*, uint32_t)) {
+	const char* name;
+	int code;
+	if (!callback) {
+		return SUCCESS;
+	}
+	if ((code = read_name(stream, line, &name)) != SUCCESS) {
+		return code;
+	}
+	return callback(stream->user, name, stream->line_number);
+}
+
+/** Parses one line; see obj_stream_line. Does not report failures. */
+static int parse_line(obj_stream_t* stream, buffer_t line) {
+	const obj_callbacks_t* callbacks = stream->callbacks;
+	buffer_t type;
+	if (!next_token(&line, &type)) {
+		return SUCCESS;
+	}
+	const char* t = buffer_start(type);
+	if (type.length == 1) {
+		switch (t[0]) {
+			case 'v':
+				return parse_components(stream, line, callbacks->vertex,
+					&stream->num_vertices);
+			case 'f':
+				return parse_face(stream, line);
+			case 'g':
+				return callbacks->group ? parse_group(stream, line) : SUCCESS;
+			case 's':
+				return callbacks->smoothing ? parse_smoothing(stream, line)
+					: SUCCESS;
+			case 'o':
+				return parse_name(stream, line, callbacks->object);
+			default:
+				return SUCCESS;
+		}
+	}
+	if (type.length == 2 && t[0] == 'v' && t[1] == 't') {
+		return parse_components(stream, line, callbacks->texcoord,
+			&stream->num_textures);
+	}
+	if (type.length == 2 && t[0] == 'v' && t[1] == 'n') {
+		return parse_components(stream, line, callbacks->normal,
+			&stream->num_normals);
+	}
+	if (buffer_equ(type, "usemtl")) {
+		return parse_name(stream, line, callbacks->material);
+	}
+	if (buffer_equ(type, "mtllib")) {
+		return parse_name(stream, line, callbacks->library);
+	}
+	return SUCCESS;
+}
+
+/** Reports a failure on the current line through the error callback, or 
+ * prints it.
+ * @param stream The parser.
+ * @param code The failure.
+ */
+static void report(obj_stream_t* stream, int code) {
+	if (stream->callbacks->error) {
+		stream->callbacks->error(stream->user, code, stream->line_number);
+	} else {
+		printf("Error: %s at line %u\n", errstr(code), stream->line_number);
+	}
+}
+
+// -----------------------------------------------------------------------------
+// Implementation
+// -----------------------------------------------------------------------------
+
+void
+obj_stream_init(obj_stream_t* stream,
+	const obj_callbacks_t* callbacks,
+	void* user,
+	uint32_t flags) {
+	*stream = (obj_stream_t) {
+		.callbacks = callbacks,
+		.user = user,
+		.flags = flags
+	};
+}
+
+int
+obj_stream_line(obj_stream_t* stream, const char* line, size_t length) {
+	stream->line_number++;
+	buffer_t buffer = { .data = line, .offset = 0,
+		.length = (unsigned int)length };
+	int code = parse_line(stream, buffer);
+	if (code != SUCCESS) {
+		report(stream, code);
+	}
+	return code;
+}
+
+void
+obj_stream_destroy(obj_stream_t* stream) {
+	for (uint32_t k = 0; k < 3; k++) {
+		free(stream->corners[k]);
+	}
+	free(stream->relative);
+	free(stream->text);
+	free(stream->names);
+	*stream = (obj_stream_t) {0};
+}
+
+int
+obj_parse_stream(FILE* file,
+	const obj_callbacks_t* callbacks,
+	void* user,
+	uint32_t flags) {
+	obj_stream_t stream;
+	char chunk[MAX_LINE_LEN];
+	// Holds the start of a line longer than the chunk.
+	char* pending = NULL;
+	uint32_t pending_length = 0;
+	uint32_t pending_cap = 0;
+	int code = SUCCESS;
+
+	obj_stream_init(&stream, callbacks, user, flags);
+	while (code == SUCCESS && fgets(chunk, sizeof chunk, file)) {
+		size_t length = strlen(chunk);
+		int complete = length > 0 && chunk[length - 1] == '\n';
+		if (complete) {
+			length--;
+		}
+		if (!complete && !feof(file)) {
+			if (array_reserve((void**)&pending, &pending_cap,
+				pending_length + (uint32_t)length, sizeof *pending)
+				!= SUCCESS) {
+				code = MEMORY_REFUSED;
+				break;
+			}
+			memcpy(pending + pending_length, chunk, length);
+			pending_length += (uint32_t)length;
+			continue;
+		}
+		if (pending_length == 0) {
+			code = obj_stream_line(&stream, chunk, length);
+			continue;
+		}
+		if (array_reserve((void**)&pending, &pending_cap,
+			pending_length + (uint32_t)length, sizeof *pending) != SUCCESS) {
+			code = MEMORY_REFUSED;
+			break;
+		}
+		memcpy(pending + pending_length, chunk, length);
+		code = obj_stream_line(&stream, pending, pending_length + length);
+		pending_length = 0;
+	}
+	if (code == SUCCESS && pending_length > 0) {
+		code = obj_stream_line(&stream, pending, pending_length);
+	}
+	free(pending);
+	obj_stream_destroy(&stream);
+	return code;
+}
+
+int
+obj_parse_span(const char* data,
+	size_t size,
+	const obj_callbacks_t* callbacks,
+	void* user,
+	uint32_t flags) {
+	obj_stream_t stream;
+	int code = SUCCESS;
+	const char* p = data;
+	const char* end = data + size;
+
+	obj_stream_init(&stream, callbacks, user, flags);
+	while (code == SUCCESS && p < end) {
+		const char* newline = memchr(p, '\n', (size_t)(end - p));
+		const char* stop = newline ? newline : end;
+		code = obj_stream_line(&stream, p, (size_t)(stop - p));
+		p = stop + 1;
+	}
+	obj_stream_destroy(&stream);
+	return code;
+}
+
+/** Determines if the start of a line makes it a comment.
+ * @param line The start of the line.
+ * @param length Its length.
+ * @return 1 if the first character other than whitespace is '#'.
+ */
+static int is_comment(const char* line, size_t length) {
+	size_t i = 0;
+	while (i < length && is_space(line[i])) {
+		i++;
+	}
+	return i < length && line[i] == '#';
+}
+
+int
+obj_parse_fd(int fd,
+	const obj_callbacks_t* callbacks,
+	void* user,
+	uint32_t flags) {
+	obj_stream_t stream;
+	ringbuf_t ring;
+	// Holds the start of a line longer than the ring, as obj_parse_stream 
+	// does for lines longer than its chunk. Comments only keep their start.
+	char* pending = NULL;
+	uint32_t pending_length = 0;
+	uint32_t pending_cap = 0;
+	int comment = 0;
+	int code;
+	int last = 0;
+
+	if ((code = ringbuf_init(&ring, OBJ_FD_BUFFER_SIZE)) != SUCCESS) {
+		return code;
+	}
+	obj_stream_init(&stream, callbacks, user, flags);
+	while (code == SUCCESS) {
+		const char* line;
+		size_t length;
+		while (code == SUCCESS && (line = ringbuf_line(&ring, last, &length))) {
+			if (pending_length == 0) {
+				code = obj_stream_line(&stream, line, length);
+				continue;
+			}
+			if (!comment) {
+				if (array_reserve((void**)&pending, &pending_cap,
+					pending_length + (uint32_t)length, sizeof *pending) 
+					!= SUCCESS) {
+					code = MEMORY_REFUSED;
+					break;
+				}
+				memcpy(pending + pending_length, line, length);
+				pending_length += (uint32_t)length;
+			}
+			code = obj_stream_line(&stream, pending, pending_length);
+			pending_length = 0;
+			comment = 0;
+		}
+		if (code != SUCCESS) {
+			break;
+		}
+		if (last) {
+			if (pending_length > 0) {
+				code = obj_stream_line(&stream, pending, pending_length);
+			}
+			break;
+		}
+		if (ringbuf_full(&ring)) {
+			// The line does not fit in the ring; set its start aside.
+			if (comment) {
+				ringbuf_drain(&ring, NULL);
+			} else if (array_reserve((void**)&pending, &pending_cap,
+				pending_length + (uint32_t)ring.capacity, sizeof *pending) 
+				!= SUCCESS) {
+				code = MEMORY_REFUSED;
+				break;
+			} else {
+				pending_length += (uint32_t)ringbuf_drain(&ring, 
+					pending + pending_length);
+				comment = is_comment(pending, pending_length);
+			}
+		}
+		size_t count;
+		if ((code = ringbuf_fill(&ring, fd, &count)) != SUCCESS) {
+			report(&stream, code);
+			break;
+		}
+		last = count == 0;
+	}
+	free(pending);
+	obj_stream_destroy(&stream);
+	ringbuf_destroy(&ring);
+	return code;
+}
@@ -0,0 +1,388 @@
+#include "quantize.h"
+#include "pack.h"
+#include "defs.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define QUANTIZE_X86
+#include <immintrin.h>
+#endif
+
+// -----------------------------------------------------------------------------
+// Static utility
+// -----------------------------------------------------------------------------
+
+/* Positions repeat their per-component constants every 12 floats for every
+ * dimension from 1 to 4, which is a whole number of 4-float vectors. */
+#define PATTERN 12
+
+/** Encodes the first three components of a normal on the octahedron, in 
+ * [-1, 1]. A zero normal encodes as (0, 0).
+ */
+static inline void octahedral(const float* n, float* u, float* v) {
+	float sum = fabsf(n[0]) + fabsf(n[1]) + fabsf(n[2]);
+	float inv = sum > 0.0f ? 1.0f / sum : 0.0f;
+	float x = n[0] * inv;
+	float y = n[1] * inv;
+	if (n[2] * inv < 0.0f) {
+		float fx = x < 0.0f ? -1.0f : 1.0f;
+		float fy = y < 0.0f ? -1.0f : 1.0f;
+		float ox = (1.0f - fabsf(y)) * fx;
+		y = (1.0f - fabsf(x)) * fy;
+		x = ox;
+	}
+	*u = x;
+	*v = y;
+}
+
+static inline float clampf(float value, float low, float high) {
+	return value < low ? low : (value > high ? high : value);
+}
+
+/** Quantizes count floats to 16 bits: round((in - origin) * factor), with the
+ * constants repeating every PATTERN floats.
+ */
+static void unorm16_scalar(const float* in, 
+	size_t count, 
+	const float* origin, 
+	const float* factor, 
+	uint16_t* out) {
+	for (size_t i = 0; i < count; i++) {
+		float q = (in[i] - origin[i % PATTERN]) * factor[i % PATTERN];
+		out[i] = (uint16_t)lrintf(clampf(q, 0.0f, 65535.0f));
+	}
+}
+
+/** Encodes normals of stride floats as two signed values of the given 
+ * largest magnitude each.
+ */
+static void octahedral_scalar(const float* in, 
+	size_t count, 
+	uint32_t stride, 
+	float range, 
+	int32_t* out) {
+	for (size_t i = 0; i < count; i++) {
+		float u, v;
+		octahedral(in + i * stride, &u, &v);
+		out[2 * i] = (int32_t)lrintf(clampf(u, -1.0f, 1.0f) * range);
+		out[2 * i + 1] = (int32_t)lrintf(clampf(v, -1.0f, 1.0f) * range);
+	}
+}
+
+static void half_scalar(const float* in, size_t count, uint16_t* out) {
+	for (size_t i = 0; i < count; i++) {
+		out[i] = pack_half(in[i]);
+	}
+}
+
+#ifdef QUANTIZE_X86
+__attribute__((target("sse2")))
+static void unorm16_sse2(const float* in, 
+	size_t count, 
+	const float* origin, 
+	const float* factor, 
+	uint16_t* out) {
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 top = _mm_set1_ps(65535.0f);
+	// Biased so the signed saturating pack keeps the whole unsigned range.
+	const __m128i bias = _mm_set1_epi32(32768);
+	const __m128i flip = _mm_set1_epi16((short)0x8000);
+	size_t i = 0;
+	for (; i + PATTERN <= count; i += PATTERN) {
+		__m128i q[3];
+		for (int j = 0; j < 3; j++) {
+			__m128 x = _mm_loadu_ps(in + i + 4 * j);
+			x = _mm_mul_ps(_mm_sub_ps(x, _mm_loadu_ps(origin + 4 * j)), 
+				_mm_loadu_ps(factor + 4 * j));
+			x = _mm_min_ps(_mm_max_ps(x, zero), top);
+			q[j] = _mm_sub_epi32(_mm_cvtps_epi32(x), bias);
+		}
+		__m128i lo = _mm_xor_si128(_mm_packs_epi32(q[0], q[1]), flip);
+		__m128i hi = _mm_xor_si128(_mm_packs_epi32(q[2], q[2]), flip);
+		_mm_storeu_si128((__m128i*)(out + i), lo);
+		_mm_storel_epi64((__m128i*)(out + i + 8), hi);
+	}
+	unorm16_scalar(in + i, count - i, origin, factor, out + i);
+}
+
+__attribute__((target("sse2")))
+static void octahedral_sse2(const float* in, 
+	size_t count, 
+	uint32_t stride, 
+	float range, 
+	int32_t* out) {
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 minus_one = _mm_set1_ps(-1.0f);
+	const __m128 magnitude = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+	const __m128 scale = _mm_set1_ps(range);
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		const float* n = in + i * stride;
+		__m128 x = _mm_setr_ps(n[0], n[stride], n[2 * stride], 
+			n[3 * stride]);
+		__m128 y = _mm_setr_ps(n[1], n[stride + 1], n[2 * stride + 1], 
+			n[3 * stride + 1]);
+		__m128 z = _mm_setr_ps(n[2], n[stride + 2], n[2 * stride + 2], 
+			n[3 * stride + 2]);
+		__m128 sum = _mm_add_ps(_mm_add_ps(_mm_and_ps(x, magnitude), 
+			_mm_and_ps(y, magnitude)), _mm_and_ps(z, magnitude));
+		__m128 inv = _mm_and_ps(_mm_div_ps(one, sum), 
+			_mm_cmpgt_ps(sum, zero));
+		x = _mm_mul_ps(x, inv);
+		y = _mm_mul_ps(y, inv);
+		__m128 lower = _mm_cmplt_ps(_mm_mul_ps(z, inv), zero);
+		__m128 x_negative = _mm_cmplt_ps(x, zero);
+		__m128 y_negative = _mm_cmplt_ps(y, zero);
+		__m128 fx = _mm_or_ps(_mm_and_ps(x_negative, minus_one), 
+			_mm_andnot_ps(x_negative, one));
+		__m128 fy = _mm_or_ps(_mm_and_ps(y_negative, minus_one), 
+			_mm_andnot_ps(y_negative, one));
+		__m128 ox = _mm_mul_ps(_mm_sub_ps(one, _mm_and_ps(y, magnitude)), fx);
+		__m128 oy = _mm_mul_ps(_mm_sub_ps(one, _mm_and_ps(x, magnitude)), fy);
+		x = _mm_or_ps(_mm_and_ps(lower, ox), _mm_andnot_ps(lower, x));
+		y = _mm_or_ps(_mm_and_ps(lower, oy), _mm_andnot_ps(lower, y));
+		x = _mm_mul_ps(_mm_min_ps(_mm_max_ps(x, minus_one), one), scale);
+		y = _mm_mul_ps(_mm_min_ps(_mm_max_ps(y, minus_one), one), scale);
+		__m128i qx = _mm_cvtps_epi32(x);
+		__m128i qy = _mm_cvtps_epi32(y);
+		_mm_storeu_si128((__m128i*)(out + 2 * i), _mm_unpacklo_epi32(qx, qy));
+		_mm_storeu_si128((__m128i*)(out + 2 * i + 4), 
+			_mm_unpackhi_epi32(qx, qy));
+	}
+	octahedral_scalar(in + i * stride, count - i, stride, range, out + 2 * i);
+}
+
+__attribute__((target("sse2,f16c")))
+static void half_f16c(const float* in, size_t count, uint16_t* out) {
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128i h = _mm_cvtps_ph(_mm_loadu_ps(in + i), 
+			_MM_FROUND_TO_NEAREST_INT);
+		_mm_storel_epi64((__m128i*)(out + i), h);
+	}
+	half_scalar(in + i, count - i, out + i);
+}
+#endif
+
+/** Measures the error of decoded positions.
+ */
+static quantize_error_t position_error(const mesh_t* mesh, 
+	const quantized_t* q) {
+	quantize_error_t error = {0.0f, 0.0f};
+	double total = 0.0;
+	size_t count = (size_t)q->num_positions * q->position_dim;
+	for (size_t i = 0; i < count; i++) {
+		uint32_t c = (uint32_t)(i % q->position_dim);
+		float decoded = q->origin[c] + (float)q->positions[i] * q->scale[c];
+		float e = fabsf(decoded - mesh->positions[i]);
+		error.max = e > error.max ? e : error.max;
+		total += (double)e * e;
+	}
+	error.rms = count ? (float)sqrt(total / (double)count) : 0.0f;
+	return error;
+}
+
+/** Measures the angle between the normals and their decoded directions. Zero 
+ * normals are skipped.
+ */
+static quantize_error_t normal_error(const mesh_t* mesh, 
+	const quantized_t* q, 
+	const int32_t* encoded, 
+	float range) {
+	quantize_error_t error = {0.0f, 0.0f};
+	double total = 0.0;
+	uint32_t counted = 0;
+	for (uint32_t i = 0; i < q->num_normals; i++) {
+		const float* n = mesh->normals + (size_t)i * mesh->vertex_dim;
+		if (n[0] == 0.0f && n[1] == 0.0f && n[2] == 0.0f) {
+			continue;
+		}
+		float d[3];
+		quantize_decode_normal((float)encoded[2 * i] / range, 
+			(float)encoded[2 * i + 1] / range, d);
+		// acos loses small angles to rounding; atan2 of the cross and dot
+		// products does not.
+		double cx = (double)n[1] * d[2] - (double)n[2] * d[1];
+		double cy = (double)n[2] * d[0] - (double)n[0] * d[2];
+		double cz = (double)n[0] * d[1] - (double)n[1] * d[0];
+		double dot = (double)n[0] * d[0] + (double)n[1] * d[1] 
+			+ (double)n[2] * d[2];
+		float e = (float)(atan2(sqrt(cx * cx + cy * cy + cz * cz), dot) 
+			* 57.29577951308232);
+		error.max = e > error.max ? e : error.max;
+		total += (double)e * e;
+		counted++;
+	}
+	error.rms = counted ? (float)sqrt(total / counted) : 0.0f;
+	return error;
+}
+
+static quantize_error_t texcoord_error(const mesh_t* mesh, 
+	const quantized_t* q) {
+	quantize_error_t error = {0.0f, 0.0f};
+	double total = 0.0;
+	size_t count = (size_t)q->num_texcoords * q->texcoord_dim;
+	for (size_t i = 0; i < count; i++) {
+		float e = fabsf(pack_unhalf(q->texcoords[i]) - mesh->texcoords[i]);
+		error.max = e > error.max ? e : error.max;
+		total += (double)e * e;
+	}
+	error.rms = count ? (float)sqrt(total / (double)count) : 0.0f;
+	return error;
+}
+
+/** Quantizes the positions relative to their bounding box, as read.
+ */
+static void quantize_positions(const mesh_t* mesh, 
+	quantize_kernel_t kernel, 
+	quantized_t* q) {
+	uint32_t dim = q->position_dim;
+	const float* lower = mesh->aabb_min;
+	const float* upper = mesh->aabb_max;
+	float origin[PATTERN], factor[PATTERN];
+	for (uint32_t c = 0; c < dim; c++) {
+		float extent = upper[c] - lower[c];
+		q->origin[c] = lower[c];
+		q->scale[c] = extent / 65535.0f;
+	}
+	for (uint32_t i = 0; i < PATTERN; i++) {
+		uint32_t c = i % dim;
+		float extent = upper[c] - lower[c];
+		origin[i] = lower[c];
+		factor[i] = extent > 0.0f ? 65535.0f / extent : 0.0f;
+	}
+	size_t count = (size_t)q->num_positions * dim;
+#ifdef QUANTIZE_X86
+	if (kernel >= QUANTIZE_SSE2) {
+		unorm16_sse2(mesh->positions, count, origin, factor, q->positions);
+		return;
+	}
+#endif
+	(void)kernel;
+	unorm16_scalar(mesh->positions, count, origin, factor, q->positions);
+}
+
+// -----------------------------------------------------------------------------
+// Implementation
+// -----------------------------------------------------------------------------
+
+quantize_kernel_t
+quantize_best(void) {
+#ifdef QUANTIZE_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("sse2")) {
+		return __builtin_cpu_supports("f16c") ? QUANTIZE_F16C : QUANTIZE_SSE2;
+	}
+#endif
+	return QUANTIZE_SCALAR;
+}
+
+const char*
+quantize_name(quantize_kernel_t kernel) {
+	switch (kernel) {
+		case QUANTIZE_AUTO:
+			return "auto";
+		case QUANTIZE_SSE2:
+			return "sse2";
+		case QUANTIZE_F16C:
+			return "f16c";
+		default:
+			return "scalar";
+	}
+}
+
+void
+quantize_decode_normal(float x, float y, float normal[3]) {
+	float z = 1.0f - fabsf(x) - fabsf(y);
+	if (z < 0.0f) {
+		float ox = (1.0f - fabsf(y)) * (x < 0.0f ? -1.0f : 1.0f);
+		y = (1.0f - fabsf(x)) * (y < 0.0f ? -1.0f : 1.0f);
+		x = ox;
+	}
+	float length = sqrtf(x * x + y * y + z * z);
+	normal[0] = x / length;
+	normal[1] = y / length;
+	normal[2] = z / length;
+}
+
+int
+quantize_mesh(const mesh_t* mesh, 
+	uint32_t normal_bits, 
+	quantize_kernel_t kernel, 
+	quantized_t* out) {
+	quantize_kernel_t best = quantize_best();
+	if (kernel == QUANTIZE_AUTO || kernel > best) {
+		kernel = best;
+	}
+	*out = (quantized_t) {
+		.num_positions = mesh->num_vertices,
+		.position_dim = mesh->vertex_dim,
+		.num_normals = mesh->num_normals,
+		.normal_bits = normal_bits,
+		.num_texcoords = mesh->num_textures,
+		.texcoord_dim = mesh->tex_dim
+	};
+	if ((normal_bits != 8 && normal_bits != 16) || mesh->vertex_dim > 4 ||
+		(mesh->num_normals > 0 && mesh->vertex_dim < 3)) {
+		return INVALID_DIMS;
+	}
+	size_t positions = (size_t)mesh->num_vertices * mesh->vertex_dim;
+	size_t texcoords = (size_t)mesh->num_textures * mesh->tex_dim;
+	out->positions = malloc(positions * sizeof *out->positions + 1);
+	out->texcoords = malloc(texcoords * sizeof *out->texcoords + 1);
+	out->normals = malloc((size_t)mesh->num_normals * 2 * normal_bits / 8 + 1);
+	int32_t* encoded = malloc((size_t)mesh->num_normals * 2 
+		* sizeof *encoded + 1);
+	if (!out->positions || !out->texcoords || !out->normals || !encoded) {
+		free(encoded);
+		quantized_destroy(out);
+		return MEMORY_REFUSED;
+	}
+
+	if (mesh->num_vertices > 0) {
+		quantize_positions(mesh, kernel, out);
+	}
+	float range = normal_bits == 8 ? 127.0f : 32767.0f;
+#ifdef QUANTIZE_X86
+	if (kernel >= QUANTIZE_SSE2) {
+		octahedral_sse2(mesh->normals, mesh->num_normals, mesh->vertex_dim, 
+			range, encoded);
+	} else
+#endif
+	{
+		octahedral_scalar(mesh->normals, mesh->num_normals, mesh->vertex_dim,
+			range, encoded);
+	}
+	for (size_t i = 0; i < (size_t)mesh->num_normals * 2; i++) {
+		if (normal_bits == 8) {
+			((int8_t*)out->normals)[i] = (int8_t)encoded[i];
+		} else {
+			((int16_t*)out->normals)[i] = (int16_t)encoded[i];
+		}
+	}
+#ifdef QUANTIZE_X86
+	if (kernel == QUANTIZE_F16C) {
+		half_f16c(mesh->texcoords, texcoords, out->texcoords);
+	} else
+#endif
+	{
+		half_scalar(mesh->texcoords, texcoords, out->texcoords);
+	}
+
+	out->position_error = position_error(mesh, out);
+	out->normal_error = normal_error(mesh, out, encoded, range);
+	out->texcoord_error = texcoord_error(mesh, out);
+	free(encoded);
+	return SUCCESS;
+}
+
+void
+quantized_destroy(quantized_t* quantized) {
+	free(quantized->positions);
+	free(quantized->normals);
+	free(quantized->texcoords);
+	*quantized = (quantized_t) {0};
+}
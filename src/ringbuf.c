@@ -0,0 +1,147 @@
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "ringbuf.h"
+#include "defs.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+// -----------------------------------------------------------------------------
+// Static utility
+// -----------------------------------------------------------------------------
+
+/** Reads from a descriptor once.
+ * @param fd The descriptor.
+ * @param dest Receives the bytes.
+ * @param size The largest number of bytes to read.
+ * @return The number of bytes read, 0 at the end of the input, or -1.
+ */
+static long
+read_fd(int fd, char* dest, size_t size) {
+#ifdef _WIN32
+	return _read(fd, dest, size > 0x40000000u ? 0x40000000u : (unsigned)size);
+#else
+	return (long)read(fd, dest, size);
+#endif
+}
+
+// -----------------------------------------------------------------------------
+// Implementation
+// -----------------------------------------------------------------------------
+int
+ringbuf_init(ringbuf_t* ring, size_t capacity) {
+	size_t size = 1;
+	while (size < capacity) {
+		size <<= 1;
+	}
+	*ring = (ringbuf_t) { .capacity = size };
+	ring->data = malloc(size);
+	ring->line = malloc(size);
+	if (!ring->data || !ring->line) {
+		ringbuf_destroy(ring);
+		return MEMORY_REFUSED;
+	}
+	return SUCCESS;
+}
+
+void
+ringbuf_destroy(ringbuf_t* ring) {
+	free(ring->data);
+	free(ring->line);
+	*ring = (ringbuf_t) {0};
+}
+
+int
+ringbuf_fill(ringbuf_t* ring, int fd, size_t* count) {
+	if (ring->head == ring->tail) {
+		// Start over at the front so the whole ring is one free piece.
+		ring->head = ring->tail = ring->scanned = 0;
+	}
+	size_t mask = ring->capacity - 1;
+	size_t start = ring->tail & mask;
+	// The free space is contiguous up to the end of data or up to the head.
+	size_t space = ring->capacity - (ring->tail - ring->head);
+	if (space > ring->capacity - start) {
+		space = ring->capacity - start;
+	}
+	*count = 0;
+	if (space == 0) {
+		return SUCCESS;
+	}
+	long n;
+	do {
+		n = read_fd(fd, ring->data + start, space);
+	} while (n < 0 && errno == EINTR);
+	if (n < 0) {
+		return INVALID_FILE;
+	}
+	ring->tail += (size_t)n;
+	*count = (size_t)n;
+	return SUCCESS;
+}
+
+const char*
+ringbuf_line(ringbuf_t* ring, int last, size_t* length) {
+	size_t mask = ring->capacity - 1;
+	size_t end = ring->scanned;
+	if (end < ring->head) {
+		end = ring->head;
+	}
+	// Search both contiguous pieces of the unscanned bytes.
+	while (end < ring->tail) {
+		size_t start = end & mask;
+		size_t span = ring->tail - end;
+		if (span > ring->capacity - start) {
+			span = ring->capacity - start;
+		}
+		const char* newline = memchr(ring->data + start, '\n', span);
+		if (newline) {
+			end += (size_t)(newline - (ring->data + start));
+			break;
+		}
+		end += span;
+	}
+	ring->scanned = end;
+	if (end == ring->tail && (!last || end == ring->head)) {
+		return NULL;
+	}
+
+	size_t first = ring->head & mask;
+	*length = end - ring->head;
+	const char* line = ring->data + first;
+	if (first + *length > ring->capacity) {
+		size_t head_part = ring->capacity - first;
+		memcpy(ring->line, ring->data + first, head_part);
+		memcpy(ring->line + head_part, ring->data, *length - head_part);
+		line = ring->line;
+	}
+	// Consume the newline too, if there is one.
+	ring->head = end < ring->tail ? end + 1 : end;
+	ring->scanned = ring->head;
+	return line;
+}
+
+size_t
+ringbuf_drain(ringbuf_t* ring, char* dest) {
+	size_t mask = ring->capacity - 1;
+	size_t first = ring->head & mask;
+	size_t count = ring->tail - ring->head;
+	if (dest) {
+		size_t head_part = ring->capacity - first;
+		if (head_part > count) {
+			head_part = count;
+		}
+		memcpy(dest, ring->data + first, head_part);
+		memcpy(dest + head_part, ring->data, count - head_part);
+	}
+	ring->head = ring->scanned = ring->tail;
+	return count;
+}
@@ -0,0 +1,798 @@
+#include "simplify.h"
+#include "defs.h"
+#include "utils.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// -----------------------------------------------------------------------------
+// Static utility
+// -----------------------------------------------------------------------------
+
+/* A feature edge pulls its ends towards the plane through it, weighted this
+ * many times the square of its length. */
+#define FEATURE_WEIGHT 10.0
+/* The most welded vertices one position may have and still be collapsed. */
+#define MAX_WEDGES 8
+/* A collapse may not turn a triangle's normal by more than about 75 degrees.
+ */
+#define MIN_NORMAL_COS 0.25
+
+/** @struct quadric_t
+ * @brief The sum of squared distances to a set of weighted planes, as the
+ * upper triangle of a symmetric 4x4 matrix, and the sum of the weights.
+ */
+typedef struct {
+	double a2, ab, ac, ad, b2, bc, bd, c2, cd, d2;
+	double weight;
+} quadric_t;
+
+/* Not in the heap. */
+#define NO_SLOT UINT32_MAX
+
+/** @struct candidate_t
+ * @brief A neighbour a position could move onto.
+ */
+typedef struct {
+	float cost;
+	uint32_t target;
+} candidate_t;
+
+/** @struct simplifier_t
+ * @brief The state of a simplification. Triangles refer to welded vertices,
+ * which share a position on seams; collapses move positions.
+ */
+typedef struct {
+	/** The welded vertex of every corner of every triangle. */
+	uint32_t* corners;
+	/** The position of every welded vertex. */
+	const uint32_t* wedge_position;
+	const mtl_t** material;
+	uint8_t* alive;
+	uint32_t num_triangles;
+	uint32_t num_alive;
+
+	uint32_t num_positions;
+	/** Three coordinates per position. */
+	float* points;
+	quadric_t* quadrics;
+	/** The triangles around every position, dead ones included until the
+	 * list is next moved: pool[offset[p]] through pool[offset[p] + count[p]].
+	 */
+	uint32_t* offset;
+	uint32_t* count;
+	uint32_t* capacity;
+	uint32_t* pool;
+	uint32_t pool_size;
+	uint32_t pool_cap;
+	/** 1 for positions on a feature edge. A collapse never makes a feature
+	 * edge where there was none, so the others are never checked. */
+	uint8_t* on_feature;
+
+	/** Scratch space: marks for finding distinct neighbours, the neighbours
+	 * themselves, the candidates of a position and the ring of a collapse. */
+	uint32_t* mark;
+	uint32_t mark_value;
+	uint32_t* neighbors;
+	uint32_t neighbors_cap;
+	candidate_t* candidates;
+	uint32_t candidates_cap;
+	uint32_t* ring;
+	uint32_t ring_cap;
+
+	/** The cheapest collapse of every position: onto target[p] at cost[p].
+	 * The heap holds the positions that have one, cheapest first, and slot[p]
+	 * is where p is in it, or NO_SLOT. */
+	float* cost;
+	uint32_t* target;
+	uint32_t* heap;
+	uint32_t* slot;
+	uint32_t heap_size;
+	/** The largest normalized cost collapsed so far. */
+	double max_error;
+} simplifier_t;
+
+static void quadric_add_plane(quadric_t* q,
+	const double n[3],
+	double d,
+	double weight) {
+	q->a2 += weight * n[0] * n[0];
+	q->ab += weight * n[0] * n[1];
+	q->ac += weight * n[0] * n[2];
+	q->ad += weight * n[0] * d;
+	q->b2 += weight * n[1] * n[1];
+	q->bc += weight * n[1] * n[2];
+	q->bd += weight * n[1] * d;
+	q->c2 += weight * n[2] * n[2];
+	q->cd += weight * n[2] * d;
+	q->d2 += weight * d * d;
+}
+
+static void quadric_add(quadric_t* q, const quadric_t* other) {
+	q->a2 += other->a2;
+	q->ab += other->ab;
+	q->ac += other->ac;
+	q->ad += other->ad;
+	q->b2 += other->b2;
+	q->bc += other->bc;
+	q->bd += other->bd;
+	q->c2 += other->c2;
+	q->cd += other->cd;
+	q->d2 += other->d2;
+	q->weight += other->weight;
+}
+
+/** Evaluates the sum of two quadrics at a point, divided by their weight: the
+ * mean squared distance to their planes. */
+static double quadric_error(const quadric_t* q,
+	const quadric_t* r,
+	const float* p) {
+	double x = p[0], y = p[1], z = p[2];
+	double error = (q->a2 + r->a2) * x * x + (q->b2 + r->b2) * y * y
+		+ (q->c2 + r->c2) * z * z + (q->d2 + r->d2)
+		+ 2.0 * ((q->ab + r->ab) * x * y + (q->ac + r->ac) * x * z
+		+ (q->bc + r->bc) * y * z + (q->ad + r->ad) * x
+		+ (q->bd + r->bd) * y + (q->cd + r->cd) * z);
+	double weight = q->weight + r->weight;
+	error = error > 0.0 ? error : 0.0;
+	return weight > 0.0 ? error / weight : error;
+}
+
+static void cross3(const double a[3], const double b[3], double out[3]) {
+	out[0] = a[1] * b[2] - a[2] * b[1];
+	out[1] = a[2] * b[0] - a[0] * b[2];
+	out[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+static double dot3(const double a[3], const double b[3]) {
+	return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+/** Computes the unnormalized normal of a triangle given its three points. */
+static void triangle_normal(const float* a,
+	const float* b,
+	const float* c,
+	double n[3]) {
+	double e[3], f[3];
+	for (uint32_t k = 0; k < 3; k++) {
+		e[k] = (double)b[k] - a[k];
+		f[k] = (double)c[k] - a[k];
+	}
+	cross3(e, f, n);
+}
+
+static inline uint32_t corner_position(const simplifier_t* s,
+	uint32_t t,
+	uint32_t j) {
+	return s->wedge_position[s->corners[3 * t + j]];
+}
+
+/** @returns The corner of a triangle at a position, or 3. */
+static inline uint32_t find_corner(const simplifier_t* s,
+	uint32_t t,
+	uint32_t p) {
+	uint32_t j = 0;
+	while (j < 3 && corner_position(s, t, j) != p) {
+		j++;
+	}
+	return j;
+}
+
+static inline void heap_place(simplifier_t* s, uint32_t i, uint32_t p) {
+	s->heap[i] = p;
+	s->slot[p] = i;
+}
+
+static void heap_sift_up(simplifier_t* s, uint32_t i) {
+	uint32_t p = s->heap[i];
+	while (i > 0 && s->cost[s->heap[(i - 1) / 2]] > s->cost[p]) {
+		heap_place(s, i, s->heap[(i - 1) / 2]);
+		i = (i - 1) / 2;
+	}
+	heap_place(s, i, p);
+}
+
+static void heap_sift_down(simplifier_t* s, uint32_t i) {
+	uint32_t p = s->heap[i];
+	for (;;) {
+		uint32_t child = 2 * i + 1;
+		if (child >= s->heap_size) {
+			break;
+		}
+		if (child + 1 < s->heap_size &&
+			s->cost[s->heap[child + 1]] < s->cost[s->heap[child]]) {
+			child++;
+		}
+		if (s->cost[s->heap[child]] >= s->cost[p]) {
+			break;
+		}
+		heap_place(s, i, s->heap[child]);
+		i = child;
+	}
+	heap_place(s, i, p);
+}
+
+/** Sets the cheapest collapse of a position, adding it to the heap or moving
+ * it within. */
+static void heap_set(simplifier_t* s, uint32_t p, float cost, uint32_t to) {
+	int up = s->slot[p] == NO_SLOT || cost < s->cost[p];
+	s->cost[p] = cost;
+	s->target[p] = to;
+	if (s->slot[p] == NO_SLOT) {
+		heap_place(s, s->heap_size++, p);
+	}
+	if (up) {
+		heap_sift_up(s, s->slot[p]);
+	} else {
+		heap_sift_down(s, s->slot[p]);
+	}
+}
+
+static void heap_remove(simplifier_t* s, uint32_t p) {
+	uint32_t i = s->slot[p];
+	if (i == NO_SLOT) {
+		return;
+	}
+	s->slot[p] = NO_SLOT;
+	uint32_t last = s->heap[--s->heap_size];
+	if (i < s->heap_size) {
+		heap_place(s, i, last);
+		heap_sift_up(s, i);
+		heap_sift_down(s, s->slot[last]);
+	}
+}
+
+/** Adds a triangle to the list of a position, moving the list to the end of
+ * the pool without its dead triangles when it is full.
+ * @returns SUCCESS or MEMORY_REFUSED.
+ */
+static int append_triangle(simplifier_t* s, uint32_t p, uint32_t t) {
+	if (s->count[p] == s->capacity[p]) {
+		uint32_t live = 0;
+		for (uint32_t i = 0; i < s->count[p]; i++) {
+			live += s->alive[s->pool[s->offset[p] + i]];
+		}
+		uint32_t cap = 2 * live + 4;
+		if (array_reserve((void**)&s->pool, &s->pool_cap, s->pool_size + cap,
+			sizeof *s->pool) != SUCCESS) {
+			return MEMORY_REFUSED;
+		}
+		uint32_t* dest = s->pool + s->pool_size;
+		uint32_t n = 0;
+		for (uint32_t i = 0; i < s->count[p]; i++) {
+			uint32_t other = s->pool[s->offset[p] + i];
+			if (s->alive[other]) {
+				dest[n++] = other;
+			}
+		}
+		s->offset[p] = s->pool_size;
+		s->count[p] = n;
+		s->capacity[p] = cap;
+		s->pool_size += cap;
+	}
+	s->pool[s->offset[p] + s->count[p]++] = t;
+	return SUCCESS;
+}
+
+/** Collects the distinct positions sharing a live triangle with p into
+ * s->neighbors, and leaves them marked with s->mark_value.
+ * @returns The number of neighbours, or UINT32_MAX when out of memory.
+ */
+static uint32_t find_neighbors(simplifier_t* s, uint32_t p) {
+	uint32_t n = 0;
+	s->mark_value += 2;
+	if (array_reserve((void**)&s->neighbors, &s->neighbors_cap,
+		2 * s->count[p] + 1, sizeof *s->neighbors) != SUCCESS) {
+		return UINT32_MAX;
+	}
+	for (uint32_t i = 0; i < s->count[p]; i++) {
+		uint32_t t = s->pool[s->offset[p] + i];
+		if (!s->alive[t]) {
+			continue;
+		}
+		for (uint32_t j = 0; j < 3; j++) {
+			uint32_t q = corner_position(s, t, j);
+			if (q == p || s->mark[q] == s->mark_value) {
+				continue;
+			}
+			s->mark[q] = s->mark_value;
+			s->neighbors[n++] = q;
+		}
+	}
+	return n;
+}
+
+/** An edge is a feature when it does not join exactly two triangles, or
+ * when its triangles differ in material or in the welded vertices at its
+ * ends: a border, a non-manifold edge, a material boundary or a seam.
+ */
+static int is_feature_edge(const simplifier_t* s, uint32_t p, uint32_t q) {
+	uint32_t shared = 0;
+	uint32_t first = 0;
+	for (uint32_t i = 0; i < s->count[p]; i++) {
+		uint32_t t = s->pool[s->offset[p] + i];
+		uint32_t jq;
+		if (!s->alive[t] || (jq = find_corner(s, t, q)) == 3) {
+			continue;
+		}
+		if (shared++ == 0) {
+			first = t;
+			continue;
+		}
+		uint32_t jp = find_corner(s, t, p);
+		if (s->material[t] != s->material[first] ||
+			s->corners[3 * t + jp]
+			!= s->corners[3 * first + find_corner(s, first, p)] ||
+			s->corners[3 * t + jq]
+			!= s->corners[3 * first + find_corner(s, first, q)]) {
+			return 1;
+		}
+	}
+	return shared != 2;
+}
+
+/** Finds which welded vertex of the target each welded vertex of a position
+ * becomes, from the triangles of the edge between them.
+ * @returns 1 if every welded vertex of the position has exactly one, 0
+ * otherwise.
+ */
+static int map_wedges(const simplifier_t* s,
+	uint32_t p,
+	uint32_t target,
+	uint32_t from[MAX_WEDGES],
+	uint32_t to[MAX_WEDGES],
+	uint32_t* num_wedges) {
+	uint32_t n = 0;
+	for (uint32_t i = 0; i < s->count[p]; i++) {
+		uint32_t t = s->pool[s->offset[p] + i];
+		if (!s->alive[t]) {
+			continue;
+		}
+		uint32_t wedge = s->corners[3 * t + find_corner(s, t, p)];
+		uint32_t k = 0;
+		while (k < n && from[k] != wedge) {
+			k++;
+		}
+		if (k == n) {
+			if (n == MAX_WEDGES) {
+				return 0;
+			}
+			from[n] = wedge;
+			to[n++] = UINT32_MAX;
+		}
+		uint32_t jt = find_corner(s, t, target);
+		if (jt < 3) {
+			uint32_t other = s->corners[3 * t + jt];
+			if (to[k] != UINT32_MAX && to[k] != other) {
+				return 0;
+			}
+			to[k] = other;
+		}
+	}
+	for (uint32_t k = 0; k < n; k++) {
+		if (to[k] == UINT32_MAX) {
+			return 0;
+		}
+	}
+	*num_wedges = n;
+	return 1;
+}
+
+/** The link condition: the edge's ends may share no neighbours but the
+ * corners opposite the edge, or the collapse pinches the surface.
+ */
+static int keeps_manifold(simplifier_t* s, uint32_t p, uint32_t target) {
+	uint32_t n = find_neighbors(s, p);
+	if (n == UINT32_MAX) {
+		return 0;
+	}
+	uint32_t common = 0;
+	uint32_t shared = 0;
+	uint32_t around = 0;
+	for (uint32_t i = 0; i < s->count[target]; i++) {
+		uint32_t t = s->pool[s->offset[target] + i];
+		if (!s->alive[t]) {
+			continue;
+		}
+		around++;
+		shared += find_corner(s, t, p) < 3;
+		for (uint32_t j = 0; j < 3; j++) {
+			uint32_t q = corner_position(s, t, j);
+			if (s->mark[q] == s->mark_value) {
+				s->mark[q] = s->mark_value + 1;
+				common++;
+			}
+		}
+	}
+	// The target itself is a neighbour of p. A tetrahedron passes the link
+	// condition but would flatten into two triangles back to back.
+	return common == shared + 1 && !(n == 3 && around == 3 && shared == 2);
+}
+
+/** @returns 1 if no triangle that survives the collapse turns too far. */
+static int keeps_orientation(const simplifier_t* s,
+	uint32_t p,
+	uint32_t target) {
+	const float* moved = s->points + 3 * (size_t)target;
+	for (uint32_t i = 0; i < s->count[p]; i++) {
+		uint32_t t = s->pool[s->offset[p] + i];
+		if (!s->alive[t] || find_corner(s, t, target) < 3) {
+			continue;
+		}
+		const float* before[3];
+		const float* after[3];
+		for (uint32_t j = 0; j < 3; j++) {
+			uint32_t q = corner_position(s, t, j);
+			before[j] = s->points + 3 * (size_t)q;
+			after[j] = q == p ? moved : before[j];
+		}
+		double n[3], m[3];
+		triangle_normal(before[0], before[1], before[2], n);
+		triangle_normal(after[0], after[1], after[2], m);
+		double length = sqrt(dot3(n, n) * dot3(m, m));
+		if (length == 0.0 || dot3(n, m) < MIN_NORMAL_COS * length) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+static int is_valid(simplifier_t* s, uint32_t p, uint32_t target) {
+	uint32_t from[MAX_WEDGES], to[MAX_WEDGES], n;
+	return map_wedges(s, p, target, from, to, &n) &&
+		keeps_orientation(s, p, target) && keeps_manifold(s, p, target);
+}
+
+/** Finds the cheapest neighbour a position may move onto and queues it. A
+ * position with no feature edges may move onto any neighbour, one with two
+ * only along them, and any other stays. With validate, the candidates are
+ * checked cheapest first, so the collapse queued is known to be valid; 
+ * without, it is checked when it comes first.
+ * @returns SUCCESS or MEMORY_REFUSED.
+ */
+static int evaluate(simplifier_t* s, uint32_t p, int validate) {
+	uint32_t n = find_neighbors(s, p);
+	if (n == UINT32_MAX || array_reserve((void**)&s->candidates,
+		&s->candidates_cap, n + 1, sizeof *s->candidates) != SUCCESS) {
+		return MEMORY_REFUSED;
+	}
+	uint32_t features = 0;
+	uint32_t num_candidates = 0;
+	for (uint32_t i = 0; i < n; i++) {
+		s->candidates[num_candidates].target = s->neighbors[i];
+		if (s->on_feature[p] &&
+			is_feature_edge(s, p, s->neighbors[i])) {
+			// Feature candidates go first, and are all that is left.
+			s->candidates[num_candidates] = s->candidates[features];
+			s->candidates[features++].target = s->neighbors[i];
+		}
+		num_candidates++;
+	}
+	if (features == 1 || features > 2) {
+		heap_remove(s, p);
+		return SUCCESS;
+	}
+	if (features == 2) {
+		num_candidates = 2;
+	}
+	for (uint32_t i = 0; i < num_candidates; i++) {
+		uint32_t q = s->candidates[i].target;
+		s->candidates[i].cost = (float)quadric_error(s->quadrics + p,
+			s->quadrics + q, s->points + 3 * (size_t)q);
+	}
+	// Insertion sort: rings are small.
+	for (uint32_t i = 1; i < num_candidates; i++) {
+		candidate_t c = s->candidates[i];
+		uint32_t j = i;
+		while (j > 0 && s->candidates[j - 1].cost > c.cost) {
+			s->candidates[j] = s->candidates[j - 1];
+			j--;
+		}
+		s->candidates[j] = c;
+	}
+	for (uint32_t i = 0; i < num_candidates; i++) {
+		candidate_t c = s->candidates[i];
+		if (!validate || is_valid(s, p, c.target)) {
+			heap_set(s, p, c.cost, c.target);
+			return SUCCESS;
+		}
+	}
+	heap_remove(s, p);
+	return SUCCESS;
+}
+
+/** Moves a position onto a neighbour: the triangles of the edge die, the
+ * others take the target's welded vertices, and the ring is evaluated again.
+ * @returns SUCCESS or MEMORY_REFUSED.
+ */
+static int collapse(simplifier_t* s, uint32_t p, uint32_t target) {
+	uint32_t from[MAX_WEDGES], to[MAX_WEDGES], n = 0;
+	map_wedges(s, p, target, from, to, &n);
+	for (uint32_t i = 0; i < s->count[p]; i++) {
+		uint32_t t = s->pool[s->offset[p] + i];
+		if (!s->alive[t]) {
+			continue;
+		}
+		if (find_corner(s, t, target) < 3) {
+			s->alive[t] = 0;
+			s->num_alive--;
+			continue;
+		}
+		uint32_t* corner = s->corners + 3 * t + find_corner(s, t, p);
+		uint32_t k = 0;
+		while (from[k] != *corner) {
+			k++;
+		}
+		*corner = to[k];
+		if (append_triangle(s, target, t) != SUCCESS) {
+			return MEMORY_REFUSED;
+		}
+	}
+	quadric_add(s->quadrics + target, s->quadrics + p);
+	s->count[p] = 0;
+
+	uint32_t num_ring = find_neighbors(s, target);
+	if (num_ring == UINT32_MAX || array_reserve((void**)&s->ring,
+		&s->ring_cap, num_ring + 1, sizeof *s->ring) != SUCCESS) {
+		return MEMORY_REFUSED;
+	}
+	memcpy(s->ring, s->neighbors, num_ring * sizeof *s->ring);
+	s->ring[num_ring++] = target;
+	for (uint32_t i = 0; i < num_ring; i++) {
+		if (evaluate(s, s->ring[i], 0) != SUCCESS) {
+			return MEMORY_REFUSED;
+		}
+	}
+	return SUCCESS;
+}
+
+/** Collapses edges until at most the budget of triangles is left or no
+ * collapse is possible.
+ * @returns SUCCESS or MEMORY_REFUSED.
+ */
+static int simplify_to(simplifier_t* s, uint32_t budget) {
+	while (s->num_alive > budget && s->heap_size > 0) {
+		uint32_t p = s->heap[0];
+		uint32_t target = s->target[p];
+		int code;
+		if (!is_valid(s, p, target)) {
+			code = evaluate(s, p, 1);
+		} else {
+			if (s->cost[p] > s->max_error) {
+				s->max_error = s->cost[p];
+			}
+			heap_remove(s, p);
+			code = collapse(s, p, target);
+		}
+		if (code != SUCCESS) {
+			return code;
+		}
+	}
+	return SUCCESS;
+}
+
+static void free_simplifier(simplifier_t* s) {
+	free(s->corners);
+	free(s->alive);
+	free(s->points);
+	free(s->quadrics);
+	free(s->offset);
+	free(s->count);
+	free(s->capacity);
+	free(s->pool);
+	free(s->on_feature);
+	free(s->mark);
+	free(s->neighbors);
+	free(s->candidates);
+	free(s->ring);
+	free(s->cost);
+	free(s->target);
+	free(s->heap);
+	free(s->slot);
+	free((void*)s->wedge_position);
+	free((void*)s->material);
+}
+
+/** Builds the triangle lists, the quadrics of the triangles and of the
+ * feature edges, and the first heap.
+ * @returns SUCCESS or MEMORY_REFUSED.
+ */
+static int init_simplifier(simplifier_t* s,
+	const mesh_t* mesh,
+	const weld_t* weld) {
+	uint32_t num_triangles = mesh->num_faces;
+	uint32_t num_positions = mesh->num_vertices;
+	uint32_t* wedge_position = malloc((size_t)weld->num_vertices
+		* sizeof *wedge_position + 1);
+	const mtl_t** material = malloc((size_t)num_triangles
+		* sizeof *material + 1);
+	*s = (simplifier_t) {
+		.wedge_position = wedge_position,
+		.material = material,
+		.num_triangles = num_triangles,
+		.num_alive = num_triangles,
+		.num_positions = num_positions,
+		.pool_size = weld->num_indices,
+		.pool_cap = weld->num_indices
+	};
+	s->corners = malloc((size_t)weld->num_indices * sizeof *s->corners + 1);
+	s->alive = malloc((size_t)num_triangles + 1);
+	s->points = malloc((size_t)num_positions * 3 * sizeof *s->points + 1);
+	s->quadrics = calloc((size_t)num_positions + 1, sizeof *s->quadrics);
+	s->offset = calloc((size_t)num_positions + 1, sizeof *s->offset);
+	s->count = calloc((size_t)num_positions + 1, sizeof *s->count);
+	s->capacity = calloc((size_t)num_positions + 1, sizeof *s->capacity);
+	s->pool = malloc((size_t)weld->num_indices * sizeof *s->pool + 1);
+	s->cost = malloc((size_t)num_positions * sizeof *s->cost + 1);
+	s->target = malloc((size_t)num_positions * sizeof *s->target + 1);
+	s->heap = malloc((size_t)num_positions * sizeof *s->heap + 1);
+	s->slot = malloc((size_t)num_positions * sizeof *s->slot + 1);
+	s->on_feature = calloc((size_t)num_positions + 1, sizeof *s->on_feature);
+	s->mark = calloc((size_t)num_positions + 1, sizeof *s->mark);
+	if (!wedge_position || !material || !s->corners || !s->alive ||
+		!s->points || !s->quadrics || !s->offset || !s->count ||
+		!s->capacity || !s->pool || !s->cost || !s->target || !s->heap ||
+		!s->slot || !s->on_feature || !s->mark) {
+		return MEMORY_REFUSED;
+	}
+
+	memcpy(s->corners, weld->indices, (size_t)weld->num_indices
+		* sizeof *s->corners);
+	memset(s->alive, 1, num_triangles);
+	memset(s->slot, 0xFF, (size_t)num_positions * sizeof *s->slot);
+	for (uint32_t c = 0; c < weld->num_indices; c++) {
+		wedge_position[weld->indices[c]] = mesh->face_indices[c] - 1;
+	}
+	for (uint32_t t = 0; t < num_triangles; t++) {
+		material[t] = mesh->face_data ? mesh->face_data[t].material : NULL;
+	}
+	for (uint32_t p = 0; p < num_positions; p++) {
+		for (uint32_t k = 0; k < 3; k++) {
+			s->points[3 * p + k] = k < mesh->vertex_dim
+				? mesh->positions[(size_t)p * mesh->vertex_dim + k] : 0.0f;
+		}
+	}
+	for (uint32_t c = 0; c < weld->num_indices; c++) {
+		s->capacity[wedge_position[s->corners[c]]]++;
+	}
+	uint32_t sum = 0;
+	for (uint32_t p = 0; p < num_positions; p++) {
+		s->offset[p] = sum;
+		sum += s->capacity[p];
+	}
+	for (uint32_t c = 0; c < weld->num_indices; c++) {
+		uint32_t p = wedge_position[s->corners[c]];
+		s->pool[s->offset[p] + s->count[p]++] = c / 3;
+	}
+
+	for (uint32_t t = 0; t < num_triangles; t++) {
+		const float* p[3];
+		for (uint32_t j = 0; j < 3; j++) {
+			p[j] = s->points + 3 * (size_t)corner_position(s, t, j);
+		}
+		double n[3];
+		triangle_normal(p[0], p[1], p[2], n);
+		double length = sqrt(dot3(n, n));
+		if (length == 0.0) {
+			continue;
+		}
+		for (uint32_t k = 0; k < 3; k++) {
+			n[k] /= length;
+		}
+		double d = -(n[0] * p[0][0] + n[1] * p[0][1] + n[2] * p[0][2]);
+		for (uint32_t j = 0; j < 3; j++) {
+			quadric_t* q = s->quadrics + corner_position(s, t, j);
+			quadric_add_plane(q, n, d, 0.5 * length);
+			q->weight += 0.5 * length;
+		}
+		// A feature edge also keeps to the plane through it that stands
+		// upright on the triangle, so the feature keeps its shape.
+		for (uint32_t j = 0; j < 3; j++) {
+			uint32_t a = corner_position(s, t, j);
+			uint32_t b = corner_position(s, t, (j + 1) % 3);
+			if (!is_feature_edge(s, a, b)) {
+				continue;
+			}
+			s->on_feature[a] = s->on_feature[b] = 1;
+			double e[3], m[3];
+			for (uint32_t k = 0; k < 3; k++) {
+				e[k] = (double)p[(j + 1) % 3][k] - p[j][k];
+			}
+			cross3(e, n, m);
+			double edge = dot3(e, e);
+			double norm = sqrt(dot3(m, m));
+			if (norm == 0.0) {
+				continue;
+			}
+			for (uint32_t k = 0; k < 3; k++) {
+				m[k] /= norm;
+			}
+			double md = -(m[0] * p[j][0] + m[1] * p[j][1] + m[2] * p[j][2]);
+			quadric_add_plane(s->quadrics + a, m, md, FEATURE_WEIGHT * edge);
+			quadric_add_plane(s->quadrics + b, m, md, FEATURE_WEIGHT * edge);
+		}
+	}
+
+	for (uint32_t p = 0; p < num_positions; p++) {
+		if (s->count[p] > 0 && evaluate(s, p, 0) != SUCCESS) {
+			return MEMORY_REFUSED;
+		}
+	}
+	return SUCCESS;
+}
+
+/** Copies the live triangles into a level.
+ * @returns SUCCESS or MEMORY_REFUSED.
+ */
+static int write_level(const simplifier_t* s, lod_t* level) {
+	level->num_indices = 3 * s->num_alive;
+	level->indices = malloc((size_t)level->num_indices
+		* sizeof *level->indices + 1);
+	level->error = (float)sqrt(s->max_error);
+	if (!level->indices) {
+		return MEMORY_REFUSED;
+	}
+	uint32_t* out = level->indices;
+	for (uint32_t t = 0; t < s->num_triangles; t++) {
+		if (s->alive[t]) {
+			memcpy(out, s->corners + 3 * t, 3 * sizeof *out);
+			out += 3;
+		}
+	}
+	return SUCCESS;
+}
+
+// -----------------------------------------------------------------------------
+// Implementation
+// -----------------------------------------------------------------------------
+
+int
+simplify_lod_chain(const mesh_t* mesh,
+	const float* ratios,
+	uint32_t num_ratios,
+	lod_chain_t* chain) {
+	int code;
+	*chain = (lod_chain_t) {0};
+	if (!mesh->face_indices || mesh->num_corners != 3 * mesh->num_faces) {
+		return INVALID_DIMS;
+	}
+	for (uint32_t i = 0; i < num_ratios; i++) {
+		if (!(ratios[i] > 0.0f && ratios[i] <= 1.0f) ||
+			(i > 0 && ratios[i] > ratios[i - 1])) {
+			return INVALID_DIMS;
+		}
+	}
+	chain->levels = calloc((size_t)num_ratios + 1, sizeof *chain->levels);
+	if (!chain->levels) {
+		return MEMORY_REFUSED;
+	}
+	chain->num_levels = num_ratios;
+	if ((code = weld_mesh(mesh, &chain->weld)) != SUCCESS) {
+		lod_chain_destroy(chain);
+		return code;
+	}
+
+	simplifier_t state;
+	code = init_simplifier(&state, mesh, &chain->weld);
+	for (uint32_t i = 0; i < num_ratios && code == SUCCESS; i++) {
+		uint32_t budget = (uint32_t)((double)ratios[i] * mesh->num_faces);
+		if ((code = simplify_to(&state, budget)) == SUCCESS) {
+			code = write_level(&state, chain->levels + i);
+		}
+	}
+	free_simplifier(&state);
+	if (code != SUCCESS) {
+		lod_chain_destroy(chain);
+	}
+	return code;
+}
+
+void
+lod_chain_destroy(lod_chain_t* chain) {
+	for (uint32_t i = 0; i < chain->num_levels; i++) {
+		free(chain->levels[i].indices);
+	}
+	free(chain->levels);
+	weld_destroy(&chain->weld);
+	*chain = (lod_chain_t) {0};
+}
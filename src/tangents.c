@@ -0,0 +1,821 @@
+#include "tangents.h"
+#include "parallel.h"
+#include "defs.h"
+#include "utils.h"
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// -----------------------------------------------------------------------------
+// Static utility
+// -----------------------------------------------------------------------------
+
+/* The number of tasks per thread, so that uneven shares still balance. */
+#define TASKS_PER_THREAD 4
+
+/* No vertex, triangle or group. */
+#define NONE UINT32_MAX
+
+/* Triangle flags, named as in the reference. A degenerate triangle has two
+ * coinciding positions and takes no part until its corners copy a tangent.
+ * A triangle that may group with any has no usable texture frame of its own
+ * and takes the orientation of the first group to reach it. */
+#define DEGENERATE (1 << 0)
+#define ORIENT_PRESERVING (1 << 1)
+#define GROUP_WITH_ANY (1 << 2)
+
+/** @struct triangle_t
+ * @brief The texture frame of a triangle and its neighbours.
+ */
+typedef struct {
+	/** The unit directions of increasing s and t, flipped if the mapping
+	 * mirrors the triangle. Zero when undefined. */
+	float os[3];
+	float ot[3];
+	/** The triangle across edge i, from corner i to corner i + 1. */
+	uint32_t neighbors[3];
+	uint8_t flag;
+} triangle_t;
+
+/** @struct group_t
+ * @brief The triangles around one vertex that share its tangent, reachable
+ * from one another across edges and with the same orientation.
+ */
+typedef struct {
+	/** The corner that started the group; its vertex is the group's. */
+	uint32_t corner;
+	/** The group's triangles in members[first, first + count). */
+	uint32_t first;
+	uint32_t count;
+	uint8_t orient;
+} group_t;
+
+/** @struct edge_t
+ * @brief A triangle edge from a vertex to a later one, for pairing.
+ */
+typedef struct {
+	uint32_t other;
+	uint32_t triangle;
+	uint8_t edge;
+	/** Set if the edge runs from the vertex to other. */
+	uint8_t forward;
+} edge_t;
+
+/** @struct subgroup_t
+ * @brief The triangles one corner of a group averages over, and their
+ * tangent.
+ */
+typedef struct {
+	/** The first member whose mask of triangles this is. */
+	uint32_t member;
+	float tangent[3];
+} subgroup_t;
+
+/** State shared by the tasks of one tangents_generate call. */
+typedef struct {
+	const mesh_t* mesh;
+	uint32_t num_tasks;
+	uint32_t num_triangles;
+	/* The unit normal of every mesh normal. */
+	float* normals;
+	/* The vertex of every corner: corners with equal position, texture
+	 * coordinate and normal share one. */
+	uint32_t* vertices;
+	uint32_t num_vertices;
+	/* The hash of every corner's values, while numbering vertices. */
+	uint32_t* hashes;
+	/* The corners of every partition of the hashes. */
+	uint32_t* partitions;
+	triangle_t* triangles;
+	/* The corners of non-degenerate triangles around every vertex, in corner
+	 * order. */
+	uint32_t* vertex_offsets;
+	uint32_t* vertex_corners;
+	/* The group of every corner, or NONE. */
+	uint32_t* corner_groups;
+	group_t* groups;
+	uint32_t num_groups;
+	uint32_t* members;
+	/* Four floats per corner. */
+	float* tangents;
+	/* The result of every task. */
+	int* codes;
+} tangent_state_t;
+
+/** Gets the share of count items of a task.
+ */
+static void task_range(uint32_t count,
+	uint32_t task,
+	uint32_t num_tasks,
+	uint32_t* begin,
+	uint32_t* end) {
+	*begin = (uint32_t)((uint64_t)count * task / num_tasks);
+	*end = (uint32_t)((uint64_t)count * (task + 1) / num_tasks);
+}
+
+static inline const float* corner_position(const tangent_state_t* state,
+	uint32_t corner) {
+	const mesh_t* mesh = state->mesh;
+	return mesh->positions
+		+ (size_t)(mesh->face_indices[corner] - 1) * mesh->vertex_dim;
+}
+
+static inline const float* corner_texcoord(const tangent_state_t* state,
+	uint32_t corner) {
+	const mesh_t* mesh = state->mesh;
+	return mesh->texcoords
+		+ (size_t)(mesh->face_texs[corner] - 1) * mesh->tex_dim;
+}
+
+static inline const float* corner_normal(const tangent_state_t* state,
+	uint32_t corner) {
+	return state->normals + (size_t)(state->mesh->face_norms[corner] - 1) * 3;
+}
+
+static inline int not_zero(float x) {
+	return fabsf(x) > FLT_MIN;
+}
+
+static inline float dot3(const float* a, const float* b) {
+	return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+/** Scales a vector to unit length unless it is zero.
+ */
+static void normalize3(float* v) {
+	if (not_zero(v[0]) || not_zero(v[1]) || not_zero(v[2])) {
+		float inv = 1.0f / sqrtf(dot3(v, v));
+		v[0] *= inv;
+		v[1] *= inv;
+		v[2] *= inv;
+	}
+}
+
+/** Projects a vector onto the plane of a unit normal and normalizes it.
+ */
+static void project(const float* n, const float* v, float* out) {
+	float d = dot3(n, v);
+	for (uint32_t k = 0; k < 3; k++) {
+		out[k] = v[k] - d * n[k];
+	}
+	normalize3(out);
+}
+
+/** The bits of a float that hash equal floats alike, zeros of either sign
+ * included. */
+static inline uint32_t float_bits(float x) {
+	uint32_t bits = 0;
+	if (x != 0.0f) {
+		memcpy(&bits, &x, sizeof bits);
+	}
+	return bits;
+}
+
+/** Gathers the position, texture coordinate and raw normal of a corner.
+ */
+static void corner_key(const tangent_state_t* state,
+	uint32_t corner,
+	float key[8]) {
+	const mesh_t* mesh = state->mesh;
+	const float* p = corner_position(state, corner);
+	const float* t = corner_texcoord(state, corner);
+	const float* n = mesh->normals
+		+ (size_t)(mesh->face_norms[corner] - 1) * mesh->vertex_dim;
+	memcpy(key, p, 3 * sizeof *key);
+	memcpy(key + 3, t, 2 * sizeof *key);
+	memcpy(key + 5, n, 3 * sizeof *key);
+}
+
+/** Runs the tasks of one phase.
+ * @returns The first failure of a task, or SUCCESS.
+ */
+static int run_tasks(tangent_state_t* state,
+	uint32_t num_threads,
+	parallel_task_t task) {
+	parallel_for(state->num_tasks, num_threads, task, state);
+	for (uint32_t t = 0; t < state->num_tasks; t++) {
+		if (state->codes[t] != SUCCESS) {
+			return state->codes[t];
+		}
+	}
+	return SUCCESS;
+}
+
+/** Checks whether two corners have equal values, which they do without
+ * looking if they share all three indices.
+ */
+static int same_values(const tangent_state_t* state, uint32_t a, uint32_t b) {
+	const mesh_t* mesh = state->mesh;
+	if (mesh->face_indices[a] == mesh->face_indices[b] &&
+		mesh->face_texs[a] == mesh->face_texs[b] &&
+		mesh->face_norms[a] == mesh->face_norms[b]) {
+		return 1;
+	}
+	float key[8], other[8];
+	corner_key(state, a, key);
+	corner_key(state, b, other);
+	uint32_t k = 0;
+	while (k < 8 && key[k] == other[k]) {
+		k++;
+	}
+	return k == 8;
+}
+
+/** Hashes the values of a corner.
+ */
+static uint32_t hash_corner(const tangent_state_t* state, uint32_t corner) {
+	float key[8];
+	corner_key(state, corner, key);
+	uint64_t h = 0;
+	for (uint32_t k = 0; k < 8; k++) {
+		h = (h ^ float_bits(key[k])) * 0x9E3779B97F4A7C15u;
+		h ^= h >> 29;
+	}
+	return (uint32_t)(h >> 32);
+}
+
+/** The share of the corners with a hash, by its high bits.
+ */
+static inline uint32_t hash_partition(uint32_t hash, uint32_t num_tasks) {
+	return (uint32_t)(((uint64_t)hash * num_tasks) >> 32);
+}
+
+/** Worker that hashes a share of the corners.
+ * @param ctx The tangent_state_t.
+ * @param task The index of the share.
+ */
+static void hash_corners(void* ctx, uint32_t task) {
+	tangent_state_t* state = ctx;
+	uint32_t begin, end;
+	task_range(state->num_triangles * 3, task, state->num_tasks, &begin, 
+		&end);
+	for (uint32_t c = begin; c < end; c++) {
+		state->hashes[c] = hash_corner(state, c);
+	}
+}
+
+/** Worker that matches the corners of one partition of the hashes, in
+ * corner order, to the first corner with the same values. Equal values hash
+ * alike, so no match crosses partitions.
+ * @param ctx The tangent_state_t.
+ * @param task The index of the partition.
+ */
+static void match_corners(void* ctx, uint32_t task) {
+	tangent_state_t* state = ctx;
+	const uint32_t* order = state->vertex_corners;
+	uint32_t begin = state->partitions[task];
+	uint32_t end = state->partitions[task + 1];
+	uint32_t capacity = 16;
+	while (capacity < (end - begin) * 2u && capacity < (1u << 31)) {
+		capacity <<= 1;
+	}
+	// Every slot holds the first corner of its vertex.
+	uint32_t* table = malloc((size_t)capacity * sizeof *table);
+	if (!table) {
+		state->codes[task] = MEMORY_REFUSED;
+		return;
+	}
+	state->codes[task] = SUCCESS;
+	for (uint32_t i = 0; i < capacity; i++) {
+		table[i] = NONE;
+	}
+	for (uint32_t i = begin; i < end; i++) {
+		uint32_t c = order[i];
+		uint32_t h = state->hashes[c];
+		uint32_t slot = h & (capacity - 1);
+		for (;; slot = (slot + 1) & (capacity - 1)) {
+			uint32_t first = table[slot];
+			if (first == NONE) {
+				table[slot] = state->vertices[c] = c;
+				break;
+			}
+			if (state->hashes[first] == h && same_values(state, c, first)) {
+				state->vertices[c] = first;
+				break;
+			}
+		}
+	}
+	free(table);
+}
+
+/** Numbers the vertices: corners with equal values share one, as in the
+ * reference, even when the file indexes them separately. The corners are
+ * hashed across threads and split by hash, so every thread matches its own
+ * share in a table of its own; vertices are then numbered in the order of
+ * their first corners.
+ * @param state The state, with vertices allocated. Borrows corner_groups for
+ * the hashes and vertex_corners for the partitions.
+ * @param num_threads The number of threads to use.
+ * @returns SUCCESS or MEMORY_REFUSED.
+ */
+static int number_vertices(tangent_state_t* state, uint32_t num_threads) {
+	uint32_t corners = state->num_triangles * 3;
+	uint32_t num_tasks = state->num_tasks;
+	state->hashes = state->corner_groups;
+	parallel_for(num_tasks, num_threads, hash_corners, state);
+	uint32_t* partitions = state->partitions;
+	memset(partitions, 0, ((size_t)num_tasks + 1) * sizeof *partitions);
+	for (uint32_t c = 0; c < corners; c++) {
+		partitions[hash_partition(state->hashes[c], num_tasks) + 1]++;
+	}
+	for (uint32_t t = 0; t < num_tasks; t++) {
+		partitions[t + 1] += partitions[t];
+	}
+	for (uint32_t c = 0; c < corners; c++) {
+		uint32_t t = hash_partition(state->hashes[c], num_tasks);
+		state->vertex_corners[partitions[t]++] = c;
+	}
+	// partitions[t] is now where t + 1 starts.
+	memmove(partitions + 1, partitions, num_tasks * sizeof *partitions);
+	partitions[0] = 0;
+	int code = run_tasks(state, num_threads, match_corners);
+	if (code != SUCCESS) {
+		return code;
+	}
+	// A first corner comes before the others of its vertex.
+	state->num_vertices = 0;
+	for (uint32_t c = 0; c < corners; c++) {
+		uint32_t first = state->vertices[c];
+		state->vertices[c] = first == c 
+			? state->num_vertices++ : state->vertices[first];
+	}
+	return SUCCESS;
+}
+
+/** Worker that computes the texture frames of a share of the triangles.
+ * @param ctx The tangent_state_t.
+ * @param task The index of the share.
+ */
+static void init_triangles(void* ctx, uint32_t task) {
+	tangent_state_t* state = ctx;
+	uint32_t begin, end;
+	task_range(state->num_triangles, task, state->num_tasks, &begin, &end);
+	for (uint32_t f = begin; f < end; f++) {
+		triangle_t* tri = &state->triangles[f];
+		*tri = (triangle_t) {
+			.neighbors = { NONE, NONE, NONE }, .flag = GROUP_WITH_ANY
+		};
+		const float* v1 = corner_position(state, 3 * f);
+		const float* v2 = corner_position(state, 3 * f + 1);
+		const float* v3 = corner_position(state, 3 * f + 2);
+		if ((v1[0] == v2[0] && v1[1] == v2[1] && v1[2] == v2[2]) ||
+			(v1[0] == v3[0] && v1[1] == v3[1] && v1[2] == v3[2]) ||
+			(v2[0] == v3[0] && v2[1] == v3[1] && v2[2] == v3[2])) {
+			tri->flag = DEGENERATE;
+			continue;
+		}
+		const float* t1 = corner_texcoord(state, 3 * f);
+		const float* t2 = corner_texcoord(state, 3 * f + 1);
+		const float* t3 = corner_texcoord(state, 3 * f + 2);
+		float t21x = t2[0] - t1[0], t21y = t2[1] - t1[1];
+		float t31x = t3[0] - t1[0], t31y = t3[1] - t1[1];
+		float area = t21x * t31y - t21y * t31x;
+		float os[3], ot[3];
+		for (uint32_t k = 0; k < 3; k++) {
+			float d1 = v2[k] - v1[k];
+			float d2 = v3[k] - v1[k];
+			os[k] = t31y * d1 - t21y * d2;
+			ot[k] = -t31x * d1 + t21x * d2;
+		}
+		if (area > 0.0f) {
+			tri->flag |= ORIENT_PRESERVING;
+		}
+		if (!not_zero(area)) {
+			continue;
+		}
+		float length_s = sqrtf(dot3(os, os));
+		float length_t = sqrtf(dot3(ot, ot));
+		float sign = tri->flag & ORIENT_PRESERVING ? 1.0f : -1.0f;
+		for (uint32_t k = 0; k < 3 && not_zero(length_s); k++) {
+			tri->os[k] = sign / length_s * os[k];
+		}
+		for (uint32_t k = 0; k < 3 && not_zero(length_t); k++) {
+			tri->ot[k] = sign / length_t * ot[k];
+		}
+		if (not_zero(length_s / fabsf(area)) &&
+			not_zero(length_t / fabsf(area))) {
+			tri->flag &= ~GROUP_WITH_ANY;
+		}
+	}
+}
+
+/** Lists the corners of the non-degenerate triangles around every vertex.
+ * @param state The state, with its arrays allocated.
+ */
+static void link_vertices(tangent_state_t* state) {
+	uint32_t* offsets = state->vertex_offsets;
+	uint32_t corners = state->num_triangles * 3;
+	memset(offsets, 0, ((size_t)state->num_vertices + 1) * sizeof *offsets);
+	for (uint32_t c = 0; c < corners; c++) {
+		if (!(state->triangles[c / 3].flag & DEGENERATE)) {
+			offsets[state->vertices[c]]++;
+		}
+	}
+	for (uint32_t v = 0; v < state->num_vertices; v++) {
+		offsets[v + 1] += offsets[v];
+	}
+	// offsets[v] is now one past the corners of v; fill them back to front.
+	for (uint32_t c = corners; c-- > 0;) {
+		if (!(state->triangles[c / 3].flag & DEGENERATE)) {
+			state->vertex_corners[--offsets[state->vertices[c]]] = c;
+		}
+	}
+}
+
+/** Sorts the edges around a vertex by their other vertex, then triangle. 
+ * There are few, so insertion sort beats qsort's calls.
+ */
+static void sort_edges(edge_t* edges, uint32_t count) {
+	for (uint32_t i = 1; i < count; i++) {
+		edge_t edge = edges[i];
+		uint32_t j = i;
+		while (j > 0 && (edges[j - 1].other > edge.other ||
+			(edges[j - 1].other == edge.other &&
+			edges[j - 1].triangle > edge.triangle))) {
+			edges[j] = edges[j - 1];
+			j--;
+		}
+		edges[j] = edge;
+	}
+}
+
+/** Worker that pairs the edges from a share of the vertices to later ones.
+ * Like the reference, an edge pairs with the first unpaired edge of a later
+ * triangle that runs the other way between the same vertices, which settles
+ * edges shared by more than two triangles.
+ * @param ctx The tangent_state_t.
+ * @param task The index of the share.
+ */
+static void pair_edges(void* ctx, uint32_t task) {
+	tangent_state_t* state = ctx;
+	triangle_t* triangles = state->triangles;
+	edge_t* edges = NULL;
+	uint32_t capacity = 0;
+	uint32_t first, last;
+	task_range(state->num_vertices, task, state->num_tasks, &first, &last);
+	state->codes[task] = SUCCESS;
+	for (uint32_t v = first; v < last; v++) {
+		uint32_t begin = state->vertex_offsets[v];
+		uint32_t end = state->vertex_offsets[v + 1];
+		if (array_reserve((void**)&edges, &capacity, 2 * (end - begin) + 1,
+			sizeof *edges) != SUCCESS) {
+			state->codes[task] = MEMORY_REFUSED;
+			break;
+		}
+		uint32_t count = 0;
+		for (uint32_t i = begin; i < end; i++) {
+			uint32_t corner = state->vertex_corners[i];
+			uint32_t f = corner / 3, j = corner % 3;
+			uint32_t next = state->vertices[3 * f + (j + 1) % 3];
+			uint32_t prev = state->vertices[3 * f + (j + 2) % 3];
+			if (next > v) {
+				edges[count++] = (edge_t) { next, f, (uint8_t)j, 1 };
+			}
+			if (prev > v) {
+				edges[count++] = (edge_t) { prev, f, (uint8_t)((j + 2) % 3),
+					0 };
+			}
+		}
+		sort_edges(edges, count);
+		for (uint32_t a = 0; a < count; a++) {
+			const edge_t* ea = &edges[a];
+			if (triangles[ea->triangle].neighbors[ea->edge] != NONE) {
+				continue;
+			}
+			for (uint32_t b = a + 1; b < count && edges[b].other == ea->other;
+				b++) {
+				const edge_t* eb = &edges[b];
+				if (eb->forward != ea->forward &&
+					triangles[eb->triangle].neighbors[eb->edge] == NONE) {
+					triangles[ea->triangle].neighbors[ea->edge] = eb->triangle;
+					triangles[eb->triangle].neighbors[eb->edge] = ea->triangle;
+					break;
+				}
+			}
+		}
+	}
+	free(edges);
+}
+
+/** Groups the triangles around every vertex, in triangle order. A group
+ * grows depth first across the two edges at its vertex, left then right,
+ * exactly as the reference recurses: the first group to reach a triangle
+ * that may group with any decides its orientation.
+ * @param state The state, with its arrays allocated.
+ * @returns SUCCESS or MEMORY_REFUSED.
+ */
+static int build_groups(tangent_state_t* state) {
+	triangle_t* triangles = state->triangles;
+	uint32_t* stack = NULL;
+	uint32_t stack_cap = 0;
+	uint32_t offset = 0;
+	for (uint32_t f = 0; f < state->num_triangles; f++) {
+		for (uint32_t i = 0; i < 3; i++) {
+			if (triangles[f].flag & (DEGENERATE | GROUP_WITH_ANY) ||
+				state->corner_groups[3 * f + i] != NONE) {
+				continue;
+			}
+			uint32_t g = state->num_groups++;
+			group_t* group = &state->groups[g];
+			*group = (group_t) { .corner = 3 * f + i, .first = offset,
+				.orient = (triangles[f].flag & ORIENT_PRESERVING) != 0 };
+			uint32_t vertex = state->vertices[3 * f + i];
+			state->members[offset + group->count++] = f;
+			state->corner_groups[3 * f + i] = g;
+			uint32_t size = 0;
+			if (array_reserve((void**)&stack, &stack_cap, 2, sizeof *stack)
+				!= SUCCESS) {
+				free(stack);
+				return MEMORY_REFUSED;
+			}
+			// Pushed right first, so the left is walked first.
+			stack[size++] = triangles[f].neighbors[(i + 2) % 3];
+			stack[size++] = triangles[f].neighbors[i];
+			while (size > 0) {
+				uint32_t t = stack[--size];
+				if (t == NONE) {
+					continue;
+				}
+				triangle_t* tri = &triangles[t];
+				uint32_t j = 0;
+				while (state->vertices[3 * t + j] != vertex) {
+					j++;
+				}
+				if (state->corner_groups[3 * t + j] != NONE) {
+					continue;
+				}
+				if (tri->flag & GROUP_WITH_ANY &&
+					state->corner_groups[3 * t] == NONE &&
+					state->corner_groups[3 * t + 1] == NONE &&
+					state->corner_groups[3 * t + 2] == NONE) {
+					tri->flag = (uint8_t)((tri->flag & ~ORIENT_PRESERVING) |
+						(group->orient ? ORIENT_PRESERVING : 0));
+				}
+				if (((tri->flag & ORIENT_PRESERVING) != 0) != group->orient) {
+					continue;
+				}
+				state->members[offset + group->count++] = t;
+				state->corner_groups[3 * t + j] = g;
+				if (array_reserve((void**)&stack, &stack_cap, size + 2,
+					sizeof *stack) != SUCCESS) {
+					free(stack);
+					return MEMORY_REFUSED;
+				}
+				stack[size++] = tri->neighbors[(j + 2) % 3];
+				stack[size++] = tri->neighbors[j];
+			}
+			offset += group->count;
+		}
+	}
+	free(stack);
+	return SUCCESS;
+}
+
+/** Averages the tangents of a subgroup's triangles at a vertex, weighting
+ * each by its angle there after projecting both onto the normal's plane.
+ * @param state The state.
+ * @param members The group's triangles, in ascending order.
+ * @param frames The projected frame of every member, s then t.
+ * @param mask One bit per member, set for the subgroup's.
+ * @param count The number of members.
+ * @param vertex The vertex.
+ * @param n The vertex's unit normal.
+ * @param out Output tangent.
+ */
+static void eval_tangent(const tangent_state_t* state,
+	const uint32_t* members,
+	const float* frames,
+	const uint64_t* mask,
+	uint32_t count,
+	uint32_t vertex,
+	const float* n,
+	float* out) {
+	out[0] = out[1] = out[2] = 0.0f;
+	for (uint32_t m = 0; m < count; m++) {
+		if (!(mask[m / 64] >> (m % 64) & 1)) {
+			continue;
+		}
+		uint32_t f = members[m];
+		const triangle_t* tri = &state->triangles[f];
+		if (tri->flag & GROUP_WITH_ANY) {
+			continue;
+		}
+		uint32_t i = 0;
+		while (state->vertices[3 * f + i] != vertex) {
+			i++;
+		}
+		const float* os = frames + 6 * m;
+		float v1[3], v2[3], e1[3], e2[3];
+		const float* p0 = corner_position(state, 3 * f + (i + 2) % 3);
+		const float* p1 = corner_position(state, 3 * f + i);
+		const float* p2 = corner_position(state, 3 * f + (i + 1) % 3);
+		for (uint32_t k = 0; k < 3; k++) {
+			e1[k] = p0[k] - p1[k];
+			e2[k] = p2[k] - p1[k];
+		}
+		project(n, e1, v1);
+		project(n, e2, v2);
+		float cosine = dot3(v1, v2);
+		cosine = cosine > 1.0f ? 1.0f : (cosine < -1.0f ? -1.0f : cosine);
+		float angle = (float)acos(cosine);
+		for (uint32_t k = 0; k < 3; k++) {
+			out[k] += angle * os[k];
+		}
+	}
+	normalize3(out);
+}
+
+/** Sorts the members of a group, by insertion as there are few.
+ */
+static void sort_members(uint32_t* members, uint32_t count) {
+	for (uint32_t i = 1; i < count; i++) {
+		uint32_t member = members[i];
+		uint32_t j = i;
+		while (j > 0 && members[j - 1] > member) {
+			members[j] = members[j - 1];
+			j--;
+		}
+		members[j] = member;
+	}
+}
+
+/** Worker that computes the tangents of a share of the groups. Within a
+ * group, a corner averages over the triangles whose projected frames are not
+ * exactly opposite its own, which with the default threshold is all of them
+ * but for degenerate mappings. The triangles of every corner are a bit mask
+ * over the sorted members, so equal subgroups are found by comparing masks.
+ * @param ctx The tangent_state_t.
+ * @param task The index of the share.
+ */
+static void group_tangents(void* ctx, uint32_t task) {
+	tangent_state_t* state = ctx;
+	uint64_t* masks = NULL;
+	subgroup_t* subgroups = NULL;
+	float* frames = NULL;
+	uint32_t masks_cap = 0, subgroups_cap = 0, frames_cap = 0;
+	uint32_t first, last;
+	task_range(state->num_groups, task, state->num_tasks, &first, &last);
+	state->codes[task] = SUCCESS;
+	for (uint32_t g = first; g < last; g++) {
+		const group_t* group = &state->groups[g];
+		uint32_t* members = state->members + group->first;
+		uint32_t count = group->count;
+		uint32_t words = (count + 63) / 64;
+		uint32_t vertex = state->vertices[group->corner];
+		const float* n = corner_normal(state, group->corner);
+		if (array_reserve((void**)&frames, &frames_cap, 6 * count,
+			sizeof *frames) != SUCCESS ||
+			array_reserve((void**)&subgroups, &subgroups_cap, count,
+			sizeof *subgroups) != SUCCESS ||
+			array_reserve((void**)&masks, &masks_cap, count * words,
+			sizeof *masks) != SUCCESS) {
+			state->codes[task] = MEMORY_REFUSED;
+			break;
+		}
+		sort_members(members, count);
+		for (uint32_t m = 0; m < count; m++) {
+			project(n, state->triangles[members[m]].os, frames + 6 * m);
+			project(n, state->triangles[members[m]].ot, frames + 6 * m + 3);
+		}
+		memset(masks, 0, (size_t)count * words * sizeof *masks);
+		for (uint32_t a = 0; a < count; a++) {
+			uint64_t* mask_a = masks + (size_t)a * words;
+			mask_a[a / 64] |= (uint64_t)1 << (a % 64);
+			for (uint32_t b = a + 1; b < count; b++) {
+				int any = ((state->triangles[members[a]].flag |
+					state->triangles[members[b]].flag) & GROUP_WITH_ANY) != 0;
+				if (any ||
+					(dot3(frames + 6 * a, frames + 6 * b) > -1.0f &&
+					dot3(frames + 6 * a + 3, frames + 6 * b + 3) > -1.0f)) {
+					mask_a[b / 64] |= (uint64_t)1 << (b % 64);
+					masks[(size_t)b * words + a / 64] |= 
+						(uint64_t)1 << (a % 64);
+				}
+			}
+		}
+		uint32_t num_subgroups = 0;
+		for (uint32_t a = 0; a < count; a++) {
+			const uint64_t* mask = masks + (size_t)a * words;
+			uint32_t s = 0;
+			while (s < num_subgroups && memcmp(masks + (size_t)subgroups[s]
+				.member * words, mask, words * sizeof *mask) != 0) {
+				s++;
+			}
+			if (s == num_subgroups) {
+				subgroups[s].member = a;
+				eval_tangent(state, members, frames, mask, count, vertex, n,
+					subgroups[s].tangent);
+				num_subgroups++;
+			}
+			uint32_t f = members[a];
+			uint32_t i = 0;
+			while (state->corner_groups[3 * f + i] != g) {
+				i++;
+			}
+			float* out = state->tangents + 4 * (size_t)(3 * f + i);
+			memcpy(out, subgroups[s].tangent, 3 * sizeof *out);
+			out[3] = group->orient ? 1.0f : -1.0f;
+		}
+	}
+	free(masks);
+	free(subgroups);
+	free(frames);
+}
+
+// -----------------------------------------------------------------------------
+// Implementation
+// -----------------------------------------------------------------------------
+int
+tangents_generate(mesh_t* mesh, uint32_t num_threads) {
+	if (!mesh->face_texs || !mesh->face_norms) {
+		return NOT_FOUND;
+	}
+	if (mesh->vertex_dim < 3 || mesh->tex_dim < 2 ||
+		mesh->num_corners != mesh->num_faces * 3 ||
+		(mesh->num_faces && mesh->face_dim != 3)) {
+		return INVALID_DIMS;
+	}
+	if (num_threads == 0) {
+		num_threads = parallel_threads();
+	}
+	tangent_state_t state = {
+		.mesh = mesh,
+		.num_tasks = num_threads * TASKS_PER_THREAD,
+		.num_triangles = mesh->num_faces
+	};
+	size_t corners = mesh->num_corners;
+	state.normals = malloc((size_t)mesh->num_normals * 3 * sizeof(float) + 1);
+	state.vertices = malloc(corners * sizeof *state.vertices + 1);
+	state.triangles = malloc((size_t)mesh->num_faces
+		* sizeof *state.triangles + 1);
+	state.vertex_corners = malloc(corners * sizeof *state.vertex_corners + 1);
+	state.corner_groups = malloc(corners * sizeof *state.corner_groups + 1);
+	state.groups = malloc(corners * sizeof *state.groups + 1);
+	state.members = malloc(corners * sizeof *state.members + 1);
+	state.tangents = malloc(corners * 4 * sizeof *state.tangents + 1);
+	state.codes = calloc(state.num_tasks, sizeof *state.codes);
+	state.partitions = malloc(((size_t)state.num_tasks + 1) 
+		* sizeof *state.partitions);
+	int code = SUCCESS;
+	if (!state.normals || !state.vertices || !state.triangles ||
+		!state.vertex_corners || !state.corner_groups || !state.groups ||
+		!state.members || !state.tangents || !state.codes || 
+		!state.partitions) {
+		code = MEMORY_REFUSED;
+	}
+
+	if (code == SUCCESS) {
+		for (uint32_t i = 0; i < mesh->num_normals; i++) {
+			memcpy(state.normals + 3 * (size_t)i, mesh->normals
+				+ (size_t)i * mesh->vertex_dim, 3 * sizeof(float));
+			normalize3(state.normals + 3 * (size_t)i);
+		}
+		code = number_vertices(&state, num_threads);
+	}
+	for (size_t c = 0; code == SUCCESS && c < corners; c++) {
+		float* out = state.tangents + 4 * c;
+		out[0] = out[3] = 1.0f;
+		out[1] = out[2] = 0.0f;
+		state.corner_groups[c] = NONE;
+	}
+	if (code == SUCCESS && !(state.vertex_offsets = malloc(
+		((size_t)state.num_vertices + 1) * sizeof *state.vertex_offsets))) {
+		code = MEMORY_REFUSED;
+	}
+	if (code == SUCCESS) {
+		parallel_for(state.num_tasks, num_threads, init_triangles, &state);
+		link_vertices(&state);
+		code = run_tasks(&state, num_threads, pair_edges);
+	}
+	if (code == SUCCESS && (code = build_groups(&state)) == SUCCESS) {
+		code = run_tasks(&state, num_threads, group_tangents);
+	}
+	if (code == SUCCESS) {
+		// Degenerate triangles copy from the first good corner of a vertex.
+		for (size_t c = 0; c < corners; c++) {
+			uint32_t v = state.vertices[c];
+			if (state.triangles[c / 3].flag & DEGENERATE &&
+				state.vertex_offsets[v] < state.vertex_offsets[v + 1]) {
+				memcpy(state.tangents + 4 * c, state.tangents + 4
+					* (size_t)state.vertex_corners[state.vertex_offsets[v]],
+					4 * sizeof *state.tangents);
+			}
+		}
+		free(mesh->tangents);
+		mesh->tangents = state.tangents;
+	} else {
+		free(state.tangents);
+	}
+	free(state.normals);
+	free(state.vertices);
+	free(state.triangles);
+	free(state.vertex_offsets);
+	free(state.vertex_corners);
+	free(state.corner_groups);
+	free(state.groups);
+	free(state.members);
+	free(state.codes);
+	free(state.partitions);
+	return code;
+}
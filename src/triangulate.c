@@ -0,0 +1,213 @@
+#include "triangulate.h"
+#include "defs.h"
+#include "utils.h"
+#include <math.h>
+#include <stdlib.h>
+
+// -----------------------------------------------------------------------------
+// Static utility
+// -----------------------------------------------------------------------------
+
+/** Twice the signed area of the 2D triangle (a, b, c); positive when it winds
+ * counter-clockwise.
+ */
+static inline float cross2(const float* a, const float* b, const float* c) {
+	return (b[0] - a[0]) * (c[1] - a[1]) - (b[1] - a[1]) * (c[0] - a[0]);
+}
+
+/** Makes room for a polygon of the given size.
+ * @returns SUCCESS or MEMORY_REFUSED.
+ */
+static int reserve(triangulator_t* t, uint32_t size) {
+	if (size <= t->capacity) {
+		return SUCCESS;
+	}
+	uint32_t capacity = t->capacity ? t->capacity : 8;
+	while (capacity < size) {
+		capacity *= 2;
+	}
+	uint32_t* triangles = realloc(t->triangles,
+		(size_t)capacity * 3 * sizeof *triangles);
+	if (!triangles) {
+		return MEMORY_REFUSED;
+	}
+	t->triangles = triangles;
+	float* points = realloc(t->points, (size_t)capacity * 2 * sizeof *points);
+	if (!points) {
+		return MEMORY_REFUSED;
+	}
+	t->points = points;
+	uint32_t* prev = realloc(t->prev, (size_t)capacity * sizeof *prev);
+	if (!prev) {
+		return MEMORY_REFUSED;
+	}
+	t->prev = prev;
+	uint32_t* next = realloc(t->next, (size_t)capacity * sizeof *next);
+	if (!next) {
+		return MEMORY_REFUSED;
+	}
+	t->next = next;
+	t->capacity = capacity;
+	return SUCCESS;
+}
+
+/** Projects the corners onto the coordinate plane most parallel to the 
+ * polygon, using its Newell normal.
+ * @returns 1.0f if the projected polygon winds counter-clockwise, -1.0f
+ * otherwise.
+ */
+static float project(triangulator_t* t, 
+	const float* positions, 
+	uint32_t dim, 
+	const uint32_t* indices, 
+	uint32_t size) {
+	float normal[3] = {0.0f, 0.0f, 0.0f};
+	for (uint32_t i = 0; i < size; i++) {
+		const float* a = positions + (size_t)(indices[i] - 1) * dim;
+		const float* b = positions + 
+			(size_t)(indices[(i + 1) % size] - 1) * dim;
+		float az = dim > 2 ? a[2] : 0.0f;
+		float bz = dim > 2 ? b[2] : 0.0f;
+		normal[0] += (a[1] - b[1]) * (az + bz);
+		normal[1] += (az - bz) * (a[0] + b[0]);
+		normal[2] += (a[0] - b[0]) * (a[1] + b[1]);
+	}
+	// Drop the axis the normal is largest along.
+	uint32_t drop = 2;
+	if (fabsf(normal[0]) > fabsf(normal[1]) && 
+		fabsf(normal[0]) > fabsf(normal[2])) {
+		drop = 0;
+	} else if (fabsf(normal[1]) > fabsf(normal[2])) {
+		drop = 1;
+	}
+	uint32_t u = drop == 0 ? 1 : 0;
+	uint32_t v = drop == 2 ? 1 : 2;
+	float area = 0.0f;
+	for (uint32_t i = 0; i < size; i++) {
+		const float* p = positions + (size_t)(indices[i] - 1) * dim;
+		t->points[2 * i] = p[u];
+		t->points[2 * i + 1] = v < dim ? p[v] : 0.0f;
+	}
+	for (uint32_t i = 0; i < size; i++) {
+		const float* a = t->points + 2 * i;
+		const float* b = t->points + 2 * ((i + 1) % size);
+		area += a[0] * b[1] - b[0] * a[1];
+	}
+	return area < 0.0f ? -1.0f : 1.0f;
+}
+
+/** Determines if every corner of the projected polygon turns the same way.
+ */
+static int is_convex(const triangulator_t* t, uint32_t size, float winding) {
+	for (uint32_t i = 0; i < size; i++) {
+		const float* a = t->points + 2 * ((i + size - 1) % size);
+		const float* b = t->points + 2 * i;
+		const float* c = t->points + 2 * ((i + 1) % size);
+		if (cross2(a, b, c) * winding < 0.0f) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/** Determines if corner b of the remaining ring is an ear: it turns the same
+ * way as the polygon and no other remaining corner lies in its triangle.
+ */
+static int is_ear(const triangulator_t* t, 
+	uint32_t a, 
+	uint32_t b, 
+	uint32_t c,
+	float winding) {
+	const float* pa = t->points + 2 * a;
+	const float* pb = t->points + 2 * b;
+	const float* pc = t->points + 2 * c;
+	if (cross2(pa, pb, pc) * winding <= 0.0f) {
+		return 0;
+	}
+	for (uint32_t i = t->next[c]; i != a; i = t->next[i]) {
+		const float* p = t->points + 2 * i;
+		if ((p[0] == pa[0] && p[1] == pa[1]) || 
+			(p[0] == pb[0] && p[1] == pb[1]) ||
+			(p[0] == pc[0] && p[1] == pc[1])) {
+			continue;
+		}
+		if (cross2(pa, pb, p) * winding >= 0.0f && 
+			cross2(pb, pc, p) * winding >= 0.0f &&
+			cross2(pc, pa, p) * winding >= 0.0f) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+// -----------------------------------------------------------------------------
+// Implementation
+// -----------------------------------------------------------------------------
+
+void
+triangulator_init(triangulator_t* triangulator) {
+	*triangulator = (triangulator_t) {0};
+}
+
+void
+triangulator_destroy(triangulator_t* triangulator) {
+	free(triangulator->triangles);
+	free(triangulator->points);
+	free(triangulator->prev);
+	free(triangulator->next);
+	*triangulator = (triangulator_t) {0};
+}
+
+int
+triangulate_polygon(triangulator_t* triangulator,
+	const float* positions,
+	uint32_t dim,
+	const uint32_t* indices,
+	uint32_t size) {
+	triangulator_t* t = triangulator;
+	if (reserve(t, size) != SUCCESS) {
+		return MEMORY_REFUSED;
+	}
+	uint32_t* out = t->triangles;
+	float winding = size > 3 
+		? project(t, positions, dim, indices, size) : 1.0f;
+	if (size == 3 || is_convex(t, size, winding)) {
+		for (uint32_t i = 1; i + 1 < size; i++) {
+			*out++ = 0;
+			*out++ = i;
+			*out++ = i + 1;
+		}
+		return SUCCESS;
+	}
+
+	for (uint32_t i = 0; i < size; i++) {
+		t->prev[i] = (i + size - 1) % size;
+		t->next[i] = (i + 1) % size;
+	}
+	uint32_t remaining = size;
+	uint32_t corner = 0;
+	// The number of corners tried since the last ear was clipped.
+	uint32_t misses = 0;
+	while (remaining > 3) {
+		uint32_t a = t->prev[corner];
+		uint32_t c = t->next[corner];
+		// A degenerate polygon may have no ear left; clip anyway.
+		if (misses >= remaining || is_ear(t, a, corner, c, winding)) {
+			*out++ = a;
+			*out++ = corner;
+			*out++ = c;
+			t->next[a] = c;
+			t->prev[c] = a;
+			remaining--;
+			misses = 0;
+			corner = a;
+		} else {
+			misses++;
+			corner = c;
+		}
+	}
+	*out++ = t->prev[corner];
+	*out++ = corner;
+	*out++ = t->next[corner];
+	return SUCCESS;
+}
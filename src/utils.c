@@ -2,6 +2,7 @@
 #include <string.h>
 
 #include "utils.h"
+#include "fastfloat.h"
 
 inline int 
 strequ(const char* str0, const char* str1) {
@@ -26,7 +27,10 @@ const type_t dataformat) {
         token[strcspn(token, "\n")] = '\0';
         switch(dataformat) {
             case TYPE_FLOAT:
-                ((float*)buffer)[o] = atof(token);
+                if (!fastfloat_parse(token, token + strlen(token), 
+                    &((float*)buffer)[o])) {
+                    return PARSING_FAILURE;
+                }
             break;
             case TYPE_UINT:
                 ((uint32_t*)buffer)[o] = atoi(token);
@@ -49,6 +53,55 @@ const type_t dataformat) {
     return SUCCESS;
 }
 
+int 
+array_reserve(void** data, 
+uint32_t* capacity, 
+const uint32_t required, 
+const size_t size) {
+    if (required <= *capacity && *data) {
+        return SUCCESS;
+    }
+    uint32_t new_capacity = *capacity ? *capacity : 16;
+    while (new_capacity < required) {
+        // Saturate instead of wrapping around on enormous arrays.
+        if (new_capacity > UINT32_MAX / 2) {
+            new_capacity = required;
+            break;
+        }
+        new_capacity <<= 1;
+    }
+    void* temp = realloc(*data, (size_t)new_capacity * size);
+    if (!temp) {
+        return MEMORY_REFUSED;
+    }
+    *data = temp;
+    *capacity = new_capacity;
+    return SUCCESS;
+}
+
+int 
+array_trim(void** data, 
+uint32_t* capacity, 
+const uint32_t used, 
+const size_t size) {
+    if (used == 0) {
+        free(*data);
+        *data = NULL;
+        *capacity = 0;
+        return SUCCESS;
+    }
+    if (used == *capacity) {
+        return SUCCESS;
+    }
+    void* temp = realloc(*data, (size_t)used * size);
+    if (!temp) {
+        return MEMORY_REFUSED;
+    }
+    *data = temp;
+    *capacity = used;
+    return SUCCESS;
+}
+
 void 
 buffer_print(const void* data, const type_t type, const uint32_t length) {
     printf("[");
@@ -4,7 +4,7 @@
 vec_t
 cross(const vec_t* a, const vec_t* b) {
 	return (vec_t) {
-		.x = (a->y * a->z) - (a->z * b->y),
+		.x = (a->y * b->z) - (a->z * b->y),
 		.y = (a->z * b->x) - (a->x * b->z), 
 		.z = (a->x * b->y) - (a->y * b->x)
 	};
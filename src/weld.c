@@ -0,0 +1,229 @@
+#include "weld.h"
+#include "defs.h"
+#include "utils.h"
+#include <stdlib.h>
+#include <string.h>
+
+// -----------------------------------------------------------------------------
+// Static utility
+// -----------------------------------------------------------------------------
+
+/* Marks an empty slot of the table. */
+#define EMPTY_SLOT UINT32_MAX
+
+/** @struct weld_slot_t
+ * @brief One slot of the table: a triplet and its vertex. Keeping the key in
+ * the slot lets a probe compare without touching the vertex array.
+ */
+typedef struct {
+	uint32_t key[3];
+	uint32_t vertex;
+	/** The first corner of the vertex, whose tangent it has. */
+	uint32_t corner;
+} weld_slot_t;
+
+/** Hashes a triplet of 1-based indices, 0 for an absent one.
+ */
+static inline uint32_t hash_triplet(uint32_t p, uint32_t t, uint32_t n) {
+	uint64_t h = p * 0x9E3779B97F4A7C15u;
+	h ^= (t + (h >> 29)) * 0xBF58476D1CE4E5B9u;
+	h ^= (n + (h >> 31)) * 0x94D049BB133111EBu;
+	return (uint32_t)(h >> 32);
+}
+
+/** Hashes the bits of a tangent into the hash of its triplet.
+ */
+static inline uint32_t hash_tangent(uint32_t h, const float* tangent) {
+	uint32_t bits[4];
+	memcpy(bits, tangent, sizeof bits);
+	for (uint32_t k = 0; k < 4; k++) {
+		h = (h ^ bits[k]) * 0x9E3779B1u;
+		h ^= h >> 15;
+	}
+	return h;
+}
+
+/** Finds the slot of a triplet: the slot holding it, or the empty slot where
+ * it belongs.
+ * @param table The table.
+ * @param mask The capacity of the table minus one.
+ * @param key The triplet.
+ * @param tangents The tangents of the mesh, or NULL.
+ * @param corner The corner whose tangent completes the key.
+ * @returns The slot.
+ */
+static inline uint32_t find_slot(const weld_slot_t* table, 
+	uint32_t mask, 
+	const uint32_t key[3],
+	const float* tangents,
+	uint32_t corner) {
+	uint32_t h = hash_triplet(key[0], key[1], key[2]);
+	const float* tangent = tangents ? tangents + 4 * (size_t)corner : NULL;
+	if (tangent) {
+		h = hash_tangent(h, tangent);
+	}
+	uint32_t slot = h & mask;
+	while (table[slot].vertex != EMPTY_SLOT &&
+		(table[slot].key[0] != key[0] || table[slot].key[1] != key[1] ||
+		table[slot].key[2] != key[2] || (tangent && memcmp(tangent, 
+		tangents + 4 * (size_t)table[slot].corner, 4 * sizeof *tangent)))) {
+		slot = (slot + 1) & mask;
+	}
+	return slot;
+}
+
+/** Allocates a table with every slot empty.
+ * @param capacity The number of slots. A power of two.
+ * @returns The table, or NULL.
+ */
+static weld_slot_t* alloc_table(uint32_t capacity) {
+	weld_slot_t* table = malloc((size_t)capacity * sizeof *table);
+	for (uint32_t i = 0; table && i < capacity; i++) {
+		table[i].vertex = EMPTY_SLOT;
+	}
+	return table;
+}
+
+/** Doubles the capacity of the table, moving every triplet.
+ * @param table Pointer to the table. Replaced on success.
+ * @param capacity Pointer to the number of slots. Doubled on success.
+ * @param tangents The tangents of the mesh, or NULL.
+ * @returns SUCCESS or MEMORY_REFUSED.
+ */
+static int grow_table(weld_slot_t** table, 
+	uint32_t* capacity, 
+	const float* tangents) {
+	uint32_t grown = *capacity * 2;
+	weld_slot_t* next = alloc_table(grown);
+	if (!next) {
+		return MEMORY_REFUSED;
+	}
+	for (uint32_t i = 0; i < *capacity; i++) {
+		if ((*table)[i].vertex != EMPTY_SLOT) {
+			next[find_slot(next, grown - 1, (*table)[i].key, tangents, 
+				(*table)[i].corner)] = (*table)[i];
+		}
+	}
+	free(*table);
+	*table = next;
+	*capacity = grown;
+	return SUCCESS;
+}
+
+/** Copies the attributes of a triplet and a corner's tangent into a new 
+ * interleaved vertex.
+ */
+static void write_vertex(const mesh_t* mesh, 
+	const weld_t* weld, 
+	const uint32_t key[3], 
+	uint32_t corner,
+	float* dest) {
+	memcpy(dest, mesh->positions + (size_t)(key[0] - 1) * mesh->vertex_dim,
+		mesh->vertex_dim * sizeof *dest);
+	if (weld->flag & tex_flag) {
+		memcpy(dest + weld->texcoord_offset, 
+			mesh->texcoords + (size_t)(key[1] - 1) * mesh->tex_dim,
+			mesh->tex_dim * sizeof *dest);
+	}
+	if (weld->flag & norm_flag) {
+		memcpy(dest + weld->normal_offset, 
+			mesh->normals + (size_t)(key[2] - 1) * mesh->vertex_dim,
+			mesh->vertex_dim * sizeof *dest);
+	}
+	if (weld->flag & WELD_TANGENT_FLAG) {
+		memcpy(dest + weld->tangent_offset, 
+			mesh->tangents + 4 * (size_t)corner, 4 * sizeof *dest);
+	}
+}
+
+// -----------------------------------------------------------------------------
+// Implementation
+// -----------------------------------------------------------------------------
+
+int
+weld_mesh(const mesh_t* mesh, weld_t* weld) {
+	uint32_t corners = mesh->num_corners;
+	*weld = (weld_t) { .flag = mesh->face_flag.flag, .ratio = 1.0f };
+	if (mesh->tangents) {
+		weld->flag |= WELD_TANGENT_FLAG;
+	}
+	weld->texcoord_offset = mesh->vertex_dim;
+	weld->normal_offset = mesh->vertex_dim 
+		+ (weld->flag & tex_flag ? mesh->tex_dim : 0);
+	weld->tangent_offset = weld->normal_offset 
+		+ (weld->flag & norm_flag ? mesh->vertex_dim : 0);
+	weld->stride = weld->tangent_offset 
+		+ (weld->flag & WELD_TANGENT_FLAG ? 4 : 0);
+	if (corners == 0) {
+		return SUCCESS;
+	}
+
+	// A closed triangle mesh has about half as many distinct vertices as
+	// faces. The table grows to stay at most half full, so probes stay short.
+	uint32_t capacity = 16;
+	while (capacity < mesh->num_faces && capacity < (1u << 30)) {
+		capacity <<= 1;
+	}
+	uint32_t vertex_cap = 0;
+	weld_slot_t* table = alloc_table(capacity);
+	weld->indices = malloc((size_t)corners * sizeof *weld->indices);
+	if (!table || !weld->indices) {
+		free(table);
+		weld_destroy(weld);
+		return MEMORY_REFUSED;
+	}
+
+	const uint32_t* sources[3] = {
+		mesh->face_indices, mesh->face_texs, mesh->face_norms
+	};
+	for (uint32_t c = 0; c < corners; c++) {
+		uint32_t key[3];
+		for (uint32_t k = 0; k < 3; k++) {
+			key[k] = sources[k] ? sources[k][c] : 0;
+		}
+		uint32_t slot = find_slot(table, capacity - 1, key, mesh->tangents, c);
+		if (table[slot].vertex == EMPTY_SLOT) {
+			if ((weld->num_vertices + 1) * 2 > capacity) {
+				if (grow_table(&table, &capacity, mesh->tangents) != SUCCESS) {
+					free(table);
+					weld_destroy(weld);
+					return MEMORY_REFUSED;
+				}
+				slot = find_slot(table, capacity - 1, key, mesh->tangents, c);
+			}
+			if (array_reserve((void**)&weld->vertices, &vertex_cap, 
+				(weld->num_vertices + 1) * weld->stride, 
+				sizeof *weld->vertices) != SUCCESS) {
+				free(table);
+				weld_destroy(weld);
+				return MEMORY_REFUSED;
+			}
+			table[slot] = (weld_slot_t) {
+				.key = { key[0], key[1], key[2] },
+				.vertex = weld->num_vertices,
+				.corner = c
+			};
+			write_vertex(mesh, weld, key, c, weld->vertices 
+				+ (size_t)weld->num_vertices * weld->stride);
+			weld->num_vertices++;
+		}
+		weld->indices[c] = table[slot].vertex;
+	}
+	free(table);
+	weld->num_indices = corners;
+	weld->ratio = (float)weld->num_vertices / (float)corners;
+
+	if (array_trim((void**)&weld->vertices, &vertex_cap, 
+		weld->num_vertices * weld->stride, sizeof *weld->vertices) != SUCCESS) {
+		weld_destroy(weld);
+		return MEMORY_REFUSED;
+	}
+	return SUCCESS;
+}
+
+void
+weld_destroy(weld_t* weld) {
+	free(weld->vertices);
+	free(weld->indices);
+	*weld = (weld_t) {0};
+}
@@ -0,0 +1,209 @@
+#include <locale.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "defs.h"
+#include "buffer.h"
+#include "fastfloat.h"
+
+#define RANDOM_RUNS 1000000
+
+/** xorshift64*, so every run checks the same inputs. */
+static uint64_t next_random(void) {
+    static uint64_t state = 0x9E3779B97F4A7C15u;
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return state * 0x2545F4914F6CDD1Du;
+}
+
+static uint32_t float_bits(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof bits);
+    return bits;
+}
+
+/** Parses the string with both fastfloat_parse and strtof, which is correctly
+ * rounded in the "C" locale, and compares the bits and the consumed length.
+ * @returns 1 if both agree, 0 otherwise.
+ */
+int check(const char* str) {
+    char* expected_end;
+    float expected = strtof(str, &expected_end);
+    float actual = 0.0f;
+    const char* end = fastfloat_parse(str, str + strlen(str), &actual);
+    if (!end) {
+        end = str;
+    }
+    if (end != expected_end || (expected == expected
+        && float_bits(expected) != float_bits(actual)) ||
+        (expected != expected && actual == actual)) {
+        printf("Mismatch for \"%s\": got %.9g (%08x, %d chars), "
+            "expected %.9g (%08x, %d chars)\n", str, actual, float_bits(actual),
+            (int)(end - str), expected, float_bits(expected),
+            (int)(expected_end - str));
+        return 0;
+    }
+    return 1;
+}
+
+/** Checks hand-picked inputs: ties, subnormals, overflow, long mantissas. */
+int test_edge_cases(void) {
+    static const char* cases[] = {
+        "0", "-0", "+0.0", "0e999", "1", "-1", "1.5", ".5", "5.", "1e10",
+        "16777216", "16777217", "16777218", "16777219", "33554434",
+        "1.00000005960464477539062500", "1.00000005960464477539062501",
+        "1.00000005960464477539062499", "0.1", "0.2", "0.3", "3.14159265358979",
+        "1.4e-45", "1.401298464324817e-45", "7e-46", "7.006492321624085e-46",
+        "7.006492321624086e-46", "1e-46", "1.1754942e-38", "1.17549435e-38",
+        "1.1754943508222875e-38", "3.4028234e38", "3.40282347e38",
+        "3.4028235677973366e38", "3.4028235677973367e38", "1e39", "-1e39",
+        "1e-400", "123456789012345678901234567890",
+        "0.000000000000000000000000000000000000000000001",
+        "1234567890123456789012345678901234567890e-50",
+        "179769313486231570000000000000000000000000000000000000000000000e-25",
+        "1e", "1e+", "1e-x", "2.5E-3", "2.5e+3", "-.25", "00000000001.5",
+        "inf", "-Infinity", "NaN", "infin", "1.0abc", "4.", "1,5", ",5",
+        "9999999999999999999", "10000000000000000000", "18446744073709551615", 
+        "18446744073709551616",
+        "0.0000000000000000000000000000000000000000000000000000001e50",
+        "8.589973e9", "8.589974e9", "3.0000002384185791015625",
+        "3.00000023841857910156250001"
+    };
+    int passed = 1;
+    for (size_t i = 0; i < sizeof cases / sizeof *cases; i++) {
+        passed &= check(cases[i]);
+    }
+    return passed;
+}
+
+/** Formats random finite floats at several precisions and parses them back.
+ * The shortest round-trip format must recover the exact bits.
+ */
+int test_random_floats(void) {
+    static const char* formats[] = { "%.9g", "%.6g", "%.3g", "%.12e", "%f",
+        "%.17g", "%.30g" };
+    char str[512];
+    int passed = 1;
+    for (int i = 0; i < RANDOM_RUNS && passed; i++) {
+        uint32_t bits = (uint32_t)next_random();
+        float value;
+        memcpy(&value, &bits, sizeof value);
+        if (value != value || value - value != 0.0f) {
+            continue;
+        }
+        for (size_t f = 0; f < sizeof formats / sizeof *formats; f++) {
+            snprintf(str, sizeof str, formats[f], value);
+            passed &= check(str);
+        }
+        float parsed;
+        snprintf(str, sizeof str, "%.9g", value);
+        fastfloat_parse(str, str + strlen(str), &parsed);
+        if (float_bits(parsed) != bits) {
+            printf("Round trip of %08x through \"%s\" failed\n", bits, str);
+            passed = 0;
+        }
+    }
+    return passed;
+}
+
+/** Parses random decimal strings with up to 40 digits and exponents spanning
+ * the whole float range.
+ */
+int test_random_decimals(void) {
+    char str[128];
+    int passed = 1;
+    for (int i = 0; i < RANDOM_RUNS && passed; i++) {
+        uint64_t r = next_random();
+        int digits = 1 + (int)(r % 40);
+        int point = (int)((r >> 8) % (uint64_t)(digits + 1));
+        int exponent = (int)((r >> 16) % 100) - 60;
+        int n = 0;
+        if (r >> 63) {
+            str[n++] = '-';
+        }
+        for (int d = 0; d < digits; d++) {
+            if (d == point) {
+                str[n++] = '.';
+            }
+            str[n++] = (char)('0' + next_random() % 10);
+        }
+        snprintf(str + n, sizeof str - (size_t)n, "e%d", exponent);
+        passed &= check(str);
+    }
+    return passed;
+}
+
+/** Parses spans that are not NUL-terminated. A span with anything after its
+ * number fails, including a ',' where the '.' separator belongs.
+ */
+int test_buffers(void) {
+    const char* line = "v 1.25 -2.5 3e2";
+    float x, y, z;
+    buffer_t a = { .data = line, .offset = 2, .length = 4 };
+    buffer_t b = { .data = line, .offset = 7, .length = 4 };
+    buffer_t c = { .data = line, .offset = 12, .length = 3 };
+    buffer_t bad = { .data = line, .offset = 0, .length = 1 };
+    int passed = buffer_get_float(a, &x) == SUCCESS && x == 1.25f &&
+        buffer_get_float(b, &y) == SUCCESS && y == -2.5f &&
+        buffer_get_float(c, &z) == SUCCESS && z == 300.0f &&
+        buffer_get_float(bad, &x) == PARSING_FAILURE;
+    static const char* partial[] = { "1.0x", "1e", "+", "-.", "1.5 ", "3e2e", 
+        "1,5", ",5" };
+    for (size_t i = 0; i < sizeof partial / sizeof *partial; i++) {
+        buffer_t token = { .data = partial[i], .offset = 0, 
+            .length = (unsigned int)strlen(partial[i]) };
+        x = 7.0f;
+        if (buffer_get_float(token, &x) != PARSING_FAILURE || x != 7.0f) {
+            printf("\"%s\" was accepted as a number\n", partial[i]);
+            passed = 0;
+        }
+    }
+    return passed;
+}
+
+/** The parser must ignore the locale's decimal separator. */
+int test_locale(void) {
+    static const char* locales[] = { "de_DE.UTF-8", "de_DE", "fr_FR.UTF-8" };
+    int passed = 1;
+    for (size_t i = 0; i < sizeof locales / sizeof *locales; i++) {
+        if (setlocale(LC_NUMERIC, locales[i])) {
+            float value;
+            const char* str = "1.5";
+            passed = fastfloat_parse(str, str + 3, &value) == str + 3 &&
+                value == 1.5f;
+            break;
+        }
+    }
+    setlocale(LC_NUMERIC, "C");
+    return passed;
+}
+
+int main(void) {
+    int failed = 0;
+    if (!test_edge_cases()) {
+        printf("Edge cases failed\n");
+        failed = 1;
+    }
+    if (!test_random_floats()) {
+        printf("Random float round trips failed\n");
+        failed = 1;
+    }
+    if (!test_random_decimals()) {
+        printf("Random decimal strings failed\n");
+        failed = 1;
+    }
+    if (!test_buffers()) {
+        printf("Buffer parsing failed\n");
+        failed = 1;
+    }
+    if (!test_locale()) {
+        printf("Locale independence failed\n");
+        failed = 1;
+    }
+    if (!failed) {
+        printf("All float tests passed\n");
+    }
+    return failed;
+}
@@ -1,8 +1,2458 @@
+#define _POSIX_C_SOURCE 200809L
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 #include "obj.h"
 #include "mtl.h"
+#include "classify.h"
+#include "filemap.h"
+#include "parse.h"
+#include "weld.h"
+#include "pack.h"
+#include "quantize.h"
+#include "index_buffer.h"
+#include "optimize.h"
+#include "simplify.h"
+#include "meshlet.h"
+#include "normals.h"
+#include "tangents.h"
+#include "bvh.h"
+#include "hull.h"
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+/** Compares two meshes component by component.
+ * @returns SUCCESS if both meshes hold the same data, 0 otherwise.
+ */
+int test_mesh_equal(const mesh_t* a, const mesh_t* b) {
+    if (a->num_vertices != b->num_vertices ||
+        a->num_normals != b->num_normals ||
+        a->num_textures != b->num_textures ||
+        a->num_faces != b->num_faces ||
+        a->vertex_dim != b->vertex_dim ||
+        a->tex_dim != b->tex_dim ||
+        a->face_dim != b->face_dim ||
+        a->face_flag.flag != b->face_flag.flag) {
+        return 0;
+    }
+    if (a->num_corners != b->num_corners ||
+        (a->num_vertices && memcmp(a->positions, b->positions,
+        a->num_vertices * a->vertex_dim * sizeof(float)) != 0) ||
+        (a->num_normals && memcmp(a->normals, b->normals,
+        a->num_normals * a->vertex_dim * sizeof(float)) != 0) ||
+        (a->num_textures && memcmp(a->texcoords, b->texcoords,
+        a->num_textures * a->tex_dim * sizeof(float)) != 0)) {
+        return 0;
+    }
+    for (uint32_t i = 0; i < a->num_faces; i++) {
+        uint32_t size = obj_face_size(a, i);
+        if (size != obj_face_size(b, i) ||
+            (a->face_flag.flag & pos_flag && memcmp(obj_face_indices(a, i),
+            obj_face_indices(b, i), size * sizeof(uint32_t)) != 0) ||
+            (a->face_flag.flag & tex_flag && memcmp(obj_face_texs(a, i),
+            obj_face_texs(b, i), size * sizeof(uint32_t)) != 0) ||
+            (a->face_flag.flag & norm_flag && memcmp(obj_face_norms(a, i),
+            obj_face_norms(b, i), size * sizeof(uint32_t)) != 0)) {
+            return 0;
+        }
+    }
+    if (!a->face_smoothing != !b->face_smoothing ||
+        (a->face_smoothing && memcmp(a->face_smoothing, b->face_smoothing,
+        a->num_faces * sizeof(uint32_t)) != 0)) {
+        return 0;
+    }
+    if (!a->tangents != !b->tangents ||
+        (a->tangents && memcmp(a->tangents, b->tangents,
+        a->num_corners * 4 * sizeof(float)) != 0)) {
+        return 0;
+    }
+    if (memcmp(a->aabb_min, b->aabb_min, sizeof a->aabb_min) != 0 ||
+        memcmp(a->aabb_max, b->aabb_max, sizeof a->aabb_max) != 0 ||
+        memcmp(a->sphere_center, b->sphere_center, 
+        sizeof a->sphere_center) != 0 ||
+        a->sphere_radius != b->sphere_radius ||
+        a->num_groups != b->num_groups || 
+        a->num_objects != b->num_objects ||
+        a->num_materials != b->num_materials) {
+        return 0;
+    }
+    uint32_t num_ranges = a->num_groups + a->num_objects + a->num_materials;
+    for (uint32_t i = 0; i < num_ranges; i++) {
+        uint32_t j = i;
+        const obj_range_t* x = a->groups;
+        const obj_range_t* y = b->groups;
+        if (j >= a->num_groups) {
+            j -= a->num_groups;
+            x = a->objects;
+            y = b->objects;
+            if (j >= a->num_objects) {
+                j -= a->num_objects;
+                x = a->materials;
+                y = b->materials;
+            }
+        }
+        x += j;
+        y += j;
+        if (strcmp(x->name, y->name) != 0 || 
+            !x->material != !y->material ||
+            x->first_face != y->first_face || 
+            x->num_faces != y->num_faces ||
+            memcmp(x->aabb_min, y->aabb_min, sizeof x->aabb_min) != 0 ||
+            memcmp(x->aabb_max, y->aabb_max, sizeof x->aabb_max) != 0) {
+            return 0;
+        }
+    }
+    return SUCCESS;
+}
+
+/** Reads the file in both the two-pass and single-pass modes and compares the
+ * results.
+ */
+int test_single_pass(const char* fn) {
+    int code;
+    mesh_t two_pass;
+    mesh_t single_pass;
+    if ((code = obj_read(fn, &two_pass)) != SUCCESS) {
+        return code;
+    }
+    if ((code = obj_read_ex(fn, &single_pass, OBJ_SINGLE_PASS)) != SUCCESS) {
+        obj_destroy(&two_pass);
+        return code;
+    }
+    code = test_mesh_equal(&two_pass, &single_pass);
+    obj_destroy(&two_pass);
+    obj_destroy(&single_pass);
+    return code;
+}
+
+/** Reads the file through a memory mapping and compares the result with the
+ * single-pass read.
+ */
+int test_mmap(const char* fn) {
+    int code;
+    mesh_t single_pass;
+    mesh_t mapped;
+    if ((code = obj_read_ex(fn, &single_pass, OBJ_SINGLE_PASS)) != SUCCESS) {
+        return code;
+    }
+    if ((code = obj_read_mmap(fn, &mapped)) != SUCCESS) {
+        obj_destroy(&single_pass);
+        return code;
+    }
+    code = test_mesh_equal(&single_pass, &mapped);
+    obj_destroy(&single_pass);
+    obj_destroy(&mapped);
+    return code;
+}
+
+/** Reads the file across several threads and compares the result with the
+ * memory-mapped read.
+ */
+int test_parallel(const char* fn, uint32_t num_threads) {
+    int code;
+    mesh_t mapped;
+    mesh_t parallel;
+    if ((code = obj_read_mmap(fn, &mapped)) != SUCCESS) {
+        return code;
+    }
+    if ((code = obj_read_parallel(fn, &parallel, 0, num_threads)) != SUCCESS) {
+        obj_destroy(&mapped);
+        return code;
+    }
+    code = test_mesh_equal(&mapped, &parallel);
+    obj_destroy(&mapped);
+    obj_destroy(&parallel);
+    return code;
+}
+
+/** Writes a strip of quads large enough to be split into several chunks, with
+ * every face using relative indices, and reads it in parallel.
+ */
+int test_parallel_relative(void) {
+    int code;
+    mesh_t mesh;
+    const char* fn = "out/relative.obj";
+    const uint32_t quads = 20000;
+    FILE* file = fopen(fn, "w");
+    if (!file) {
+        return INVALID_FILE;
+    }
+    fprintf(file, "o Strip\nv 0 0 0\nv 0 1 0\nvt 0 0\nvt 0 1\n");
+    for (uint32_t i = 1; i <= quads; i++) {
+        fprintf(file, "v %u 0 0\nv %u 1 0\nvt %u 0\nvt %u 1\n"
+            "f -4/-4 -2/-2 -1/-1 -3/-3\n", i, i, i, i);
+    }
+    fclose(file);
+    if ((code = test_parallel(fn, 8)) != SUCCESS) {
+        return code;
+    }
+    if ((code = obj_read_parallel(fn, &mesh, 0, 8)) != SUCCESS) {
+        return code;
+    }
+    code = mesh.num_faces == quads && mesh.name && 
+        strcmp(mesh.name, "Strip") == 0 ? SUCCESS : 0;
+    for (uint32_t i = 0; i < mesh.num_faces && code == SUCCESS; i++) {
+        const uint32_t* indices = obj_face_indices(&mesh, i);
+        const uint32_t* texs = obj_face_texs(&mesh, i);
+        if (indices[0] != 2 * i + 1 || indices[2] != 2 * i + 4 || 
+            texs[1] != 2 * i + 3) {
+            code = 0;
+        }
+    }
+    obj_destroy(&mesh);
+    return code;
+}
+
+/** Checks that every classifier kernel and the block-wise file classifier 
+ * agree, that the counts match the mesh, and that the line index is exact.
+ */
+int test_classify(const char* fn) {
+    int code;
+    mesh_t mesh;
+    filemap_t map;
+    line_counts_t expected;
+    line_index_t index = {0};
+    if ((code = obj_read_mmap(fn, &mesh)) != SUCCESS) {
+        return code;
+    }
+    if ((code = filemap_open(fn, &map)) != SUCCESS) {
+        obj_destroy(&mesh);
+        return code;
+    }
+    code = classify_lines(map.data, map.size, CLASSIFY_SCALAR, &expected, 
+        &index);
+    if (code == SUCCESS && (expected.vertices != mesh.num_vertices ||
+        expected.normals != mesh.num_normals ||
+        expected.textures != mesh.num_textures ||
+        expected.faces != mesh.num_faces || index.count != expected.lines)) {
+        code = 0;
+    }
+    for (uint32_t i = 0; i < index.count && code == SUCCESS; i++) {
+        if (index.starts[i] != 0 && map.data[index.starts[i] - 1] != '\n') {
+            code = 0;
+        }
+    }
+    const classify_kernel_t kernels[] = { 
+        CLASSIFY_SSE2, CLASSIFY_AVX2, CLASSIFY_AUTO 
+    };
+    for (size_t k = 0; k < sizeof kernels / sizeof *kernels; k++) {
+        line_counts_t counts;
+        line_index_t other = {0};
+        if (code == SUCCESS && 
+            (code = classify_lines(map.data, map.size, kernels[k], &counts, 
+            &other)) == SUCCESS && 
+            (memcmp(&counts, &expected, sizeof counts) != 0 ||
+            other.count != index.count || (index.count && memcmp(other.starts, 
+            index.starts, index.count * sizeof *index.starts) != 0))) {
+            code = 0;
+        }
+        free(other.starts);
+    }
+    FILE* file = fopen(fn, "r");
+    if (file) {
+        line_counts_t counts;
+        line_index_t other = {0};
+        if (code == SUCCESS && 
+            (code = classify_file(file, &counts, &other)) == SUCCESS &&
+            (memcmp(&counts, &expected, sizeof counts) != 0 ||
+            other.count != index.count || (index.count && memcmp(other.starts, 
+            index.starts, index.count * sizeof *index.starts) != 0))) {
+            code = 0;
+        }
+        free(other.starts);
+        fclose(file);
+    }
+    free(index.starts);
+    filemap_close(&map);
+    obj_destroy(&mesh);
+    return code;
+}
+
+/** Classifies short buffers whose last lines end within a few bytes. */
+int test_classify_edges(void) {
+    static const struct {
+        const char* text;
+        line_counts_t counts;
+    } cases[] = {
+        { "", { 0, 0, 0, 0, 0, 0 } },
+        { "v", { 1, 0, 0, 0, 0, 0 } },
+        { "v 1", { 1, 1, 0, 0, 0, 0 } },
+        { "vt", { 1, 0, 0, 0, 0, 0 } },
+        { "\nvt 1", { 2, 0, 1, 0, 0, 0 } },
+        { "vn\t1\nf 1\no\n", { 3, 0, 0, 1, 1, 0 } },
+        { "o a\n\nv\t0\r\nvx 1\n# f\n f 1\nf", { 7, 1, 0, 0, 0, 1 } }
+    };
+    for (size_t i = 0; i < sizeof cases / sizeof *cases; i++) {
+        for (int k = CLASSIFY_SCALAR; k <= CLASSIFY_AVX2; k++) {
+            line_counts_t counts;
+            classify_lines(cases[i].text, strlen(cases[i].text), 
+                (classify_kernel_t)k, &counts, NULL);
+            if (memcmp(&counts, &cases[i].counts, sizeof counts) != 0) {
+                return 0;
+            }
+        }
+    }
+    return SUCCESS;
+}
+
+/** Writes the lines to file and reads it with every reader.
+ * @returns SUCCESS if every reader returns the expected code, 0 otherwise.
+ */
+int test_read_code(const char* fn, const char* lines, int expected) {
+    mesh_t mesh;
+    FILE* file = fopen(fn, "w");
+    if (!file) {
+        return INVALID_FILE;
+    }
+    fputs(lines, file);
+    fclose(file);
+    int codes[4];
+    codes[0] = obj_read(fn, &mesh);
+    obj_destroy(&mesh);
+    codes[1] = obj_read_ex(fn, &mesh, OBJ_SINGLE_PASS);
+    obj_destroy(&mesh);
+    codes[2] = obj_read_mmap(fn, &mesh);
+    obj_destroy(&mesh);
+    codes[3] = obj_read_parallel(fn, &mesh, 0, 4);
+    obj_destroy(&mesh);
+    for (int i = 0; i < 4; i++) {
+        if (codes[i] != expected) {
+            return 0;
+        }
+    }
+    return SUCCESS;
+}
+
+/** Checks relative index resolution and the rejection of out-of-range 
+ * indices, including one in a chunk after the first of a parallel read.
+ */
+int test_face_indices(void) {
+    int code;
+    mesh_t mesh;
+    const char* fn = "out/indices.obj";
+    const char* valid = "v 0 0 0\nv 1 0 0\nv 1 1 0\nvn 0 0 1\n"
+        "f -3//-1 -2//-1 -1//1\nv 0 1 0\nf 1//1 -2//1 -1//-1\n";
+    if ((code = test_read_code(fn, valid, SUCCESS)) != SUCCESS) {
+        return code;
+    }
+    if ((code = obj_read_mmap(fn, &mesh)) != SUCCESS) {
+        return code;
+    }
+    code = obj_face_indices(&mesh, 0)[0] == 1 && 
+        obj_face_indices(&mesh, 0)[2] == 3 && 
+        obj_face_indices(&mesh, 1)[1] == 3 && 
+        obj_face_indices(&mesh, 1)[2] == 4 && 
+        obj_face_norms(&mesh, 1)[2] == 1 ? SUCCESS : 0;
+    obj_destroy(&mesh);
+    if (code != SUCCESS) {
+        return code;
+    }
+
+    static const char* invalid[] = {
+        "v 0 0 0\nv 1 0 0\nv 1 1 0\nf 1 2 0\n",
+        "v 0 0 0\nv 1 0 0\nv 1 1 0\nf 1 2 4\n",
+        "v 0 0 0\nv 1 0 0\nv 1 1 0\nf -4 -2 -1\n",
+        "v 0 0 0\nv 1 0 0\nv 1 1 0\nf 1 2 99999999999\n",
+        "v 0 0 0\nv 1 0 0\nv 1 1 0\nvt 0 0\nf 1/1 2/2 3/1\n"
+    };
+    for (size_t i = 0; i < sizeof invalid / sizeof *invalid; i++) {
+        if (test_read_code(fn, invalid[i], INDEX_OUT_OF_RANGE) != SUCCESS) {
+            return 0;
+        }
+    }
+    // Every '/' needs an index after it, or the second '/' of "v//n".
+    static const char* malformed[] = {
+        "v 0 0 0\nf 1 1a 1\n",
+        "v 0 0 0\nvt 0 0\nvn 0 0 1\nf 1/ 1/ 1/\n",
+        "v 0 0 0\nvt 0 0\nvn 0 0 1\nf 1// 1// 1//\n",
+        "v 0 0 0\nvt 0 0\nvn 0 0 1\nf 1/1/ 1/1/ 1/1/\n",
+        "v 0 0 0\nvt 0 0\nvn 0 0 1\nf 1///1 1///1 1///1\n",
+        "v 0 0 0\nvt 0 0\nvn 0 0 1\nf 1/1/1/ 1/1/1/ 1/1/1/\n",
+        "v 0 0 0\nvt 0 0\nvn 0 0 1\nf /1 /1 /1\n",
+        // Coordinates are held to the same rule as indices.
+        "v 1.0x 0 0\nf 1 1 1\n",
+        "v 0 0 0\nvt 0 1e\nf 1/1 1/1 1/1\n",
+        "v 0 0 0\nvn 0 - 1\nf 1//1 1//1 1//1\n",
+        "v 1,5 0 0\nf 1 1 1\n"
+    };
+    for (size_t i = 0; i < sizeof malformed / sizeof *malformed; i++) {
+        if (test_read_code(fn, malformed[i], PARSING_FAILURE) != SUCCESS) {
+            return 0;
+        }
+    }
+
+    // Large enough to be split; the last face refers past every vertex.
+    FILE* file = fopen(fn, "w");
+    if (!file) {
+        return INVALID_FILE;
+    }
+    for (uint32_t i = 0; i < 30000; i++) {
+        fprintf(file, "v %u 0 0\nv %u 1 0\nv %u 0 1\nf -3 -2 -1\n", i, i, i);
+    }
+    fprintf(file, "f 1 2 90001\n");
+    fclose(file);
+    code = obj_read_parallel(fn, &mesh, 0, 4) == INDEX_OUT_OF_RANGE ? SUCCESS : 0;
+    obj_destroy(&mesh);
+    return code;
+}
+
+/** Reads a file that mixes triangles, quads and a pentagon.
+ */
+int test_mixed_arity(void) {
+    int code;
+    mesh_t mesh;
+    const char* fn = "out/mixed.obj";
+    FILE* file = fopen(fn, "w");
+    if (!file) {
+        return INVALID_FILE;
+    }
+    fprintf(file, "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nv 0.5 1.5 0\n"
+        "f 1 2 3\nf 1 2 3 4\nf 1 2 3 5 4\n");
+    fclose(file);
+    if ((code = obj_read_mmap(fn, &mesh)) != SUCCESS) {
+        return code;
+    }
+    code = mesh.num_faces == 3 && mesh.num_corners == 12 &&
+        mesh.face_dim == 5 && obj_face_size(&mesh, 0) == 3 &&
+        obj_face_size(&mesh, 1) == 4 && obj_face_size(&mesh, 2) == 5 &&
+        obj_face_indices(&mesh, 2)[3] == 5 &&
+        mesh.face_data[1].indices[3] == 4 ? SUCCESS : 0;
+    obj_destroy(&mesh);
+    return code;
+}
+
+/** Tallies what the streaming parser reports. */
+typedef struct {
+    uint32_t vertices;
+    uint32_t corners;
+    uint32_t faces;
+    uint32_t groups;
+    uint32_t materials;
+    uint32_t smoothing;
+    uint32_t last_line;
+    float min_y;
+} stream_stats_t;
+
+static int count_vertex(void* user, const float* values, uint32_t dim, 
+    uint32_t line) {
+    stream_stats_t* stats = user;
+    if (stats->vertices == 0 || values[1] < stats->min_y) {
+        stats->min_y = values[1];
+    }
+    stats->vertices++;
+    stats->last_line = line;
+    return dim == 3 ? SUCCESS : INVALID_DIMS;
+}
+
+static int count_face(void* user, const obj_face_event_t* face, 
+    uint32_t line) {
+    stream_stats_t* stats = user;
+    stats->faces++;
+    stats->corners += face->size;
+    stats->last_line = line;
+    return SUCCESS;
+}
+
+static int count_group(void* user, const char* const* names, uint32_t count,
+    uint32_t line) {
+    stream_stats_t* stats = user;
+    (void)names;
+    stats->groups += count;
+    stats->last_line = line;
+    return SUCCESS;
+}
+
+static int count_material(void* user, const char* name, uint32_t line) {
+    stream_stats_t* stats = user;
+    stats->materials += strcmp(name, "red paint") == 0;
+    stats->last_line = line;
+    return SUCCESS;
+}
+
+static int count_smoothing(void* user, uint32_t group, uint32_t line) {
+    stream_stats_t* stats = user;
+    stats->smoothing += group;
+    stats->last_line = line;
+    return SUCCESS;
+}
+
+/** Streams a file through counting callbacks and compares the counts with a
+ * full read, then checks the other directives and their line numbers.
+ */
+int test_stream(const char* fn) {
+    static const obj_callbacks_t callbacks = {
+        .vertex = count_vertex,
+        .face = count_face,
+        .group = count_group,
+        .material = count_material,
+        .smoothing = count_smoothing
+    };
+    int code;
+    mesh_t mesh;
+    stream_stats_t stats = {0};
+    FILE* file = fopen(fn, "r");
+    if (!file) {
+        return INVALID_FILE;
+    }
+    code = obj_parse_stream(file, &callbacks, &stats, 0);
+    fclose(file);
+    if (code != SUCCESS || (code = obj_read(fn, &mesh)) != SUCCESS) {
+        return code;
+    }
+    code = stats.vertices == mesh.num_vertices && 
+        stats.faces == mesh.num_faces && 
+        stats.corners == mesh.num_corners ? SUCCESS : 0;
+    for (uint32_t i = 0; i < mesh.num_vertices && code == SUCCESS; i++) {
+        if (mesh.positions[i * mesh.vertex_dim + 1] < stats.min_y) {
+            code = 0;
+        }
+    }
+    obj_destroy(&mesh);
+    if (code != SUCCESS) {
+        return code;
+    }
+
+    const char* text = "# header\ng left right\nv 0 0 0\nv 1 0 0\r\n"
+        "usemtl red paint\ns 4\nv 0 1 0\ns off\ng\nf 1 2 3\n";
+    stats = (stream_stats_t) {0};
+    code = obj_parse_span(text, strlen(text), &callbacks, &stats, 0);
+    if (code != SUCCESS || stats.vertices != 3 || stats.groups != 2 ||
+        stats.materials != 1 || stats.smoothing != 4 || stats.faces != 1 ||
+        stats.last_line != 10) {
+        return 0;
+    }
+    // A callback stops the parse with its own code.
+    text = "v 0 0\n";
+    return obj_parse_span(text, strlen(text), &callbacks, &stats, 0) 
+        == INVALID_DIMS ? SUCCESS : 0;
+}
+
+/** Reads the file from memory and from a pipe, which cannot be rewound, and
+ * compares both with obj_read. Also checks that lines longer than the ring 
+ * buffer read the same through a descriptor as through obj_read.
+ */
+int test_memory_and_fd(const char* fn) {
+    int code;
+    mesh_t expected, mesh;
+    if ((code = obj_read(fn, &expected)) != SUCCESS) {
+        return code;
+    }
+
+    filemap_t map;
+    if ((code = filemap_open(fn, &map)) != SUCCESS) {
+        obj_destroy(&expected);
+        return code;
+    }
+    code = obj_read_memory(map.data, map.size, &mesh);
+    filemap_close(&map);
+    if (code == SUCCESS) {
+        code = test_mesh_equal(&expected, &mesh) ? SUCCESS : 0;
+    }
+    obj_destroy(&mesh);
+
+    char command[512];
+    snprintf(command, sizeof command, "cat '%s'", fn);
+    FILE* pipe = code == SUCCESS ? popen(command, "r") : NULL;
+    if (pipe) {
+        code = obj_read_fd(fileno(pipe), &mesh);
+        pclose(pipe);
+        if (code == SUCCESS) {
+            code = test_mesh_equal(&expected, &mesh) ? SUCCESS : 0;
+        }
+        obj_destroy(&mesh);
+    }
+    obj_destroy(&expected);
+    if (code != SUCCESS) {
+        return code;
+    }
+
+    // Lines longer than the ring: a comment spanning several rings, a vertex
+    // padded past one, and a face spanning two at the end of the input, 
+    // without a newline.
+    const char* long_fn = "out/long_line.obj";
+    FILE* file = fopen(long_fn, "w");
+    if (!file) {
+        return INVALID_FILE;
+    }
+    fputs("v 0 0 0\nv 1 0 0\n  #", file);
+    for (int i = 0; i < 5 * OBJ_FD_BUFFER_SIZE / 2; i++) {
+        fputc('x', file);
+    }
+    fputs("\nv 0 1", file);
+    for (int i = 0; i < OBJ_FD_BUFFER_SIZE; i++) {
+        fputc(' ', file);
+    }
+    fputs("0\nf", file);
+    for (int i = 0; i < OBJ_FD_BUFFER_SIZE / 3; i++) {
+        fputs(" 1 2 3", file);
+    }
+    fclose(file);
+    if ((code = obj_read(long_fn, &expected)) != SUCCESS) {
+        return code;
+    }
+    code = expected.num_vertices == 3 && expected.num_faces == 1 
+        && expected.positions[7] == 1.0f ? SUCCESS : 0;
+    int fd = open(long_fn, O_RDONLY);
+    if (code == SUCCESS && fd < 0) {
+        code = INVALID_FILE;
+    }
+    if (code == SUCCESS) {
+        code = obj_read_fd(fd, &mesh);
+        if (code == SUCCESS) {
+            code = test_mesh_equal(&expected, &mesh) ? SUCCESS : 0;
+        }
+        obj_destroy(&mesh);
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+    // A pipe hands the lines over in small reads.
+    snprintf(command, sizeof command, "cat '%s'", long_fn);
+    pipe = code == SUCCESS ? popen(command, "r") : NULL;
+    if (pipe) {
+        code = obj_read_fd(fileno(pipe), &mesh);
+        pclose(pipe);
+        if (code == SUCCESS) {
+            code = test_mesh_equal(&expected, &mesh) ? SUCCESS : 0;
+        }
+        obj_destroy(&mesh);
+    }
+    obj_destroy(&expected);
+    return code;
+}
+
+/** Sums the signed areas of the triangles of a mesh in the xy plane.
+ * @returns The total area, or -1 if a triangle winds clockwise.
+ */
+static float triangle_area(const mesh_t* mesh) {
+    float total = 0.0f;
+    for (uint32_t i = 0; i < mesh->num_faces; i++) {
+        const uint32_t* f = obj_face_indices(mesh, i);
+        const float* a = mesh->positions + (f[0] - 1) * mesh->vertex_dim;
+        const float* b = mesh->positions + (f[1] - 1) * mesh->vertex_dim;
+        const float* c = mesh->positions + (f[2] - 1) * mesh->vertex_dim;
+        float area = 0.5f * ((b[0] - a[0]) * (c[1] - a[1]) - 
+            (b[1] - a[1]) * (c[0] - a[0]));
+        if (area < 0.0f) {
+            return -1.0f;
+        }
+        total += area;
+    }
+    return total;
+}
+
+/** Reads a concave L-shaped hexagon, a quad, a triangle and a line with 
+ * OBJ_TRIANGULATE, then a file large enough for the parallel reader to split.
+ */
+int test_triangulate(void) {
+    int code;
+    mesh_t mesh, expected;
+    const char* fn = "out/triangulate.obj";
+    // A fan around the hexagon's first corner would wind backwards.
+    const char* lines = "v 1 1 0\nv 1 2 0\nv 0 2 0\nv 0 0 0\nv 2 0 0\n"
+        "v 2 1 0\nvt 0 0\nf 3/1 4/1 5/1 6/1 1/1 2/1\nf 4/1 5/1 6/1 3/1\n"
+        "f 4/1 5/1 6/1\nf 1/1 2/1\n";
+    FILE* file = fopen(fn, "w");
+    if (!file) {
+        return INVALID_FILE;
+    }
+    fputs(lines, file);
+    fclose(file);
+    const uint32_t flags[] = { 
+        OBJ_TRIANGULATE, OBJ_TRIANGULATE | OBJ_SINGLE_PASS 
+    };
+    for (size_t i = 0; i < sizeof flags / sizeof *flags; i++) {
+        if ((code = obj_read_ex(fn, &mesh, flags[i])) != SUCCESS) {
+            return code;
+        }
+        float area = triangle_area(&mesh);
+        code = mesh.num_faces == 4 + 2 + 1 && mesh.face_dim == 3 &&
+            mesh.num_corners == 21 && mesh.face_texs &&
+            mesh.face_data[6].indices[2] == 6 &&
+            area > 6.999f && area < 7.001f ? SUCCESS : 0;
+        obj_destroy(&mesh);
+        if (code != SUCCESS) {
+            return code;
+        }
+    }
+
+    file = fopen(fn, "w");
+    if (!file) {
+        return INVALID_FILE;
+    }
+    for (uint32_t i = 0; i < 20000; i++) {
+        fprintf(file, "v %u 1 0\nv %u 2 0\nv %u 2 0\nv %u 0 0\nv %u 0 0\n"
+            "v %u 1 0\n", 2 * i + 1, 2 * i + 1, 2 * i, 2 * i, 2 * i + 2, 
+            2 * i + 2);
+    }
+    for (uint32_t i = 0; i < 20000; i++) {
+        uint32_t v = 6 * i + 1;
+        fprintf(file, "f %u %u %u %u %u %u\n", v + 2, v + 3, v + 4, v + 5, v,
+            v + 1);
+    }
+    fclose(file);
+    if ((code = obj_read_ex(fn, &expected, OBJ_TRIANGULATE)) != SUCCESS) {
+        return code;
+    }
+    if ((code = obj_read_parallel(fn, &mesh, OBJ_TRIANGULATE, 4)) == SUCCESS) {
+        float area = triangle_area(&mesh);
+        code = test_mesh_equal(&expected, &mesh) && 
+            mesh.num_faces == 80000 && area > 59990.0f && area < 60010.0f 
+            ? SUCCESS : 0;
+    }
+    obj_destroy(&mesh);
+    obj_destroy(&expected);
+    return code;
+}
+
+/** Welds the triangulated mesh and checks that every corner's vertex holds 
+ * the corner's own attributes and that no two vertices are the same triplet.
+ */
+int test_weld(const char* fn) {
+    int code;
+    mesh_t mesh;
+    weld_t weld;
+    if ((code = obj_read_ex(fn, &mesh, OBJ_TRIANGULATE)) != SUCCESS) {
+        return code;
+    }
+    if ((code = weld_mesh(&mesh, &weld)) != SUCCESS) {
+        obj_destroy(&mesh);
+        return code;
+    }
+    // The first corner that uses each vertex, to find duplicates.
+    uint32_t* first = malloc((weld.num_vertices + 1) * sizeof *first);
+    code = first && weld.num_indices == mesh.num_corners && 
+        weld.num_vertices <= weld.num_indices &&
+        weld.ratio * weld.num_indices > weld.num_vertices - 0.5f ? SUCCESS : 0;
+    for (uint32_t v = 0; code == SUCCESS && v < weld.num_vertices; v++) {
+        first[v] = UINT32_MAX;
+    }
+    for (uint32_t c = 0; code == SUCCESS && c < mesh.num_corners; c++) {
+        uint32_t v = weld.indices[c];
+        const float* vertex = weld.vertices + (size_t)v * weld.stride;
+        uint32_t p = mesh.face_indices[c] - 1;
+        if (v >= weld.num_vertices || memcmp(vertex, mesh.positions 
+            + p * mesh.vertex_dim, mesh.vertex_dim * sizeof *vertex) != 0 ||
+            (mesh.face_texs && memcmp(vertex + weld.texcoord_offset, 
+            mesh.texcoords + (mesh.face_texs[c] - 1) * mesh.tex_dim, 
+            mesh.tex_dim * sizeof *vertex) != 0) ||
+            (mesh.face_norms && memcmp(vertex + weld.normal_offset, 
+            mesh.normals + (mesh.face_norms[c] - 1) * mesh.vertex_dim, 
+            mesh.vertex_dim * sizeof *vertex) != 0)) {
+            code = 0;
+        } else if (first[v] == UINT32_MAX) {
+            first[v] = c;
+        } else if (mesh.face_indices[first[v]] != mesh.face_indices[c] ||
+            (mesh.face_texs && mesh.face_texs[first[v]] != mesh.face_texs[c]) 
+            || (mesh.face_norms && 
+            mesh.face_norms[first[v]] != mesh.face_norms[c])) {
+            code = 0;
+        }
+    }
+    // Every vertex is used, and used first in order.
+    for (uint32_t v = 0; code == SUCCESS && v < weld.num_vertices; v++) {
+        if (first[v] == UINT32_MAX || (v > 0 && first[v] < first[v - 1])) {
+            code = 0;
+        }
+    }
+    free(first);
+    weld_destroy(&weld);
+    obj_destroy(&mesh);
+    return code;
+}
+
+/** Packs the welded mesh into a 32-byte layout and its corners into a 
+ * half-float position layout, and checks the values against the mesh.
+ */
+int test_pack(const char* fn) {
+    int code;
+    mesh_t mesh;
+    weld_t weld;
+    if (pack_half(1.0f) != 0x3C00 || pack_half(-2.0f) != 0xC000 ||
+        pack_half(0.1f) != 0x2E66 || pack_half(65504.0f) != 0x7BFF ||
+        pack_half(65520.0f) != 0x7C00 || pack_half(5.9604645e-8f) != 0x0001 ||
+        pack_half(2.9802322e-8f) != 0x0000 || pack_half(1e-5f) != 0x00A8) {
+        return 0;
+    }
+    if ((code = obj_read_ex(fn, &mesh, OBJ_TRIANGULATE)) != SUCCESS) {
+        return code;
+    }
+    if ((code = weld_mesh(&mesh, &weld)) != SUCCESS) {
+        obj_destroy(&mesh);
+        return code;
+    }
+    // Position, normal and texture coordinate, in 32 bytes when present.
+    pack_element_t elements[3] = {
+        { PACK_POSITION, PACK_FLOAT32, 3, 0 },
+        { PACK_NORMAL, PACK_FLOAT32, 3, 12 },
+        { PACK_TEXCOORD, PACK_FLOAT32, 2, 24 }
+    };
+    pack_layout_t layout = { elements, 1, 32 };
+    if (mesh.face_norms) {
+        layout.num_elements = 2;
+        if (mesh.face_texs) {
+            layout.num_elements = 3;
+        }
+    }
+    uint8_t* buffer = malloc((size_t)mesh.num_corners * 32 + 1);
+    code = buffer && pack_weld(&weld, &layout, buffer) == SUCCESS 
+        ? SUCCESS : 0;
+    for (uint32_t v = 0; code == SUCCESS && v < weld.num_vertices; v++) {
+        const float* vertex = weld.vertices + (size_t)v * weld.stride;
+        const uint8_t* packed = buffer + (size_t)v * 32;
+        if (memcmp(packed, vertex, 3 * sizeof(float)) != 0 ||
+            (mesh.face_norms && memcmp(packed + 12, 
+            vertex + weld.normal_offset, 3 * sizeof(float)) != 0) ||
+            (mesh.face_norms && mesh.face_texs && memcmp(packed + 24, 
+            vertex + weld.texcoord_offset, 2 * sizeof(float)) != 0)) {
+            code = 0;
+        }
+    }
+
+    // Half-float positions with a fourth component, which must be 1.
+    pack_element_t half = { PACK_POSITION, PACK_FLOAT16, 4, 0 };
+    pack_layout_t half_layout = { &half, 1, 8 };
+    if (code == SUCCESS && 
+        pack_corners(&mesh, &half_layout, buffer) != SUCCESS) {
+        code = 0;
+    }
+    for (uint32_t c = 0; code == SUCCESS && c < mesh.num_corners; c++) {
+        const float* p = mesh.positions + (size_t)(mesh.face_indices[c] - 1) 
+            * mesh.vertex_dim;
+        uint16_t packed[4];
+        memcpy(packed, buffer + (size_t)c * 8, sizeof packed);
+        if (packed[0] != pack_half(p[0]) || packed[1] != pack_half(p[1]) ||
+            packed[2] != pack_half(p[2]) || packed[3] != 0x3C00) {
+            code = 0;
+        }
+    }
+
+    pack_element_t bad = { PACK_POSITION, PACK_FLOAT32, 3, 8 };
+    pack_layout_t bad_layout = { &bad, 1, 16 };
+    if (code == SUCCESS && 
+        pack_weld(&weld, &bad_layout, buffer) != INVALID_DIMS) {
+        code = 0;
+    }
+    pack_element_t missing = { PACK_TEXCOORD, PACK_UNORM16, 2, 0 };
+    pack_layout_t missing_layout = { &missing, 1, 4 };
+    if (code == SUCCESS && !mesh.face_texs && 
+        pack_weld(&weld, &missing_layout, buffer) != NOT_FOUND) {
+        code = 0;
+    }
+    free(buffer);
+    weld_destroy(&weld);
+    obj_destroy(&mesh);
+    return code;
+}
+
+/** Quantizes the file and a mesh of random attributes with every kernel the
+ * processor supports. Every kernel must give the scalar kernel's values, and
+ * the errors must stay within the precision of each format.
+ */
+int test_quantize(const char* fn) {
+    int code;
+    mesh_t meshes[2];
+    const char* random_fn = "out/quantize.obj";
+    FILE* file = fopen(random_fn, "w");
+    if (!file) {
+        return INVALID_FILE;
+    }
+    uint32_t state = 12345;
+    for (uint32_t i = 0; i < 1001; i++) {
+        float r[8];
+        for (int j = 0; j < 8; j++) {
+            state = state * 1664525u + 1013904223u;
+            r[j] = (float)(state >> 8) / 16777216.0f;
+        }
+        fprintf(file, "v %f %f %f\nvn %f %f %f\nvt %f %f\n", r[0] * 10.0f, 
+            r[1] - 5.0f, r[2] * 0.01f, r[3] - 0.5f, r[4] - 0.5f, r[5] - 0.5f, 
+            r[6], r[7]);
+    }
+    fprintf(file, "vn 0 0 0\nf 1/1/1 2/2/2 3/3/3\n");
+    fclose(file);
+    if ((code = obj_read(fn, &meshes[0])) != SUCCESS) {
+        return code;
+    }
+    if ((code = obj_read(random_fn, &meshes[1])) != SUCCESS) {
+        obj_destroy(&meshes[0]);
+        return code;
+    }
+    for (int m = 0; m < 2 && code == SUCCESS; m++) {
+        const mesh_t* mesh = &meshes[m];
+        for (uint32_t bits = 8; bits <= 16 && code == SUCCESS; bits += 8) {
+            quantized_t expected;
+            if ((code = quantize_mesh(mesh, bits, QUANTIZE_SCALAR, &expected))
+                != SUCCESS) {
+                break;
+            }
+            float scale = 0.0f;
+            for (uint32_t c = 0; c < expected.position_dim; c++) {
+                scale = expected.scale[c] > scale ? expected.scale[c] : scale;
+            }
+            if (expected.position_error.max > scale * 0.5f * 1.001f + 1e-6f ||
+                expected.position_error.rms > expected.position_error.max ||
+                expected.normal_error.max > (bits == 8 ? 1.5f : 0.02f) ||
+                expected.texcoord_error.max > 0.0005f) {
+                code = 0;
+            }
+            for (quantize_kernel_t k = QUANTIZE_SSE2; 
+                k <= quantize_best() && code == SUCCESS; k++) {
+                quantized_t actual;
+                if ((code = quantize_mesh(mesh, bits, k, &actual)) != SUCCESS) {
+                    break;
+                }
+                size_t positions = (size_t)mesh->num_vertices 
+                    * mesh->vertex_dim * sizeof *actual.positions;
+                size_t normals = (size_t)mesh->num_normals * 2 * bits / 8;
+                size_t texcoords = (size_t)mesh->num_textures * mesh->tex_dim
+                    * sizeof *actual.texcoords;
+                if (memcmp(expected.positions, actual.positions, positions) ||
+                    memcmp(expected.normals, actual.normals, normals) ||
+                    memcmp(expected.texcoords, actual.texcoords, texcoords)) {
+                    printf("Kernel %s differs from scalar\n", 
+                        quantize_name(k));
+                    code = 0;
+                }
+                quantized_destroy(&actual);
+            }
+            quantized_destroy(&expected);
+        }
+    }
+    obj_destroy(&meshes[0]);
+    obj_destroy(&meshes[1]);
+    return code;
+}
+
+/** Builds index buffers from the welded and the triangulated mesh, and from
+ * indices that need 32 bits.
+ */
+int test_index_buffer(const char* fn) {
+    int code;
+    mesh_t mesh;
+    weld_t weld;
+    index_buffer_t welded, positions;
+    if ((code = obj_read_ex(fn, &mesh, OBJ_TRIANGULATE)) != SUCCESS) {
+        return code;
+    }
+    if ((code = weld_mesh(&mesh, &weld)) != SUCCESS) {
+        obj_destroy(&mesh);
+        return code;
+    }
+    if ((code = index_buffer_from_weld(&weld, &welded)) == SUCCESS &&
+        (code = index_buffer_from_mesh(&mesh, &positions)) == SUCCESS) {
+        uint32_t width = weld.num_vertices < 65536 ? 2 : 4;
+        code = welded.width == width && welded.count == weld.num_indices &&
+            positions.width == (mesh.num_vertices < 65536 ? 2 : 4) &&
+            positions.count == mesh.num_corners ? SUCCESS : 0;
+        for (uint32_t i = 0; code == SUCCESS && i < welded.count; i++) {
+            if (index_buffer_get(&welded, i) != weld.indices[i] ||
+                index_buffer_get(&positions, i) != mesh.face_indices[i] - 1) {
+                code = 0;
+            }
+        }
+        index_buffer_destroy(&positions);
+        index_buffer_destroy(&welded);
+    }
+    weld_destroy(&weld);
+    obj_destroy(&mesh);
+    if (code != SUCCESS) {
+        return code;
+    }
+
+    // 65535 vertices fit in 16 bits. At 65536 the last index would be 0xFFFF,
+    // the primitive restart index, so the buffer widens.
+    const uint32_t indices[] = { 0, 65534, 7, 65535 };
+    index_buffer_t narrow, wide;
+    if ((code = index_buffer_build(indices, 2, 65535, 0, &narrow)) 
+        != SUCCESS) {
+        return code;
+    }
+    if ((code = index_buffer_build(indices, 4, 65536, 0, &wide)) != SUCCESS) {
+        index_buffer_destroy(&narrow);
+        return code;
+    }
+    code = narrow.width == 2 && index_buffer_get(&narrow, 1) == 65534 &&
+        wide.width == 4 && index_buffer_get(&wide, 3) == 65535 ? SUCCESS : 0;
+    index_buffer_destroy(&narrow);
+    index_buffer_destroy(&wide);
+    return code;
+}
+
+static int compare_triangles(const void* a, const void* b) {
+    const uint32_t* x = a;
+    const uint32_t* y = b;
+    for (int i = 0; i < 3; i++) {
+        if (x[i] != y[i]) {
+            return x[i] < y[i] ? -1 : 1;
+        }
+    }
+    return 0;
+}
+
+/** Checks that two triangle lists hold the same triangles, with the same 
+ * winding, in any order. Sorts both lists.
+ */
+static int same_triangles(uint32_t* a, uint32_t* b, uint32_t count) {
+    qsort(a, count / 3, 3 * sizeof *a, compare_triangles);
+    qsort(b, count / 3, 3 * sizeof *b, compare_triangles);
+    return memcmp(a, b, (size_t)count * sizeof *a) == 0;
+}
+
+/** Reorders the welded triangles for the vertex cache. The triangles must 
+ * survive unchanged and the cache must not miss more than before.
+ */
+int test_vertex_cache(const char* fn) {
+    int code;
+    mesh_t mesh;
+    weld_t weld;
+    if ((code = obj_read_ex(fn, &mesh, OBJ_TRIANGULATE)) != SUCCESS) {
+        return code;
+    }
+    code = weld_mesh(&mesh, &weld);
+    obj_destroy(&mesh);
+    if (code != SUCCESS) {
+        return code;
+    }
+    size_t size = (size_t)weld.num_indices * sizeof *weld.indices;
+    uint32_t* original = malloc(size + 1);
+    cache_stats_t before, after;
+    if (!original) {
+        weld_destroy(&weld);
+        return MEMORY_REFUSED;
+    }
+    memcpy(original, weld.indices, size);
+    if ((code = optimize_vertex_cache(weld.indices, weld.num_indices, 
+        weld.num_vertices, &before, &after)) == SUCCESS) {
+        cache_stats_t original_check = optimize_cache_stats(original, 
+            weld.num_indices, weld.num_vertices, OPTIMIZE_FIFO_SIZE);
+        cache_stats_t check = optimize_cache_stats(weld.indices, 
+            weld.num_indices, weld.num_vertices, OPTIMIZE_FIFO_SIZE);
+        printf("ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n", before.acmr, 
+            after.acmr, before.atvr, after.atvr);
+        code = after.acmr <= before.acmr && after.acmr == check.acmr &&
+            after.atvr == check.atvr && before.acmr == original_check.acmr &&
+            before.atvr == original_check.atvr &&
+            after.atvr >= 1.0f && after.acmr <= 3.0f &&
+            same_triangles(original, weld.indices, weld.num_indices) 
+            ? SUCCESS : 0;
+    }
+    free(original);
+    weld_destroy(&weld);
+    if (code != SUCCESS) {
+        return code;
+    }
+    // Two triangles sharing an edge miss four times in any order.
+    uint32_t quad[] = { 0, 1, 2, 2, 1, 3 };
+    if (optimize_vertex_cache(quad, 5, 4, NULL, NULL) != INVALID_DIMS ||
+        optimize_vertex_cache(quad, 6, 4, &before, &after) != SUCCESS) {
+        return 0;
+    }
+    return before.acmr == 2.0f && after.acmr == 2.0f && after.atvr == 1.0f 
+        ? SUCCESS : 0;
+}
+
+/** Renumbers the vertices after reordering the triangles, then clusters the
+ * triangles for overdraw. Every corner must keep its vertex data, the 
+ * vertices must come in first-use order, and the clusters must keep the 
+ * triangles and, within the threshold, the cache misses.
+ */
+int test_vertex_fetch(const char* fn) {
+    int code;
+    mesh_t mesh;
+    weld_t weld;
+    if ((code = obj_read_ex(fn, &mesh, OBJ_TRIANGULATE)) != SUCCESS) {
+        return code;
+    }
+    uint32_t dim = mesh.vertex_dim;
+    code = weld_mesh(&mesh, &weld);
+    obj_destroy(&mesh);
+    if (code != SUCCESS) {
+        return code;
+    }
+    uint32_t vertex_size = weld.stride * sizeof *weld.vertices;
+    size_t size = (size_t)weld.num_indices * vertex_size;
+    float* corners = malloc(size + 1);
+    uint32_t* sorted = malloc((size_t)weld.num_indices * sizeof *sorted + 1);
+    if (!corners || !sorted || (code = optimize_vertex_cache(weld.indices, 
+        weld.num_indices, weld.num_vertices, NULL, NULL)) != SUCCESS) {
+        code = code == SUCCESS ? MEMORY_REFUSED : code;
+        goto done;
+    }
+    for (uint32_t i = 0; i < weld.num_indices; i++) {
+        memcpy(corners + (size_t)i * weld.stride, weld.vertices 
+            + (size_t)weld.indices[i] * weld.stride, vertex_size);
+    }
+    fetch_stats_t before = optimize_fetch_stats(weld.indices, 
+        weld.num_indices, weld.num_vertices, vertex_size);
+    uint32_t used;
+    if ((code = optimize_vertex_fetch(weld.vertices, weld.stride, 
+        weld.indices, weld.num_indices, weld.num_vertices, &used)) 
+        != SUCCESS) {
+        goto done;
+    }
+    fetch_stats_t after = optimize_fetch_stats(weld.indices, 
+        weld.num_indices, weld.num_vertices, vertex_size);
+    printf("Overfetch %.3f -> %.3f\n", before.overfetch, after.overfetch);
+    uint32_t next = 0;
+    // First-use order may fetch a little more when the layout was already 
+    // close to draw order, but never much more.
+    code = used == weld.num_vertices && after.overfetch >= 1.0f 
+        && after.overfetch <= before.overfetch * 1.05f ? SUCCESS : 0;
+    for (uint32_t i = 0; i < weld.num_indices && code == SUCCESS; i++) {
+        if (weld.indices[i] > next || memcmp(corners + (size_t)i * weld.stride,
+            weld.vertices + (size_t)weld.indices[i] * weld.stride, 
+            vertex_size) != 0) {
+            code = 0;
+        }
+        next += weld.indices[i] == next;
+    }
+    if (code != SUCCESS) {
+        goto done;
+    }
+
+    cache_stats_t cache = optimize_cache_stats(weld.indices, 
+        weld.num_indices, weld.num_vertices, OPTIMIZE_FIFO_SIZE);
+    memcpy(sorted, weld.indices, (size_t)weld.num_indices * sizeof *sorted);
+    if ((code = optimize_overdraw(weld.indices, weld.num_indices, 
+        weld.vertices, weld.stride, dim, weld.num_vertices, 
+        1.05f)) != SUCCESS) {
+        goto done;
+    }
+    cache_stats_t clustered = optimize_cache_stats(weld.indices, 
+        weld.num_indices, weld.num_vertices, OPTIMIZE_FIFO_SIZE);
+    printf("Overdraw clusters ACMR %.3f -> %.3f\n", cache.acmr, 
+        clustered.acmr);
+    code = clustered.acmr <= cache.acmr * 1.05f + 0.05f && 
+        same_triangles(sorted, weld.indices, weld.num_indices) ? SUCCESS : 0;
+done:
+    free(corners);
+    free(sorted);
+    weld_destroy(&weld);
+    return code;
+}
+
+/** Checks that every level of a chain keeps to its budget and holds no 
+ * triangle with two corners at one position.
+ */
+static int check_levels(const lod_chain_t* chain, uint32_t num_triangles) {
+    const weld_t* weld = &chain->weld;
+    float error = 0.0f;
+    for (uint32_t i = 0; i < chain->num_levels; i++) {
+        const lod_t* level = chain->levels + i;
+        if (level->num_indices / 3 > num_triangles || level->error < error) {
+            return 0;
+        }
+        error = level->error;
+        for (uint32_t c = 0; c < level->num_indices; c += 3) {
+            const float* p[3];
+            for (uint32_t j = 0; j < 3; j++) {
+                if (level->indices[c + j] >= weld->num_vertices) {
+                    return 0;
+                }
+                p[j] = weld->vertices 
+                    + (size_t)level->indices[c + j] * weld->stride;
+            }
+            for (uint32_t j = 0; j < 3; j++) {
+                if (memcmp(p[j], p[(j + 1) % 3], 3 * sizeof *p[j]) == 0) {
+                    return 0;
+                }
+            }
+        }
+        num_triangles = level->num_indices / 3;
+    }
+    return 1;
+}
+
+/** Simplifies the mesh into a chain of levels, then a flat grid split by a 
+ * UV seam down the middle and by a material boundary across it. Flat, the 
+ * grid simplifies freely, but no triangle may cross either line or take 
+ * texture coordinates from the other side of the seam.
+ */
+int test_simplify(const char* fn) {
+    int code;
+    mesh_t mesh;
+    lod_chain_t chain;
+    const float ratios[] = { 0.5f, 0.25f, 0.125f };
+    if ((code = obj_read_ex(fn, &mesh, OBJ_TRIANGULATE)) != SUCCESS) {
+        return code;
+    }
+    if ((code = simplify_lod_chain(&mesh, ratios, 3, &chain)) == SUCCESS) {
+        printf("LODs");
+        for (uint32_t i = 0; i < chain.num_levels; i++) {
+            printf(" %u (error %g)", chain.levels[i].num_indices / 3, 
+                chain.levels[i].error);
+        }
+        printf("\n");
+        code = check_levels(&chain, mesh.num_faces) ? SUCCESS : 0;
+        lod_chain_destroy(&chain);
+    }
+    const float bad[] = { 0.25f, 0.5f };
+    if (code == SUCCESS && 
+        simplify_lod_chain(&mesh, bad, 2, &chain) != INVALID_DIMS) {
+        code = 0;
+    }
+    obj_destroy(&mesh);
+    if (code != SUCCESS) {
+        return code;
+    }
+
+    const char* grid_fn = "out/simplify.obj";
+    const uint32_t size = 16, half = size / 2;
+    FILE* file = fopen(grid_fn, "w");
+    if (!file) {
+        return INVALID_FILE;
+    }
+    for (uint32_t y = 0; y <= size; y++) {
+        for (uint32_t x = 0; x <= size; x++) {
+            fprintf(file, "v %u %u 0\nvt %g %g\nvt %g %g\n", x, y, 
+                (double)x / size, (double)y / size, 1.0 + (double)x / size,
+                (double)y / size);
+        }
+    }
+    for (uint32_t y = 0; y < size; y++) {
+        for (uint32_t x = 0; x < size; x++) {
+            uint32_t v[4] = { y * (size + 1) + x + 1, y * (size + 1) + x + 2,
+                (y + 1) * (size + 1) + x + 2, (y + 1) * (size + 1) + x + 1 };
+            uint32_t side = x < half ? 1 : 0;
+            fprintf(file, "f %u/%u %u/%u %u/%u\nf %u/%u %u/%u %u/%u\n", 
+                v[0], 2 * v[0] - side, v[1], 2 * v[1] - side, 
+                v[2], 2 * v[2] - side, v[0], 2 * v[0] - side,
+                v[2], 2 * v[2] - side, v[3], 2 * v[3] - side);
+        }
+    }
+    fclose(file);
+    if ((code = obj_read_ex(grid_fn, &mesh, OBJ_TRIANGULATE)) != SUCCESS) {
+        return code;
+    }
+    static mtl_t bottom, top;
+    for (uint32_t f = 0; f < mesh.num_faces; f++) {
+        const uint32_t* indices = obj_face_indices(&mesh, f);
+        float y = mesh.positions[(indices[0] - 1) * mesh.vertex_dim + 1] 
+            + mesh.positions[(indices[1] - 1) * mesh.vertex_dim + 1]
+            + mesh.positions[(indices[2] - 1) * mesh.vertex_dim + 1];
+        mesh.face_data[f].material = y < 3.0f * half ? &bottom : &top;
+    }
+    code = simplify_lod_chain(&mesh, ratios, 2, &chain);
+    if (code == SUCCESS) {
+        const lod_t* level = chain.levels + 1;
+        code = check_levels(&chain, mesh.num_faces) &&
+            level->num_indices / 3 <= mesh.num_faces / 4 ? SUCCESS : 0;
+        for (uint32_t c = 0; c < level->num_indices && code == SUCCESS; 
+            c += 3) {
+            float low[3] = { (float)size, (float)size, 2.0f };
+            float high[3] = { 0.0f, 0.0f, 0.0f };
+            for (uint32_t j = 0; j < 3; j++) {
+                const float* v = chain.weld.vertices + (size_t)
+                    level->indices[c + j] * chain.weld.stride;
+                const float values[3] = { v[0], v[1], 
+                    v[chain.weld.texcoord_offset] };
+                for (uint32_t k = 0; k < 3; k++) {
+                    low[k] = values[k] < low[k] ? values[k] : low[k];
+                    high[k] = values[k] > high[k] ? values[k] : high[k];
+                }
+            }
+            if ((low[0] < half && high[0] > half) || 
+                (low[1] < half && high[1] > half) || 
+                (high[0] <= half && high[2] > 0.5f) || 
+                (low[0] >= half && low[2] < 1.0f)) {
+                code = 0;
+            }
+        }
+        lod_chain_destroy(&chain);
+    }
+    obj_destroy(&mesh);
+    return code;
+}
+
+/** Checks one meshlet: its limits, that its sphere holds its vertices, that 
+ * its cone holds its normals, and that whenever it reports facing away from a
+ * camera every one of its triangles does. Appends its triangles to out.
+ */
+static int check_meshlet(const meshlets_t* meshlets, 
+    const meshlet_t* meshlet, 
+    const weld_t* weld, 
+    uint32_t** out) {
+    if (meshlet->vertex_count > MESHLET_MAX_VERTICES || 
+        meshlet->triangle_count > MESHLET_MAX_TRIANGLES || 
+        meshlet->triangle_count == 0) {
+        return 0;
+    }
+    const uint32_t* vertices = meshlets->vertices + meshlet->vertex_offset;
+    const uint8_t* triangles = meshlets->triangles + meshlet->triangle_offset;
+    for (uint32_t i = 0; i < meshlet->vertex_count; i++) {
+        const float* p = weld->vertices + (size_t)vertices[i] * weld->stride;
+        float distance = 0.0f;
+        for (uint32_t k = 0; k < 3; k++) {
+            distance += (p[k] - meshlet->center[k]) 
+                * (p[k] - meshlet->center[k]);
+        }
+        if (sqrtf(distance) > meshlet->radius) {
+            return 0;
+        }
+    }
+    float min_dot = sqrtf(1.0f - meshlet->cone_cutoff * meshlet->cone_cutoff);
+    for (uint32_t i = 0; i < meshlet->triangle_count; i++) {
+        const float* p[3];
+        for (uint32_t j = 0; j < 3; j++) {
+            if (triangles[3 * i + j] >= meshlet->vertex_count) {
+                return 0;
+            }
+            *(*out)++ = vertices[triangles[3 * i + j]];
+            p[j] = weld->vertices 
+                + (size_t)vertices[triangles[3 * i + j]] * weld->stride;
+        }
+        float e[3], f[3], n[3];
+        for (uint32_t k = 0; k < 3; k++) {
+            e[k] = p[1][k] - p[0][k];
+            f[k] = p[2][k] - p[0][k];
+        }
+        n[0] = e[1] * f[2] - e[2] * f[1];
+        n[1] = e[2] * f[0] - e[0] * f[2];
+        n[2] = e[0] * f[1] - e[1] * f[0];
+        float length = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (length == 0.0f || meshlet->cone_cutoff >= 1.0f) {
+            continue;
+        }
+        if ((n[0] * meshlet->cone_axis[0] + n[1] * meshlet->cone_axis[1] 
+            + n[2] * meshlet->cone_axis[2]) / length < min_dot - 1e-3f) {
+            return 0;
+        }
+        // Cameras all around the meshlet, near and far.
+        for (int c = 0; c < 27 * 2; c++) {
+            float camera[3];
+            float scale = (c < 27 ? 2.0f : 20.0f) * meshlet->radius;
+            for (uint32_t k = 0; k < 3; k++) {
+                int step = k == 0 ? c % 3 : k == 1 ? c / 3 % 3 : c / 9 % 3;
+                camera[k] = meshlet->center[k] + (float)(step - 1) * scale;
+            }
+            float facing = 0.0f;
+            for (uint32_t k = 0; k < 3; k++) {
+                facing += n[k] * (camera[k] - p[0][k]);
+            }
+            if (meshlet_is_backfacing(meshlet, camera) && 
+                facing > 1e-4f * length * scale) {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+/** Partitions the welded triangles into meshlets, which must hold every 
+ * triangle exactly once and bound them correctly.
+ */
+int test_meshlets(const char* fn) {
+    int code;
+    mesh_t mesh;
+    weld_t weld;
+    meshlets_t meshlets;
+    if ((code = obj_read_ex(fn, &mesh, OBJ_TRIANGULATE)) != SUCCESS) {
+        return code;
+    }
+    uint32_t dim = mesh.vertex_dim;
+    code = weld_mesh(&mesh, &weld);
+    obj_destroy(&mesh);
+    if (code != SUCCESS) {
+        return code;
+    }
+    if (meshlet_build(weld.indices, weld.num_indices, weld.vertices, 
+        weld.stride, dim, weld.num_vertices, 2, MESHLET_MAX_TRIANGLES, 
+        &meshlets) != INVALID_DIMS) {
+        weld_destroy(&weld);
+        return 0;
+    }
+    if ((code = meshlet_build(weld.indices, weld.num_indices, weld.vertices, 
+        weld.stride, dim, weld.num_vertices, MESHLET_MAX_VERTICES, 
+        MESHLET_MAX_TRIANGLES, &meshlets)) != SUCCESS) {
+        weld_destroy(&weld);
+        return code;
+    }
+    uint32_t* gathered = malloc((size_t)weld.num_indices * sizeof *gathered
+        + 1);
+    uint32_t* out = gathered;
+    code = gathered && meshlets.num_triangles == weld.num_indices 
+        ? SUCCESS : 0;
+    uint32_t culled = 0;
+    for (uint32_t i = 0; i < meshlets.num_meshlets && code == SUCCESS; i++) {
+        code = check_meshlet(&meshlets, meshlets.meshlets + i, &weld, &out) 
+            ? SUCCESS : 0;
+        culled += meshlets.meshlets[i].cone_cutoff < 1.0f;
+    }
+    if (code == SUCCESS) {
+        printf("%u meshlets, %u with a normal cone\n", meshlets.num_meshlets,
+            culled);
+        code = same_triangles(gathered, weld.indices, weld.num_indices) 
+            ? SUCCESS : 0;
+    }
+    free(gathered);
+    meshlets_destroy(&meshlets);
+    weld_destroy(&weld);
+    return code;
+}
+
+/** Writes a strip of quads split into several chunks, with smoothing groups
+ * changing between and inside chunks, and checks the group of every face of
+ * every reader.
+ */
+int test_smoothing_groups(void) {
+    int code;
+    mesh_t mesh;
+    const char* fn = "out/smoothing.obj";
+    const uint32_t quads = 20000;
+    FILE* file = fopen(fn, "w");
+    if (!file) {
+        return INVALID_FILE;
+    }
+    fprintf(file, "v 0 0 0\nv 0 1 0\n");
+    for (uint32_t i = 1; i <= quads; i++) {
+        if (i % 3000 == 0) {
+            uint32_t group = i / 3000 % 3;
+            fprintf(file, group ? "s %u\n" : "s off\n", group);
+        }
+        fprintf(file, "v %u 0 0\nv %u 1 0\nf -4 -2 -1 -3\n", i, i);
+    }
+    fclose(file);
+    if ((code = test_parallel(fn, 8)) != SUCCESS) {
+        return code;
+    }
+    for (int reader = 0; reader < 2 && code == SUCCESS; reader++) {
+        if ((code = reader ? obj_read_parallel(fn, &mesh, OBJ_TRIANGULATE, 8)
+            : obj_read_ex(fn, &mesh, OBJ_TRIANGULATE)) != SUCCESS) {
+            return code;
+        }
+        code = mesh.num_faces == 2 * quads && mesh.face_smoothing 
+            ? SUCCESS : 0;
+        for (uint32_t i = 0; i < mesh.num_faces && code == SUCCESS; i++) {
+            uint32_t quad = i / 2 + 1;
+            if (mesh.face_smoothing[i] != quad / 3000 % 3) {
+                code = 0;
+            }
+        }
+        obj_destroy(&mesh);
+    }
+    if (code != SUCCESS) {
+        return code;
+    }
+    if ((code = test_read_code(fn, "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 3\n", 
+        SUCCESS)) != SUCCESS || (code = obj_read(fn, &mesh)) != SUCCESS) {
+        return code;
+    }
+    code = mesh.face_smoothing == NULL ? SUCCESS : 0;
+    obj_destroy(&mesh);
+    return code;
+}
+
+/** Checks the normals of a cube centered on the origin, read from a file with
+ * the given smoothing lines before its faces.
+ * @param fn The file to write the cube to.
+ * @param smoothing The "s" line, or an empty string.
+ * @param mode The normals to generate.
+ * @param crease_angle The crease angle.
+ * @param expected The expected number of normals.
+ * @param smooth Set if every normal must point along its position, otherwise
+ * along its face.
+ */
+static int check_cube(const char* fn, 
+    const char* smoothing, 
+    normals_mode mode, 
+    float crease_angle, 
+    uint32_t expected, 
+    int smooth) {
+    int code;
+    mesh_t mesh;
+    FILE* file = fopen(fn, "w");
+    if (!file) {
+        return INVALID_FILE;
+    }
+    fprintf(file, "v 1 1 -1\nv 1 -1 -1\nv 1 1 1\nv 1 -1 1\nv -1 1 -1\n"
+        "v -1 -1 -1\nv -1 1 1\nv -1 -1 1\n%sf 1 5 7 3\nf 4 3 7 8\n"
+        "f 8 7 5 6\nf 6 2 4 8\nf 2 1 3 4\nf 6 5 1 2\n", smoothing);
+    fclose(file);
+    if ((code = obj_read(fn, &mesh)) != SUCCESS) {
+        return code;
+    }
+    if ((code = normals_generate(&mesh, mode, crease_angle, 2)) != SUCCESS) {
+        obj_destroy(&mesh);
+        return code;
+    }
+    code = mesh.num_normals == expected && mesh.face_flag.flag & norm_flag 
+        ? SUCCESS : 0;
+    for (uint32_t i = 0; i < mesh.num_faces && code == SUCCESS; i++) {
+        const uint32_t* indices = mesh.face_data[i].indices;
+        for (uint32_t j = 0; j < obj_face_size(&mesh, i); j++) {
+            const float* n = mesh.normal_data[mesh.face_data[i].norms[j] - 1]
+                .norm;
+            const float* p = mesh.vertex_data[indices[j] - 1].pos;
+            const float* q = mesh.vertex_data[indices[(j + 2) % 4] - 1].pos;
+            for (uint32_t k = 0; k < 3; k++) {
+                // The face's normal is its only component where its opposite
+                // corners agree.
+                float want = smooth ? p[k] / sqrtf(3.0f) 
+                    : p[k] == q[k] ? p[k] : 0.0f;
+                if (fabsf(n[k] - want) > 1e-6f) {
+                    code = 0;
+                }
+            }
+        }
+    }
+    obj_destroy(&mesh);
+    return code;
+}
+
+/** Generates normals for a cube and for the file, checking them against 
+ * their faces and that neither the reader nor the thread count changes them.
+ */
+int test_normals(const char* fn) {
+    int code;
+    mesh_t mesh;
+    mesh_t other;
+    const char* cube = "out/normals.obj";
+    const float pi = 3.14159265f;
+    if (check_cube(cube, "", NORMALS_SMOOTH, NORMALS_NO_CREASE, 8, 1) 
+        != SUCCESS ||
+        check_cube(cube, "s 1\n", NORMALS_SMOOTH, NORMALS_NO_CREASE, 8, 1) 
+        != SUCCESS ||
+        check_cube(cube, "s 1\n", NORMALS_SMOOTH, pi / 4, 24, 0) 
+        != SUCCESS ||
+        check_cube(cube, "s off\n", NORMALS_SMOOTH, NORMALS_NO_CREASE, 6, 0) 
+        != SUCCESS ||
+        check_cube(cube, "", NORMALS_FLAT, NORMALS_NO_CREASE, 6, 0) 
+        != SUCCESS) {
+        return 0;
+    }
+    // The load flags only fill in missing normals.
+    if ((code = obj_read_ex(cube, &mesh, OBJ_SMOOTH_NORMALS)) != SUCCESS) {
+        return code;
+    }
+    code = mesh.num_normals == 8 ? SUCCESS : 0;
+    obj_destroy(&mesh);
+    if (code != SUCCESS || test_read_code(cube, "v 0 0 0\nv 1 0 0\nv 0 1 0\n"
+        "vn 0 0 -1\nf 1//1 2//1 3//1\n", SUCCESS) != SUCCESS || 
+        obj_read_ex(cube, &mesh, OBJ_SMOOTH_NORMALS) != SUCCESS) {
+        return 0;
+    }
+    code = mesh.num_normals == 1 && mesh.normals[2] == -1.0f ? SUCCESS : 0;
+    obj_destroy(&mesh);
+    if (code != SUCCESS || 
+        test_read_code(cube, "v 0 0\nv 1 0\nv 0 1\nf 1 2 3\n", SUCCESS) 
+        != SUCCESS || 
+        obj_read_ex(cube, &mesh, OBJ_FLAT_NORMALS) != INVALID_DIMS) {
+        return 0;
+    }
+    // With no faces there is nothing to fill in, even without positions.
+    static const char* faceless[] = { "", "vn 0 0 1\n", "v 0 0\nv 1 0\n" };
+    for (size_t i = 0; i < sizeof faceless / sizeof *faceless; i++) {
+        if (test_read_code(cube, faceless[i], SUCCESS) != SUCCESS) {
+            return 0;
+        }
+        for (uint32_t flags = OBJ_FLAT_NORMALS; flags <= OBJ_SMOOTH_NORMALS;
+            flags <<= 1) {
+            code = obj_read_ex(cube, &mesh, flags);
+            obj_destroy(&mesh);
+            if (code != SUCCESS || 
+                (code = obj_read_parallel(cube, &mesh, flags, 4)) != SUCCESS) {
+                return 0;
+            }
+            obj_destroy(&mesh);
+        }
+    }
+
+    const uint32_t flags = OBJ_TRIANGULATE | OBJ_SMOOTH_NORMALS;
+    if ((code = obj_read_ex(fn, &mesh, flags)) != SUCCESS) {
+        return code;
+    }
+    if ((code = obj_read_parallel(fn, &other, flags, 4)) != SUCCESS) {
+        obj_destroy(&mesh);
+        return code;
+    }
+    code = test_mesh_equal(&mesh, &other);
+    for (uint32_t m = 0; m < 2 && code == SUCCESS; m++) {
+        normals_mode mode = m ? NORMALS_FLAT : NORMALS_SMOOTH;
+        if ((code = normals_generate(&mesh, mode, pi / 3, 1)) != SUCCESS ||
+            (code = normals_generate(&other, mode, pi / 3, 7)) != SUCCESS) {
+            break;
+        }
+        code = test_mesh_equal(&mesh, &other) == SUCCESS &&
+            (mode == NORMALS_SMOOTH || mesh.num_normals == mesh.num_faces) 
+            ? SUCCESS : 0;
+        // Within the crease angle, a corner's normal leans towards its face.
+        for (uint32_t i = 0; i < mesh.num_faces && code == SUCCESS; i++) {
+            const float* a = mesh.vertex_data[mesh.face_data[i].indices[0] - 1]
+                .pos;
+            const float* b = mesh.vertex_data[mesh.face_data[i].indices[1] - 1]
+                .pos;
+            const float* c = mesh.vertex_data[mesh.face_data[i].indices[2] - 1]
+                .pos;
+            float f[3] = {
+                (b[1] - a[1]) * (c[2] - a[2]) - (b[2] - a[2]) * (c[1] - a[1]),
+                (b[2] - a[2]) * (c[0] - a[0]) - (b[0] - a[0]) * (c[2] - a[2]),
+                (b[0] - a[0]) * (c[1] - a[1]) - (b[1] - a[1]) * (c[0] - a[0])
+            };
+            float area = sqrtf(f[0] * f[0] + f[1] * f[1] + f[2] * f[2]);
+            for (uint32_t j = 0; j < 3; j++) {
+                const float* n = mesh.normal_data[mesh.face_data[i].norms[j]
+                    - 1].norm;
+                float length = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+                float lean = n[0] * f[0] + n[1] * f[1] + n[2] * f[2];
+                if (area > 1e-12f && (fabsf(length - 1.0f) > 1e-5f || 
+                    lean <= 0.0f || 
+                    (mode == NORMALS_FLAT && lean < 0.9999f * area))) {
+                    code = 0;
+                }
+            }
+        }
+    }
+    obj_destroy(&mesh);
+    obj_destroy(&other);
+    return code;
+}
+
+/** Writes a grid of 8 by 4 quads over [0, 2] x [0, 1] whose texture is
+ * mirrored in x at its middle, so the right half maps with the opposite 
+ * orientation. A flat grid has one normal and ends with a degenerate 
+ * triangle at its first corner; a bumpy one has no normals.
+ */
+static int write_grid(const char* fn, int bumpy) {
+    static char lines[16384];
+    int length = 0;
+    for (uint32_t y = 0; y <= 4; y++) {
+        for (uint32_t x = 0; x <= 8; x++) {
+            float px = x * 0.25f, py = y * 0.25f;
+            float z = bumpy ? 0.1f * sinf(3.0f * px) * cosf(2.0f * py) : 0.0f;
+            length += sprintf(lines + length, "v %g %g %g\nvt %g %g\n", px, py,
+                z, px <= 1.0f ? px : 2.0f - px, py);
+        }
+    }
+    length += sprintf(lines + length, bumpy ? "" : "vn 0 0 1\n");
+    for (uint32_t y = 0; y < 4; y++) {
+        for (uint32_t x = 0; x < 8; x++) {
+            uint32_t a = y * 9 + x + 1;
+            uint32_t q[4] = { a, a + 1, a + 10, a + 9 };
+            length += sprintf(lines + length, "f");
+            for (uint32_t j = 0; j < 4; j++) {
+                length += sprintf(lines + length, bumpy ? " %u/%u" : " %u/%u/1",
+                    q[j], q[j]);
+            }
+            length += sprintf(lines + length, "\n");
+        }
+    }
+    if (!bumpy) {
+        sprintf(lines + length, "f 1/1/1 1/1/1 2/2/1\n");
+    }
+    return test_read_code(fn, lines, SUCCESS);
+}
+
+/** Generates tangents for a small curved patch and compares them with values
+ * worked out in double precision by following the reference MikkTSpace step 
+ * by step: welding, triangle frames, grouping around each vertex by edges and
+ * orientation, angle-weighted averages projected onto each normal, and the 
+ * copies for degenerate triangles. The middle column is mapped across a seam
+ * from the left one, the right column is mirrored, and the last triangle is 
+ * degenerate and copies the first good corners of its vertices.
+ * @returns SUCCESS if every tangent and sign is within 1e-5 of the reference.
+ */
+static int check_reference_tangents(void) {
+    const char* fn = "out/reference_tangents.obj";
+    const char* lines = 
+        "v 0 0 0\nv 1 0 0.2\nv 2 0.1 0.5\nv 3 0 0.4\nv 0 1 0.1\n"
+        "v 1.1 1 0.3\nv 2 1 0.6\nv 3 1.2 0.5\nvt 0 0\nvt 0.45 0.05\n"
+        "vt 0.5 0.55\nvt 0.02 0.5\nvt 0.6 0\nvt 1 0.1\nvt 0.95 0.5\n"
+        "vt 0.62 0.48\nvt 0.7 0.12\nvt 0.68 0.52\n"
+        "vn 0.099380799 -0.0496903995 0.99380799\n"
+        "vn -0.148340453 0 0.988936353\n"
+        "vn -0.195180015 -0.0975900073 0.975900073\n"
+        "vn 0.0496903995 0.099380799 0.99380799\n"
+        "vn 0 -0.196116135 0.980580676\n"
+        "vn -0.0984135663 -0.147620349 0.984135663\n"
+        "vn -0.242250792 0.0484501583 0.969003166\n"
+        "vn 0.099503719 0 0.99503719\nf 1/1/1 2/2/2 6/3/6\n"
+        "f 1/1/1 6/3/6 5/4/5\nf 2/5/2 3/6/3 7/7/7\nf 2/5/2 7/7/7 6/8/6\n"
+        "f 3/6/3 4/9/4 8/10/8\nf 3/6/3 8/10/8 7/7/7\nf 6/8/6 7/7/7 6/8/6\n";
+    static const float expected[21][4] = {
+        { 0.991165f, -0.083218f, -0.103277f, 1.0f },
+        { 0.984098f, -0.098796f, 0.147615f, 1.0f },
+        { 0.992926f, -0.080578f, 0.087206f, 1.0f },
+        { 0.991165f, -0.083218f, -0.103277f, 1.0f },
+        { 0.992926f, -0.080578f, 0.087206f, 1.0f },
+        { 0.998476f, -0.054113f, -0.010823f, 1.0f },
+        { 0.985618f, -0.081852f, 0.147843f, 1.0f },
+        { 0.976500f, -0.112057f, 0.184094f, 1.0f },
+        { 0.965607f, -0.085171f, 0.245660f, 1.0f },
+        { 0.985618f, -0.081852f, 0.147843f, 1.0f },
+        { 0.965607f, -0.085171f, 0.245660f, 1.0f },
+        { 0.995141f, -0.011722f, 0.097756f, 1.0f },
+        { -0.980113f, 0.055751f, -0.190447f, -1.0f },
+        { -0.987995f, 0.150623f, 0.034337f, -1.0f },
+        { -0.994936f, 0.014278f, 0.099494f, -1.0f },
+        { -0.980113f, 0.055751f, -0.190447f, -1.0f },
+        { -0.994936f, 0.014278f, 0.099494f, -1.0f },
+        { -0.956638f, -0.178419f, -0.230239f, -1.0f },
+        { 0.995141f, -0.011722f, 0.097756f, 1.0f },
+        { 0.965607f, -0.085171f, 0.245660f, 1.0f },
+        { 0.995141f, -0.011722f, 0.097756f, 1.0f }
+    };
+    mesh_t mesh;
+    int code;
+    if ((code = test_read_code(fn, lines, SUCCESS)) != SUCCESS ||
+        (code = obj_read_ex(fn, &mesh, OBJ_TRIANGULATE | OBJ_TANGENTS)) 
+        != SUCCESS) {
+        return 0;
+    }
+    code = mesh.tangents && mesh.num_corners == 21 ? SUCCESS : 0;
+    for (uint32_t c = 0; c < 21 && code == SUCCESS; c++) {
+        const float* t = mesh.tangents + 4 * (size_t)c;
+        for (uint32_t k = 0; k < 4; k++) {
+            if (fabsf(t[k] - expected[c][k]) > 1e-5f) {
+                printf("Corner %u: tangent (%f, %f, %f, %f) differs from "
+                    "the reference\n", c, t[0], t[1], t[2], t[3]);
+                code = 0;
+                break;
+            }
+        }
+    }
+    obj_destroy(&mesh);
+    return code;
+}
+
+/** Generates tangents for a mirrored grid, checking them against the texture
+ * gradients and the welding of its seam, and for a bumpy grid, checking 
+ * that neither the reader nor the thread count changes them. Also compares
+ * a small patch with the reference.
+ */
+int test_tangents(const char* fn) {
+    int code;
+    mesh_t mesh;
+    mesh_t other;
+    const char* grid = "out/tangents.obj";
+    if (check_reference_tangents() != SUCCESS) {
+        return 0;
+    }
+    if (write_grid(grid, 0) != SUCCESS ||
+        (code = obj_read_ex(grid, &mesh, OBJ_TANGENTS)) != SUCCESS) {
+        return 0;
+    }
+    code = mesh.tangents && mesh.face_dim == 3 && 
+        mesh.num_faces == 65 ? SUCCESS : 0;
+    // dP/du is +x on the left half and -x on the mirrored right half, where
+    // the bitangent keeps pointing along dP/dv by flipping its sign.
+    for (uint32_t i = 0; i < mesh.num_faces && code == SUCCESS; i++) {
+        const uint32_t* indices = mesh.face_data[i].indices;
+        float x = 0.0f;
+        for (uint32_t j = 0; j < 3; j++) {
+            x += mesh.vertex_data[indices[j] - 1].pos[0] / 3.0f;
+        }
+        float s = x < 1.0f ? 1.0f : -1.0f;
+        for (uint32_t j = 0; j < 3; j++) {
+            const float* t = mesh.tangents + 4 * (size_t)(3 * i + j);
+            const float n[3] = { 0.0f, 0.0f, 1.0f };
+            float b[3];
+            tangents_bitangent(n, t, b);
+            if (fabsf(t[0] - s) > 1e-6f || fabsf(t[1]) > 1e-6f || 
+                fabsf(t[2]) > 1e-6f || t[3] != s || fabsf(b[0]) > 1e-6f ||
+                fabsf(b[1] - 1.0f) > 1e-6f || fabsf(b[2]) > 1e-6f) {
+                code = 0;
+            }
+        }
+    }
+    // The seam's five positions weld into two vertices each.
+    weld_t weld;
+    if (code != SUCCESS || (code = weld_mesh(&mesh, &weld)) != SUCCESS) {
+        obj_destroy(&mesh);
+        return 0;
+    }
+    const pack_element_t element = { PACK_TANGENT, PACK_FLOAT32, 4, 0 };
+    const pack_layout_t layout = { &element, 1, 4 * sizeof(float) };
+    float* packed = malloc((size_t)weld.num_vertices * 4 * sizeof(float) + 1);
+    code = packed && weld.num_vertices == 50 && weld.flag & WELD_TANGENT_FLAG &&
+        weld.stride == weld.tangent_offset + 4 ? SUCCESS : 0;
+    if (code == SUCCESS && 
+        (code = pack_weld(&weld, &layout, packed)) == SUCCESS) {
+        for (uint32_t c = 0; c < weld.num_indices; c++) {
+            if (memcmp(packed + 4 * (size_t)weld.indices[c], 
+                mesh.tangents + 4 * (size_t)c, 4 * sizeof(float)) != 0) {
+                code = 0;
+            }
+        }
+    }
+    free(packed);
+    weld_destroy(&weld);
+    obj_destroy(&mesh);
+    if (code != SUCCESS) {
+        return 0;
+    }
+
+    // A file without texture coordinates reads without tangents.
+    if ((code = obj_read_ex(fn, &mesh, OBJ_TANGENTS | OBJ_SMOOTH_NORMALS)) 
+        != SUCCESS) {
+        return code;
+    }
+    code = !mesh.tangents && (mesh.face_texs || 
+        tangents_generate(&mesh, 0) == NOT_FOUND) ? SUCCESS : 0;
+    obj_destroy(&mesh);
+    if (code != SUCCESS) {
+        return 0;
+    }
+
+    const uint32_t flags = OBJ_TANGENTS | OBJ_SMOOTH_NORMALS;
+    if (write_grid(grid, 1) != SUCCESS ||
+        (code = obj_read_ex(grid, &mesh, flags)) != SUCCESS) {
+        return 0;
+    }
+    if ((code = obj_read_parallel(grid, &other, flags, 4)) != SUCCESS) {
+        obj_destroy(&mesh);
+        return code;
+    }
+    code = test_mesh_equal(&mesh, &other);
+    if (code == SUCCESS && 
+        ((code = tangents_generate(&mesh, 1)) != SUCCESS ||
+        (code = tangents_generate(&other, 7)) != SUCCESS)) {
+        code = 0;
+    }
+    if (code == SUCCESS) {
+        code = test_mesh_equal(&mesh, &other);
+    }
+    // Every tangent is a unit vector in the plane of its corner's normal.
+    for (uint32_t c = 0; c < mesh.num_corners && code == SUCCESS; c++) {
+        const float* t = mesh.tangents + 4 * (size_t)c;
+        const float* n = mesh.normals + (size_t)(mesh.face_norms[c] - 1) * 3;
+        float length = sqrtf(t[0] * t[0] + t[1] * t[1] + t[2] * t[2]);
+        float normal = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        float dot = (t[0] * n[0] + t[1] * n[1] + t[2] * n[2]) / normal;
+        if (fabsf(length - 1.0f) > 1e-5f || fabsf(dot) > 1e-5f ||
+            fabsf(t[3]) != 1.0f) {
+            code = 0;
+        }
+    }
+    obj_destroy(&mesh);
+    obj_destroy(&other);
+    return code;
+}
+
+/** Checks the bounds of a range against its faces' positions.
+ * @returns SUCCESS if they are exact, 0 otherwise.
+ */
+static int check_range(const mesh_t* mesh, const obj_range_t* range) {
+    float lower[4] = {0}, upper[4] = {0};
+    uint32_t seen = 0;
+    if (range->first_face + range->num_faces > mesh->num_faces) {
+        return 0;
+    }
+    for (uint32_t i = range->first_face; 
+        i < range->first_face + range->num_faces; i++) {
+        const uint32_t* indices = obj_face_indices(mesh, i);
+        for (uint32_t j = 0; j < obj_face_size(mesh, i); j++) {
+            const float* p = mesh->positions 
+                + (size_t)(indices[j] - 1) * mesh->vertex_dim;
+            for (uint32_t c = 0; c < mesh->vertex_dim; c++) {
+                lower[c] = !seen || p[c] < lower[c] ? p[c] : lower[c];
+                upper[c] = !seen || p[c] > upper[c] ? p[c] : upper[c];
+            }
+            seen++;
+        }
+    }
+    return memcmp(lower, range->aabb_min, sizeof lower) == 0 &&
+        memcmp(upper, range->aabb_max, sizeof upper) == 0 ? SUCCESS : 0;
+}
+
+/** Checks the box and sphere of a mesh and of its groups and objects 
+ * against its positions.
+ * @returns SUCCESS if the box is exact and the sphere holds every position,
+ * 0 otherwise.
+ */
+static int check_bounds(const mesh_t* mesh) {
+    float lower[4] = {0}, upper[4] = {0};
+    for (uint32_t i = 0; i < mesh->num_vertices; i++) {
+        const float* p = mesh->positions + (size_t)i * mesh->vertex_dim;
+        for (uint32_t c = 0; c < mesh->vertex_dim; c++) {
+            lower[c] = i == 0 || p[c] < lower[c] ? p[c] : lower[c];
+            upper[c] = i == 0 || p[c] > upper[c] ? p[c] : upper[c];
+        }
+    }
+    if (memcmp(lower, mesh->aabb_min, sizeof lower) != 0 ||
+        memcmp(upper, mesh->aabb_max, sizeof upper) != 0) {
+        return 0;
+    }
+    float extent = 0.0f;
+    for (uint32_t c = 0; c < 3 && c < mesh->vertex_dim; c++) {
+        float half = (upper[c] - lower[c]) * 0.5f;
+        extent += half * half;
+    }
+    // Ritter's sphere is at most a few percent larger than the box's.
+    if (mesh->num_vertices && (mesh->sphere_radius * mesh->sphere_radius 
+        < extent * 0.25f || mesh->sphere_radius * mesh->sphere_radius 
+        > extent * 1.2f + 1e-6f)) {
+        return 0;
+    }
+    for (uint32_t i = 0; i < mesh->num_vertices; i++) {
+        const float* p = mesh->positions + (size_t)i * mesh->vertex_dim;
+        float distance = 0.0f;
+        for (uint32_t c = 0; c < 3 && c < mesh->vertex_dim; c++) {
+            float d = p[c] - mesh->sphere_center[c];
+            distance += d * d;
+        }
+        if (sqrtf(distance) > mesh->sphere_radius) {
+            return 0;
+        }
+    }
+    for (uint32_t i = 0; i < mesh->num_groups; i++) {
+        if (check_range(mesh, &mesh->groups[i]) != SUCCESS) {
+            return 0;
+        }
+    }
+    for (uint32_t i = 0; i < mesh->num_objects; i++) {
+        if (check_range(mesh, &mesh->objects[i]) != SUCCESS) {
+            return 0;
+        }
+    }
+    for (uint32_t i = 0; i < mesh->num_materials; i++) {
+        if (check_range(mesh, &mesh->materials[i]) != SUCCESS) {
+            return 0;
+        }
+    }
+    return SUCCESS;
+}
+
+/** Checks the bounds of the file, then writes a strip of quads split into 
+ * groups and objects large enough to be read in several chunks, and checks 
+ * its ranges with and without triangulation and across the readers.
+ */
+int test_bounds(const char* fn) {
+    int code;
+    mesh_t mesh;
+    mesh_t parallel;
+    const char* strip_fn = "out/ranges.obj";
+    const uint32_t quads = 6000, leading = 3;
+    if ((code = obj_read(fn, &mesh)) != SUCCESS) {
+        return code;
+    }
+    code = check_bounds(&mesh);
+    obj_destroy(&mesh);
+    if (code != SUCCESS) {
+        return code;
+    }
+
+    FILE* file = fopen(strip_fn, "w");
+    if (!file) {
+        return INVALID_FILE;
+    }
+    for (uint32_t q = 0; q < quads; q++) {
+        if (q == leading) {
+            fprintf(file, "g unused\n");
+        }
+        if (q >= leading && (q - leading) % 1000 == 0) {
+            fprintf(file, "o obj%u\n", (q - leading) / 1000);
+        }
+        if (q >= leading && (q - leading) % 500 == 0) {
+            // The fifth group has no name.
+            if ((q - leading) / 500 == 4) {
+                fprintf(file, "g\n");
+            } else {
+                fprintf(file, "g part%u x\n", (q - leading) / 500);
+            }
+        }
+        fprintf(file, "v %u 0 %u\nv %u 0 0\nv %u 1 0\nv %u 1 -%u\n"
+            "f %u %u %u %u\n", q, q % 7, q + 1, q + 1, q, q % 5, 
+            4 * q + 1, 4 * q + 2, 4 * q + 3, 4 * q + 4);
+    }
+    fclose(file);
+    for (uint32_t triangulate = 0; triangulate < 2; triangulate++) {
+        uint32_t flags = triangulate ? OBJ_TRIANGULATE : 0;
+        uint32_t per_quad = triangulate ? 2 : 1;
+        if ((code = obj_read_ex(strip_fn, &mesh, flags)) != SUCCESS) {
+            return code;
+        }
+        if ((code = obj_read_parallel(strip_fn, &parallel, flags, 8)) 
+            != SUCCESS) {
+            obj_destroy(&mesh);
+            return code;
+        }
+        code = test_mesh_equal(&mesh, &parallel);
+        if (code == SUCCESS) {
+            code = check_bounds(&mesh);
+        }
+        if (code == SUCCESS && (mesh.num_groups != 12 || 
+            mesh.num_objects != 6)) {
+            code = 0;
+        }
+        for (uint32_t i = 0; i < mesh.num_groups && code == SUCCESS; i++) {
+            const obj_range_t* group = &mesh.groups[i];
+            uint32_t first = leading + i * 500;
+            uint32_t count = first + 500 <= quads ? 500 : quads - first;
+            char name[32];
+            sprintf(name, "part%u x", i);
+            if (strcmp(group->name, i == 4 ? "" : name) != 0 ||
+                group->first_face != first * per_quad || 
+                group->num_faces != count * per_quad) {
+                code = 0;
+            }
+        }
+        for (uint32_t i = 0; i < mesh.num_objects && code == SUCCESS; i++) {
+            const obj_range_t* object = &mesh.objects[i];
+            uint32_t first = leading + i * 1000;
+            uint32_t count = first + 1000 <= quads ? 1000 : quads - first;
+            char name[32];
+            sprintf(name, "obj%u", i);
+            if (strcmp(object->name, name) != 0 ||
+                object->first_face != first * per_quad || 
+                object->num_faces != count * per_quad ||
+                object->aabb_min[0] != (float)first || 
+                object->aabb_max[0] != (float)(first + count)) {
+                code = 0;
+            }
+        }
+        obj_destroy(&mesh);
+        obj_destroy(&parallel);
+        if (code != SUCCESS) {
+            return code;
+        }
+    }
+    return SUCCESS;
+}
+
+/** Intersects a ray with every triangle of a hierarchy, the slow way.
+ * @returns 1 if the ray hits any, with the least t in closest.
+ */
+static int brute_force_hit(const bvh_t* bvh, 
+    const bvh_ray_t* ray, 
+    float* closest) {
+    int found = 0;
+    for (uint32_t i = 0; i < bvh->num_triangles; i++) {
+        const float* v = bvh->vertices + 9 * (size_t)i;
+        const float* d = ray->direction;
+        float e1[3], e2[3], s[3], p[3], q[3];
+        for (int k = 0; k < 3; k++) {
+            e1[k] = v[3 + k] - v[k];
+            e2[k] = v[6 + k] - v[k];
+            s[k] = ray->origin[k] - v[k];
+        }
+        p[0] = d[1] * e2[2] - d[2] * e2[1];
+        p[1] = d[2] * e2[0] - d[0] * e2[2];
+        p[2] = d[0] * e2[1] - d[1] * e2[0];
+        float det = e1[0] * p[0] + e1[1] * p[1] + e1[2] * p[2];
+        if (det == 0.0f) {
+            continue;
+        }
+        float inv = 1.0f / det;
+        float a = (s[0] * p[0] + s[1] * p[1] + s[2] * p[2]) * inv;
+        q[0] = s[1] * e1[2] - s[2] * e1[1];
+        q[1] = s[2] * e1[0] - s[0] * e1[2];
+        q[2] = s[0] * e1[1] - s[1] * e1[0];
+        float b = (d[0] * q[0] + d[1] * q[1] + d[2] * q[2]) * inv;
+        float t = (e2[0] * q[0] + e2[1] * q[1] + e2[2] * q[2]) * inv;
+        if (a < 0.0f || a > 1.0f || b < 0.0f || a + b > 1.0f || 
+            t < ray->t_min || t > ray->t_max) {
+            continue;
+        }
+        if (!found || t < *closest) {
+            *closest = t;
+        }
+        found = 1;
+    }
+    return found;
+}
+
+/** Checks that every node bounds its children or triangles and that the 
+ * leaves hold every triangle once, in order.
+ */
+static int check_nodes(const bvh_t* bvh) {
+    uint32_t next = 0;
+    for (uint32_t i = 0; i < bvh->num_nodes; i++) {
+        const bvh_node_t* node = &bvh->nodes[i];
+        if (node->count == 0) {
+            const bvh_node_t* children[2] = { 
+                &bvh->nodes[i + 1], &bvh->nodes[node->offset] 
+            };
+            if (node->offset <= i + 1 || node->offset >= bvh->num_nodes) {
+                return 0;
+            }
+            for (int c = 0; c < 2; c++) {
+                for (int k = 0; k < 3; k++) {
+                    if (children[c]->lower[k] < node->lower[k] || 
+                        children[c]->upper[k] > node->upper[k]) {
+                        return 0;
+                    }
+                }
+            }
+            continue;
+        }
+        if (node->offset != next) {
+            return 0;
+        }
+        next += node->count;
+        for (uint32_t j = node->offset * 9; j < next * 9; j++) {
+            if (bvh->vertices[j] < node->lower[j % 3] || 
+                bvh->vertices[j] > node->upper[j % 3]) {
+                return 0;
+            }
+        }
+    }
+    return next == bvh->num_triangles ? SUCCESS : 0;
+}
+
+/** Builds the hierarchy of the file on one thread and on four, which must 
+ * agree, and casts rays and segments through it against every triangle.
+ */
+int test_bvh(const char* fn) {
+    int code;
+    mesh_t mesh;
+    bvh_t bvhs[2];
+    if ((code = obj_read(fn, &mesh)) != SUCCESS) {
+        return code;
+    }
+    code = bvh_build(&mesh, 1, &bvhs[0]);
+    if (code != (mesh.face_dim > 3 ? INVALID_DIMS : SUCCESS)) {
+        obj_destroy(&mesh);
+        return 0;
+    }
+    bvh_destroy(&bvhs[0]);
+    obj_destroy(&mesh);
+    if ((code = obj_read_ex(fn, &mesh, OBJ_TRIANGULATE)) != SUCCESS) {
+        return code;
+    }
+    if ((code = bvh_build(&mesh, 1, &bvhs[0])) != SUCCESS) {
+        obj_destroy(&mesh);
+        return code;
+    }
+    if ((code = bvh_build(&mesh, 4, &bvhs[1])) != SUCCESS) {
+        bvh_destroy(&bvhs[0]);
+        obj_destroy(&mesh);
+        return code;
+    }
+    const bvh_t* bvh = &bvhs[0];
+    if (bvh->num_nodes != bvhs[1].num_nodes || 
+        bvh->depth != bvhs[1].depth ||
+        bvh->num_triangles != mesh.num_faces ||
+        memcmp(bvh->nodes, bvhs[1].nodes, 
+        bvh->num_nodes * sizeof *bvh->nodes) != 0 ||
+        memcmp(bvh->faces, bvhs[1].faces, 
+        bvh->num_triangles * sizeof *bvh->faces) != 0 ||
+        check_nodes(bvh) != SUCCESS) {
+        code = 0;
+    }
+    uint32_t state = 12345;
+    for (uint32_t i = 0; i < 500 && code == SUCCESS; i++) {
+        float r[6];
+        for (int j = 0; j < 6; j++) {
+            state = state * 1664525u + 1013904223u;
+            r[j] = (float)(state >> 8) / 16777216.0f;
+        }
+        // From outside the bounding sphere toward a point in the box, and
+        // on the 17th ray away from it.
+        float from[3], to[3], length = 0.0f;
+        for (int k = 0; k < 3; k++) {
+            from[k] = r[k] - 0.5f;
+            length += from[k] * from[k];
+        }
+        length = sqrtf(length);
+        for (int k = 0; k < 3; k++) {
+            from[k] = mesh.sphere_center[k] + from[k] / length 
+                * 2.0f * mesh.sphere_radius;
+            to[k] = mesh.aabb_min[k] + r[3 + k] 
+                * (mesh.aabb_max[k] - mesh.aabb_min[k]);
+        }
+        bvh_ray_t ray;
+        bvh_segment(from, to, &ray);
+        if (i % 17 == 0) {
+            for (int k = 0; k < 3; k++) {
+                ray.direction[k] = -ray.direction[k];
+            }
+        }
+        float expected = 0.0f;
+        int segment = brute_force_hit(bvh, &ray, &expected);
+        if (bvh_any_hit(bvh, &ray) != segment) {
+            code = 0;
+        }
+        ray.t_max = INFINITY;
+        bvh_hit_t hit;
+        int found = brute_force_hit(bvh, &ray, &expected);
+        if (bvh_closest_hit(bvh, &ray, &hit) != found || 
+            bvh_any_hit(bvh, &ray) != found ||
+            (found && (hit.t != expected || hit.face >= mesh.num_faces ||
+            hit.u < 0.0f || hit.v < 0.0f || hit.u + hit.v > 1.0f))) {
+            code = 0;
+        }
+    }
+    bvh_destroy(&bvhs[0]);
+    bvh_destroy(&bvhs[1]);
+    obj_destroy(&mesh);
+    return code;
+}
+
+/** Tests the hull of a file's positions: every position lies behind every
+ * face, the hull is a closed triangulated sphere that obj_is_convex accepts,
+ * and it does not depend on the thread count.
+ */
+int test_hull(const char* fn) {
+    int code;
+    mesh_t mesh;
+    mesh_t hulls[2];
+    if ((code = obj_read(fn, &mesh)) != SUCCESS) {
+        return code;
+    }
+    if ((code = hull_build(&mesh, 1, &hulls[0])) != SUCCESS) {
+        obj_destroy(&mesh);
+        return code;
+    }
+    if ((code = hull_build(&mesh, 4, &hulls[1])) != SUCCESS) {
+        obj_destroy(&hulls[0]);
+        obj_destroy(&mesh);
+        return code;
+    }
+    const mesh_t* hull = &hulls[0];
+    if (test_mesh_equal(hull, &hulls[1]) != SUCCESS ||
+        hull->num_faces != 2 * hull->num_vertices - 4 ||
+        hull->num_vertices > mesh.num_vertices ||
+        !obj_is_convex(hull)) {
+        code = 0;
+    }
+    float scale = 0.0f;
+    for (int k = 0; k < 3; k++) {
+        scale += fmaxf(fabsf(mesh.aabb_min[k]), fabsf(mesh.aabb_max[k]));
+    }
+    // A convex mesh's positions all lie on its hull.
+    int convex = obj_is_convex(&mesh);
+    for (uint32_t i = 0; i < mesh.num_vertices && code == SUCCESS; i++) {
+        const float* p = mesh.positions + (size_t)i * mesh.vertex_dim;
+        float nearest = INFINITY;
+        for (uint32_t f = 0; f < hull->num_faces; f++) {
+            const uint32_t* v = obj_face_indices(hull, f);
+            const float* a = hull->positions + 3 * (size_t)(v[0] - 1);
+            const float* b = hull->positions + 3 * (size_t)(v[1] - 1);
+            const float* c = hull->positions + 3 * (size_t)(v[2] - 1);
+            float ab[3], ac[3], n[3];
+            for (int k = 0; k < 3; k++) {
+                ab[k] = b[k] - a[k];
+                ac[k] = c[k] - a[k];
+            }
+            n[0] = ab[1] * ac[2] - ab[2] * ac[1];
+            n[1] = ab[2] * ac[0] - ab[0] * ac[2];
+            n[2] = ab[0] * ac[1] - ab[1] * ac[0];
+            float length = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            float d = ((p[0] - a[0]) * n[0] + (p[1] - a[1]) * n[1] 
+                + (p[2] - a[2]) * n[2]) / length;
+            if (d > 1e-5f * scale) {
+                code = 0;
+            }
+            nearest = fminf(nearest, fabsf(d));
+        }
+        if (convex && nearest > 1e-5f * scale) {
+            code = 0;
+        }
+    }
+    obj_destroy(&hulls[0]);
+    obj_destroy(&hulls[1]);
+    obj_destroy(&mesh);
+    return code;
+}
+
+/** Tests obj_is_convex on small solids: a cube either way round, dented,
+ * open, and beside another, and that flat points have no hull.
+ */
+int test_convexity(void) {
+    static const char cube[] =
+        "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\n"
+        "v 0 0 1\nv 1 0 1\nv 1 1 1\nv 0 1 1\n";
+    static const char outward[] =
+        "f 1 4 3 2\nf 5 6 7 8\nf 1 2 6 5\nf 2 3 7 6\nf 3 4 8 7\nf 4 1 5 8\n";
+    static const char inward[] =
+        "f 2 3 4 1\nf 8 7 6 5\nf 5 6 2 1\nf 6 7 3 2\nf 7 8 4 3\nf 8 5 1 4\n";
+    static const char open[] =
+        "f 1 4 3 2\nf 5 6 7 8\nf 1 2 6 5\nf 2 3 7 6\nf 3 4 8 7\n";
+    // The top made a pyramid pushed into the cube.
+    static const char dented[] =
+        "v 0.5 0.5 0.5\n"
+        "f 1 4 3 2\nf 1 2 6 5\nf 2 3 7 6\nf 3 4 8 7\nf 4 1 5 8\n"
+        "f 5 6 9\nf 6 7 9\nf 7 8 9\nf 8 5 9\n";
+    static const char twice[] =
+        "v 3 3 3\nv 4 3 3\nv 4 4 3\nv 3 4 3\n"
+        "v 3 3 4\nv 4 3 4\nv 4 4 4\nv 3 4 4\n"
+        "f 1 4 3 2\nf 5 6 7 8\nf 1 2 6 5\nf 2 3 7 6\nf 3 4 8 7\nf 4 1 5 8\n"
+        "f 9 12 11 10\nf 13 14 15 16\nf 9 10 14 13\nf 10 11 15 14\n"
+        "f 11 12 16 15\nf 12 9 13 16\n";
+    static const char flat[] =
+        "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nv 0.5 0.5 0\nf 1 2 3 4\n";
+    const char* bodies[] = { outward, inward, open, dented, twice };
+    const int expected[] = { 1, 1, 0, 0, 0 };
+    char data[1024];
+    mesh_t mesh, hull;
+    int code;
+    for (int i = 0; i < 5; i++) {
+        snprintf(data, sizeof data, "%s%s", cube, bodies[i]);
+        if ((code = obj_read_memory(data, strlen(data), &mesh)) != SUCCESS) {
+            return code;
+        }
+        code = obj_is_convex(&mesh) == expected[i] ? SUCCESS : 0;
+        if (code == SUCCESS && 
+            (code = hull_build(&mesh, 0, &hull)) == SUCCESS) {
+            // Only a cube's corners are on its hull.
+            if ((i < 4 && hull.num_vertices != 8) ||
+                hull.num_faces != 2 * hull.num_vertices - 4 ||
+                !obj_is_convex(&hull)) {
+                code = 0;
+            }
+            obj_destroy(&hull);
+        }
+        obj_destroy(&mesh);
+        if (code != SUCCESS) {
+            return code;
+        }
+    }
+    if ((code = obj_read_memory(flat, sizeof flat - 1, &mesh)) != SUCCESS) {
+        return code;
+    }
+    code = hull_build(&mesh, 0, &hull) == INVALID_DIMS && 
+        hull.num_faces == 0 && !obj_is_convex(&mesh) ? SUCCESS : 0;
+    obj_destroy(&mesh);
+    return code;
+}
+
+/** Checks that the faces of every material range point at its material, 
+ * which has its name, and that faces before the first range have none.
+ */
+static int check_materials(const mesh_t* mesh) {
+    uint32_t first = mesh->num_materials ? mesh->materials[0].first_face 
+        : mesh->num_faces;
+    for (uint32_t f = 0; f < first; f++) {
+        if (mesh->face_data[f].material) {
+            return 0;
+        }
+    }
+    for (uint32_t i = 0; i < mesh->num_materials; i++) {
+        const obj_range_t* range = &mesh->materials[i];
+        if ((range->material && 
+            strcmp(range->material->name, range->name) != 0) ||
+            (i + 1 < mesh->num_materials && range->first_face 
+            + range->num_faces != range[1].first_face)) {
+            return 0;
+        }
+        for (uint32_t f = range->first_face; 
+            f < range->first_face + range->num_faces; f++) {
+            if (mesh->face_data[f].material != range->material) {
+                return 0;
+            }
+        }
+    }
+    return SUCCESS;
+}
+
+/** Checks the materials of the file, then writes a strip of quads that 
+ * switches between three materials of a library and one missing from it, 
+ * across groups, and checks its material ranges across the readers, and 
+ * sorted by material.
+ */
+int test_materials(const char* fn) {
+    int code;
+    mesh_t mesh;
+    mesh_t other;
+    const char* strip_fn = "out/materials.obj";
+    const char* library_fn = "out/materials.mtl";
+    const char* names[] = { "red", "green", "blue", "missing" };
+    const uint32_t quads = 6000, leading = 2, run = 250, group = 400;
+    if ((code = obj_read(fn, &mesh)) != SUCCESS) {
+        return code;
+    }
+    code = check_materials(&mesh);
+    obj_destroy(&mesh);
+    if (code != SUCCESS) {
+        return code;
+    }
+
+    FILE* file = fopen(library_fn, "w");
+    if (!file) {
+        return INVALID_FILE;
+    }
+    fprintf(file, "newmtl red\nKd 1 0 0\nnewmtl green\nKd 0 1 0\n"
+        "newmtl blue\nKd 0 0 1\n");
+    fclose(file);
+    if (!(file = fopen(strip_fn, "w"))) {
+        return INVALID_FILE;
+    }
+    fprintf(file, "mtllib materials.mtl\n");
+    for (uint32_t q = 0; q < quads; q++) {
+        if (q >= leading && (q - leading) % run == 0) {
+            fprintf(file, "usemtl %s\n", names[(q - leading) / run % 4]);
+        }
+        if (q >= leading && (q - leading) % group == 0) {
+            fprintf(file, "g part%u\n", (q - leading) / group);
+        }
+        fprintf(file, "v %u 0 %u\nv %u 0 0\nv %u 1 0\nv %u 1 -%u\n"
+            "f %u %u %u %u\n", q, q % 7, q + 1, q + 1, q, q % 5, 
+            4 * q + 1, 4 * q + 2, 4 * q + 3, 4 * q + 4);
+    }
+    fclose(file);
+    const uint32_t runs = (quads - leading + run - 1) / run;
+    for (uint32_t variant = 0; variant < 4; variant++) {
+        uint32_t flags = (variant & 1 ? OBJ_TRIANGULATE : 0) 
+            | (variant & 2 ? OBJ_SORT_MATERIALS : 0);
+        uint32_t per_quad = variant & 1 ? 2 : 1;
+        if ((code = obj_read_ex(strip_fn, &mesh, flags)) != SUCCESS) {
+            return code;
+        }
+        if ((code = obj_read_parallel(strip_fn, &other, flags, 8)) 
+            != SUCCESS) {
+            obj_destroy(&mesh);
+            return code;
+        }
+        code = test_mesh_equal(&mesh, &other);
+        if (code == SUCCESS) {
+            code = check_bounds(&mesh);
+        }
+        if (code == SUCCESS) {
+            code = check_materials(&mesh);
+        }
+        if (code == SUCCESS && mesh.num_materials != (variant & 2 ? 4 : runs)) {
+            code = 0;
+        }
+        for (uint32_t i = 0; i < mesh.num_materials && code == SUCCESS; i++) {
+            const obj_range_t* range = &mesh.materials[i];
+            if (strcmp(range->name, names[i % 4]) != 0 || 
+                !range->material != (i % 4 == 3)) {
+                code = 0;
+            }
+            if (variant & 2) {
+                continue;
+            }
+            uint32_t first = leading + i * run;
+            uint32_t count = first + run <= quads ? run : quads - first;
+            if (range->first_face != first * per_quad || 
+                range->num_faces != count * per_quad) {
+                code = 0;
+            }
+        }
+        // Sorted, the faces of every group and material stay in file order,
+        // and keep their group.
+        for (uint32_t f = 0; variant & 2 && f < mesh.num_faces && 
+            code == SUCCESS; f++) {
+            uint32_t q = (obj_face_indices(&mesh, f)[0] - 1) / 4;
+            uint32_t next = f + 1 < mesh.num_faces 
+                ? (obj_face_indices(&mesh, f + 1)[0] - 1) / 4 : quads;
+            const mtl_t* material = mesh.face_data[f].material;
+            const mtl_t* following = f + 1 < mesh.num_faces 
+                ? mesh.face_data[f + 1].material : NULL;
+            const obj_range_t* in = NULL;
+            for (uint32_t g = 0; g < mesh.num_groups; g++) {
+                if (f >= mesh.groups[g].first_face && f < 
+                    mesh.groups[g].first_face + mesh.groups[g].num_faces) {
+                    in = &mesh.groups[g];
+                }
+            }
+            char name[32];
+            sprintf(name, "part%u", q >= leading ? (q - leading) / group : 0);
+            if ((q < leading) != !in || (in && strcmp(in->name, name) != 0) ||
+                (material == following && next < q)) {
+                code = 0;
+            }
+        }
+        obj_destroy(&mesh);
+        obj_destroy(&other);
+        if (code != SUCCESS) {
+            return code;
+        }
+    }
+    return SUCCESS;
+}
 
 int main(int argc, char** argv) {
     mesh_t mesh;
@@ -29,6 +2479,133 @@ int main(int argc, char** argv) {
     obj_fwrite(&mesh, "output.txt");
     obj_destroy(&mesh);
 
+    if ((code = test_single_pass(fn)) != SUCCESS) {
+        printf("Single-pass read failed\n");
+        return 1;
+    }
+
+    if ((code = test_mmap(fn)) != SUCCESS) {
+        printf("Memory-mapped read failed\n");
+        return 1;
+    }
+
+    if ((code = test_parallel(fn, 0)) != SUCCESS) {
+        printf("Parallel read failed\n");
+        return 1;
+    }
+
+    if ((code = test_parallel_relative()) != SUCCESS) {
+        printf("Parallel read with relative indices failed\n");
+        return 1;
+    }
+
+    if ((code = test_classify(fn)) != SUCCESS ||
+        (code = test_classify_edges()) != SUCCESS) {
+        printf("Line classification failed\n");
+        return 1;
+    }
+
+    if ((code = test_face_indices()) != SUCCESS) {
+        printf("Face index resolution failed\n");
+        return 1;
+    }
+
+    if ((code = test_mixed_arity()) != SUCCESS) {
+        printf("Mixed face arity read failed\n");
+        return 1;
+    }
+
+    if ((code = test_stream(fn)) != SUCCESS) {
+        printf("Streaming parse failed\n");
+        return 1;
+    }
+
+    if ((code = test_memory_and_fd(fn)) != SUCCESS) {
+        printf("Memory and descriptor reads failed\n");
+        return 1;
+    }
+
+    if ((code = test_triangulate()) != SUCCESS) {
+        printf("Triangulation failed\n");
+        return 1;
+    }
+
+    if ((code = test_weld(fn)) != SUCCESS) {
+        printf("Vertex welding failed\n");
+        return 1;
+    }
+
+    if ((code = test_pack(fn)) != SUCCESS) {
+        printf("Interleaved packing failed\n");
+        return 1;
+    }
+
+    if ((code = test_quantize(fn)) != SUCCESS) {
+        printf("Attribute quantization failed\n");
+        return 1;
+    }
+
+    if ((code = test_index_buffer(fn)) != SUCCESS) {
+        printf("Index buffer width selection failed\n");
+        return 1;
+    }
+
+    if ((code = test_vertex_cache(fn)) != SUCCESS) {
+        printf("Vertex cache optimization failed\n");
+        return 1;
+    }
+
+    if ((code = test_vertex_fetch(fn)) != SUCCESS) {
+        printf("Vertex fetch optimization failed\n");
+        return 1;
+    }
+
+    if ((code = test_simplify(fn)) != SUCCESS) {
+        printf("Simplification failed\n");
+        return 1;
+    }
+
+    if ((code = test_meshlets(fn)) != SUCCESS) {
+        printf("Meshlet partitioning failed\n");
+        return 1;
+    }
+
+    if ((code = test_smoothing_groups()) != SUCCESS) {
+        printf("Smoothing groups failed\n");
+        return 1;
+    }
+
+    if ((code = test_normals(fn)) != SUCCESS) {
+        printf("Normal generation failed\n");
+        return 1;
+    }
+
+    if ((code = test_tangents(fn)) != SUCCESS) {
+        printf("Tangent generation failed\n");
+        return 1;
+    }
+
+    if ((code = test_bounds(fn)) != SUCCESS) {
+        printf("Bounds failed\n");
+        return 1;
+    }
+
+    if ((code = test_bvh(fn)) != SUCCESS) {
+        printf("Bounding volume hierarchy failed\n");
+        return 1;
+    }
+
+    if ((code = test_materials(fn)) != SUCCESS) {
+        printf("Material ranges failed\n");
+        return 1;
+    }
+
+    if ((code = test_hull(fn)) != SUCCESS || 
+        (code = test_convexity()) != SUCCESS) {
+        printf("Convex hull failed\n");
+        return 1;
+    }
+
     getchar();
 
     return 0;